@@ -0,0 +1,251 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_BATCHPRODUCERCONSUMERQUEUE_H
+#define TTT_BATCHPRODUCERCONSUMERQUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <stdint.h>
+#include <utility>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/*
+ * One producer, one consumer queue in the spirit of
+ * folly::ProducerConsumerQueue, tuned for streaming:
+ *
+ *  - producer and consumer indices live on separate cache lines, and each
+ *    side keeps a private copy of the other side's index so it only touches
+ *    the shared line when its copy says the queue is full (or empty)
+ *  - writeN()/readN() move a batch and publish the index once
+ *  - with Blocking set, waitNotEmpty()/waitNotFull() sleep on a futex.
+ *    Publishing then adds one fence and a flag load per call (not per
+ *    record); without Blocking there is no extra code at all.
+ *
+ * All size slots are usable; size must be a power of two.
+ */
+template<class T, bool Blocking = false>
+class BatchProducerConsumerQueue {
+public:
+    typedef T value_type;
+
+    BatchProducerConsumerQueue(const BatchProducerConsumerQueue&) = delete;
+    BatchProducerConsumerQueue& operator = (const BatchProducerConsumerQueue&) = delete;
+
+    explicit BatchProducerConsumerQueue(uint32_t size)
+        : size_(size)
+        , mask_(size - 1)
+        , records_(static_cast<T*>(std::malloc(sizeof(T) * size)))
+        , writeIndex_(0)
+        , cachedRead_(0)
+        , readIndex_(0)
+        , cachedWrite_(0)
+        , consumerWaiting_(0)
+        , producerWaiting_(0)
+    {
+        assert(size >= 2 && (size & (size - 1)) == 0);
+        if (!records_) {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~BatchProducerConsumerQueue() {
+        uint32_t read = readIndex_.load(std::memory_order_relaxed);
+        uint32_t end = writeIndex_.load(std::memory_order_relaxed);
+        for (; read != end; read++) {
+            records_[read & mask_].~T();
+        }
+        std::free(records_);
+    }
+
+    template<class ...Args>
+    bool write(Args&&... recordArgs) {
+        uint32_t const currentWrite = writeIndex_.load(std::memory_order_relaxed);
+        if (currentWrite - cachedRead_ == size_) {
+            cachedRead_ = readIndex_.load(std::memory_order_acquire);
+            if (currentWrite - cachedRead_ == size_) {
+                // queue is full
+                return false;
+            }
+        }
+        new (&records_[currentWrite & mask_]) T(std::forward<Args>(recordArgs)...);
+        publishWrite(currentWrite + 1);
+        return true;
+    }
+
+    // Move up to n records in, returns how many fit
+    size_t writeN(T* records, size_t n) {
+        uint32_t const currentWrite = writeIndex_.load(std::memory_order_relaxed);
+        size_t space = size_ - (currentWrite - cachedRead_);
+        if (space < n) {
+            cachedRead_ = readIndex_.load(std::memory_order_acquire);
+            space = size_ - (currentWrite - cachedRead_);
+        }
+        if (n > space) {
+            n = space;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+            new (&records_[(currentWrite + i) & mask_]) T(std::move(records[i]));
+        }
+        publishWrite(currentWrite + (uint32_t) n);
+        return n;
+    }
+
+    // move the value at the front of the queue to given variable
+    bool read(T& record) {
+        uint32_t const currentRead = readIndex_.load(std::memory_order_relaxed);
+        if (currentRead == cachedWrite_) {
+            cachedWrite_ = writeIndex_.load(std::memory_order_acquire);
+            if (currentRead == cachedWrite_) {
+                // queue is empty
+                return false;
+            }
+        }
+        record = std::move(records_[currentRead & mask_]);
+        records_[currentRead & mask_].~T();
+        publishRead(currentRead + 1);
+        return true;
+    }
+
+    // Move up to n records out, returns how many were available
+    size_t readN(T* records, size_t n) {
+        uint32_t const currentRead = readIndex_.load(std::memory_order_relaxed);
+        size_t avail = cachedWrite_ - currentRead;
+        if (avail < n) {
+            cachedWrite_ = writeIndex_.load(std::memory_order_acquire);
+            avail = cachedWrite_ - currentRead;
+        }
+        if (n > avail) {
+            n = avail;
+        }
+        if (n == 0) {
+            return 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+            T& slot = records_[(currentRead + i) & mask_];
+            records[i] = std::move(slot);
+            slot.~T();
+        }
+        publishRead(currentRead + (uint32_t) n);
+        return n;
+    }
+
+    // Consumer: sleep until a record is available
+    void waitNotEmpty() {
+        static_assert(Blocking, "waitNotEmpty needs a Blocking queue");
+        uint32_t const currentRead = readIndex_.load(std::memory_order_relaxed);
+        for (;;) {
+            uint32_t w = writeIndex_.load(std::memory_order_acquire);
+            if (w != currentRead) {
+                cachedWrite_ = w;
+                return;
+            }
+            consumerWaiting_.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (writeIndex_.load(std::memory_order_relaxed) == w) {
+                futex(&writeIndex_, FUTEX_WAIT_PRIVATE, w);
+            }
+            consumerWaiting_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer: sleep until a slot is free
+    void waitNotFull() {
+        static_assert(Blocking, "waitNotFull needs a Blocking queue");
+        uint32_t const currentWrite = writeIndex_.load(std::memory_order_relaxed);
+        for (;;) {
+            uint32_t r = readIndex_.load(std::memory_order_acquire);
+            if (currentWrite - r != size_) {
+                cachedRead_ = r;
+                return;
+            }
+            producerWaiting_.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (readIndex_.load(std::memory_order_relaxed) == r) {
+                futex(&readIndex_, FUTEX_WAIT_PRIVATE, r);
+            }
+            producerWaiting_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Keep the index lines apart on the heap too, without aligned new
+    static void* operator new(size_t size) {
+        void *p = NULL;
+        if (posix_memalign(&p, 64, size) != 0) {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    static void operator delete(void *p) {
+        std::free(p);
+    }
+
+    bool isEmpty() const {
+        return readIndex_.load(std::memory_order_acquire) ==
+               writeIndex_.load(std::memory_order_acquire);
+    }
+
+    bool isFull() const {
+        return writeIndex_.load(std::memory_order_acquire) -
+               readIndex_.load(std::memory_order_acquire) == size_;
+    }
+
+    // Exact when called by either side, a guess from anywhere else
+    size_t sizeGuess() const {
+        return writeIndex_.load(std::memory_order_acquire) -
+               readIndex_.load(std::memory_order_acquire);
+    }
+
+    uint32_t capacity() const { return size_; }
+
+private:
+    static void futex(std::atomic<uint32_t> *addr, int op, uint32_t val) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), op, val, NULL, NULL, 0);
+    }
+
+    void publishWrite(uint32_t index) {
+        writeIndex_.store(index, std::memory_order_release);
+        if (Blocking) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (consumerWaiting_.load(std::memory_order_relaxed)) {
+                futex(&writeIndex_, FUTEX_WAKE_PRIVATE, 1);
+            }
+        }
+    }
+
+    void publishRead(uint32_t index) {
+        readIndex_.store(index, std::memory_order_release);
+        if (Blocking) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (producerWaiting_.load(std::memory_order_relaxed)) {
+                futex(&readIndex_, FUTEX_WAKE_PRIVATE, 1);
+            }
+        }
+    }
+
+    const uint32_t size_;
+    const uint32_t mask_;
+    T* const records_;
+
+    // producer's line
+    alignas(64) std::atomic<uint32_t> writeIndex_;
+    uint32_t cachedRead_;
+
+    // consumer's line
+    alignas(64) std::atomic<uint32_t> readIndex_;
+    uint32_t cachedWrite_;
+
+    alignas(64) std::atomic<uint32_t> consumerWaiting_;
+    std::atomic<uint32_t> producerWaiting_;
+};
+
+#endif //TTT_BATCHPRODUCERCONSUMERQUEUE_H
@@ -0,0 +1,168 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "Bitplane.h"
+#include <string.h>
+#include <assert.h>
+#include <tmmintrin.h>
+
+Bitplanes::Bitplanes(unsigned channels)
+    : firstSample(0)
+    , numChannels(channels)
+    , numSamples(0)
+    , numWords(0)
+    , stride(2)
+    , storage(channels * 2) {
+    assert(channels > 0 && channels <= BITPLANE_MAX_CHANNELS);
+}
+
+void Bitplanes::resize(size_t samples) {
+    numSamples = samples;
+    numWords = (samples + BITPLANE_WORD_SAMPLES - 1) / BITPLANE_WORD_SAMPLES;
+    /* Keep every plane 16 byte sized so SSE loops never straddle planes */
+    size_t need = (numWords + 1) & ~(size_t)1;
+    if (need > stride) {
+        stride = need;
+        storage.assign(numChannels * stride, 0);
+    }
+}
+
+void Bitplanes::reset(size_t samples) {
+    resize(samples);
+    memset(&storage[0], 0, storage.size() * sizeof(uint64_t));
+}
+
+/* Transpose 16 samples into one 16 bit word per channel */
+static inline void transpose16(const uint16_t *src, uint16_t *out) {
+    static const __m128i split = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), split);
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + 8)), split);
+    /* Low bytes of all 16 samples, and high bytes */
+    __m128i lo = _mm_unpacklo_epi64(a, b);
+    __m128i hi = _mm_unpackhi_epi64(a, b);
+
+    for (int i = 7; i >= 0; i--) {
+        out[i] = (uint16_t) _mm_movemask_epi8(lo);
+        out[i + 8] = (uint16_t) _mm_movemask_epi8(hi);
+        lo = _mm_slli_epi64(lo, 1);
+        hi = _mm_slli_epi64(hi, 1);
+    }
+}
+
+void bitplane_from_samples(const uint16_t *src, size_t count, Bitplanes &dst) {
+    uint16_t words[BITPLANE_MAX_CHANNELS];
+    unsigned channels = dst.channels();
+    uint64_t *planes[BITPLANE_MAX_CHANNELS];
+    size_t i, w;
+
+    assert(src != NULL);
+    dst.resize(count);
+    for (unsigned ch = 0; ch < channels; ch++) {
+        planes[ch] = dst.plane(ch);
+    }
+
+    /* Whole 64 sample words */
+    for (w = 0; (w + 1) * 64 <= count; w++) {
+        uint64_t acc[BITPLANE_MAX_CHANNELS] = {0};
+        for (unsigned g = 0; g < 4; g++) {
+            transpose16(src + w * 64 + g * 16, words);
+            for (unsigned ch = 0; ch < channels; ch++) {
+                acc[ch] |= (uint64_t) words[ch] << (16 * g);
+            }
+        }
+        for (unsigned ch = 0; ch < channels; ch++) {
+            planes[ch][w] = acc[ch];
+        }
+    }
+
+    /* Tail, zero padded */
+    if (w * 64 < count) {
+        for (unsigned ch = 0; ch < channels; ch++) {
+            planes[ch][w] = 0;
+        }
+        for (i = w * 64; i < count; i++) {
+            for (unsigned ch = 0; ch < channels; ch++) {
+                planes[ch][w] |= (uint64_t) ((src[i] >> ch) & 1) << (i & 63);
+            }
+        }
+    }
+}
+
+void bitplane_to_samples(const Bitplanes &src, uint16_t *dst) {
+    uint16_t words[BITPLANE_MAX_CHANNELS];
+    unsigned channels = src.channels();
+    size_t count = src.samples();
+    size_t i, w;
+
+    assert(dst != NULL);
+    /* A 16x16 bit transpose is its own inverse */
+    memset(words, 0, sizeof(words));
+    for (w = 0; (w + 1) * 64 <= count; w++) {
+        for (unsigned g = 0; g < 4; g++) {
+            for (unsigned ch = 0; ch < channels; ch++) {
+                words[ch] = (uint16_t) (src.plane(ch)[w] >> (16 * g));
+            }
+            transpose16(words, dst + w * 64 + g * 16);
+        }
+    }
+
+    for (i = w * 64; i < count; i++) {
+        uint16_t s = 0;
+        for (unsigned ch = 0; ch < channels; ch++) {
+            s |= (uint16_t) (src.bit(ch, i) << ch);
+        }
+        dst[i] = s;
+    }
+}
+
+void bitplane_samples16(const Bitplanes &src, size_t first, uint16_t *dst) {
+    uint16_t words[BITPLANE_MAX_CHANNELS];
+
+    assert(first % 16 == 0);
+    memset(words, 0, sizeof(words));
+    for (unsigned ch = 0; ch < src.channels(); ch++) {
+        words[ch] = (uint16_t) (src.plane(ch)[first >> 6] >> (first & 63));
+    }
+    transpose16(words, dst);
+}
+
+void bitplane_from_logic16(const uint8_t *raw, size_t length, unsigned numChannels, Bitplanes &dst) {
+    size_t blocks = length / (2 * numChannels);
+
+    assert(length % (2 * numChannels) == 0);
+    assert(numChannels == dst.channels());
+    dst.reset(blocks * 16);
+
+    for (size_t b = 0; b < blocks; b++) {
+        const uint8_t *p = raw + b * 2 * numChannels;
+        for (unsigned ch = 0; ch < numChannels; ch++) {
+            uint64_t word = (uint64_t) (p[2 * ch] | (p[2 * ch + 1] << 8));
+            dst.plane(ch)[b >> 2] |= word << (16 * (b & 3));
+        }
+    }
+}
+
+void bitplane_to_logic16(const Bitplanes &src, uint8_t *dst) {
+    size_t blocks = src.samples() / 16;
+    unsigned numChannels = src.channels();
+
+    for (size_t b = 0; b < blocks; b++) {
+        for (unsigned ch = 0; ch < numChannels; ch++) {
+            uint16_t word = (uint16_t) (src.plane(ch)[b >> 2] >> (16 * (b & 3)));
+            *dst++ = (uint8_t) word;
+            *dst++ = (uint8_t) (word >> 8);
+        }
+    }
+}
+
+void bitplane_logic16_samples(const uint8_t *block, unsigned numChannels, uint16_t *dst) {
+    uint16_t words[BITPLANE_MAX_CHANNELS];
+
+    assert(numChannels <= BITPLANE_MAX_CHANNELS);
+    memset(words, 0, sizeof(words));
+    for (unsigned ch = 0; ch < numChannels; ch++) {
+        words[ch] = (uint16_t) (block[2 * ch] | (block[2 * ch + 1] << 8));
+    }
+    transpose16(words, dst);
+}
@@ -0,0 +1,77 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_BITPLANE_H
+#define TTT_BITPLANE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define BITPLANE_MAX_CHANNELS 16
+#define BITPLANE_WORD_SAMPLES 64
+
+/*
+ * Per-channel bit planes of a block of samples. Sample i of a channel is
+ * bit (i % 64) of word (i / 64) of that channel's plane, so bit 0 is the
+ * earliest sample. Planes are padded with zeros up to a whole word.
+ */
+class Bitplanes {
+public:
+    explicit Bitplanes(unsigned channels = BITPLANE_MAX_CHANNELS);
+
+    /* Resize to hold samples; contents are left undefined */
+    void resize(size_t samples);
+    /* Resize and zero all planes */
+    void reset(size_t samples);
+
+    unsigned channels() const { return numChannels; }
+    size_t samples() const { return numSamples; }
+    size_t words() const { return numWords; }
+
+    uint64_t *plane(unsigned ch) { return &storage[ch * stride]; }
+    const uint64_t *plane(unsigned ch) const { return &storage[ch * stride]; }
+
+    bool bit(unsigned ch, size_t i) const {
+        return (plane(ch)[i >> 6] >> (i & 63)) & 1;
+    }
+
+    /* Absolute index of sample 0 in the capture stream */
+    uint64_t firstSample;
+
+private:
+    unsigned numChannels;
+    size_t numSamples;
+    size_t numWords;
+    size_t stride;
+    std::vector<uint64_t> storage;
+};
+
+/* Transpose interleaved 16-bit sample words (bit n = channel n) to planes */
+void bitplane_from_samples(const uint16_t *src, size_t count, Bitplanes &dst);
+
+/* Transpose planes back to interleaved sample words, dst holds dst.samples() */
+void bitplane_to_samples(const Bitplanes &src, uint16_t *dst);
+
+/* Transpose the 16 samples from first, a multiple of 16, back to sample words */
+void bitplane_samples16(const Bitplanes &src, size_t first, uint16_t *dst);
+
+/*
+ * Gather planes from Logic16 transfer data. The device sends blocks of 16
+ * samples as one little endian word per enabled channel, so this is a pure
+ * gather with no bit transpose. length must be a multiple of 2 * numChannels.
+ */
+void bitplane_from_logic16(const uint8_t *raw, size_t length, unsigned numChannels, Bitplanes &dst);
+
+/*
+ * Scatter planes back to Logic16 transfer data, the inverse of
+ * bitplane_from_logic16 for src.channels() channels. Only whole blocks of
+ * 16 samples are written: dst holds src.samples() / 16 * 2 * src.channels().
+ */
+void bitplane_to_logic16(const Bitplanes &src, uint8_t *dst);
+
+/* Transpose one Logic16 block of 16 samples to sample words */
+void bitplane_logic16_samples(const uint8_t *block, unsigned numChannels, uint16_t *dst);
+
+#endif //TTT_BITPLANE_H
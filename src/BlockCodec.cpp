@@ -0,0 +1,472 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "BlockCodec.h"
+#include <string.h>
+#include <assert.h>
+#include <stdexcept>
+#include <emmintrin.h>
+
+#define BLOCK_HEADER_SIZE 10
+#define BLOCK_CODEC_FLAG_LZ 0x01
+
+#define PLANE_ZERO 0
+#define PLANE_ONE  1
+#define PLANE_RAW  2
+#define PLANE_RLE0 3
+#define PLANE_RLE1 4
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MAX_OFFSET 65535
+
+using namespace std;
+
+static void corrupt() {
+    throw runtime_error("BlockCodec: corrupt block");
+}
+
+static inline uint8_t *put_varint(uint8_t *p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+static inline const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint32_t &v) {
+    v = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (p == end) {
+            corrupt();
+        }
+        uint8_t b = *p++;
+        v |= (uint32_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return p;
+        }
+    }
+    corrupt();
+    return p;
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    memcpy(p, &v, 4);
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t tail_mask(size_t samples) {
+    unsigned rem = samples & 63;
+    return rem ? (((uint64_t) 1 << rem) - 1) : ~(uint64_t) 0;
+}
+
+/* Set bits [from, to) of a zeroed plane */
+static void fill_ones(uint64_t *plane, size_t from, size_t to) {
+    static const __m128i ones = _mm_set1_epi32(-1);
+    if (from >= to) {
+        return;
+    }
+    size_t fw = from >> 6, lw = (to - 1) >> 6;
+    uint64_t head = ~(uint64_t) 0 << (from & 63);
+    uint64_t tail = tail_mask(to);
+    if (fw == lw) {
+        plane[fw] |= head & tail;
+        return;
+    }
+    plane[fw] |= head;
+    size_t w = fw + 1;
+    for (; w + 2 <= lw; w += 2) {
+        _mm_storeu_si128((__m128i *) &plane[w], ones);
+    }
+    for (; w < lw; w++) {
+        plane[w] = ~(uint64_t) 0;
+    }
+    plane[lw] |= tail;
+}
+
+BlockCodec::BlockCodec(uint32_t blockSamples, bool lz, unsigned channels)
+    : block(blockSamples)
+    , useLz(lz)
+    , planes(channels)
+    , lzTable(1 << LZ_HASH_BITS) {
+    assert(blockSamples > 0);
+    scratch.resize(maxCompressedSize(blockSamples));
+}
+
+size_t BlockCodec::maxCompressedSize(size_t count) const {
+    size_t blocks = (count + block - 1) / block;
+    size_t words = (block + 63) / 64;
+    return blocks * (BLOCK_HEADER_SIZE + 4 + planes.channels() * (1 + words * 8));
+}
+
+size_t BlockCodec::compress(const uint16_t *samples, size_t count, uint8_t *dst, size_t capacity) {
+    size_t out = 0;
+    size_t bound = maxCompressedSize(block);
+
+    for (size_t pos = 0; pos < count; pos += block) {
+        size_t n = count - pos < block ? count - pos : block;
+        if (capacity - out < bound) {
+            throw length_error("BlockCodec: output buffer too small");
+        }
+        out += compressBlock(samples + pos, n, dst + out);
+    }
+    return out;
+}
+
+size_t BlockCodec::compressBlock(const uint16_t *samples, size_t count, uint8_t *dst) {
+    uint8_t flags = 0;
+    size_t payload;
+
+    bitplane_from_samples(samples, count, planes);
+
+    if (useLz) {
+        size_t raw = encodePlanes(&scratch[0]);
+        size_t packed = lz_compress(&scratch[0], raw, dst + BLOCK_HEADER_SIZE + 4,
+                                    raw - 1, &lzTable[0]);
+        if (packed) {
+            put32(dst + BLOCK_HEADER_SIZE, (uint32_t) raw);
+            payload = packed + 4;
+            flags |= BLOCK_CODEC_FLAG_LZ;
+        } else {
+            memcpy(dst + BLOCK_HEADER_SIZE, &scratch[0], raw);
+            payload = raw;
+        }
+    } else {
+        payload = encodePlanes(dst + BLOCK_HEADER_SIZE);
+    }
+
+    put32(dst, (uint32_t) count);
+    dst[4] = (uint8_t) planes.channels();
+    dst[5] = flags;
+    put32(dst + 6, (uint32_t) payload);
+    return BLOCK_HEADER_SIZE + payload;
+}
+
+size_t BlockCodec::encodePlanes(uint8_t *dst) {
+    size_t words = planes.words();
+    size_t rawBytes = words * 8;
+    uint64_t last = tail_mask(planes.samples());
+    uint8_t *p = dst;
+
+    for (unsigned ch = 0; ch < planes.channels(); ch++) {
+        const uint64_t *w = planes.plane(ch);
+        uint64_t any = 0, all = ~(uint64_t) 0;
+        size_t toggles = 0;
+        uint64_t carry = w[0] & 1;
+
+        for (size_t i = 0; i < words; i++) {
+            uint64_t mask = i + 1 == words ? last : ~(uint64_t) 0;
+            uint64_t x = w[i];
+            any |= x;
+            all &= x | ~mask;
+            toggles += __builtin_popcountll((x ^ ((x << 1) | carry)) & mask);
+            carry = x >> 63;
+        }
+
+        if (!any) {
+            *p++ = PLANE_ZERO;
+            continue;
+        }
+        if (all == ~(uint64_t) 0) {
+            *p++ = PLANE_ONE;
+            continue;
+        }
+
+        /* Each run costs at least one varint byte */
+        if (toggles + 5 < rawBytes) {
+            uint8_t *start = p;
+            uint8_t *limit = p + 1 + rawBytes;
+            size_t prev = 0;
+            *p++ = (w[0] & 1) ? PLANE_RLE1 : PLANE_RLE0;
+            p = put_varint(p, (uint32_t) toggles);
+            bool fits = true;
+            carry = w[0] & 1;
+            for (size_t i = 0; i < words && fits; i++) {
+                uint64_t mask = i + 1 == words ? last : ~(uint64_t) 0;
+                uint64_t t = (w[i] ^ ((w[i] << 1) | carry)) & mask;
+                carry = w[i] >> 63;
+                while (t) {
+                    size_t pos = i * 64 + __builtin_ctzll(t);
+                    p = put_varint(p, (uint32_t) (pos - prev));
+                    prev = pos;
+                    t &= t - 1;
+                    if (p + 5 > limit) {
+                        fits = false;
+                        break;
+                    }
+                }
+            }
+            if (fits) {
+                continue;
+            }
+            /* Runs turned out longer than the raw plane */
+            p = start;
+        }
+
+        *p++ = PLANE_RAW;
+        memcpy(p, w, rawBytes);
+        p += rawBytes;
+    }
+    return p - dst;
+}
+
+const uint8_t *BlockCodec::decodePlanes(const uint8_t *src, const uint8_t *end) {
+    size_t samples = planes.samples();
+    size_t rawBytes = planes.words() * 8;
+
+    for (unsigned ch = 0; ch < planes.channels(); ch++) {
+        uint64_t *w = planes.plane(ch);
+        if (src == end) {
+            corrupt();
+        }
+        uint8_t mode = *src++;
+        switch (mode) {
+        case PLANE_ZERO:
+            break;
+        case PLANE_ONE:
+            fill_ones(w, 0, samples);
+            break;
+        case PLANE_RAW:
+            if ((size_t) (end - src) < rawBytes) {
+                corrupt();
+            }
+            memcpy(w, src, rawBytes);
+            src += rawBytes;
+            break;
+        case PLANE_RLE0:
+        case PLANE_RLE1: {
+            uint32_t runs, delta;
+            bool level = mode == PLANE_RLE1;
+            size_t pos = 0;
+            src = get_varint(src, end, runs);
+            for (uint32_t r = 0; r < runs; r++) {
+                src = get_varint(src, end, delta);
+                if (delta == 0 || delta > samples - pos) {
+                    corrupt();
+                }
+                if (level) {
+                    fill_ones(w, pos, pos + delta);
+                }
+                pos += delta;
+                level = !level;
+            }
+            if (level) {
+                fill_ones(w, pos, samples);
+            }
+            break;
+        }
+        default:
+            corrupt();
+        }
+    }
+    return src;
+}
+
+size_t BlockCodec::decompress(const uint8_t *src, size_t length, uint16_t *dst, size_t capacity) {
+    const uint8_t *end = src + length;
+    size_t out = 0;
+
+    while (src < end) {
+        if ((size_t) (end - src) < BLOCK_HEADER_SIZE) {
+            corrupt();
+        }
+        uint32_t count = get32(src);
+        uint8_t channels = src[4];
+        uint8_t flags = src[5];
+        uint32_t payload = get32(src + 6);
+        src += BLOCK_HEADER_SIZE;
+
+        if (channels != planes.channels() || count > block || payload > (size_t) (end - src)) {
+            corrupt();
+        }
+        if (capacity - out < count) {
+            throw length_error("BlockCodec: output buffer too small");
+        }
+
+        planes.reset(count);
+        const uint8_t *body = src;
+        const uint8_t *bodyEnd = src + payload;
+        if (flags & BLOCK_CODEC_FLAG_LZ) {
+            if (payload < 4) {
+                corrupt();
+            }
+            uint32_t raw = get32(body);
+            if (raw > scratch.size() ||
+                lz_decompress(body + 4, payload - 4, &scratch[0], raw) != raw) {
+                corrupt();
+            }
+            body = &scratch[0];
+            bodyEnd = body + raw;
+        }
+        if (decodePlanes(body, bodyEnd) != bodyEnd) {
+            corrupt();
+        }
+
+        bitplane_to_samples(planes, dst + out);
+        out += count;
+        src += payload;
+    }
+    return out;
+}
+
+static inline uint32_t lz_hash(uint32_t v, unsigned bits) {
+    return (v * 2654435761u) >> (32 - bits);
+}
+
+static inline uint64_t get64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+size_t lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity, uint32_t *table) {
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + length;
+    const uint8_t *limit = length > LZ_MIN_MATCH + LZ_LAST_LITERALS ? end - LZ_MIN_MATCH - LZ_LAST_LITERALS : src;
+    uint8_t *op = dst;
+    uint8_t *opEnd = dst + capacity;
+
+    /*
+     * Table holds position + 1 so zero means empty. Encoded planes are
+     * mostly far smaller than the block, so the table is sized to the
+     * input: clearing all of it would cost more than the search.
+     */
+    unsigned bits = 8;
+    while (bits < LZ_HASH_BITS && ((size_t) 1 << bits) < length) {
+        bits++;
+    }
+    memset(table, 0, sizeof(uint32_t) << bits);
+
+    for (;;) {
+        const uint8_t *match = NULL;
+        /* Step further the longer nothing matches, as LZ4 does */
+        unsigned misses = 1 << 6;
+        while (ip < limit) {
+            uint32_t h = lz_hash(get32(ip), bits);
+            uint32_t ref = table[h];
+            table[h] = (uint32_t) (ip - src) + 1;
+            if (ref && (size_t) (ip - src) - (ref - 1) <= LZ_MAX_OFFSET && get32(src + ref - 1) == get32(ip)) {
+                match = src + ref - 1;
+                break;
+            }
+            ip += misses++ >> 6;
+        }
+
+        size_t literals = (match ? ip : end) - anchor;
+        size_t matchLen = 0;
+        if (match) {
+            /* Eight bytes at a time, the first differing byte from the XOR */
+            const uint8_t *matchEnd = end - LZ_LAST_LITERALS;
+            matchLen = LZ_MIN_MATCH;
+            while (ip + matchLen + 8 <= matchEnd) {
+                uint64_t diff = get64(match + matchLen) ^ get64(ip + matchLen);
+                if (diff) {
+                    matchLen += __builtin_ctzll(diff) >> 3;
+                    break;
+                }
+                matchLen += 8;
+            }
+            if (ip + matchLen + 8 > matchEnd) {
+                while (ip + matchLen < matchEnd && match[matchLen] == ip[matchLen]) {
+                    matchLen++;
+                }
+            }
+        }
+
+        /* token + two varints + offset */
+        if ((size_t) (opEnd - op) < 1 + 5 + literals + 2 + 5) {
+            return 0;
+        }
+        uint8_t *token = op++;
+        *token = (uint8_t) ((literals < 15 ? literals : 15) << 4);
+        if (literals >= 15) {
+            op = put_varint(op, (uint32_t) (literals - 15));
+        }
+        memcpy(op, anchor, literals);
+        op += literals;
+
+        if (!match) {
+            break;
+        }
+
+        uint16_t offset = (uint16_t) (ip - match);
+        memcpy(op, &offset, 2);
+        op += 2;
+        size_t ml = matchLen - LZ_MIN_MATCH;
+        *token |= (uint8_t) (ml < 15 ? ml : 15);
+        if (ml >= 15) {
+            op = put_varint(op, (uint32_t) (ml - 15));
+        }
+        ip += matchLen;
+        anchor = ip;
+    }
+
+    return (size_t) (op - dst) < length ? (size_t) (op - dst) : 0;
+}
+
+size_t lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity) {
+    const uint8_t *ip = src;
+    const uint8_t *end = src + length;
+    uint8_t *op = dst;
+    uint8_t *opEnd = dst + capacity;
+
+    while (ip < end) {
+        uint8_t token = *ip++;
+        uint32_t literals = token >> 4;
+        if (literals == 15) {
+            uint32_t extra;
+            ip = get_varint(ip, end, extra);
+            literals += extra;
+        }
+        if (literals > (size_t) (end - ip) || literals > (size_t) (opEnd - op)) {
+            corrupt();
+        }
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            corrupt();
+        }
+        uint16_t offset;
+        memcpy(&offset, ip, 2);
+        ip += 2;
+        uint32_t matchLen = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15) {
+            uint32_t extra;
+            ip = get_varint(ip, end, extra);
+            matchLen += extra;
+        }
+        if (offset == 0 || offset > op - dst || matchLen > (size_t) (opEnd - op)) {
+            corrupt();
+        }
+
+        const uint8_t *ref = op - offset;
+        if (offset >= 16) {
+            /* Source is always at least 16 bytes behind, so chunks never overlap */
+            while (matchLen >= 16) {
+                _mm_storeu_si128((__m128i *) op, _mm_loadu_si128((const __m128i *) ref));
+                op += 16;
+                ref += 16;
+                matchLen -= 16;
+            }
+        }
+        while (matchLen--) {
+            *op++ = *ref++;
+        }
+    }
+    return op - dst;
+}
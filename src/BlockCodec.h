@@ -0,0 +1,61 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_BLOCKCODEC_H
+#define TTT_BLOCKCODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+
+#define BLOCK_CODEC_DEFAULT_SAMPLES 8192
+
+/*
+ * Lossless block codec for 16 channel sample words.
+ *
+ * Each block is transposed to bit planes and every plane is stored as
+ * constant, run lengths between toggles, or raw bits, whichever is
+ * smallest. An optional LZ stage runs over the encoded planes, which
+ * mostly helps when several channels carry the same bus pattern.
+ *
+ * Block layout (little endian):
+ *   u32 samples, u8 channels, u8 flags, u32 payload length, payload
+ * With BLOCK_CODEC_FLAG_LZ the payload is u32 plane length followed by
+ * the LZ stream, otherwise the plane section itself.
+ */
+class BlockCodec {
+public:
+    explicit BlockCodec(uint32_t blockSamples = BLOCK_CODEC_DEFAULT_SAMPLES, bool lz = false,
+                        unsigned channels = BITPLANE_MAX_CHANNELS);
+
+    /* Worst case output size for count samples */
+    size_t maxCompressedSize(size_t count) const;
+
+    /* Compress count samples into dst, returns bytes written */
+    size_t compress(const uint16_t *samples, size_t count, uint8_t *dst, size_t capacity);
+
+    /* Decompress a stream of blocks, returns samples written. Throws on corrupt input */
+    size_t decompress(const uint8_t *src, size_t length, uint16_t *dst, size_t capacity);
+
+    uint32_t blockSamples() const { return block; }
+
+private:
+    size_t compressBlock(const uint16_t *samples, size_t count, uint8_t *dst);
+    size_t encodePlanes(uint8_t *dst);
+    const uint8_t *decodePlanes(const uint8_t *src, const uint8_t *end);
+
+    uint32_t block;
+    bool useLz;
+    Bitplanes planes;
+    std::vector<uint8_t> scratch;
+    std::vector<uint32_t> lzTable;
+};
+
+/* LZ stage, exposed for tests. Returns 0 when the output would not shrink */
+size_t lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity, uint32_t *table);
+/* Returns bytes written, throws on corrupt input */
+size_t lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity);
+
+#endif //TTT_BLOCKCODEC_H
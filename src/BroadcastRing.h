@@ -0,0 +1,256 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_BROADCASTRING_H
+#define TTT_BROADCASTRING_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <stdint.h>
+#include <utility>
+#include "PacketHandle.h"
+
+/* Each consumer gets its own reference; plain values are copied */
+template<class T>
+inline T broadcast_share(const T &value) {
+    return value;
+}
+
+inline PacketHandle broadcast_share(const PacketHandle &handle) {
+    return handle.share();
+}
+
+/*
+ * BroadcastRing is a one producer, many consumer ring without locks. Every
+ * consumer sees every record, reading at its own pace through its own
+ * cursor. Consumers are registered before the first write(): the producer
+ * does not look for new cursors while it overwrites records, so one added
+ * later could read a record as it is being replaced.
+ *
+ * The producer keeps a cached lower bound of the slowest cursor and only
+ * rescans the consumers when it is about to overwrite a record that bound
+ * says may still be unread. What happens to a consumer that lags a whole
+ * ring behind depends on its policy:
+ *
+ *   BROADCAST_BLOCK        write() fails until the consumer catches up
+ *   BROADCAST_DROP_OLDEST  the consumer skips the records it missed
+ *   BROADCAST_DETACH       the consumer is cut off and reads fail from then on
+ *
+ * Skipping or detaching a consumer that is in the middle of copying the
+ * oldest record makes write() fail for that one call; retrying succeeds
+ * as soon as the copy is done.
+ */
+template<class T>
+class BroadcastRing {
+public:
+    typedef T value_type;
+
+    enum Policy {
+        BROADCAST_BLOCK,
+        BROADCAST_DROP_OLDEST,
+        BROADCAST_DETACH
+    };
+
+    enum ReadResult {
+        READ_OK,
+        READ_EMPTY,
+        READ_DETACHED
+    };
+
+    BroadcastRing(const BroadcastRing&) = delete;
+    BroadcastRing& operator = (const BroadcastRing&) = delete;
+
+    // size must be a power of two >= 2.
+    BroadcastRing(uint32_t size, unsigned maxConsumers)
+        : size_(size)
+        , mask_(size - 1)
+        , maxConsumers_(maxConsumers)
+        , records_(static_cast<T*>(std::malloc(sizeof(T) * size)))
+        , consumers_(allocConsumers(maxConsumers))
+        , numConsumers_(0)
+        , gate_(0)
+        , writeIndex_(0)
+    {
+        assert(size >= 2 && (size & (size - 1)) == 0);
+        if (!records_ || !consumers_) {
+            std::free(records_);
+            freeConsumers(consumers_, maxConsumers);
+            throw std::bad_alloc();
+        }
+    }
+
+    ~BroadcastRing() {
+        uint64_t end = writeIndex_.load(std::memory_order_relaxed);
+        uint64_t read = end > size_ ? end - size_ : 0;
+        for (; read != end; read++) {
+            records_[read & mask_].~T();
+        }
+        std::free(records_);
+        freeConsumers(consumers_, maxConsumers_);
+    }
+
+    // Register a consumer that starts with the first record written. Only
+    // from one thread, before the first write(); the consumer threads may
+    // be started afterwards. Returns its id, or -1 if maxConsumers are
+    // registered.
+    int addConsumer(Policy policy) {
+        assert(writeIndex_.load(std::memory_order_relaxed) == 0);
+        unsigned id = numConsumers_.load(std::memory_order_relaxed);
+        if (id == maxConsumers_) {
+            return -1;
+        }
+        consumers_[id].policy = policy;
+        consumers_[id].dropped.store(0, std::memory_order_relaxed);
+        consumers_[id].cursor.store(0, std::memory_order_relaxed);
+        numConsumers_.store(id + 1, std::memory_order_release);
+        return (int) id;
+    }
+
+    template<class ...Args>
+    bool write(Args&&... recordArgs) {
+        auto const currentWrite = writeIndex_.load(std::memory_order_relaxed);
+
+        if (currentWrite >= size_) {
+            auto const oldest = currentWrite - size_;
+            if (gate_ <= oldest && !advanceGate(oldest, currentWrite)) {
+                return false;
+            }
+            records_[currentWrite & mask_].~T();
+        }
+
+        new (&records_[currentWrite & mask_]) T(std::forward<Args>(recordArgs)...);
+        writeIndex_.store(currentWrite + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Share the next record for this consumer into record
+    ReadResult read(int consumer, T& record) {
+        Consumer &c = consumers_[consumer];
+
+        for (;;) {
+            uint64_t cur = c.cursor.load(std::memory_order_acquire);
+            if (cur & DETACHED) {
+                return READ_DETACHED;
+            }
+            if (cur == writeIndex_.load(std::memory_order_acquire)) {
+                // nothing new
+                return READ_EMPTY;
+            }
+
+            if (c.policy != BROADCAST_BLOCK &&
+                !c.cursor.compare_exchange_weak(cur, cur | BUSY, std::memory_order_acquire)) {
+                // producer moved us on, try again
+                continue;
+            }
+
+            record = broadcast_share(records_[cur & mask_]);
+            c.cursor.store(cur + 1, std::memory_order_release);
+            return READ_OK;
+        }
+    }
+
+    // Records this consumer skipped because it lagged behind
+    uint64_t dropped(int consumer) const {
+        return consumers_[consumer].dropped.load(std::memory_order_relaxed);
+    }
+
+    bool detached(int consumer) const {
+        return (consumers_[consumer].cursor.load(std::memory_order_acquire) & DETACHED) != 0;
+    }
+
+    // Records not yet read by this consumer; a guess while writes happen.
+    size_t sizeGuess(int consumer) const {
+        uint64_t cur = consumers_[consumer].cursor.load(std::memory_order_acquire);
+        if (cur & DETACHED) {
+            return 0;
+        }
+        return writeIndex_.load(std::memory_order_acquire) - (cur & POSITION);
+    }
+
+private:
+    static const uint64_t BUSY = (uint64_t) 1 << 63;
+    static const uint64_t DETACHED = (uint64_t) 1 << 62;
+    static const uint64_t POSITION = DETACHED - 1;
+
+    struct alignas(64) Consumer {
+        std::atomic<uint64_t> cursor;
+        std::atomic<uint64_t> dropped;
+        Policy policy;
+
+        Consumer() : cursor(0), dropped(0), policy(BROADCAST_BLOCK) {}
+    };
+
+    // Cache line aligned without relying on aligned operator new
+    static Consumer* allocConsumers(unsigned n) {
+        void *p = NULL;
+        if (posix_memalign(&p, 64, sizeof(Consumer) * (n ? n : 1)) != 0) {
+            return NULL;
+        }
+        Consumer *c = static_cast<Consumer*>(p);
+        for (unsigned i = 0; i < n; i++) {
+            new (&c[i]) Consumer();
+        }
+        return c;
+    }
+
+    static void freeConsumers(Consumer *c, unsigned n) {
+        if (c) {
+            for (unsigned i = 0; i < n; i++) {
+                c[i].~Consumer();
+            }
+        }
+        std::free(c);
+    }
+
+    // Move the slowest cursor past oldest, or fail if a consumer holds it
+    bool advanceGate(uint64_t oldest, uint64_t currentWrite) {
+        unsigned n = numConsumers_.load(std::memory_order_acquire);
+        uint64_t slowest = currentWrite;
+
+        for (unsigned i = 0; i < n; i++) {
+            Consumer &c = consumers_[i];
+            uint64_t cur = c.cursor.load(std::memory_order_acquire);
+            if (cur & DETACHED) {
+                continue;
+            }
+            uint64_t pos = cur & POSITION;
+            if (pos <= oldest) {
+                if (c.policy == BROADCAST_BLOCK || (cur & BUSY)) {
+                    gate_ = pos;
+                    return false;
+                }
+                uint64_t next = c.policy == BROADCAST_DETACH ? DETACHED : oldest + 1;
+                if (!c.cursor.compare_exchange_strong(cur, next, std::memory_order_acq_rel)) {
+                    gate_ = pos;
+                    return false;
+                }
+                if (c.policy == BROADCAST_DETACH) {
+                    continue;
+                }
+                c.dropped.fetch_add(oldest + 1 - pos, std::memory_order_relaxed);
+                pos = oldest + 1;
+            }
+            if (pos < slowest) {
+                slowest = pos;
+            }
+        }
+        gate_ = slowest;
+        return true;
+    }
+
+    const uint32_t size_;
+    const uint64_t mask_;
+    const unsigned maxConsumers_;
+    T* const records_;
+    Consumer* const consumers_;
+    std::atomic<unsigned> numConsumers_;
+
+    // producer only: no consumer cursor is below this
+    alignas(64) uint64_t gate_;
+    alignas(64) std::atomic<uint64_t> writeIndex_;
+};
+
+#endif //TTT_BROADCASTRING_H
@@ -0,0 +1,37 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_CAPTUREFILE_H
+#define TTT_CAPTUREFILE_H
+
+#include <stdint.h>
+
+/*
+ * Indexed capture file. A header followed by records, each a record header
+ * and the transfer data exactly as the Logic16 delivered it. Records of
+ * several devices may be mixed in one file. Files without the magic are
+ * treated as raw captures: bare transfer data of a single device.
+ */
+
+#define CAPTURE_FILE_MAGIC   "TTTCAP1"
+#define CAPTURE_FILE_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t numChannels;
+    uint64_t samplerate;
+    uint32_t flags;
+    uint32_t reserved;
+} capture_file_header_t;
+
+typedef struct {
+    /** Bytes of transfer data following this header */
+    uint32_t size;
+    int32_t id;
+    /** Absolute index of the first sample in the record */
+    uint64_t sample;
+} capture_record_header_t;
+
+#endif //TTT_CAPTUREFILE_H
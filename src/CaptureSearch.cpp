@@ -0,0 +1,448 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "CaptureSearch.h"
+#include "Bitplane.h"
+#include "CaptureFile.h"
+#include "ParallelDecode.h"
+#include <algorithm>
+#include <assert.h>
+#include <fcntl.h>
+#include <mutex>
+#include <smmintrin.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef struct {
+    char magic[8];
+    uint32_t numChannels;
+    uint32_t reserved;
+    uint64_t chunkSamples;
+    uint64_t count;
+    /** The capture the index was built from */
+    uint64_t records;
+    uint64_t captureBytes;
+} search_index_header_t;
+
+CaptureIndex::CaptureIndex(unsigned numChannels, uint64_t chunkSamples)
+    : numChannels(numChannels)
+    , chunkSamples(chunkSamples)
+    , sorted(true)
+    , recordCount(0)
+    , dataBytes(0) {
+    assert(numChannels > 0 && numChannels <= BITPLANE_MAX_CHANNELS);
+    assert(chunkSamples > 0 && chunkSamples % 16 == 0);
+}
+
+void CaptureIndex::process(const sr_wrap_packet_t *packet) {
+    add(packet->id, packet->sample, packet->data, packet->size);
+}
+
+void CaptureIndex::add(int id, uint64_t sample, const uint8_t *data, size_t length) {
+    size_t blockBytes = 2 * numChannels;
+    Open *o = NULL;
+    for (auto &e : open) {
+        if (e.id == id) {
+            o = &e;
+        }
+    }
+    if (!o) {
+        open.push_back(Open{ id, SIZE_MAX, 0 });
+        o = &open.back();
+    }
+    recordCount++;
+    dataBytes += length;
+
+    uint16_t words[16];
+    for (size_t b = 0; b < length / blockBytes; b++, sample += 16) {
+        uint64_t chunk = sample / chunkSamples;
+        bitplane_logic16_samples(data + b * blockBytes, numChannels, words);
+        if (o->summary == SIZE_MAX || summaries[o->summary].chunk != chunk) {
+            SearchSummary s;
+            memset(&s, 0, sizeof(s));
+            s.id = id;
+            s.chunk = chunk;
+            if (!summaries.empty() && (summaries.back().id > id ||
+                                       (summaries.back().id == id && summaries.back().chunk >= chunk))) {
+                sorted = false;
+            }
+            summaries.push_back(s);
+            o->summary = summaries.size() - 1;
+            /* Anything but the first sample, so that it is recorded */
+            o->last = (uint16_t) ~words[0];
+        }
+
+        SearchSummary &s = summaries[o->summary];
+        uint16_t last = o->last;
+        for (unsigned i = 0; i < 16; i++) {
+            uint16_t v = words[i];
+            if (v != last) {
+                s.seen[0][(v & 0xff) >> 6] |= (uint64_t) 1 << (v & 63);
+                s.seen[1][v >> 14] |= (uint64_t) 1 << ((v >> 8) & 63);
+                last = v;
+            }
+        }
+        o->last = last;
+    }
+}
+
+void CaptureIndex::sort() {
+    if (!sorted) {
+        std::stable_sort(summaries.begin(), summaries.end(), [](const SearchSummary &a, const SearchSummary &b) {
+            return a.id != b.id ? a.id < b.id : a.chunk < b.chunk;
+        });
+        /* Open chunks are not extended after this, a later block starts a new summary */
+        open.clear();
+        sorted = true;
+    }
+}
+
+uint64_t CaptureIndex::captureBytes() const {
+    return sizeof(capture_file_header_t) + recordCount * sizeof(capture_record_header_t) + dataBytes;
+}
+
+bool CaptureIndex::save(const char *path) {
+    sort();
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    search_index_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEARCH_INDEX_MAGIC, sizeof(SEARCH_INDEX_MAGIC));
+    header.numChannels = numChannels;
+    header.chunkSamples = chunkSamples;
+    header.count = summaries.size();
+    header.records = recordCount;
+    header.captureBytes = captureBytes();
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              (summaries.empty() || fwrite(&summaries[0], sizeof(SearchSummary), summaries.size(), f) == summaries.size());
+    return fclose(f) == 0 && ok;
+}
+
+bool CaptureIndex::load(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    struct stat st;
+    search_index_header_t header;
+    bool ok = fstat(fileno(f), &st) == 0 && fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, SEARCH_INDEX_MAGIC, sizeof(SEARCH_INDEX_MAGIC)) == 0 &&
+              header.numChannels > 0 && header.numChannels <= BITPLANE_MAX_CHANNELS &&
+              header.chunkSamples > 0 && header.chunkSamples % 16 == 0 &&
+              header.captureBytes >= sizeof(capture_file_header_t) &&
+              /* The summaries fill the rest of the file exactly */
+              header.count == ((uint64_t) st.st_size - sizeof(header)) / sizeof(SearchSummary) &&
+              ((uint64_t) st.st_size - sizeof(header)) % sizeof(SearchSummary) == 0;
+    if (ok) {
+        std::vector<SearchSummary> s(header.count);
+        ok = header.count == 0 || fread(&s[0], sizeof(SearchSummary), s.size(), f) == s.size();
+        if (ok) {
+            numChannels = header.numChannels;
+            chunkSamples = header.chunkSamples;
+            summaries.swap(s);
+            open.clear();
+            recordCount = header.records;
+            dataBytes = header.captureBytes - sizeof(capture_file_header_t) -
+                        header.records * sizeof(capture_record_header_t);
+            sorted = false;
+            sort();
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+bool CaptureIndex::mayContain(int id, uint64_t chunk, const SearchPattern &pattern) const {
+    if (!sorted) {
+        return true;
+    }
+    auto it = std::lower_bound(summaries.begin(), summaries.end(), make_pair(id, chunk),
+                               [](const SearchSummary &s, const pair<int, uint64_t> &key) {
+        return s.id != key.first ? s.id < key.first : s.chunk < key.second;
+    });
+    if (it == summaries.end() || it->id != id || it->chunk != chunk) {
+        return true;
+    }
+
+    for (unsigned lane = 0; lane < 2; lane++) {
+        unsigned mask = (pattern.mask >> (8 * lane)) & 0xff;
+        unsigned value = (pattern.value >> (8 * lane)) & mask;
+        const uint64_t *seen = it->seen[lane];
+        if (mask == 0) {
+            continue;
+        }
+        /* Walk the byte values that agree with the pattern on the masked bits */
+        unsigned free = ~mask & 0xff, sub = 0;
+        bool any = false;
+        do {
+            unsigned v = value | sub;
+            any = (seen[v >> 6] >> (v & 63)) & 1;
+            sub = (sub - free) & free;
+        } while (!any && sub != 0);
+        if (!any) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CaptureSearch::CaptureSearch()
+    : addr(NULL)
+    , length(0)
+    , numChannels(0)
+    , chunkIndex(BITPLANE_MAX_CHANNELS)
+    , skippedChunks(0)
+    , scannedChunks(0) {
+}
+
+CaptureSearch::~CaptureSearch() {
+    close();
+}
+
+void CaptureSearch::close() {
+    if (addr) {
+        munmap(addr, length);
+    }
+    addr = NULL;
+    length = 0;
+    numChannels = 0;
+    records.clear();
+    chunkList.clear();
+    chunkIndex = CaptureIndex(BITPLANE_MAX_CHANNELS);
+    skippedChunks = 0;
+    scannedChunks = 0;
+}
+
+void CaptureSearch::cut(int id, const vector<size_t> &track) {
+    const uint64_t chunkSamples = chunkIndex.chunkSize();
+    const size_t blockBytes = 2 * numChannels;
+
+    for (size_t r : track) {
+        const Record &rec = records[r];
+        size_t blocks = rec.size / blockBytes;
+        size_t b = 0;
+        while (b < blocks) {
+            uint64_t chunk = (rec.sample + 16 * b) / chunkSamples;
+            /* Blocks up to the one that starts in the next chunk */
+            uint64_t nextChunk = (chunk + 1) * chunkSamples;
+            size_t end = (size_t) min<uint64_t>(blocks, (nextChunk - rec.sample + 15) / 16);
+            if (chunkList.empty() || chunkList.back().id != id || chunkList.back().chunk != chunk) {
+                chunkList.push_back(Chunk{ id, chunk, vector<Piece>() });
+            }
+            chunkList.back().pieces.push_back(Piece{ r, b, end });
+            b = end;
+        }
+    }
+}
+
+bool CaptureSearch::open(const char *path, const char *indexPath) {
+    struct stat st;
+    int fd;
+
+    close();
+    if ((fd = ::open(path, O_RDONLY)) < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(capture_file_header_t)) {
+        ::close(fd);
+        return false;
+    }
+    addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        addr = NULL;
+        return false;
+    }
+    length = st.st_size;
+
+    vector<int> ids;
+    vector<vector<size_t>> tracks;
+    if (!readRecords(ids, tracks)) {
+        close();
+        return false;
+    }
+
+    /* An index of another capture, or of this one before it grew, would rule out the wrong chunks */
+    chunkIndex = CaptureIndex(numChannels);
+    if (!indexPath || !chunkIndex.load(indexPath) || chunkIndex.channels() != numChannels ||
+        chunkIndex.records() != records.size() || chunkIndex.captureBytes() != length) {
+        chunkIndex = CaptureIndex(numChannels);
+        for (size_t t = 0; t < tracks.size(); t++) {
+            for (size_t r : tracks[t]) {
+                chunkIndex.add(ids[t], records[r].sample, records[r].data, records[r].size);
+            }
+        }
+        chunkIndex.sort();
+    }
+    /* Devices in id order */
+    vector<size_t> order(ids.size());
+    for (size_t t = 0; t < order.size(); t++) {
+        order[t] = t;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return ids[a] < ids[b]; });
+    for (size_t t : order) {
+        cut(ids[t], tracks[t]);
+    }
+    return true;
+}
+
+bool CaptureSearch::readRecords(vector<int> &ids, vector<vector<size_t>> &tracks) {
+    const uint8_t *base = (const uint8_t *) addr;
+    capture_file_header_t header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC)) != 0 ||
+        header.version != CAPTURE_FILE_VERSION || header.numChannels == 0 ||
+        header.numChannels > BITPLANE_MAX_CHANNELS) {
+        return false;
+    }
+    numChannels = header.numChannels;
+
+    /* Records per device, linked to the one they continue */
+    size_t pos = sizeof(header);
+    while (pos < length) {
+        capture_record_header_t rec;
+        if (length - pos < sizeof(rec)) {
+            return false;
+        }
+        memcpy(&rec, base + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (length - pos < rec.size) {
+            return false;
+        }
+        size_t t = find(ids.begin(), ids.end(), rec.id) - ids.begin();
+        if (t == ids.size()) {
+            ids.push_back(rec.id);
+            tracks.emplace_back();
+        }
+        Record r = { base + pos, rec.size, rec.sample, -1 };
+        if (!tracks[t].empty()) {
+            const Record &last = records[tracks[t].back()];
+            if (last.sample + last.size / (2 * numChannels) * 16 == r.sample && last.size >= 2 * numChannels) {
+                r.before = (long) tracks[t].back();
+            }
+        }
+        tracks[t].push_back(records.size());
+        records.push_back(r);
+        pos += rec.size;
+    }
+    return true;
+}
+
+/*
+ * Lanes hold the channel words of a block; a lane becomes all ones where
+ * the sample agrees with the pattern on that channel, or if the channel
+ * is not in the pattern. ANDing the lanes leaves the matching samples.
+ */
+struct BlockCompare {
+    __m128i flip[2];
+    __m128i ignore[2];
+    unsigned groups;
+    size_t blockBytes;
+
+    BlockCompare(const SearchPattern &p, unsigned numChannels) {
+        uint16_t f[16], g[16];
+        for (unsigned ch = 0; ch < 16; ch++) {
+            bool used = ch < numChannels && ((p.mask >> ch) & 1);
+            f[ch] = ((p.value >> ch) & 1) ? 0 : 0xffff;
+            g[ch] = used ? 0 : 0xffff;
+        }
+        for (unsigned i = 0; i < 2; i++) {
+            flip[i] = _mm_loadu_si128((const __m128i *) (f + 8 * i));
+            ignore[i] = _mm_loadu_si128((const __m128i *) (g + 8 * i));
+        }
+        groups = (numChannels + 7) / 8;
+        blockBytes = 2 * numChannels;
+    }
+
+    /* Bit i set where sample i of the block matches; end bounds the readable data */
+    uint16_t match(const uint8_t *block, const uint8_t *end) const {
+        uint8_t padded[32];
+        if (block + 16 * groups > end) {
+            memset(padded, 0, sizeof(padded));
+            memcpy(padded, block, blockBytes);
+            block = padded;
+        }
+        __m128i m = _mm_or_si128(_mm_xor_si128(_mm_loadu_si128((const __m128i *) block), flip[0]), ignore[0]);
+        if (groups > 1) {
+            __m128i h = _mm_loadu_si128((const __m128i *) (block + 16));
+            m = _mm_and_si128(m, _mm_or_si128(_mm_xor_si128(h, flip[1]), ignore[1]));
+        }
+        m = _mm_and_si128(m, _mm_shuffle_epi32(m, 0x4e));
+        m = _mm_and_si128(m, _mm_shuffle_epi32(m, 0xb1));
+        m = _mm_and_si128(m, _mm_srli_epi32(m, 16));
+        return (uint16_t) _mm_cvtsi128_si32(m);
+    }
+};
+
+void CaptureSearch::scan(const Chunk &c, const SearchPattern &pattern, vector<uint64_t> &out) const {
+    BlockCompare cmp(pattern, numChannels);
+    const uint8_t *end = (const uint8_t *) addr + length;
+
+    for (auto &p : c.pieces) {
+        const Record &r = records[p.record];
+        /* The sample before the piece, if it continues one */
+        unsigned carry = 0;
+        if (p.from > 0) {
+            carry = cmp.match(r.data + (p.from - 1) * cmp.blockBytes, end) >> 15;
+        } else if (r.before >= 0) {
+            const Record &b = records[r.before];
+            carry = cmp.match(b.data + (b.size / cmp.blockBytes - 1) * cmp.blockBytes, end) >> 15;
+        }
+
+        for (size_t i = p.from; i < p.to; i++) {
+            unsigned m = cmp.match(r.data + i * cmp.blockBytes, end);
+            unsigned starts = m & ~((m << 1) | carry) & 0xffff;
+            carry = m >> 15;
+            while (starts) {
+                out.push_back(r.sample + 16 * i + __builtin_ctz(starts));
+                starts &= starts - 1;
+            }
+        }
+    }
+}
+
+uint64_t CaptureSearch::search(const SearchPattern &requested, unsigned threads, const Match &fn) {
+    /* Channels the capture does not have match anything, in the index as in the scan */
+    SearchPattern pattern = requested;
+    pattern.mask &= (uint16_t) ((1u << numChannels) - 1);
+    pattern.value &= pattern.mask;
+    vector<vector<uint64_t>> results(chunkList.size());
+    vector<bool> ready(chunkList.size(), false);
+    atomic<uint64_t> skippedCount(0), scannedCount(0);
+    mutex commitLock;
+    size_t nextCommit = 0;
+    uint64_t found = 0;
+
+    parallel_for(chunkList.size(), threads ? threads : 1, [&](size_t i) {
+        const Chunk &c = chunkList[i];
+        if (chunkIndex.mayContain(c.id, c.chunk, pattern)) {
+            scan(c, pattern, results[i]);
+            scannedCount++;
+        } else {
+            skippedCount++;
+        }
+
+        /* Whoever finishes the oldest chunk hands out everything ready behind it */
+        lock_guard<mutex> guard(commitLock);
+        ready[i] = true;
+        for (; nextCommit < chunkList.size() && ready[nextCommit]; nextCommit++) {
+            for (uint64_t sample : results[nextCommit]) {
+                fn(chunkList[nextCommit].id, sample);
+            }
+            found += results[nextCommit].size();
+            vector<uint64_t>().swap(results[nextCommit]);
+        }
+    });
+
+    skippedChunks = skippedCount;
+    scannedChunks = scannedCount;
+    return found;
+}
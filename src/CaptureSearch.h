@@ -0,0 +1,157 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_CAPTURESEARCH_H
+#define TTT_CAPTURESEARCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <vector>
+#include "sigrok_wrapper.h"
+
+#define SEARCH_CHUNK_SAMPLES (1 << 16)
+#define SEARCH_INDEX_MAGIC   "TTTIDX2"
+
+/*
+ * Summary of one chunk of samples of one device: for the low byte
+ * (channels 0-7) and the high byte (channels 8-15) of the sample words, a
+ * bit per value seen in the chunk. A pattern can only occur in a chunk if
+ * both bytes have a value it accepts, so most chunks are ruled out
+ * without touching their data.
+ */
+struct SearchSummary {
+    int32_t id;
+    uint32_t reserved;
+    uint64_t chunk;
+    uint64_t seen[2][4];
+};
+
+/* Samples whose channels in mask equal value */
+struct SearchPattern {
+    uint16_t value;
+    uint16_t mask;
+};
+
+/*
+ * Capture side: summarizes packets into chunks of chunkSamples samples
+ * (a multiple of 16) as they are written, and saves the summaries next to
+ * the capture. A block of 16 samples belongs to the chunk its first
+ * sample is in. Every add() is one record of the capture file; the index
+ * keeps their count and the file size they make up, so a search can tell
+ * an index that belongs to another capture.
+ */
+class CaptureIndex {
+public:
+    explicit CaptureIndex(unsigned numChannels, uint64_t chunkSamples = SEARCH_CHUNK_SAMPLES);
+
+    void process(const sr_wrap_packet_t *packet);
+    /* Summarize Logic16 data of device id starting at sample */
+    void add(int id, uint64_t sample, const uint8_t *data, size_t length);
+
+    /* Order the summaries for lookups; save() and load() do it as well */
+    void sort();
+    bool save(const char *path);
+    bool load(const char *path);
+
+    /* False if the chunk can not contain the pattern; true if unknown */
+    bool mayContain(int id, uint64_t chunk, const SearchPattern &pattern) const;
+
+    unsigned channels() const { return numChannels; }
+    uint64_t chunkSize() const { return chunkSamples; }
+    size_t chunks() const { return summaries.size(); }
+    /* The capture file the records added so far make up */
+    uint64_t records() const { return recordCount; }
+    uint64_t captureBytes() const;
+
+private:
+    struct Open {
+        int id;
+        size_t summary;
+        uint16_t last;
+    };
+
+    unsigned numChannels;
+    uint64_t chunkSamples;
+    std::vector<SearchSummary> summaries;
+    /* The chunk each device is filling */
+    std::vector<Open> open;
+    bool sorted;
+    uint64_t recordCount;
+    uint64_t dataBytes;
+};
+
+/*
+ * Searches an indexed capture file (CaptureFile.h) for the samples where a
+ * pattern starts to hold: the first sample of every run of matching
+ * samples, a gap between records ending a run. The file is mmap'ed and
+ * cut into chunks like the index; chunks the index rules out are skipped,
+ * the rest are compared 16 samples at a time with SSE straight on the
+ * Logic16 data, on several threads.
+ */
+class CaptureSearch {
+public:
+    /* Called in capture order: by device id, then by sample */
+    typedef std::function<void(int id, uint64_t sample)> Match;
+
+    CaptureSearch();
+    ~CaptureSearch();
+
+    CaptureSearch(const CaptureSearch&) = delete;
+    CaptureSearch& operator = (const CaptureSearch&) = delete;
+
+    /*
+     * Map a capture and its index, closing what was open. Without a
+     * usable index, or with one of another capture, one is built from the
+     * file first. False if the capture can not be mapped or is malformed.
+     */
+    bool open(const char *path, const char *indexPath = NULL);
+    void close();
+
+    /* Returns the number of matches passed to fn; channels past the capture's are ignored */
+    uint64_t search(const SearchPattern &pattern, unsigned threads, const Match &fn);
+
+    const CaptureIndex &index() const { return chunkIndex; }
+    /* Chunks ruled out and chunks scanned by the last search */
+    uint64_t skipped() const { return skippedChunks; }
+    uint64_t scanned() const { return scannedChunks; }
+
+private:
+    struct Record {
+        const uint8_t *data;
+        uint32_t size;
+        uint64_t sample;
+        /* The record of the device that ends where this one starts, -1 if none */
+        long before;
+    };
+
+    /* The blocks of one record that fall in a chunk */
+    struct Piece {
+        size_t record;
+        size_t from;
+        size_t to;
+    };
+
+    struct Chunk {
+        int id;
+        uint64_t chunk;
+        std::vector<Piece> pieces;
+    };
+
+    /* Records of the mapped file, grouped by device in tracks */
+    bool readRecords(std::vector<int> &ids, std::vector<std::vector<size_t>> &tracks);
+    void cut(int id, const std::vector<size_t> &track);
+    void scan(const Chunk &c, const SearchPattern &pattern, std::vector<uint64_t> &out) const;
+
+    void *addr;
+    size_t length;
+    unsigned numChannels;
+    std::vector<Record> records;
+    std::vector<Chunk> chunkList;
+    CaptureIndex chunkIndex;
+    uint64_t skippedChunks;
+    uint64_t scannedChunks;
+};
+
+#endif //TTT_CAPTURESEARCH_H
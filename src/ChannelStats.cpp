@@ -0,0 +1,244 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "ChannelStats.h"
+#include <assert.h>
+#include <string.h>
+
+using namespace std;
+
+#define NO_EDGE UINT64_MAX
+/* Index of the pulse histograms */
+#define PULSE_HIGH 0
+#define PULSE_LOW  1
+
+ChannelStats::ChannelStats(unsigned numChannels, const ChannelStatsConfig &config)
+    : numChannels(numChannels)
+    , cfg(config)
+    , slices((config.windowSlices + 1) * numChannels)
+    , sliceLength(config.windowSlices + 1)
+    , planes(numChannels) {
+    assert(numChannels > 0 && numChannels <= BITPLANE_MAX_CHANNELS);
+    assert(cfg.sliceSamples > 0 && cfg.windowSlices > 0 && cfg.publishSlices > 0);
+    reset();
+}
+
+void ChannelStats::reset() {
+    memset(&slices[0], 0, slices.size() * sizeof(Slice));
+    for (auto &s : slices) {
+        s.minWidth[PULSE_HIGH] = s.minWidth[PULSE_LOW] = UINT64_MAX;
+    }
+    for (auto &n : sliceLength) {
+        n = 0;
+    }
+    head = 0;
+    filled = 0;
+    sinceSnapshot = 0;
+    started = false;
+    next = 0;
+    sliceEnd = 0;
+    level = 0;
+    for (auto &e : lastEdge) {
+        e = NO_EDGE;
+    }
+}
+
+unsigned ChannelStats::bucket(uint64_t width) {
+    if (width < STATS_EXACT_WIDTHS) {
+        return (unsigned) width;
+    }
+    unsigned octave = 63 - __builtin_clzll(width);
+    unsigned b = STATS_EXACT_WIDTHS + (octave - 4) * 8 + (unsigned) ((width >> (octave - 3)) & 7);
+    return b < STATS_WIDTH_BUCKETS ? b : STATS_WIDTH_BUCKETS - 1;
+}
+
+uint64_t ChannelStats::bucketLow(unsigned b) {
+    if (b < STATS_EXACT_WIDTHS) {
+        return b;
+    }
+    unsigned octave = 4 + (b - STATS_EXACT_WIDTHS) / 8;
+    return (uint64_t) (8 + (b - STATS_EXACT_WIDTHS) % 8) << (octave - 3);
+}
+
+void ChannelStats::pulse(unsigned ch, uint64_t at, bool rising) {
+    if (lastEdge[ch] != NO_EDGE) {
+        /* A rising edge ends a low pulse */
+        unsigned kind = rising ? PULSE_LOW : PULSE_HIGH;
+        uint64_t width = at - lastEdge[ch];
+        Slice &s = slice(ch, head);
+        s.widths[kind][bucket(width)]++;
+        if (width < s.minWidth[kind]) {
+            s.minWidth[kind] = width;
+        }
+        if (width > s.maxWidth[kind]) {
+            s.maxWidth[kind] = width;
+        }
+    }
+    lastEdge[ch] = at;
+}
+
+/* Samples [from, to) of a block, to > from */
+void ChannelStats::account(unsigned ch, const uint64_t *plane, size_t from, size_t to, uint64_t firstSample) {
+    Slice &s = slice(ch, head);
+    size_t last = (to - 1) / 64;
+
+    for (size_t w = from / 64; w <= last; w++) {
+        uint64_t x = plane[w];
+        uint64_t before = w ? plane[w - 1] >> 63 : (level >> ch) & 1;
+        uint64_t e = x ^ ((x << 1) | before);
+        uint64_t m = ~(uint64_t) 0;
+        if (w == from / 64) {
+            m &= ~(uint64_t) 0 << (from % 64);
+        }
+        if (w == last && to % 64) {
+            m &= ((uint64_t) 1 << (to % 64)) - 1;
+        }
+
+        s.high += __builtin_popcountll(x & m);
+        e &= m;
+        if (!e) {
+            continue;
+        }
+        uint64_t r = e & x;
+        s.edges += __builtin_popcountll(e);
+        s.rising += __builtin_popcountll(r);
+        uint64_t base = firstSample + w * 64;
+        if (r) {
+            uint64_t at = base + __builtin_ctzll(r);
+            if (s.rising == (uint64_t) __builtin_popcountll(r)) {
+                s.firstRise = at;
+            }
+            s.lastRise = base + 63 - __builtin_clzll(r);
+        }
+        while (e) {
+            unsigned i = __builtin_ctzll(e);
+            pulse(ch, base + i, (x >> i) & 1);
+            e &= e - 1;
+        }
+    }
+}
+
+void ChannelStats::closeSlice() {
+    sliceEnd += cfg.sliceSamples;
+    if (filled < cfg.windowSlices) {
+        filled++;
+    }
+    head = (head + 1) % (cfg.windowSlices + 1);
+    for (unsigned ch = 0; ch < numChannels; ch++) {
+        Slice &s = slice(ch, head);
+        memset(&s, 0, sizeof(s));
+        s.minWidth[PULSE_HIGH] = s.minWidth[PULSE_LOW] = UINT64_MAX;
+    }
+    sliceLength[head] = 0;
+    if (++sinceSnapshot == cfg.publishSlices) {
+        sinceSnapshot = 0;
+        publish();
+    }
+}
+
+void ChannelStats::add(const Bitplanes &bp) {
+    size_t n = bp.samples();
+    if (n == 0) {
+        return;
+    }
+    assert(bp.channels() >= numChannels);
+
+    if (!started || bp.firstSample != next) {
+        /* Nothing is known about the line before, so no edge at sample 0 */
+        level = 0;
+        for (unsigned ch = 0; ch < numChannels; ch++) {
+            level |= (bp.plane(ch)[0] & 1) << ch;
+            lastEdge[ch] = NO_EDGE;
+        }
+        if (started && sliceLength[head]) {
+            closeSlice();
+        }
+        sliceEnd = bp.firstSample + cfg.sliceSamples;
+        started = true;
+    }
+
+    size_t pos = 0;
+    while (pos < n) {
+        size_t end = (size_t) min<uint64_t>(n, sliceEnd - bp.firstSample);
+        for (unsigned ch = 0; ch < numChannels; ch++) {
+            account(ch, bp.plane(ch), pos, end, bp.firstSample);
+        }
+        sliceLength[head] += end - pos;
+        pos = end;
+        if (bp.firstSample + pos == sliceEnd) {
+            closeSlice();
+        }
+    }
+
+    level = 0;
+    for (unsigned ch = 0; ch < numChannels; ch++) {
+        level |= (uint64_t) bp.bit(ch, n - 1) << ch;
+    }
+    next = bp.firstSample + n;
+}
+
+void ChannelStats::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+    add(planes);
+}
+
+void ChannelStats::summarize(const uint32_t *widths, uint64_t count, uint64_t min, uint64_t max, PulseSummary &out) {
+    out.count = count;
+    out.min = count ? min : 0;
+    out.max = max;
+    percentiles(widths, count, min, max, out.p50, out.p99);
+}
+
+void ChannelStats::publish() {
+    StatsSnapshot snap;
+    unsigned ring = cfg.windowSlices + 1;
+    uint32_t widths[2][STATS_WIDTH_BUCKETS];
+
+    memset(&snap, 0, sizeof(snap));
+    snap.sample = sliceEnd - cfg.sliceSamples;
+    snap.samplerate = cfg.samplerate;
+    snap.channels = numChannels;
+    /* Closed slices, oldest first */
+    unsigned oldest = (head + ring - filled) % ring;
+    for (unsigned k = 0; k < filled; k++) {
+        snap.window += sliceLength[(oldest + k) % ring];
+    }
+
+    for (unsigned ch = 0; ch < numChannels; ch++) {
+        ChannelSummary &c = snap.channel[ch];
+        uint64_t high = 0, firstRise = 0, lastRise = 0;
+        uint64_t count[2] = { 0, 0 }, minW[2] = { UINT64_MAX, UINT64_MAX }, maxW[2] = { 0, 0 };
+        memset(widths, 0, sizeof(widths));
+
+        for (unsigned k = 0; k < filled; k++) {
+            const Slice &s = slice(ch, (oldest + k) % ring);
+            high += s.high;
+            c.edges += s.edges;
+            if (s.rising) {
+                if (c.rising == 0) {
+                    firstRise = s.firstRise;
+                }
+                lastRise = s.lastRise;
+                c.rising += s.rising;
+            }
+            for (unsigned kind = 0; kind < 2; kind++) {
+                for (unsigned b = 0; b < STATS_WIDTH_BUCKETS; b++) {
+                    widths[kind][b] += s.widths[kind][b];
+                    count[kind] += s.widths[kind][b];
+                }
+                minW[kind] = s.minWidth[kind] < minW[kind] ? s.minWidth[kind] : minW[kind];
+                maxW[kind] = s.maxWidth[kind] > maxW[kind] ? s.maxWidth[kind] : maxW[kind];
+            }
+        }
+
+        if (c.rising >= 2 && lastRise > firstRise) {
+            c.frequency = (double) (c.rising - 1) * cfg.samplerate / (double) (lastRise - firstRise);
+        }
+        c.duty = snap.window ? (double) high / (double) snap.window : 0;
+        summarize(widths[PULSE_HIGH], count[PULSE_HIGH], minW[PULSE_HIGH], maxW[PULSE_HIGH], c.high);
+        summarize(widths[PULSE_LOW], count[PULSE_LOW], minW[PULSE_LOW], maxW[PULSE_LOW], c.low);
+    }
+    latest.publish(snap);
+}
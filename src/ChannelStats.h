@@ -0,0 +1,151 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_CHANNELSTATS_H
+#define TTT_CHANNELSTATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "LatestValue.h"
+#include "sigrok_wrapper.h"
+
+/* Pulse widths below this are counted exactly, above it in 1/8 octaves */
+#define STATS_EXACT_WIDTHS 16
+#define STATS_WIDTH_BUCKETS (STATS_EXACT_WIDTHS + 8 * 40)
+
+struct ChannelStatsConfig {
+    uint64_t samplerate;
+    /** The window moves by one slice at a time */
+    uint64_t sliceSamples;
+    unsigned windowSlices;
+    /** A snapshot is published every this many slices */
+    unsigned publishSlices;
+};
+
+/* Pulse widths in samples: min, max and percentiles of complete pulses */
+struct PulseSummary {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p99;
+};
+
+struct ChannelSummary {
+    /** Rising edges per second, from the first to the last in the window */
+    double frequency;
+    /** Fraction of the window the line was high */
+    double duty;
+    uint64_t edges;
+    uint64_t rising;
+    PulseSummary high;
+    PulseSummary low;
+};
+
+struct StatsSnapshot {
+    /** Absolute sample the window ends at, and its length */
+    uint64_t sample;
+    uint64_t window;
+    uint64_t samplerate;
+    unsigned channels;
+    ChannelSummary channel[BITPLANE_MAX_CHANNELS];
+};
+
+/*
+ * Streaming per-channel statistics over a sliding window. High time and
+ * edge counts come from popcounts of each plane word and of its XOR with
+ * itself shifted by one sample; only the edges themselves are visited to
+ * measure pulse widths into log-linear histograms.
+ *
+ * The window is kept as a ring of slices; every publishSlices slices the
+ * slices are summed into a StatsSnapshot which readers on other threads
+ * copy through snapshot() without locks.
+ */
+class ChannelStats {
+public:
+    ChannelStats(unsigned numChannels, const ChannelStatsConfig &config);
+
+    void reset();
+
+    /* Account a block; blocks follow each other, a gap ends all pulses */
+    void add(const Bitplanes &bp);
+    /* Capture callback side: gather a Logic16 packet and add it */
+    void process(const sr_wrap_packet_t *packet);
+
+    /* Any thread: the latest published snapshot, false before the first */
+    bool snapshot(StatsSnapshot &out) const { return latest.read(out); }
+    uint32_t published() const { return latest.version(); }
+
+    static unsigned bucket(uint64_t width);
+    static uint64_t bucketLow(unsigned bucket);
+    /* p50 and p99 of the count values in a histogram of bucket(), within [min, max] */
+    template<class T>
+    static void percentiles(const T *histogram, uint64_t count, uint64_t min, uint64_t max,
+                            uint64_t &p50, uint64_t &p99);
+
+private:
+    struct Slice {
+        uint64_t high;
+        uint64_t edges;
+        uint64_t rising;
+        uint64_t firstRise;
+        uint64_t lastRise;
+        uint64_t minWidth[2];
+        uint64_t maxWidth[2];
+        uint32_t widths[2][STATS_WIDTH_BUCKETS];
+    };
+
+    Slice &slice(unsigned ch, unsigned index) {
+        return slices[index * numChannels + ch];
+    }
+    void account(unsigned ch, const uint64_t *plane, size_t from, size_t to, uint64_t firstSample);
+    void pulse(unsigned ch, uint64_t at, bool rising);
+    void closeSlice();
+    void publish();
+    static void summarize(const uint32_t *widths, uint64_t count, uint64_t min, uint64_t max, PulseSummary &out);
+
+    unsigned numChannels;
+    ChannelStatsConfig cfg;
+    std::vector<Slice> slices;
+    std::vector<uint64_t> sliceLength;
+    /* Slice being filled, and how many of the ring hold data */
+    unsigned head;
+    unsigned filled;
+    unsigned sinceSnapshot;
+    bool started;
+    uint64_t next;
+    uint64_t sliceEnd;
+    /* Channel levels at the last sample */
+    uint64_t level;
+    uint64_t lastEdge[BITPLANE_MAX_CHANNELS];
+    Bitplanes planes;
+    LatestValue<StatsSnapshot> latest;
+};
+
+template<class T>
+void ChannelStats::percentiles(const T *histogram, uint64_t count, uint64_t min, uint64_t max,
+                               uint64_t &p50, uint64_t &p99) {
+    const double q[2] = { 0.5, 0.99 };
+    uint64_t *value[2] = { &p50, &p99 };
+    uint64_t seen = 0;
+    unsigned k = 0;
+    p50 = 0;
+    p99 = 0;
+    if (!count) {
+        return;
+    }
+    for (unsigned b = 0; b < STATS_WIDTH_BUCKETS && k < 2; b++) {
+        seen += histogram[b];
+        while (k < 2 && seen >= q[k] * count) {
+            /* Middle of the bucket, within what was seen */
+            uint64_t low = bucketLow(b);
+            uint64_t v = b < STATS_EXACT_WIDTHS ? low : low + (bucketLow(b + 1) - low) / 2;
+            *value[k++] = v < min ? min : v > max ? max : v;
+        }
+    }
+}
+
+#endif //TTT_CHANNELSTATS_H
@@ -0,0 +1,141 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "ClockedSampler.h"
+#include <assert.h>
+
+using namespace std;
+
+/* Edges in a 64-sample word from which transposing beats gathering */
+#define CLOCKED_DENSE_EDGES 6
+
+ClockedSampler::ClockedSampler(const ClockedConfig &config, unsigned numChannels)
+    : cfg(config)
+    , numChannels(numChannels)
+    , dataBits(0)
+    , planes(numChannels) {
+    assert(cfg.clock < numChannels);
+    assert(cfg.edge != 0 && (cfg.edge & ~EDGE_BOTH) == 0);
+    assert(cfg.enable < (int) numChannels);
+    assert(cfg.dataMask && (cfg.dataMask >> numChannels) == 0);
+
+    for (unsigned ch = 0; ch < numChannels; ch++) {
+        if (cfg.dataMask & (1 << ch)) {
+            dataChannels[dataBits++] = ch;
+        }
+    }
+    unsigned lowBits = __builtin_popcount(cfg.dataMask & 0xff);
+    for (unsigned v = 0; v < 256; v++) {
+        uint16_t lo = 0, hi = 0;
+        for (unsigned k = 0, n = 0; k < 8; k++) {
+            if (cfg.dataMask & (1 << k)) {
+                lo |= ((v >> k) & 1) << n++;
+            }
+        }
+        for (unsigned k = 0, n = lowBits; k < 8; k++) {
+            if (cfg.dataMask & (0x100 << k)) {
+                hi |= ((v >> k) & 1) << n++;
+            }
+        }
+        packLow[v] = lo;
+        packHigh[v] = hi;
+    }
+    reset();
+}
+
+void ClockedSampler::reset() {
+    started = false;
+    clockLevel = false;
+}
+
+void ClockedSampler::latch(const Bitplanes &bp, size_t w, uint64_t edges,
+                           vector<uint16_t> &words, vector<uint64_t> &samples) {
+    uint64_t base = bp.firstSample + w * 64;
+
+    if (__builtin_popcountll(edges) >= CLOCKED_DENSE_EDGES) {
+        uint16_t group[16];
+        for (unsigned g = 0; g < 4; g++) {
+            unsigned m = (unsigned) (edges >> (16 * g)) & 0xffff;
+            if (!m) {
+                continue;
+            }
+            bitplane_samples16(bp, w * 64 + 16 * g, group);
+            while (m) {
+                unsigned i = __builtin_ctz(m);
+                words.push_back(pack(group[i]));
+                samples.push_back(base + 16 * g + i);
+                m &= m - 1;
+            }
+        }
+        return;
+    }
+
+    while (edges) {
+        unsigned i = __builtin_ctzll(edges);
+        uint16_t v = 0;
+        for (unsigned k = 0; k < dataBits; k++) {
+            v |= (uint16_t) (((bp.plane(dataChannels[k])[w] >> i) & 1) << k);
+        }
+        words.push_back(v);
+        samples.push_back(base + i);
+        edges &= edges - 1;
+    }
+}
+
+size_t ClockedSampler::sample(const Bitplanes &bp, vector<uint16_t> &words, vector<uint64_t> &samples) {
+    size_t n = bp.samples();
+    size_t before = words.size();
+    if (n == 0) {
+        return 0;
+    }
+
+    const uint64_t *clk = bp.plane(cfg.clock);
+    const uint64_t *en = cfg.enable >= 0 ? bp.plane((unsigned) cfg.enable) : NULL;
+    uint64_t flip = cfg.enableActiveLow ? ~(uint64_t) 0 : 0;
+    size_t full = n / 64;
+    size_t nw = (n + 63) / 64;
+
+    if (!started) {
+        clockLevel = clk[0] & 1;
+        started = true;
+    }
+    uint64_t carry = clockLevel ? 1 : 0;
+    size_t w = 0;
+
+    while (w < nw) {
+        if (w + 2 <= full) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(clk + w));
+            __m128i sh = _mm_or_si128(_mm_slli_epi64(x, 1), _mm_slli_si128(_mm_srli_epi64(x, 63), 8));
+            __m128i e = _mm_xor_si128(x, _mm_or_si128(sh, _mm_cvtsi64_si128((long long) carry)));
+            if (_mm_testz_si128(e, e)) {
+                carry = clk[w + 1] >> 63;
+                w += 2;
+                continue;
+            }
+        }
+        uint64_t valid = w < full ? ~(uint64_t) 0 : ((uint64_t) 1 << (n % 64)) - 1;
+        uint64_t x = clk[w] & valid;
+        uint64_t e = edge_select(edge_word(x, carry), x, cfg.edge) & valid;
+        if (w == full) {
+            carry = (x >> (n % 64 - 1)) & 1;
+        }
+        if (en) {
+            e &= en[w] ^ flip;
+        }
+        if (e) {
+            latch(bp, w, e, words, samples);
+        }
+        w++;
+    }
+    clockLevel = carry != 0;
+    return words.size() - before;
+}
+
+size_t ClockedSampler::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+    wordList.clear();
+    sampleList.clear();
+    return sample(planes, wordList, sampleList);
+}
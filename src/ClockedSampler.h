@@ -0,0 +1,79 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_CLOCKEDSAMPLER_H
+#define TTT_CLOCKEDSAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "EdgeScan.h"
+#include "sigrok_wrapper.h"
+
+#define CLOCKED_NO_ENABLE (-1)
+
+struct ClockedConfig {
+    unsigned clock;
+    /** EDGE_RISING, EDGE_FALLING or EDGE_BOTH */
+    unsigned edge;
+    /** Channels latched, packed into the low bits of a word in channel order */
+    uint16_t dataMask;
+    /** Qualifier sampled with the data, CLOCKED_NO_ENABLE for none */
+    int enable;
+    bool enableActiveLow;
+};
+
+/*
+ * Synchronous parallel bus sampler: latches the data lines on the chosen
+ * clock edges, optionally only while an enable line is active.
+ *
+ * Clock edges and the enable qualifier are combined 64 samples at a time
+ * on the planes, idle clock is skipped two words per SSE test. Where edges
+ * are dense, 16 samples are transposed back to sample words with SSE and
+ * picked from; sparse edges gather their bits plane by plane.
+ *
+ * The first sample of a capture is never an edge, blocks must follow each
+ * other and an edge may fall on the first sample of a block.
+ */
+class ClockedSampler {
+public:
+    ClockedSampler(const ClockedConfig &config, unsigned numChannels = 16);
+
+    void reset();
+
+    /* Append the latched words and the samples of their edges, returns how many */
+    size_t sample(const Bitplanes &bp, std::vector<uint16_t> &words, std::vector<uint64_t> &samples);
+
+    /* Capture callback side: gather a Logic16 packet and sample it */
+    size_t process(const sr_wrap_packet_t *packet);
+    const std::vector<uint16_t> &words() const { return wordList; }
+    const std::vector<uint64_t> &samples() const { return sampleList; }
+
+    /* Width of the latched words */
+    unsigned bits() const { return dataBits; }
+
+private:
+    void latch(const Bitplanes &bp, size_t w, uint64_t edges,
+               std::vector<uint16_t> &words, std::vector<uint64_t> &samples);
+
+    uint16_t pack(uint16_t s) const {
+        return (uint16_t) (packLow[s & 0xff] | packHigh[s >> 8]);
+    }
+
+    ClockedConfig cfg;
+    unsigned numChannels;
+    unsigned dataBits;
+    unsigned dataChannels[BITPLANE_MAX_CHANNELS];
+    /* Packed data bits of either byte of a sample word */
+    uint16_t packLow[256];
+    uint16_t packHigh[256];
+    bool started;
+    bool clockLevel;
+    Bitplanes planes;
+    std::vector<uint16_t> wordList;
+    std::vector<uint64_t> sampleList;
+};
+
+#endif //TTT_CLOCKEDSAMPLER_H
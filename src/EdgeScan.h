@@ -0,0 +1,119 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_EDGESCAN_H
+#define TTT_EDGESCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <smmintrin.h>
+
+#define EDGE_RISING  1
+#define EDGE_FALLING 2
+#define EDGE_BOTH    (EDGE_RISING | EDGE_FALLING)
+
+/*
+ * Transitions of one 64-sample word: bit i is set where sample i differs
+ * from sample i - 1. carry holds the sample before bit 0 and is advanced.
+ */
+inline uint64_t edge_word(uint64_t x, uint64_t &carry) {
+    uint64_t e = x ^ ((x << 1) | carry);
+    carry = x >> 63;
+    return e;
+}
+
+inline uint64_t edge_select(uint64_t edges, uint64_t x, unsigned which) {
+    uint64_t keep = 0;
+    if (which & EDGE_RISING) {
+        keep |= x;
+    }
+    if (which & EDGE_FALLING) {
+        keep |= ~x;
+    }
+    return edges & keep;
+}
+
+template<class F>
+inline void edge_emit(uint64_t mask, uint64_t x, size_t base, F &fn) {
+    while (mask) {
+        unsigned i = __builtin_ctzll(mask);
+        fn(base + i, ((x >> i) & 1) != 0);
+        mask &= mask - 1;
+    }
+}
+
+/*
+ * Call fn(index, rising) for every selected edge in the first samples of
+ * a bit plane, in order. level is the line before sample 0 on entry and
+ * the level of the last sample on return. Two words are tested per SSE
+ * op, so an idle line costs almost nothing.
+ */
+template<class F>
+inline void edge_scan(const uint64_t *plane, size_t samples, bool &level, unsigned which, F fn) {
+    size_t full = samples / 64;
+    uint64_t carry = level ? 1 : 0;
+    size_t w = 0;
+
+    for (; w + 2 <= full; w += 2) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane + w));
+        __m128i sh = _mm_or_si128(_mm_slli_epi64(x, 1), _mm_slli_si128(_mm_srli_epi64(x, 63), 8));
+        __m128i e = _mm_xor_si128(x, _mm_or_si128(sh, _mm_cvtsi64_si128((long long) carry)));
+        carry = plane[w + 1] >> 63;
+        if (_mm_testz_si128(e, e)) {
+            continue;
+        }
+        edge_emit(edge_select((uint64_t) _mm_cvtsi128_si64(e), plane[w], which), plane[w], w * 64, fn);
+        edge_emit(edge_select((uint64_t) _mm_extract_epi64(e, 1), plane[w + 1], which), plane[w + 1], (w + 1) * 64, fn);
+    }
+    for (; w < full; w++) {
+        uint64_t e = edge_word(plane[w], carry);
+        edge_emit(edge_select(e, plane[w], which), plane[w], w * 64, fn);
+    }
+    if (samples % 64) {
+        uint64_t valid = ((uint64_t) 1 << (samples % 64)) - 1;
+        uint64_t x = plane[w] & valid;
+        uint64_t e = edge_word(x, carry) & valid;
+        edge_emit(edge_select(e, x, which), x, w * 64, fn);
+        carry = (x >> (samples % 64 - 1)) & 1;
+    }
+    if (samples) {
+        level = carry != 0;
+    }
+}
+
+/*
+ * Index of the first selected edge at or after from, samples if there is
+ * none. level is the line before sample 0. Quiet stretches are skipped
+ * two words per SSE test like edge_scan.
+ */
+inline size_t edge_find(const uint64_t *plane, size_t samples, size_t from, bool level, unsigned which) {
+    if (from >= samples) {
+        return samples;
+    }
+    size_t w = from / 64;
+    size_t words = (samples + 63) / 64;
+    uint64_t carry = w ? plane[w - 1] >> 63 : (level ? 1 : 0);
+    uint64_t e = edge_select(edge_word(plane[w], carry), plane[w], which) & (~(uint64_t) 0 << (from % 64));
+
+    while (!e) {
+        w++;
+        for (; w + 2 <= words; w += 2) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane + w));
+            __m128i sh = _mm_or_si128(_mm_slli_epi64(x, 1), _mm_slli_si128(_mm_srli_epi64(x, 63), 8));
+            __m128i d = _mm_xor_si128(x, _mm_or_si128(sh, _mm_cvtsi64_si128((long long) carry)));
+            if (!_mm_testz_si128(d, d)) {
+                break;
+            }
+            carry = plane[w + 1] >> 63;
+        }
+        if (w >= words) {
+            return samples;
+        }
+        e = edge_select(edge_word(plane[w], carry), plane[w], which);
+    }
+    size_t i = w * 64 + __builtin_ctzll(e);
+    return i < samples ? i : samples;
+}
+
+#endif //TTT_EDGESCAN_H
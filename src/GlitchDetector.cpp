@@ -0,0 +1,140 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "GlitchDetector.h"
+#include <assert.h>
+#include <string.h>
+
+using namespace std;
+
+typedef unsigned __int128 u128;
+
+GlitchDetector::GlitchDetector(unsigned numChannels, unsigned threshold)
+    : numChannels(numChannels)
+    , planes(numChannels) {
+    assert(numChannels > 0 && numChannels <= BITPLANE_MAX_CHANNELS);
+    for (unsigned ch = 0; ch < BITPLANE_MAX_CHANNELS; ch++) {
+        setThreshold(ch, threshold);
+    }
+    reset();
+}
+
+void GlitchDetector::setThreshold(unsigned ch, unsigned threshold) {
+    assert(ch < BITPLANE_MAX_CHANNELS && threshold <= GLITCH_MAX_THRESHOLD);
+    thresholds[ch] = threshold;
+}
+
+void GlitchDetector::reset() {
+    memset(history, 0, sizeof(history));
+    memset(counts, 0, sizeof(counts));
+    started = false;
+    next = 0;
+    total = 0;
+    scanned = 0;
+}
+
+/*
+ * Bit i of the result is set when sample i and the width samples before it
+ * are equal. same has bit i set when sample i equals sample i - 1; runs of
+ * it are ANDed together by doubling.
+ */
+static u128 runs(u128 same, unsigned width) {
+    u128 run = ~(u128) 0;
+    unsigned length = 0, span = 1;
+
+    for (; width; width >>= 1) {
+        if (width & 1) {
+            run &= same << length;
+            length += span;
+        }
+        same &= same << span;
+        span *= 2;
+    }
+    return run;
+}
+
+size_t GlitchDetector::scan(unsigned ch, const uint64_t *plane, size_t n, uint64_t firstSample, vector<Glitch> &out) {
+    const unsigned width = thresholds[ch] - 1;
+    GlitchTotals &t = counts[ch];
+    uint64_t h = history[ch];
+    size_t found = 0;
+
+    for (size_t w = 0; w * 64 < n; w++) {
+        unsigned valid = n - w * 64 < 64 ? (unsigned) (n - w * 64) : 64;
+        uint64_t mask = valid == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << valid) - 1;
+        uint64_t x = plane[w] & mask;
+        uint64_t e = (x ^ ((x << 1) | (h >> 63))) & mask;
+        /* The word after the 64 samples before it */
+        u128 v = (u128) h | (u128) x << 64;
+        h = (uint64_t) (v >> valid);
+        if (!e) {
+            continue;
+        }
+
+        /* An edge ends a glitch unless the run before it is long enough */
+        u128 edges = v ^ (v << 1);
+        uint64_t g = e & ~(uint64_t) (runs(~edges, width) >> 63);
+        while (g) {
+            unsigned j = __builtin_ctzll(g);
+            /* The run is at most width samples, so its start is in v */
+            u128 before = edges & ((((u128) 1) << (64 + j)) - 1);
+            uint64_t hi = (uint64_t) (before >> 64);
+            unsigned start = hi ? 127 - __builtin_clzll(hi) : 63 - __builtin_clzll((uint64_t) before);
+
+            Glitch glitch;
+            glitch.width = 64 + j - start;
+            glitch.sample = firstSample + w * 64 + j - glitch.width;
+            glitch.channel = (uint8_t) ch;
+            glitch.level = (uint8_t) ((v >> (63 + j)) & 1);
+            out.push_back(glitch);
+
+            if (glitch.level) {
+                t.high++;
+            } else {
+                t.low++;
+            }
+            if (t.narrowest == 0 || glitch.width < t.narrowest) {
+                t.narrowest = glitch.width;
+            }
+            t.lastSample = glitch.sample;
+            found++;
+            g &= g - 1;
+        }
+    }
+    history[ch] = h;
+    return found;
+}
+
+size_t GlitchDetector::add(const Bitplanes &bp, vector<Glitch> &out) {
+    size_t n = bp.samples();
+    size_t found = 0;
+    if (n == 0) {
+        return 0;
+    }
+
+    if (!started || bp.firstSample != next) {
+        /* Nothing known before the block: the first level has always been */
+        for (unsigned ch = 0; ch < numChannels; ch++) {
+            history[ch] = bp.bit(ch, 0) ? ~(uint64_t) 0 : 0;
+        }
+        started = true;
+    }
+    for (unsigned ch = 0; ch < numChannels; ch++) {
+        if (thresholds[ch] < 2) {
+            history[ch] = (bp.plane(ch)[(n - 1) / 64] >> ((n - 1) % 64)) & 1 ? ~(uint64_t) 0 : 0;
+            continue;
+        }
+        found += scan(ch, bp.plane(ch), n, bp.firstSample, out);
+    }
+    next = bp.firstSample + n;
+    scanned += n;
+    total += found;
+    return found;
+}
+
+size_t GlitchDetector::process(const sr_wrap_packet_t *packet, vector<Glitch> &out) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+    return add(planes, out);
+}
@@ -0,0 +1,83 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_GLITCHDETECTOR_H
+#define TTT_GLITCHDETECTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "sigrok_wrapper.h"
+
+/* Widest threshold: the history kept per channel is one plane word */
+#define GLITCH_MAX_THRESHOLD 64
+#define GLITCH_DEFAULT_THRESHOLD 3
+
+struct Glitch {
+    /** Absolute index of the first sample of the pulse */
+    uint64_t sample;
+    uint32_t width;
+    uint8_t channel;
+    /** Level of the pulse: 1 for a high spike, 0 for a low dropout */
+    uint8_t level;
+};
+
+struct GlitchTotals {
+    uint64_t high;
+    uint64_t low;
+    /** Narrowest pulse seen, 0 before the first */
+    uint32_t narrowest;
+    uint64_t lastSample;
+};
+
+/*
+ * Flags pulses narrower than a per-channel threshold, on every channel of
+ * one device. A word without edges costs one shift and XOR; otherwise a
+ * mask of samples that continue a run of at least threshold equal samples
+ * is built by doubling shifts over the word and the 64 samples before it,
+ * and every edge outside that mask ends a glitch.
+ *
+ * Pulses that start before the first block or before a gap in the sample
+ * numbers have no known width and are never reported.
+ */
+class GlitchDetector {
+public:
+    explicit GlitchDetector(unsigned numChannels, unsigned threshold = GLITCH_DEFAULT_THRESHOLD);
+
+    /* Report pulses narrower than threshold samples on ch, 0 turns it off */
+    void setThreshold(unsigned ch, unsigned threshold);
+    unsigned threshold(unsigned ch) const { return thresholds[ch]; }
+
+    /* Forget the line history and totals */
+    void reset();
+
+    /*
+     * Scan a block, appending glitches to out grouped by channel and in
+     * sample order within a channel. Returns the number appended.
+     */
+    size_t add(const Bitplanes &bp, std::vector<Glitch> &out);
+    /* Capture callback side: gather a Logic16 packet and add it */
+    size_t process(const sr_wrap_packet_t *packet, std::vector<Glitch> &out);
+
+    const GlitchTotals &totals(unsigned ch) const { return counts[ch]; }
+    uint64_t glitches() const { return total; }
+    uint64_t samples() const { return scanned; }
+
+private:
+    size_t scan(unsigned ch, const uint64_t *plane, size_t n, uint64_t firstSample, std::vector<Glitch> &out);
+
+    unsigned numChannels;
+    unsigned thresholds[BITPLANE_MAX_CHANNELS];
+    /* The last 64 samples of each channel, bit 63 the newest */
+    uint64_t history[BITPLANE_MAX_CHANNELS];
+    GlitchTotals counts[BITPLANE_MAX_CHANNELS];
+    bool started;
+    uint64_t next;
+    uint64_t total;
+    uint64_t scanned;
+    Bitplanes planes;
+};
+
+#endif //TTT_GLITCHDETECTOR_H
@@ -0,0 +1,81 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "HistoryRing.h"
+#include <assert.h>
+
+using namespace std;
+
+HistoryRing::HistoryRing(int id, uint64_t samplerate, double seconds, size_t maxBuffers)
+    : id(id)
+    , windowSamples((uint64_t) (samplerate * seconds))
+    , ring(maxBuffers)
+    , head(0)
+    , count(0)
+    , lastSpan(0) {
+    assert(maxBuffers > 0);
+}
+
+uint64_t HistoryRing::endSample(size_t i) {
+    if (i + 1 < count) {
+        return at(i + 1)->sample;
+    }
+    return at(i)->sample + lastSpan;
+}
+
+void HistoryRing::evict() {
+    at(0).reset();
+    head = (head + 1) % ring.size();
+    count--;
+}
+
+void HistoryRing::push(PacketHandle &&packet) {
+    lock_guard<mutex> lock(mtx);
+
+    if (count) {
+        lastSpan = packet->sample - at(count - 1)->sample;
+    }
+    if (count == ring.size()) {
+        evict();
+    }
+    at(count++) = std::move(packet);
+
+    /* Drop buffers that ended before the window */
+    while (count > 1 && endSample(0) + windowSamples <= endSample(count - 1)) {
+        evict();
+    }
+}
+
+HistoryWindow HistoryRing::freeze(uint64_t sample, uint64_t preSamples) {
+    lock_guard<mutex> lock(mtx);
+    uint64_t from = sample > preSamples ? sample - preSamples : 0;
+    HistoryWindow window;
+
+    window.id = id;
+    window.firstSample = 0;
+    while (count) {
+        PacketHandle &packet = at(0);
+        if (endSample(0) > from && packet->sample <= sample) {
+            if (window.buffers.empty()) {
+                window.firstSample = packet->sample;
+            }
+            window.buffers.push_back(std::move(packet));
+            head = (head + 1) % ring.size();
+            count--;
+        } else {
+            evict();
+        }
+    }
+    return window;
+}
+
+size_t HistoryRing::buffers() {
+    lock_guard<mutex> lock(mtx);
+    return count;
+}
+
+uint64_t HistoryRing::span() {
+    lock_guard<mutex> lock(mtx);
+    return count ? endSample(count - 1) - at(0)->sample : 0;
+}
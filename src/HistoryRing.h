@@ -0,0 +1,69 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_HISTORYRING_H
+#define TTT_HISTORYRING_H
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include "PacketHandle.h"
+
+/*
+ * Frozen pre-trigger history. The buffers go back to their pool when the
+ * last handle to them is dropped.
+ */
+struct HistoryWindow {
+    int id;
+    /** Absolute index of the first sample of the first buffer */
+    uint64_t firstSample;
+    std::vector<PacketHandle> buffers;
+};
+
+/*
+ * Keeps the most recent completed transfers of one device without copying
+ * them. The ring holds a handle to each transfer and drops it once the
+ * transfer falls out of the history window, so the ring pins at most
+ * maxBuffers transfers per device.
+ *
+ * push() is called from the receive path with a completed transfer whose
+ * packet.sample is set; the receive path then resubmits a fresh transfer
+ * from the pool. freeze() may be called from any thread.
+ */
+class HistoryRing {
+public:
+    HistoryRing(int id, uint64_t samplerate, double seconds, size_t maxBuffers);
+
+    HistoryRing(const HistoryRing&) = delete;
+    HistoryRing& operator = (const HistoryRing&) = delete;
+
+    /* Hold a reference to a completed transfer */
+    void push(PacketHandle &&packet);
+
+    /*
+     * Hand over the buffers covering [sample - preSamples, sample] and drop
+     * the rest of the history. Capture continues into fresh buffers.
+     */
+    HistoryWindow freeze(uint64_t sample, uint64_t preSamples);
+
+    size_t buffers();
+    /* Samples currently covered by the ring */
+    uint64_t span();
+
+private:
+    PacketHandle &at(size_t i) { return ring[(head + i) % ring.size()]; }
+    uint64_t endSample(size_t i);
+    void evict();
+
+    int id;
+    uint64_t windowSamples;
+    std::mutex mtx;
+    std::vector<PacketHandle> ring;
+    size_t head;
+    size_t count;
+    /* Samples in the newest packet, learnt from consecutive packets */
+    uint64_t lastSpan;
+};
+
+#endif //TTT_HISTORYRING_H
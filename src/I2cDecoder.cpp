@@ -0,0 +1,208 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "I2cDecoder.h"
+#include <assert.h>
+#include <smmintrin.h>
+
+using namespace std;
+
+static const vector<uint32_t> none;
+
+I2cDecoder::I2cDecoder(unsigned sclChannel, unsigned sdaChannel, unsigned numChannels)
+    : scl(sclChannel)
+    , sda(sdaChannel)
+    , numChannels(numChannels)
+    , planes(numChannels) {
+    assert(scl < numChannels && sda < numChannels && scl != sda);
+    reset();
+}
+
+void I2cDecoder::reset() {
+    /* Both lines idle high behind their pull-ups */
+    sclLevel = true;
+    sdaLevel = true;
+    active = false;
+    clocked = false;
+    clockedBit = 0;
+    bitCount = 0;
+    byteCount = 0;
+    shift = 0;
+    tenBitKnown = false;
+    tenBitPending = false;
+    tenBitAddress = 0;
+    transactionList.clear();
+    dataStream.clear();
+    for (auto &v : index) {
+        v.clear();
+    }
+}
+
+unsigned I2cDecoder::slot(uint16_t address, bool read, bool tenBit) {
+    unsigned s = tenBit ? 128 + (address & 0x3ff) : (address & 0x7f);
+    return s * 2 + (read ? 1 : 0);
+}
+
+const vector<uint32_t> &I2cDecoder::find(uint16_t address, bool read, bool tenBit) const {
+    if (address >= (tenBit ? 1024 : 128)) {
+        return none;
+    }
+    return index[slot(address, read, tenBit)];
+}
+
+void I2cDecoder::finish(uint64_t sample, uint8_t flags) {
+    /* Only a repeated START carries a 10-bit address over to a read */
+    tenBitPending = active && tenBitKnown && (flags & I2C_FLAG_RESTART);
+    tenBitAddress = current.address;
+    /* Nothing to file without an address */
+    if (active && byteCount > 0) {
+        current.end = sample;
+        current.flags |= flags | (bitCount ? I2C_FLAG_PARTIAL : 0);
+        index[slot(current.address, (current.flags & I2C_FLAG_READ) != 0,
+                   (current.flags & I2C_FLAG_TENBIT) != 0)].push_back((uint32_t) transactionList.size());
+        transactionList.push_back(current);
+    }
+    active = false;
+    clocked = false;
+}
+
+void I2cDecoder::onStart(uint64_t sample) {
+    finish(sample, I2C_FLAG_RESTART);
+    active = true;
+    current.start = sample;
+    current.end = sample;
+    current.dataOffset = (uint32_t) dataStream.size();
+    current.length = 0;
+    current.acked = 0;
+    current.address = 0;
+    current.flags = 0;
+    bitCount = 0;
+    byteCount = 0;
+    shift = 0;
+    tenBitKnown = false;
+}
+
+void I2cDecoder::onStop(uint64_t sample) {
+    finish(sample, 0);
+}
+
+void I2cDecoder::onBit(unsigned bit) {
+    if (!active) {
+        return;
+    }
+    if (bitCount < 8) {
+        shift = (uint8_t) (shift << 1 | bit);
+        bitCount++;
+        return;
+    }
+    /* Ninth clock: the receiver pulls SDA low to acknowledge */
+    bool ack = bit == 0;
+    bitCount = 0;
+
+    if (byteCount == 0) {
+        current.flags |= (shift & 1) ? I2C_FLAG_READ : 0;
+        current.flags |= ack ? 0 : I2C_FLAG_NACK;
+        if ((shift & 0xf8) == 0xf0) {
+            /* 11110xx: the top address bits, the rest follows a write */
+            current.flags |= I2C_FLAG_TENBIT;
+            current.address = (uint16_t) ((shift >> 1 & 3) << 8);
+            if ((shift & 1) && tenBitPending && (tenBitAddress >> 8) == (shift >> 1 & 3)) {
+                current.address = tenBitAddress;
+                tenBitKnown = true;
+            }
+        } else {
+            current.address = shift >> 1;
+        }
+    } else if (byteCount == 1 && (current.flags & I2C_FLAG_TENBIT) && !(current.flags & I2C_FLAG_READ)) {
+        current.address |= shift;
+        tenBitKnown = true;
+    } else if (current.length < 0xffff) {
+        dataStream.push_back(shift);
+        current.length++;
+        current.acked += ack ? 1 : 0;
+    }
+    byteCount++;
+    shift = 0;
+}
+
+size_t I2cDecoder::decode(const Bitplanes &bp) {
+    const uint64_t *c = bp.plane(scl);
+    const uint64_t *d = bp.plane(sda);
+    size_t samples = bp.samples();
+    size_t words = (samples + 63) / 64;
+    size_t before = transactionList.size();
+    uint64_t cCarry = sclLevel ? 1 : 0;
+    uint64_t dCarry = sdaLevel ? 1 : 0;
+    size_t w = 0;
+
+    while (w < words) {
+        /* Skip pairs of words where neither line moves */
+        if (w + 2 <= samples / 64) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + w));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(d + w));
+            __m128i xs = _mm_or_si128(_mm_slli_epi64(x, 1), _mm_slli_si128(_mm_srli_epi64(x, 63), 8));
+            __m128i ys = _mm_or_si128(_mm_slli_epi64(y, 1), _mm_slli_si128(_mm_srli_epi64(y, 63), 8));
+            __m128i e = _mm_or_si128(_mm_xor_si128(x, _mm_or_si128(xs, _mm_cvtsi64_si128((long long) cCarry))),
+                                     _mm_xor_si128(y, _mm_or_si128(ys, _mm_cvtsi64_si128((long long) dCarry))));
+            if (_mm_testz_si128(e, e)) {
+                cCarry = c[w + 1] >> 63;
+                dCarry = d[w + 1] >> 63;
+                w += 2;
+                continue;
+            }
+        }
+        uint64_t valid = ~(uint64_t) 0;
+        if (w == samples / 64) {
+            valid = ((uint64_t) 1 << (samples % 64)) - 1;
+        }
+        uint64_t x = c[w] & valid;
+        uint64_t y = d[w] & valid;
+        uint64_t xPrev = x << 1 | cCarry;
+        uint64_t yPrev = y << 1 | dCarry;
+        /* SDA may only move while SCL is low, a move with SCL high is START or STOP */
+        uint64_t high = x & xPrev;
+        uint64_t rise = x & ~xPrev;
+        uint64_t fall = ~x & xPrev;
+        uint64_t start = high & yPrev & ~y;
+        uint64_t stop = high & ~yPrev & y;
+        uint64_t events = (rise | fall | start | stop) & valid;
+        uint64_t base = bp.firstSample + w * 64;
+
+        while (events) {
+            unsigned i = __builtin_ctzll(events);
+            uint64_t m = (uint64_t) 1 << i;
+            if (rise & m) {
+                clocked = true;
+                clockedBit = (unsigned) (y >> i) & 1;
+            } else if (fall & m) {
+                if (clocked) {
+                    clocked = false;
+                    onBit(clockedBit);
+                }
+            } else if (start & m) {
+                onStart(base + i);
+            } else {
+                onStop(base + i);
+            }
+            events &= events - 1;
+        }
+        if (valid == ~(uint64_t) 0) {
+            cCarry = x >> 63;
+            dCarry = y >> 63;
+        } else if (samples % 64) {
+            cCarry = (x >> (samples % 64 - 1)) & 1;
+            dCarry = (y >> (samples % 64 - 1)) & 1;
+        }
+        w++;
+    }
+    sclLevel = cCarry != 0;
+    sdaLevel = dCarry != 0;
+    return transactionList.size() - before;
+}
+
+size_t I2cDecoder::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+    return decode(planes);
+}
@@ -0,0 +1,106 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_I2CDECODER_H
+#define TTT_I2CDECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "sigrok_wrapper.h"
+
+#define I2C_FLAG_READ      0x01
+#define I2C_FLAG_TENBIT    0x02
+/* Nobody acknowledged the address */
+#define I2C_FLAG_NACK      0x04
+/* Ended by a repeated START instead of a STOP */
+#define I2C_FLAG_RESTART   0x08
+/* Ended in the middle of a byte */
+#define I2C_FLAG_PARTIAL   0x10
+
+/* 7-bit addresses first, then 10-bit ones */
+#define I2C_ADDRESS_SLOTS (128 + 1024)
+
+/* One START .. STOP (or repeated START) with its address */
+struct I2cTransaction {
+    uint64_t start;
+    uint64_t end;
+    /** Offset of the first data byte in the data stream */
+    uint32_t dataOffset;
+    uint16_t length;
+    /** Data bytes acknowledged by the receiver */
+    uint16_t acked;
+    uint16_t address;
+    uint8_t flags;
+};
+
+/*
+ * Streaming I2C decoder over SCL/SDA bit planes. START, STOP and SCL
+ * edges are found 64 samples at a time with mask arithmetic on the two
+ * planes, quiet stretches are skipped two words per SSE test. A bit is
+ * read at the SCL rise and taken when SCL falls, so the clock pulse of a
+ * STOP or repeated START does not count as data.
+ *
+ * A 10-bit read only repeats the top two address bits after the repeated
+ * START; it gets the full address of the 10-bit transaction before it.
+ *
+ * Transactions and their data bytes are appended to two streams for the
+ * whole capture. While decoding, the position of every transaction is
+ * also filed under its address and direction, so finding all writes to
+ * one device is a lookup instead of a scan over the capture.
+ */
+class I2cDecoder {
+public:
+    I2cDecoder(unsigned sclChannel, unsigned sdaChannel, unsigned numChannels = 8);
+
+    /* Forget all transactions and the index */
+    void reset();
+
+    /* Decode a block, returns the transactions it completed */
+    size_t decode(const Bitplanes &bp);
+    /* Capture callback side: gather a Logic16 packet and decode it */
+    size_t process(const sr_wrap_packet_t *packet);
+
+    size_t transactions() const { return transactionList.size(); }
+    const I2cTransaction &transaction(size_t i) const { return transactionList[i]; }
+    const uint8_t *data(const I2cTransaction &t) const { return &dataStream[t.dataOffset]; }
+
+    /* Positions of the reads or writes of an address, in capture order */
+    const std::vector<uint32_t> &find(uint16_t address, bool read, bool tenBit = false) const;
+
+private:
+    void onStart(uint64_t sample);
+    void onStop(uint64_t sample);
+    void onBit(unsigned sda);
+    void finish(uint64_t sample, uint8_t flags);
+    static unsigned slot(uint16_t address, bool read, bool tenBit);
+
+    unsigned scl;
+    unsigned sda;
+    unsigned numChannels;
+    Bitplanes planes;
+
+    bool sclLevel;
+    bool sdaLevel;
+    bool active;
+    /* SDA seen at the last SCL rise, a bit once SCL falls again */
+    bool clocked;
+    unsigned clockedBit;
+    I2cTransaction current;
+    unsigned bitCount;
+    unsigned byteCount;
+    uint8_t shift;
+    /* Full 10-bit address of the transaction, known after its second byte */
+    bool tenBitKnown;
+    /* A 10-bit address a read after a repeated START continues */
+    bool tenBitPending;
+    uint16_t tenBitAddress;
+
+    std::vector<I2cTransaction> transactionList;
+    std::vector<uint8_t> dataStream;
+    std::vector<uint32_t> index[2 * I2C_ADDRESS_SLOTS];
+};
+
+#endif //TTT_I2CDECODER_H
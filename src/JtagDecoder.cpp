@@ -0,0 +1,284 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "JtagDecoder.h"
+#include "EdgeScan.h"
+#include <assert.h>
+
+using namespace std;
+
+/* Entry of the byte table: state after the byte, shifting cycles, slow */
+#define CHUNK_STATE(e) ((e) & 0x0f)
+#define CHUNK_SHIFTS(e) (((e) >> 4) & 0xff)
+#define CHUNK_SLOW 0x1000
+
+static const uint8_t transitions[JTAG_STATES][2] = {
+    /* TEST_LOGIC_RESET */ { JTAG_RUN_TEST_IDLE, JTAG_TEST_LOGIC_RESET },
+    /* RUN_TEST_IDLE */    { JTAG_RUN_TEST_IDLE, JTAG_SELECT_DR },
+    /* SELECT_DR */        { JTAG_CAPTURE_DR, JTAG_SELECT_IR },
+    /* CAPTURE_DR */       { JTAG_SHIFT_DR, JTAG_EXIT1_DR },
+    /* SHIFT_DR */         { JTAG_SHIFT_DR, JTAG_EXIT1_DR },
+    /* EXIT1_DR */         { JTAG_PAUSE_DR, JTAG_UPDATE_DR },
+    /* PAUSE_DR */         { JTAG_PAUSE_DR, JTAG_EXIT2_DR },
+    /* EXIT2_DR */         { JTAG_SHIFT_DR, JTAG_UPDATE_DR },
+    /* UPDATE_DR */        { JTAG_RUN_TEST_IDLE, JTAG_SELECT_DR },
+    /* SELECT_IR */        { JTAG_CAPTURE_IR, JTAG_TEST_LOGIC_RESET },
+    /* CAPTURE_IR */       { JTAG_SHIFT_IR, JTAG_EXIT1_IR },
+    /* SHIFT_IR */         { JTAG_SHIFT_IR, JTAG_EXIT1_IR },
+    /* EXIT1_IR */         { JTAG_PAUSE_IR, JTAG_UPDATE_IR },
+    /* PAUSE_IR */         { JTAG_PAUSE_IR, JTAG_EXIT2_IR },
+    /* EXIT2_IR */         { JTAG_SHIFT_IR, JTAG_UPDATE_IR },
+    /* UPDATE_IR */        { JTAG_RUN_TEST_IDLE, JTAG_SELECT_DR },
+};
+
+static const char *names[JTAG_STATES] = {
+    "Test-Logic-Reset", "Run-Test/Idle",
+    "Select-DR-Scan", "Capture-DR", "Shift-DR", "Exit1-DR", "Pause-DR", "Exit2-DR", "Update-DR",
+    "Select-IR-Scan", "Capture-IR", "Shift-IR", "Exit1-IR", "Pause-IR", "Exit2-IR", "Update-IR",
+};
+
+static bool shifting(unsigned s) {
+    return s == JTAG_SHIFT_DR || s == JTAG_SHIFT_IR;
+}
+
+/* Cycles in these states, or into reset, emit records */
+static bool eventful(unsigned s, unsigned n) {
+    return s == JTAG_CAPTURE_DR || s == JTAG_CAPTURE_IR || s == JTAG_UPDATE_DR || s == JTAG_UPDATE_IR ||
+           (n == JTAG_TEST_LOGIC_RESET && s != JTAG_TEST_LOGIC_RESET);
+}
+
+/* Eight TCK cycles per lookup */
+struct ChunkTable {
+    uint16_t entry[JTAG_STATES][256];
+
+    ChunkTable() {
+        for (unsigned s = 0; s < JTAG_STATES; s++) {
+            for (unsigned tms = 0; tms < 256; tms++) {
+                unsigned state = s, shifts = 0, slow = 0;
+                for (unsigned j = 0; j < 8; j++) {
+                    unsigned n = transitions[state][(tms >> j) & 1];
+                    shifts |= shifting(state) << j;
+                    slow |= eventful(state, n);
+                    state = n;
+                }
+                entry[s][tms] = (uint16_t) (state | shifts << 4 | (slow ? CHUNK_SLOW : 0));
+            }
+        }
+    }
+};
+
+static const ChunkTable &chunks() {
+    static const ChunkTable table;
+    return table;
+}
+
+JtagState JtagDecoder::next(JtagState s, unsigned tms) {
+    return (JtagState) transitions[s][tms & 1];
+}
+
+const char *JtagDecoder::name(JtagState s) {
+    return s < JTAG_STATES ? names[s] : "?";
+}
+
+JtagDecoder::JtagDecoder(const JtagConfig &config, unsigned numChannels)
+    : cfg(config)
+    , numChannels(numChannels)
+    , planes(numChannels) {
+    assert(cfg.tck < numChannels && cfg.tms < numChannels && cfg.tdi < numChannels && cfg.tdo < numChannels);
+    assert(cfg.tck != cfg.tms && cfg.tck != cfg.tdi && cfg.tck != cfg.tdo);
+    assert(cfg.tms != cfg.tdi && cfg.tms != cfg.tdo && cfg.tdi != cfg.tdo);
+    chunks();
+    reset();
+}
+
+void JtagDecoder::reset(JtagState initial) {
+    started = false;
+    tckLevel = false;
+    tap = initial;
+    open = false;
+    current = JtagScan();
+    tdiBits.clear();
+    tdoBits.clear();
+    base = 0;
+    length = 0;
+    scanList.clear();
+}
+
+void JtagDecoder::clear() {
+    scanList.clear();
+    /* Keep whole words from the open scan on */
+    uint64_t keep = open ? current.offset & ~(uint64_t) 63 : length & ~(uint64_t) 63;
+    size_t drop = (size_t) ((keep - base) / 64);
+    tdiBits.erase(tdiBits.begin(), tdiBits.begin() + drop);
+    tdoBits.erase(tdoBits.begin(), tdoBits.begin() + drop);
+    base = keep;
+}
+
+void JtagDecoder::append(uint64_t tdi, uint64_t tdo, unsigned n) {
+    uint64_t rel = length - base;
+    unsigned b = (unsigned) (rel % 64);
+    if (b == 0) {
+        tdiBits.push_back(0);
+        tdoBits.push_back(0);
+    }
+    size_t w = (size_t) (rel / 64);
+    tdiBits[w] |= tdi << b;
+    tdoBits[w] |= tdo << b;
+    if (b + n > 64) {
+        tdiBits.push_back(tdi >> (64 - b));
+        tdoBits.push_back(tdo >> (64 - b));
+    }
+    length += n;
+}
+
+uint64_t JtagDecoder::extract(const vector<uint64_t> &stream, uint64_t first, unsigned n) const {
+    assert(n <= 64 && first >= base);
+    uint64_t rel = first - base;
+    size_t w = (size_t) (rel / 64);
+    unsigned b = (unsigned) (rel % 64);
+    uint64_t v = stream[w] >> b;
+    if (b && b + n > 64) {
+        v |= stream[w + 1] << (64 - b);
+    }
+    return n == 64 ? v : v & (((uint64_t) 1 << n) - 1);
+}
+
+uint64_t JtagDecoder::tdi(const JtagScan &scan, size_t first, unsigned n) const {
+    assert(first + n <= scan.bits);
+    return n ? extract(tdiBits, scan.offset + first, n) : 0;
+}
+
+uint64_t JtagDecoder::tdo(const JtagScan &scan, size_t first, unsigned n) const {
+    assert(first + n <= scan.bits);
+    return n ? extract(tdoBits, scan.offset + first, n) : 0;
+}
+
+void JtagDecoder::step(uint64_t sample, unsigned tms, unsigned tdi, unsigned tdo) {
+    switch (tap) {
+        case JTAG_CAPTURE_DR:
+        case JTAG_CAPTURE_IR:
+            open = true;
+            current = JtagScan();
+            current.start = sample;
+            current.offset = length;
+            current.type = tap == JTAG_CAPTURE_DR ? JTAG_SCAN_DR : JTAG_SCAN_IR;
+            break;
+        case JTAG_SHIFT_DR:
+        case JTAG_SHIFT_IR:
+            if (open) {
+                append(tdi, tdo, 1);
+            }
+            break;
+        case JTAG_UPDATE_DR:
+        case JTAG_UPDATE_IR:
+            if (open) {
+                current.end = sample;
+                current.bits = (uint32_t) (length - current.offset);
+                scanList.push_back(current);
+                open = false;
+            }
+            break;
+    }
+
+    unsigned n = transitions[tap][tms];
+    /* Only Select-IR leads there, never from inside a scan */
+    if (n == JTAG_TEST_LOGIC_RESET && tap != JTAG_TEST_LOGIC_RESET) {
+        JtagScan r = JtagScan();
+        r.start = sample;
+        r.end = sample;
+        r.offset = length;
+        r.type = JTAG_RESET;
+        scanList.push_back(r);
+    }
+    tap = n;
+}
+
+size_t JtagDecoder::decode(const Bitplanes &bp) {
+    const ChunkTable &table = chunks();
+    size_t before = scanList.size();
+
+    size_t count = bp.samples();
+    const uint64_t *clk = bp.plane(cfg.tck);
+    const uint64_t *pms = bp.plane(cfg.tms);
+    const uint64_t *pdi = bp.plane(cfg.tdi);
+    const uint64_t *pdo = bp.plane(cfg.tdo);
+    size_t maxCycles = count / 2 + 1;
+    tmsStream.assign(maxCycles / 64 + 2, 0);
+    tdiStream.assign(maxCycles / 64 + 2, 0);
+    tdoStream.assign(maxCycles / 64 + 2, 0);
+    samples.resize(maxCycles);
+    /* The first sample of a capture is not an edge */
+    if (!started && count) {
+        tckLevel = clk[0] & 1;
+        started = true;
+    }
+    size_t n = 0;
+    edge_scan(clk, count, tckLevel, EDGE_RISING, [&](size_t i, bool) {
+        size_t w = i >> 6;
+        unsigned b = (unsigned) (i & 63);
+        tmsStream[n >> 6] |= ((pms[w] >> b) & 1) << (n & 63);
+        tdiStream[n >> 6] |= ((pdi[w] >> b) & 1) << (n & 63);
+        tdoStream[n >> 6] |= ((pdo[w] >> b) & 1) << (n & 63);
+        samples[n++] = bp.firstSample + i;
+    });
+
+    size_t i = 0;
+    while (i + 8 <= n) {
+        size_t k = i >> 6;
+        unsigned shift = (unsigned) (i & 63);
+        /* Long scans: 64 cycles of TMS low in a shift state */
+        if (shift == 0 && i + 64 <= n && shifting(tap) && tmsStream[k] == 0) {
+            if (open) {
+                append(tdiStream[k], tdoStream[k], 64);
+            }
+            i += 64;
+            continue;
+        }
+
+        unsigned tms = (unsigned) (tmsStream[k] >> shift) & 0xff;
+        uint16_t e = table.entry[tap][tms];
+        if (e & CHUNK_SLOW) {
+            for (unsigned j = 0; j < 8; j++) {
+                step(samples[i + j], (tms >> j) & 1,
+                     (unsigned) (tdiStream[k] >> (shift + j)) & 1, (unsigned) (tdoStream[k] >> (shift + j)) & 1);
+            }
+            i += 8;
+            continue;
+        }
+
+        unsigned shifts = CHUNK_SHIFTS(e);
+        if (shifts && open) {
+            uint64_t a = (tdiStream[k] >> shift) & 0xff;
+            uint64_t b = (tdoStream[k] >> shift) & 0xff;
+            if (shifts == 0xff) {
+                append(a, b, 8);
+            } else {
+                /* Shift, exit, pause and back: keep the shifting cycles */
+                uint64_t pa = 0, pb = 0;
+                unsigned count = 0;
+                for (unsigned m = shifts; m; m &= m - 1) {
+                    unsigned j = __builtin_ctz(m);
+                    pa |= ((a >> j) & 1) << count;
+                    pb |= ((b >> j) & 1) << count;
+                    count++;
+                }
+                append(pa, pb, count);
+            }
+        }
+        tap = CHUNK_STATE(e);
+        i += 8;
+    }
+    for (; i < n; i++) {
+        step(samples[i], (unsigned) (tmsStream[i >> 6] >> (i & 63)) & 1,
+             (unsigned) (tdiStream[i >> 6] >> (i & 63)) & 1, (unsigned) (tdoStream[i >> 6] >> (i & 63)) & 1);
+    }
+    return scanList.size() - before;
+}
+
+size_t JtagDecoder::process(const sr_wrap_packet_t *packet) {
+    clear();
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+    return decode(planes);
+}
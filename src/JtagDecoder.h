@@ -0,0 +1,121 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_JTAGDECODER_H
+#define TTT_JTAGDECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "sigrok_wrapper.h"
+
+enum JtagState {
+    JTAG_TEST_LOGIC_RESET,
+    JTAG_RUN_TEST_IDLE,
+    JTAG_SELECT_DR,
+    JTAG_CAPTURE_DR,
+    JTAG_SHIFT_DR,
+    JTAG_EXIT1_DR,
+    JTAG_PAUSE_DR,
+    JTAG_EXIT2_DR,
+    JTAG_UPDATE_DR,
+    JTAG_SELECT_IR,
+    JTAG_CAPTURE_IR,
+    JTAG_SHIFT_IR,
+    JTAG_EXIT1_IR,
+    JTAG_PAUSE_IR,
+    JTAG_EXIT2_IR,
+    JTAG_UPDATE_IR,
+    JTAG_STATES
+};
+
+enum JtagScanType {
+    JTAG_SCAN_IR = 1,
+    JTAG_SCAN_DR,
+    /** The TAP entered Test-Logic-Reset */
+    JTAG_RESET
+};
+
+struct JtagConfig {
+    unsigned tck;
+    unsigned tms;
+    unsigned tdi;
+    unsigned tdo;
+};
+
+/* One IR or DR scan from Capture to Update, or a reset */
+struct JtagScan {
+    /** TCK rising edges of the Capture and Update cycles */
+    uint64_t start;
+    uint64_t end;
+    /** First bit in the decoder's TDI/TDO bit streams */
+    uint64_t offset;
+    uint32_t bits;
+    uint8_t type;
+};
+
+/*
+ * JTAG decoder over TCK/TMS/TDI/TDO. TCK rising edges come from the SSE
+ * edge scan and the three lines are gathered at them into streams of one
+ * bit per cycle. The TAP controller then follows TMS eight cycles per
+ * lookup: a table indexed by state and TMS byte gives the state after
+ * the byte and which of the cycles shift. Bytes that pass a Capture,
+ * Update or reset are stepped one cycle at a time to emit scan records,
+ * 64 cycles of a long scan with TMS low are appended at once.
+ *
+ * Shifted TDI and TDO bits are appended to two bit streams, scans point
+ * into them. Scans and bits accumulate until clear().
+ */
+class JtagDecoder {
+public:
+    JtagDecoder(const JtagConfig &config, unsigned numChannels = 8);
+
+    void reset(JtagState initial = JTAG_TEST_LOGIC_RESET);
+    /* Drop completed scans and their bits, a scan in progress is kept */
+    void clear();
+
+    /* Decode a block, returns the scans it completed */
+    size_t decode(const Bitplanes &bp);
+    /* Capture callback side: clear, gather a Logic16 packet and decode it */
+    size_t process(const sr_wrap_packet_t *packet);
+
+    const std::vector<JtagScan> &scans() const { return scanList; }
+    /* Up to 64 bits of a scan from bit first, first shifted in the LSB */
+    uint64_t tdi(const JtagScan &scan, size_t first, unsigned n) const;
+    uint64_t tdo(const JtagScan &scan, size_t first, unsigned n) const;
+
+    JtagState state() const { return (JtagState) tap; }
+
+    static JtagState next(JtagState s, unsigned tms);
+    static const char *name(JtagState s);
+
+private:
+    void step(uint64_t sample, unsigned tms, unsigned tdi, unsigned tdo);
+    void append(uint64_t tdi, uint64_t tdo, unsigned n);
+    uint64_t extract(const std::vector<uint64_t> &stream, uint64_t first, unsigned n) const;
+
+    JtagConfig cfg;
+    unsigned numChannels;
+    /* TCK before the block, unknown until the first one */
+    bool started;
+    bool tckLevel;
+    unsigned tap;
+    bool open;
+    JtagScan current;
+    /* Shifted bits, first bit of the stream is bit base */
+    std::vector<uint64_t> tdiBits;
+    std::vector<uint64_t> tdoBits;
+    uint64_t base;
+    uint64_t length;
+    std::vector<JtagScan> scanList;
+    /* Rising edges of the block and the lines at them */
+    std::vector<uint64_t> samples;
+    std::vector<uint64_t> tmsStream;
+    std::vector<uint64_t> tdiStream;
+    std::vector<uint64_t> tdoStream;
+    Bitplanes planes;
+};
+
+#endif //TTT_JTAGDECODER_H
@@ -0,0 +1,92 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_LATESTVALUE_H
+#define TTT_LATESTVALUE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <type_traits>
+
+/*
+ * LatestValue holds the most recent value published by one writer for any
+ * number of readers, without locks (a sequence lock). The writer never
+ * waits; a reader that overlaps a publish copies again.
+ *
+ * The value is kept as relaxed atomic words so a torn copy is detected by
+ * the sequence number rather than being a data race. T must be trivially
+ * copyable; keep it small enough that copying it is cheap next to the
+ * publish interval.
+ */
+template<class T>
+class LatestValue {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "LatestValue needs a trivially copyable type");
+
+    LatestValue(const LatestValue&) = delete;
+    LatestValue& operator = (const LatestValue&) = delete;
+
+    LatestValue()
+        : sequence_(0)
+    {
+        for (auto &w : words_) {
+            w.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Writer only.
+    void publish(const T &value) {
+        uint64_t buffer[WORDS] = {0};
+        memcpy(buffer, &value, sizeof(T));
+
+        uint32_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            words_[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    // Copy the latest value into value, false if none was published yet.
+    bool read(T &value) const {
+        uint64_t buffer[WORDS];
+
+        for (;;) {
+            uint32_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1) {
+                // publish in progress
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < WORDS; i++) {
+                buffer[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) != before) {
+                continue;
+            }
+            if (before == 0) {
+                return false;
+            }
+            memcpy(&value, buffer, sizeof(T));
+            return true;
+        }
+    }
+
+    // Number of values published so far.
+    uint32_t version() const {
+        return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static const size_t WORDS = (sizeof(T) + 7) / 8;
+
+    alignas(64) std::atomic<uint32_t> sequence_;
+    std::atomic<uint64_t> words_[WORDS];
+};
+
+#endif //TTT_LATESTVALUE_H
@@ -0,0 +1,114 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "MergeQueue.h"
+#include <assert.h>
+#include <algorithm>
+
+using namespace std;
+
+MergeQueue::MergeQueue(unsigned numLanes, uint32_t laneCapacity) {
+    for (unsigned i = 0; i < numLanes; i++) {
+        lanes.push_back(unique_ptr<Lane>(new Lane(laneCapacity)));
+    }
+    heap.reserve(numLanes);
+}
+
+void MergeQueue::setSamplerate(unsigned lane, uint64_t samplerate) {
+    assert(samplerate > 0);
+    lanes[lane]->samplerate = samplerate;
+}
+
+bool MergeQueue::push(unsigned lane, PacketHandle &&packet) {
+    Lane &l = *lanes[lane];
+    uint64_t sample = packet->sample;
+
+    if (!l.queue.write(std::move(packet))) {
+        return false;
+    }
+    advance(lane, sample);
+    return true;
+}
+
+void MergeQueue::advance(unsigned lane, uint64_t sample) {
+    Lane &l = *lanes[lane];
+    /* Only the lane's producer writes it, no CAS needed */
+    if (sample > l.watermark.load(memory_order_relaxed)) {
+        l.watermark.store(sample, memory_order_release);
+    }
+}
+
+void MergeQueue::close(unsigned lane) {
+    lanes[lane]->closed.store(true, memory_order_release);
+}
+
+bool MergeQueue::before(uint64_t sampleA, uint64_t rateA, uint64_t sampleB, uint64_t rateB) {
+    return (unsigned __int128) sampleA * rateB < (unsigned __int128) sampleB * rateA;
+}
+
+bool MergeQueue::earlier(unsigned a, unsigned b) {
+    Lane &la = *lanes[a];
+    Lane &lb = *lanes[b];
+    if (before(la.head->sample, la.samplerate, lb.head->sample, lb.samplerate)) {
+        return true;
+    }
+    if (before(lb.head->sample, lb.samplerate, la.head->sample, la.samplerate)) {
+        return false;
+    }
+    return a < b;
+}
+
+bool MergeQueue::pop(PacketHandle &packet) {
+    auto later = [this](unsigned a, unsigned b) { return earlier(b, a); };
+
+    for (unsigned i = 0; i < lanes.size(); i++) {
+        Lane &l = *lanes[i];
+        if (!l.queued && l.queue.read(l.head)) {
+            l.queued = true;
+            heap.push_back(i);
+            push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+    if (heap.empty()) {
+        return false;
+    }
+
+    unsigned top = heap.front();
+    Lane &t = *lanes[top];
+
+    /* Every lane without a head must vouch that nothing earlier is coming */
+    for (unsigned i = 0; i < lanes.size(); i++) {
+        Lane &l = *lanes[i];
+        if (l.queued) {
+            continue;
+        }
+        bool closed = l.closed.load(memory_order_acquire);
+        uint64_t watermark = l.watermark.load(memory_order_acquire);
+        if (l.queue.read(l.head)) {
+            /* Arrived meanwhile, merge it in and decide again */
+            l.queued = true;
+            heap.push_back(i);
+            push_heap(heap.begin(), heap.end(), later);
+            return pop(packet);
+        }
+        if (!closed && before(watermark, l.samplerate, t.head->sample, t.samplerate)) {
+            return false;
+        }
+    }
+
+    pop_heap(heap.begin(), heap.end(), later);
+    heap.pop_back();
+    packet = std::move(t.head);
+    t.queued = false;
+    return true;
+}
+
+bool MergeQueue::drained() {
+    for (auto &l : lanes) {
+        if (l->queued || !l->closed.load(memory_order_acquire) || !l->queue.isEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_MERGEQUEUE_H
+#define TTT_MERGEQUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "PacketHandle.h"
+#include "ProducerConsumerQueue.h"
+
+/*
+ * Merges the packet streams of several devices into one stream ordered by
+ * absolute sample time. Every device pushes into its own lane, a wait-free
+ * ProducerConsumerQueue, so producers never contend. The consumer keeps
+ * the lane heads in a min-heap and hands out the earliest one once every
+ * other lane either has a later head, has promised (through its watermark)
+ * not to deliver anything earlier, or is closed.
+ *
+ * Lanes may run at different samplerates; times compare as sample/rate.
+ * Packets are moved through as handles, never copied.
+ */
+class MergeQueue {
+public:
+    MergeQueue(unsigned lanes, uint32_t laneCapacity);
+
+    MergeQueue(const MergeQueue&) = delete;
+    MergeQueue& operator = (const MergeQueue&) = delete;
+
+    /* Set before any packet is pushed to the lane */
+    void setSamplerate(unsigned lane, uint64_t samplerate);
+
+    /*
+     * Producer side, one thread per lane. Packets of a lane must be pushed
+     * in sample order. Returns false if the lane is full.
+     */
+    bool push(unsigned lane, PacketHandle &&packet);
+    /* Promise that the lane has nothing starting before sample */
+    void advance(unsigned lane, uint64_t sample);
+    /* No more packets on this lane */
+    void close(unsigned lane);
+
+    /* Consumer side. False if the next packet in time order is not known yet */
+    bool pop(PacketHandle &packet);
+    /* All lanes closed and delivered */
+    bool drained();
+
+private:
+    struct Lane {
+        Lane(uint32_t capacity)
+            : queue(capacity)
+            , samplerate(1)
+            , watermark(0)
+            , closed(false)
+            , queued(false) {
+        }
+        folly::ProducerConsumerQueue<PacketHandle> queue;
+        uint64_t samplerate;
+        std::atomic<uint64_t> watermark;
+        std::atomic<bool> closed;
+        /* Consumer only: head holds the lane's next packet */
+        bool queued;
+        PacketHandle head;
+    };
+
+    bool earlier(unsigned a, unsigned b);
+    bool before(uint64_t sampleA, uint64_t rateA, uint64_t sampleB, uint64_t rateB);
+    void fill();
+
+    std::vector<std::unique_ptr<Lane>> lanes;
+    /* Consumer only: lanes with a head, earliest on top */
+    std::vector<unsigned> heap;
+};
+
+#endif //TTT_MERGEQUEUE_H
@@ -0,0 +1,96 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_PACKETHANDLE_H
+#define TTT_PACKETHANDLE_H
+
+#include <stddef.h>
+#include "TransferObjectPool.h"
+
+/*
+ * Counted reference to a packet. Handles are move-only; a consumer that
+ * needs its own reference asks for one with share(). The transfer object
+ * goes back to its TransferObjectPool when the last handle lets go.
+ *
+ * Packets that do not come from a pool (e.g. ReplaySource views) can be
+ * wrapped too; those are never counted and outlive every handle.
+ */
+class PacketHandle {
+public:
+    PacketHandle()
+        : pool(NULL)
+        , pkt(NULL) {
+    }
+
+    /* Adopt one reference already counted for obj */
+    PacketHandle(TransferObjectPool *pool, sr_warp_transfer_t *obj)
+        : pool(pool)
+        , pkt(&obj->packet) {
+    }
+
+    /* Wrap a packet not owned by any pool */
+    explicit PacketHandle(sr_wrap_packet_t *packet)
+        : pool(NULL)
+        , pkt(packet) {
+    }
+
+    PacketHandle(PacketHandle &&other) noexcept
+        : pool(other.pool)
+        , pkt(other.pkt) {
+        other.pool = NULL;
+        other.pkt = NULL;
+    }
+
+    PacketHandle& operator = (PacketHandle &&other) noexcept {
+        if (this != &other) {
+            reset();
+            pool = other.pool;
+            pkt = other.pkt;
+            other.pool = NULL;
+            other.pkt = NULL;
+        }
+        return *this;
+    }
+
+    PacketHandle(const PacketHandle&) = delete;
+    PacketHandle& operator = (const PacketHandle&) = delete;
+
+    ~PacketHandle() {
+        reset();
+    }
+
+    /* A new reference to the same packet */
+    PacketHandle share() const {
+        PacketHandle h;
+        if (pool) {
+            pool->retain(transfer());
+        }
+        h.pool = pool;
+        h.pkt = pkt;
+        return h;
+    }
+
+    void reset() {
+        if (pool) {
+            pool->release(transfer());
+        }
+        pool = NULL;
+        pkt = NULL;
+    }
+
+    sr_wrap_packet_t *packet() const { return pkt; }
+    sr_wrap_packet_t *operator -> () const { return pkt; }
+    explicit operator bool() const { return pkt != NULL; }
+
+    /* References held on a pooled packet, 0 for unpooled ones */
+    uint32_t refCount() const { return pool ? pool->refCount(transfer()) : 0; }
+
+private:
+    sr_warp_transfer_t *transfer() const { return (sr_warp_transfer_t *) pkt->ref; }
+
+    TransferObjectPool *pool;
+    sr_wrap_packet_t *pkt;
+};
+
+#endif //TTT_PACKETHANDLE_H
@@ -0,0 +1,129 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_PARALLELDECODE_H
+#define TTT_PARALLELDECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "Bitplane.h"
+
+struct ParallelDecodeStats {
+    size_t chunks;
+    size_t redecoded;   /* chunks whose guessed entry state was wrong */
+};
+
+/*
+ * Run fn(0) .. fn(count - 1) on up to threads threads. Small helper for
+ * the offline drivers, which have no packets to hand to a WorkStealingPool.
+ */
+inline void parallel_for(size_t count, unsigned threads, const std::function<void(size_t)> &fn) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            fn(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < count; t++) {
+        pool.push_back(std::thread(worker));
+    }
+    worker();
+    for (auto &t : pool) {
+        t.join();
+    }
+}
+
+/*
+ * Decode a stored capture on several cores. A decoder is sequential, so
+ * the capture is cut into chunks and every chunk but the first starts at a
+ * point where the decoder can guess its state, like an idle bus or a
+ * start of frame. All chunks decode in parallel from their guesses. The
+ * chunks are then stitched in order: if the state a chunk really ends in
+ * differs from the guess its successor started with, the successor is
+ * decoded again from the right state. Results match a sequential decode.
+ *
+ * The decoder provides
+ *
+ *   typedef ... State;  comparable with ==
+ *   typedef ... Event;
+ *   State initialState() const;
+ *   size_t resync(const Bitplanes &bp, size_t from, size_t to, State &state) const;
+ *       first sample in [from, to) to start at, with the state guessed
+ *       there; to if there is none
+ *   State decode(const Bitplanes &bp, size_t from, size_t to, State state,
+ *                std::vector<Event> &out) const;
+ *       decode [from, to) starting in state, return the state at to
+ *
+ * UartDecoder, SpiDecoder and SwdDecoder provide it.
+ */
+template<class Decoder>
+std::vector<typename Decoder::Event> parallel_decode(const Decoder &decoder, const Bitplanes &bp,
+                                                     unsigned threads, size_t chunkSamples,
+                                                     ParallelDecodeStats *stats = NULL) {
+    typedef typename Decoder::State State;
+    typedef typename Decoder::Event Event;
+
+    assert(chunkSamples > 0);
+    size_t total = bp.samples();
+    size_t chunks = total ? (total + chunkSamples - 1) / chunkSamples : 1;
+
+    /* Chunk k covers [start[k], start[k + 1]) */
+    std::vector<size_t> start(chunks + 1, total);
+    std::vector<State> entry(chunks, decoder.initialState());
+    std::vector<State> leave(chunks, decoder.initialState());
+    std::vector<std::vector<Event>> events(chunks);
+
+    start[0] = 0;
+    parallel_for(chunks - 1, threads, [&](size_t i) {
+        size_t k = i + 1;
+        size_t to = std::min(total, (k + 1) * chunkSamples);
+        start[k] = decoder.resync(bp, k * chunkSamples, to, entry[k]);
+    });
+    /* A chunk without a resync point folds into the one before it */
+    for (size_t k = chunks - 1; k > 0; k--) {
+        if (start[k] >= std::min(total, (k + 1) * chunkSamples)) {
+            start[k] = start[k + 1];
+        }
+    }
+
+    parallel_for(chunks, threads, [&](size_t k) {
+        leave[k] = decoder.decode(bp, start[k], start[k + 1], entry[k], events[k]);
+    });
+
+    size_t redecoded = 0;
+    size_t count = events[0].size();
+    for (size_t k = 1; k < chunks; k++) {
+        if (start[k] == start[k + 1]) {
+            /* Folded into the chunk before, the state passes through */
+            leave[k] = leave[k - 1];
+        } else if (!(leave[k - 1] == entry[k])) {
+            entry[k] = leave[k - 1];
+            events[k].clear();
+            leave[k] = decoder.decode(bp, start[k], start[k + 1], entry[k], events[k]);
+            redecoded++;
+        }
+        count += events[k].size();
+    }
+
+    if (stats) {
+        stats->chunks = chunks;
+        stats->redecoded = redecoded;
+    }
+
+    std::vector<Event> out;
+    out.reserve(count);
+    for (auto &e : events) {
+        out.insert(out.end(), e.begin(), e.end());
+    }
+    return out;
+}
+
+#endif //TTT_PARALLELDECODE_H
@@ -0,0 +1,232 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "Pipeline.h"
+#include <assert.h>
+#include <chrono>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+using namespace std;
+
+static const unsigned BATCH = 32;
+
+static uint32_t round_pow2(uint32_t n) {
+    uint32_t p = 2;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+Pipeline::Pipeline()
+    : pressured(0)
+    , running(false) {
+}
+
+Pipeline::~Pipeline() {
+    stop();
+}
+
+int Pipeline::addStage(const string &name, int upstream, StageFn fn,
+                       uint32_t capacity, unsigned threads, bool critical) {
+    assert(!running);
+    assert(threads > 0);
+    assert(upstream >= SOURCE && upstream < (int) stageList.size());
+
+    unique_ptr<Stage> s(new Stage);
+    s->name = name;
+    s->fn = fn;
+    s->capacity = round_pow2(capacity);
+    s->critical = critical;
+    s->closed = false;
+    s->processed = 0;
+    s->dropped = 0;
+    s->stallNs = 0;
+    s->peak = 0;
+
+    unsigned producers = upstream == SOURCE ? 1 : stageList[upstream]->workers.size();
+    for (unsigned i = 0; i < threads; i++) {
+        unique_ptr<Worker> w(new Worker);
+        for (unsigned p = 0; p < producers; p++) {
+            w->inbox.push_back(unique_ptr<Inbox>(new Inbox(s->capacity)));
+        }
+        s->workers.push_back(std::move(w));
+    }
+
+    int id = (int) stageList.size();
+    stageList.push_back(std::move(s));
+    if (upstream == SOURCE) {
+        roots.push_back(id);
+    } else {
+        stageList[upstream]->children.push_back(id);
+    }
+    return id;
+}
+
+void Pipeline::start() {
+    assert(!running);
+    running = true;
+    for (size_t i = 0; i < stageList.size(); i++) {
+        Stage &s = *stageList[i];
+        for (unsigned t = 0; t < s.workers.size(); t++) {
+            s.workers[t]->thread = thread(&Pipeline::run, this, (int) i, t);
+        }
+    }
+}
+
+bool Pipeline::push(PacketHandle &&packet) {
+    bool ok = true;
+    for (size_t i = 0; i < roots.size(); i++) {
+        PacketHandle p = i + 1 < roots.size() ? packet.share() : std::move(packet);
+        ok = deliver(roots[i], 0, std::move(p), false) && ok;
+    }
+    return ok;
+}
+
+void Pipeline::stop() {
+    if (!running) {
+        return;
+    }
+    /* Stages were added after their upstream, so this closes them top down */
+    for (auto &s : stageList) {
+        s->closed.store(true, memory_order_release);
+        for (auto &w : s->workers) {
+            ring(*w);
+        }
+        for (auto &w : s->workers) {
+            w->thread.join();
+        }
+    }
+    running = false;
+}
+
+StageMetrics Pipeline::metrics(int stage) const {
+    const Stage &s = *stageList[stage];
+    StageMetrics m;
+
+    m.name = s.name;
+    m.capacity = s.capacity;
+    m.occupancy = 0;
+    for (auto &w : s.workers) {
+        for (auto &in : w->inbox) {
+            m.occupancy += in->sizeGuess();
+        }
+    }
+    m.peakOccupancy = s.peak.load(memory_order_relaxed);
+    m.processed = s.processed.load(memory_order_relaxed);
+    m.dropped = s.dropped.load(memory_order_relaxed);
+    m.stallNs = s.stallNs.load(memory_order_relaxed);
+    return m;
+}
+
+bool Pipeline::deliver(int stage, unsigned producer, PacketHandle &&packet, bool canWait) {
+    Stage &s = *stageList[stage];
+
+    if (!s.critical && degraded()) {
+        s.dropped.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    Worker &w = *s.workers[(unsigned) packet->id % s.workers.size()];
+    Inbox &in = *w.inbox[producer];
+
+    if (!in.write(std::move(packet))) {
+        if (!s.critical || !canWait) {
+            s.dropped.fetch_add(1, memory_order_relaxed);
+            return !s.critical;
+        }
+        auto t0 = chrono::steady_clock::now();
+        for (unsigned spin = 0; !in.write(std::move(packet)); spin++) {
+            if (spin < 16) {
+                this_thread::yield();
+            } else {
+                this_thread::sleep_for(chrono::microseconds(20));
+            }
+        }
+        auto t1 = chrono::steady_clock::now();
+        s.stallNs.fetch_add(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count(),
+                            memory_order_relaxed);
+    }
+
+    size_t fill = in.sizeGuess();
+    size_t peak = s.peak.load(memory_order_relaxed);
+    while (fill > peak && !s.peak.compare_exchange_weak(peak, fill, memory_order_relaxed)) {
+    }
+    if (s.critical && fill >= s.capacity * 3 / 4 && !in.high.exchange(true)) {
+        pressured.fetch_add(1, memory_order_relaxed);
+    }
+
+    ring(w);
+    return true;
+}
+
+void Pipeline::forward(Stage &s, unsigned producer, PacketHandle &packet) {
+    for (size_t i = 0; i < s.children.size(); i++) {
+        PacketHandle p = i + 1 < s.children.size() ? packet.share() : std::move(packet);
+        deliver(s.children[i], producer, std::move(p), true);
+    }
+}
+
+void Pipeline::ring(Worker &w) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (w.sleeping.load(memory_order_relaxed)) {
+        w.bell.fetch_add(1, memory_order_release);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&w.bell), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+bool Pipeline::pending(const Worker &w) {
+    for (auto &in : w.inbox) {
+        if (!in->isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Pipeline::sleep(Stage &s, Worker &w) {
+    uint32_t bell = w.bell.load(memory_order_acquire);
+    w.sleeping.store(1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!pending(w) && !s.closed.load(memory_order_relaxed)) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&w.bell), FUTEX_WAIT_PRIVATE, bell, NULL, NULL, 0);
+    }
+    w.sleeping.store(0, memory_order_relaxed);
+}
+
+void Pipeline::run(int stage, unsigned index) {
+    Stage &s = *stageList[stage];
+    Worker &w = *s.workers[index];
+    PacketHandle batch[BATCH];
+
+    for (;;) {
+        bool closed = s.closed.load(memory_order_acquire);
+        size_t got = 0;
+
+        for (auto &in : w.inbox) {
+            size_t n = in->readN(batch, BATCH);
+            if (s.critical && in->sizeGuess() <= s.capacity / 4 && in->high.exchange(false)) {
+                pressured.fetch_sub(1, memory_order_relaxed);
+            }
+            for (size_t i = 0; i < n; i++) {
+                if (s.fn(batch[i])) {
+                    forward(s, index, batch[i]);
+                }
+                batch[i].reset();
+            }
+            got += n;
+        }
+        s.processed.fetch_add(got, memory_order_relaxed);
+
+        if (got == 0) {
+            if (closed) {
+                /* closed was read before the last empty pass, nothing can follow */
+                return;
+            }
+            sleep(s, w);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_PIPELINE_H
+#define TTT_PIPELINE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BatchProducerConsumerQueue.h"
+#include "PacketHandle.h"
+
+struct StageMetrics {
+    std::string name;
+    uint32_t capacity;      /* per input queue */
+    size_t occupancy;       /* packets queued right now */
+    size_t peakOccupancy;   /* fullest any input queue has been */
+    uint64_t processed;
+    uint64_t dropped;       /* packets shed instead of queued */
+    uint64_t stallNs;       /* time upstream waited on this stage being full */
+};
+
+/*
+ * Pipeline runs packets through a tree of stages (convert, trigger, decode,
+ * sink, ...) fed by one source thread, typically the USB event thread.
+ * Each stage declares its input queue capacity and thread count. Every
+ * producer thread has its own lock-free queue into every consumer thread,
+ * and packets are spread over a stage's threads by device id, so one
+ * device's packets stay in order.
+ *
+ * Backpressure runs toward the source. When a critical stage is full its
+ * upstream workers wait, and push() refuses the packet rather than block
+ * the source. Non-critical stages never hold anyone up: they drop when
+ * full, and drop everything while any critical queue is more than three
+ * quarters full, so the critical path drains before the source has to
+ * give up a packet. Stall time is booked on the stage that was full.
+ */
+class Pipeline {
+public:
+    /* Work on the packet, return true to pass it on to the stage's children */
+    typedef std::function<bool(PacketHandle &packet)> StageFn;
+
+    static const int SOURCE = -1;
+
+    Pipeline();
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator = (const Pipeline&) = delete;
+
+    /* Before start(). upstream is SOURCE or an earlier stage. Returns the stage id */
+    int addStage(const std::string &name, int upstream, StageFn fn,
+                 uint32_t capacity, unsigned threads = 1, bool critical = true);
+
+    void start();
+    /* Source thread only. False if a critical stage had no room; the packet is dropped either way */
+    bool push(PacketHandle &&packet);
+    /* Let every stage drain, then join the workers */
+    void stop();
+
+    size_t stages() const { return stageList.size(); }
+    StageMetrics metrics(int stage) const;
+    /* Non-critical stages are being shed */
+    bool degraded() const { return pressured.load(std::memory_order_relaxed) > 0; }
+
+private:
+    typedef BatchProducerConsumerQueue<PacketHandle> Queue;
+
+    /* Input queue with its pressure flag */
+    struct Inbox : Queue {
+        Inbox(uint32_t capacity) : Queue(capacity), high(false) {}
+        std::atomic<bool> high;
+    };
+
+    struct Worker {
+        Worker() : bell(0), sleeping(0) {}
+        std::vector<std::unique_ptr<Inbox>> inbox;  /* one per upstream thread */
+        std::atomic<uint32_t> bell;
+        std::atomic<uint32_t> sleeping;
+        std::thread thread;
+    };
+
+    struct Stage {
+        std::string name;
+        StageFn fn;
+        uint32_t capacity;
+        bool critical;
+        std::vector<int> children;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<bool> closed;
+        std::atomic<uint64_t> processed;
+        std::atomic<uint64_t> dropped;
+        std::atomic<uint64_t> stallNs;
+        std::atomic<size_t> peak;
+    };
+
+    bool deliver(int stage, unsigned producer, PacketHandle &&packet, bool canWait);
+    void forward(Stage &s, unsigned producer, PacketHandle &packet);
+    void run(int stage, unsigned index);
+    void ring(Worker &w);
+    void sleep(Stage &s, Worker &w);
+    static bool pending(const Worker &w);
+
+    std::vector<std::unique_ptr<Stage>> stageList;
+    std::vector<int> roots;
+    std::atomic<int> pressured;
+    bool running;
+};
+
+#endif //TTT_PIPELINE_H
@@ -0,0 +1,156 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "PreviewDecimator.h"
+#include <assert.h>
+#include <smmintrin.h>
+#include <string.h>
+
+using namespace std;
+
+PreviewDecimator::PreviewDecimator(unsigned numChannels, const PreviewConfig &config)
+    : numChannels(numChannels)
+    , cfg(config) {
+    assert(numChannels > 0 && numChannels <= BITPLANE_MAX_CHANNELS);
+    assert(cfg.pointRate > 0 && cfg.framePoints > 0 && cfg.framePoints <= PREVIEW_MAX_POINTS);
+    perPoint = cfg.samplerate / cfg.pointRate;
+    if (perPoint == 0) {
+        perPoint = 1;
+    }
+    channelMask = (uint16_t) ((1u << numChannels) - 1);
+    reset();
+}
+
+void PreviewDecimator::reset() {
+    memset(&building, 0, sizeof(building));
+    building.samplesPerPoint = perPoint;
+    building.samplerate = cfg.samplerate;
+    building.channels = numChannels;
+    memset(accOr, 0, sizeof(accOr));
+    memset(accAnd, 0xff, sizeof(accAnd));
+    fill = 0;
+    started = false;
+    next = 0;
+}
+
+void PreviewDecimator::flush() {
+    if (building.points) {
+        latest.publish(building);
+    }
+    building.sample += building.points * perPoint;
+    building.points = 0;
+}
+
+void PreviewDecimator::point(uint16_t min, uint16_t max) {
+    building.min[building.points] = min & channelMask;
+    building.max[building.points] = max & channelMask;
+    if (++building.points == cfg.framePoints) {
+        flush();
+    }
+}
+
+/* Bit ch set where lane ch of a and b, read as channels 0-7 and 8-15, is all ones */
+static inline uint16_t lanes_set(__m128i a, __m128i b) {
+    const __m128i ones = _mm_set1_epi32(-1);
+    return (uint16_t) _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(a, ones), _mm_cmpeq_epi16(b, ones)));
+}
+
+static inline uint16_t lanes_clear(__m128i a, __m128i b) {
+    const __m128i zero = _mm_setzero_si128();
+    return (uint16_t) _mm_movemask_epi8(_mm_packs_epi16(_mm_cmpeq_epi16(a, zero), _mm_cmpeq_epi16(b, zero)));
+}
+
+void PreviewDecimator::add(uint64_t sample, const uint8_t *data, size_t length) {
+    const size_t blockBytes = 2 * numChannels;
+    size_t blocks = length / blockBytes;
+    assert(length % blockBytes == 0);
+    if (blocks == 0) {
+        return;
+    }
+
+    if (started && sample != next) {
+        /* Close the point cut short and start over where the data resumes */
+        if (fill) {
+            __m128i and0 = _mm_loadu_si128((const __m128i *) accAnd);
+            __m128i and1 = _mm_loadu_si128((const __m128i *) (accAnd + 8));
+            __m128i or0 = _mm_loadu_si128((const __m128i *) accOr);
+            __m128i or1 = _mm_loadu_si128((const __m128i *) (accOr + 8));
+            point(lanes_set(and0, and1), (uint16_t) ~lanes_clear(or0, or1));
+        }
+        flush();
+        memset(accOr, 0, sizeof(accOr));
+        memset(accAnd, 0xff, sizeof(accAnd));
+        fill = 0;
+    }
+    if (!started || sample != next) {
+        building.sample = sample;
+        started = true;
+    }
+
+    __m128i and0 = _mm_loadu_si128((const __m128i *) accAnd);
+    __m128i and1 = _mm_loadu_si128((const __m128i *) (accAnd + 8));
+    __m128i or0 = _mm_loadu_si128((const __m128i *) accOr);
+    __m128i or1 = _mm_loadu_si128((const __m128i *) (accOr + 8));
+    uint8_t padded[32] = {0};
+
+    for (size_t b = 0; b < blocks; b++) {
+        const uint8_t *p = data + b * blockBytes;
+        __m128i lo, hi;
+        if (blockBytes == 32) {
+            lo = _mm_loadu_si128((const __m128i *) p);
+            hi = _mm_loadu_si128((const __m128i *) (p + 16));
+        } else if (blockBytes == 16) {
+            lo = _mm_loadu_si128((const __m128i *) p);
+            hi = _mm_setzero_si128();
+        } else {
+            memcpy(padded, p, blockBytes);
+            lo = _mm_loadu_si128((const __m128i *) padded);
+            hi = _mm_loadu_si128((const __m128i *) (padded + 16));
+        }
+
+        if (fill + 16 <= perPoint) {
+            /* The whole block falls in the point */
+            and0 = _mm_and_si128(and0, lo);
+            and1 = _mm_and_si128(and1, hi);
+            or0 = _mm_or_si128(or0, lo);
+            or1 = _mm_or_si128(or1, hi);
+            fill += 16;
+            if (fill == perPoint) {
+                point(lanes_set(and0, and1), (uint16_t) ~lanes_clear(or0, or1));
+                and0 = and1 = _mm_set1_epi32(-1);
+                or0 = or1 = _mm_setzero_si128();
+                fill = 0;
+            }
+            continue;
+        }
+
+        /* Points end inside the block: reduce it in pieces */
+        for (unsigned i = 0; i < 16;) {
+            unsigned take = (unsigned) min<uint64_t>(16 - i, perPoint - fill);
+            __m128i m = _mm_set1_epi16((short) (((1u << take) - 1) << i));
+            and0 = _mm_and_si128(and0, _mm_or_si128(lo, _mm_andnot_si128(m, _mm_set1_epi32(-1))));
+            and1 = _mm_and_si128(and1, _mm_or_si128(hi, _mm_andnot_si128(m, _mm_set1_epi32(-1))));
+            or0 = _mm_or_si128(or0, _mm_and_si128(lo, m));
+            or1 = _mm_or_si128(or1, _mm_and_si128(hi, m));
+            fill += take;
+            i += take;
+            if (fill == perPoint) {
+                point(lanes_set(and0, and1), (uint16_t) ~lanes_clear(or0, or1));
+                and0 = and1 = _mm_set1_epi32(-1);
+                or0 = or1 = _mm_setzero_si128();
+                fill = 0;
+            }
+        }
+    }
+
+    _mm_storeu_si128((__m128i *) accAnd, and0);
+    _mm_storeu_si128((__m128i *) (accAnd + 8), and1);
+    _mm_storeu_si128((__m128i *) accOr, or0);
+    _mm_storeu_si128((__m128i *) (accOr + 8), or1);
+    next = sample + blocks * 16;
+}
+
+void PreviewDecimator::process(const sr_wrap_packet_t *packet) {
+    add(packet->sample, packet->data, packet->size);
+}
@@ -0,0 +1,84 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_PREVIEWDECIMATOR_H
+#define TTT_PREVIEWDECIMATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Bitplane.h"
+#include "LatestValue.h"
+#include "sigrok_wrapper.h"
+
+#define PREVIEW_MAX_POINTS 4096
+
+struct PreviewConfig {
+    uint64_t samplerate;
+    /** Output points per second, every channel */
+    uint64_t pointRate;
+    /** Points per published frame */
+    unsigned framePoints;
+};
+
+/*
+ * Consecutive points of all channels. Bit ch of max[i] is set if channel
+ * ch was high anywhere in point i, bit ch of min[i] if it was high all
+ * through it, so a one-sample glitch still shows as min != max.
+ */
+struct PreviewFrame {
+    /** Absolute sample point 0 starts at */
+    uint64_t sample;
+    uint64_t samplesPerPoint;
+    uint64_t samplerate;
+    unsigned channels;
+    /** Valid points; a gap in the capture publishes a short frame */
+    unsigned points;
+    uint16_t min[PREVIEW_MAX_POINTS];
+    uint16_t max[PREVIEW_MAX_POINTS];
+};
+
+/*
+ * Live preview stage: reduces Logic16 packets to min/max envelopes at a
+ * fixed point rate. Each 16-sample block is one channel word per lane, so
+ * a point is the AND and the OR of its blocks, 8 channels per SSE op, and
+ * no transpose is needed. Finished frames go out through a LatestValue,
+ * so a UI polls the newest one without ever holding up capture.
+ */
+class PreviewDecimator {
+public:
+    PreviewDecimator(unsigned numChannels, const PreviewConfig &config);
+
+    PreviewDecimator(const PreviewDecimator&) = delete;
+    PreviewDecimator& operator = (const PreviewDecimator&) = delete;
+
+    void reset();
+
+    void process(const sr_wrap_packet_t *packet);
+    /* Logic16 data starting at sample, length a multiple of 2 * numChannels */
+    void add(uint64_t sample, const uint8_t *data, size_t length);
+
+    /* Any thread: the newest frame, false before the first */
+    bool frame(PreviewFrame &out) const { return latest.read(out); }
+    uint32_t published() const { return latest.version(); }
+    uint64_t samplesPerPoint() const { return perPoint; }
+
+private:
+    void point(uint16_t min, uint16_t max);
+    void flush();
+
+    unsigned numChannels;
+    PreviewConfig cfg;
+    uint64_t perPoint;
+    uint16_t channelMask;
+    /* The point being reduced: per channel lane AND and OR so far */
+    uint16_t accAnd[BITPLANE_MAX_CHANNELS];
+    uint16_t accOr[BITPLANE_MAX_CHANNELS];
+    uint64_t fill;
+    bool started;
+    uint64_t next;
+    PreviewFrame building;
+    LatestValue<PreviewFrame> latest;
+};
+
+#endif //TTT_PREVIEWDECIMATOR_H
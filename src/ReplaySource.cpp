@@ -0,0 +1,196 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "ReplaySource.h"
+#include "Bitplane.h"
+#include "CaptureFile.h"
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+ReplaySource::ReplaySource(sr_callback_t cb)
+    : cb(cb) {
+}
+
+ReplaySource::~ReplaySource() {
+    for (auto &m : mappings) {
+        munmap(m.addr, m.length);
+    }
+}
+
+ReplaySource::Track &ReplaySource::track(int id, uint64_t samplerate, unsigned numChannels) {
+    for (auto &t : trackList) {
+        if (t.id == id) {
+            return t;
+        }
+    }
+    Track t;
+    t.id = id;
+    t.samplerate = samplerate;
+    t.numChannels = numChannels;
+    t.next = 0;
+    trackList.push_back(t);
+    return trackList.back();
+}
+
+bool ReplaySource::indexFile(uint8_t *base, size_t length) {
+    capture_file_header_t header;
+    size_t pos = sizeof(header);
+
+    memcpy(&header, base, sizeof(header));
+    if (header.version != CAPTURE_FILE_VERSION || header.numChannels == 0 ||
+        header.numChannels > BITPLANE_MAX_CHANNELS || header.samplerate == 0) {
+        return false;
+    }
+
+    /* Nothing is queued for replay unless the whole file checks out */
+    vector<pair<int, Record>> found;
+    while (pos < length) {
+        capture_record_header_t rec;
+        if (length - pos < sizeof(rec)) {
+            return false;
+        }
+        memcpy(&rec, base + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (length - pos < rec.size || rec.size % (2 * header.numChannels) != 0) {
+            return false;
+        }
+        Record r;
+        r.data = base + pos;
+        r.size = rec.size;
+        r.sample = rec.sample;
+        found.push_back(make_pair(rec.id, r));
+        pos += rec.size;
+    }
+    for (auto &f : found) {
+        track(f.first, header.samplerate, header.numChannels).records.push_back(f.second);
+    }
+    return true;
+}
+
+bool ReplaySource::open(const char *path, int id, uint64_t samplerate, unsigned numChannels, size_t packetSize) {
+    struct stat st;
+    int fd;
+    void *addr;
+
+    if ((fd = ::open(path, O_RDONLY)) < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+    uint8_t *base = (uint8_t *) addr;
+    size_t length = st.st_size;
+    bool ok;
+
+    if (length >= sizeof(capture_file_header_t) &&
+        memcmp(base, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC)) == 0) {
+        ok = indexFile(base, length);
+    } else {
+        ok = rawFile(base, length, id, samplerate, numChannels, packetSize);
+    }
+    if (!ok) {
+        munmap(addr, st.st_size);
+        return false;
+    }
+    Mapping m = { addr, (size_t) st.st_size };
+    mappings.push_back(m);
+    return true;
+}
+
+bool ReplaySource::rawFile(uint8_t *base, size_t length, int id, uint64_t samplerate, unsigned numChannels,
+                           size_t packetSize) {
+    /* Cut on whole 16 sample blocks, a partial block at the end is left out */
+    size_t blockBytes = 2 * numChannels;
+    if (samplerate == 0 || numChannels == 0 || numChannels > BITPLANE_MAX_CHANNELS || packetSize < blockBytes) {
+        return false;
+    }
+    packetSize -= packetSize % blockBytes;
+    length -= length % blockBytes;
+
+    Track &t = track(id, samplerate, numChannels);
+    uint64_t sample = 0;
+    if (!t.records.empty()) {
+        const Record &last = t.records.back();
+        sample = last.sample + last.size / blockBytes * 16;
+    }
+    for (size_t pos = 0; pos < length; pos += packetSize) {
+        Record r;
+        r.data = base + pos;
+        r.size = (uint32_t) (length - pos < packetSize ? length - pos : packetSize);
+        r.sample = sample;
+        t.records.push_back(r);
+        sample += r.size / blockBytes * 16;
+    }
+    return true;
+}
+
+static inline int64_t sample_time_ns(uint64_t sample, uint64_t samplerate) {
+    return (int64_t) ((unsigned __int128) sample * 1000000000u / samplerate);
+}
+
+uint64_t ReplaySource::run(Mode mode) {
+    uint64_t delivered = 0;
+    int64_t base = INT64_MAX;
+
+    for (auto &t : trackList) {
+        t.next = 0;
+        if (!t.records.empty()) {
+            int64_t ns = sample_time_ns(t.records[0].sample, t.samplerate);
+            base = ns < base ? ns : base;
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (;;) {
+        /* Pick the track whose next packet starts first */
+        Track *first = NULL;
+        for (auto &t : trackList) {
+            if (t.next == t.records.size()) {
+                continue;
+            }
+            if (!first) {
+                first = &t;
+                continue;
+            }
+            unsigned __int128 a = (unsigned __int128) t.records[t.next].sample * first->samplerate;
+            unsigned __int128 b = (unsigned __int128) first->records[first->next].sample * t.samplerate;
+            if (a < b) {
+                first = &t;
+            }
+        }
+        if (!first) {
+            break;
+        }
+
+        const Record &r = first->records[first->next++];
+        if (mode == REPLAY_REALTIME) {
+            int64_t due = sample_time_ns(r.sample, first->samplerate) - base;
+            this_thread::sleep_until(start + chrono::nanoseconds(due));
+        }
+
+        sr_wrap_packet_t packet;
+        packet.id = first->id;
+        packet.data = r.data;
+        packet.size = r.size;
+        packet.ref = NULL;
+        packet.sample = r.sample;
+        cb(&packet);
+        delivered++;
+    }
+    return delivered;
+}
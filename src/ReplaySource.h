@@ -0,0 +1,82 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_REPLAYSOURCE_H
+#define TTT_REPLAYSOURCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "sigrok_wrapper.h"
+
+#define REPLAY_DEFAULT_PACKET_SIZE 160256
+
+/*
+ * Feeds recorded captures through an sr_callback_t as if a Logic16 had
+ * delivered them. Files are mmap'ed and packets point straight into the
+ * read-only mapping, so packet data stays valid until the source is
+ * destroyed and must not be written to.
+ *
+ * Every device id opened becomes a track. run() interleaves all tracks by
+ * packet start time, either paced to the recorded samplerate or as fast
+ * as the callback consumes them.
+ */
+class ReplaySource {
+public:
+    enum Mode {
+        REPLAY_REALTIME,
+        REPLAY_FAST
+    };
+
+    explicit ReplaySource(sr_callback_t cb);
+    ~ReplaySource();
+
+    ReplaySource(const ReplaySource&) = delete;
+    ReplaySource& operator = (const ReplaySource&) = delete;
+
+    /*
+     * Map a capture. Indexed captures carry their own parameters; for raw
+     * captures id, samplerate and numChannels describe the stream and the
+     * data is cut into packetSize packets. Returns false, queueing nothing,
+     * if the file can not be mapped or is malformed.
+     */
+    bool open(const char *path, int id = 0, uint64_t samplerate = 16000000, unsigned numChannels = 8,
+              size_t packetSize = REPLAY_DEFAULT_PACKET_SIZE);
+
+    /* Deliver every packet of every track, returns packets delivered */
+    uint64_t run(Mode mode);
+
+    size_t tracks() const { return trackList.size(); }
+
+private:
+    struct Record {
+        uint8_t *data;
+        uint32_t size;
+        uint64_t sample;
+    };
+
+    struct Track {
+        int id;
+        uint64_t samplerate;
+        unsigned numChannels;
+        std::vector<Record> records;
+        size_t next;
+    };
+
+    struct Mapping {
+        void *addr;
+        size_t length;
+    };
+
+    Track &track(int id, uint64_t samplerate, unsigned numChannels);
+    bool indexFile(uint8_t *base, size_t length);
+    bool rawFile(uint8_t *base, size_t length, int id, uint64_t samplerate, unsigned numChannels,
+                 size_t packetSize);
+
+    sr_callback_t cb;
+    std::vector<Track> trackList;
+    std::vector<Mapping> mappings;
+};
+
+#endif //TTT_REPLAYSOURCE_H
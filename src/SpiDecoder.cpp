@@ -0,0 +1,197 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "SpiDecoder.h"
+#include "EdgeScan.h"
+#include <assert.h>
+#include <string.h>
+
+using namespace std;
+
+static inline unsigned bit_at(const uint64_t *plane, size_t i) {
+    return (plane[i >> 6] >> (i & 63)) & 1;
+}
+
+SpiDecoder::SpiDecoder(const SpiConfig &config, unsigned numChannels, size_t maxBlockSamples)
+    : cfg(config)
+    , numChannels(numChannels)
+    , planes(numChannels) {
+    assert(cfg.clk >= 0 && (unsigned) cfg.clk < numChannels);
+    assert(cfg.mosi >= 0 && (unsigned) cfg.mosi < numChannels);
+    assert(cfg.miso < (int) numChannels && cfg.cs < (int) numChannels);
+    assert(cfg.wordBits >= 1 && cfg.wordBits <= 32);
+    reserve(maxBlockSamples);
+    reset();
+}
+
+void SpiDecoder::reset() {
+    state = initialState();
+}
+
+SpiDecoder::State SpiDecoder::initialState() const {
+    State s = State();
+    s.clkLevel = cfg.cpol != 0;
+    s.csLevel = cfg.csActiveLow;
+    s.selected = cfg.cs == SPI_NO_CHANNEL;
+    s.first = false;
+    return s;
+}
+
+/* Only grows when a block is larger than any before */
+void SpiDecoder::reserve(size_t samples) {
+    size_t n = maxEvents(samples);
+    if (edges.size() < n) {
+        edges.resize(n);
+        mosiBits.resize(n);
+        misoBits.resize(n);
+        eventBuffer.resize(n);
+    }
+}
+
+void SpiDecoder::bit(State &s, uint64_t sample, unsigned mosi, unsigned miso, SpiEvent *out, size_t &n) const {
+    SpiEvent &word = s.word;
+    if (!s.selected) {
+        return;
+    }
+    if (word.bits == 0) {
+        word.sample = sample;
+        word.mosi = 0;
+        word.miso = 0;
+    }
+    if (cfg.msbFirst) {
+        word.mosi = word.mosi << 1 | mosi;
+        word.miso = word.miso << 1 | miso;
+    } else {
+        word.mosi |= mosi << word.bits;
+        word.miso |= miso << word.bits;
+    }
+    if (++word.bits == cfg.wordBits) {
+        word.flags = s.first ? SPI_FLAG_FIRST : 0;
+        out[n++] = word;
+        s.first = false;
+        word.bits = 0;
+    }
+}
+
+void SpiDecoder::chipSelect(State &s, bool active, SpiEvent *out, size_t &n) const {
+    if (!active && s.selected && s.word.bits) {
+        s.word.flags = SPI_FLAG_PARTIAL | (s.first ? SPI_FLAG_FIRST : 0);
+        out[n++] = s.word;
+    }
+    s.selected = active;
+    s.first = true;
+    s.word.bits = 0;
+}
+
+size_t SpiDecoder::decodeRange(const Bitplanes &bp, size_t from, size_t to, State &s, uint32_t *idx,
+                               uint8_t *mosiBits, uint8_t *misoBits, SpiEvent *out) const {
+    const uint64_t base = bp.firstSample;
+
+    /* Sampling edges of the clock from the word from is in, then both data lines at those indices */
+    const size_t skip = from & ~(size_t) 63;
+    size_t count = 0;
+    edge_scan(bp.plane(cfg.clk) + skip / 64, to - skip, s.clkLevel, cfg.cpol == cfg.cpha ? EDGE_RISING : EDGE_FALLING,
+              [&](size_t i, bool) {
+                  if (skip + i >= from) {
+                      idx[count++] = (uint32_t) (skip + i - from);
+                  }
+              });
+
+    const uint64_t *mosi = bp.plane(cfg.mosi);
+    for (size_t k = 0; k < count; k++) {
+        mosiBits[k] = bit_at(mosi, from + idx[k]);
+    }
+    if (cfg.miso != SPI_NO_CHANNEL) {
+        const uint64_t *miso = bp.plane(cfg.miso);
+        for (size_t k = 0; k < count; k++) {
+            misoBits[k] = bit_at(miso, from + idx[k]);
+        }
+    } else {
+        memset(misoBits, 0, count);
+    }
+
+    size_t events = 0;
+    if (cfg.cs == SPI_NO_CHANNEL) {
+        for (size_t k = 0; k < count; k++) {
+            bit(s, base + from + idx[k], mosiBits[k], misoBits[k], out, events);
+        }
+        return events;
+    }
+
+    /* Chip select changes are rare, walk them alongside the clock edges */
+    const uint64_t *cs = bp.plane(cfg.cs);
+    const bool csStart = s.csLevel;
+    size_t next = edge_find(cs, to, from, csStart, EDGE_BOTH);
+    for (size_t k = 0; k <= count; k++) {
+        size_t limit = k < count ? from + idx[k] : to - 1;
+        while (next <= limit && next < to) {
+            s.csLevel = bit_at(cs, next) != 0;
+            chipSelect(s, s.csLevel != cfg.csActiveLow, out, events);
+            next = edge_find(cs, to, next + 1, csStart, EDGE_BOTH);
+        }
+        if (k < count) {
+            bit(s, base + from + idx[k], mosiBits[k], misoBits[k], out, events);
+        }
+    }
+    return events;
+}
+
+size_t SpiDecoder::decode(const Bitplanes &bp, SpiEvent *out) {
+    const size_t n = bp.samples();
+
+    assert(bp.channels() == numChannels);
+    if (n == 0) {
+        return 0;
+    }
+    reserve(n);
+    return decodeRange(bp, 0, n, state, edges.data(), mosiBits.data(), misoBits.data(), out);
+}
+
+/* First sample after one with chip select inactive */
+size_t SpiDecoder::resync(const Bitplanes &bp, size_t from, size_t to, State &s) const {
+    s = initialState();
+    if (cfg.cs == SPI_NO_CHANNEL) {
+        return to;
+    }
+    const uint64_t *cs = bp.plane(cfg.cs);
+    for (size_t i = from ? from - 1 : 0; i + 1 < to; i = (i | 63) + 1) {
+        uint64_t inactive = cfg.csActiveLow ? cs[i >> 6] : ~cs[i >> 6];
+        inactive &= ~(uint64_t) 0 << (i & 63);
+        if (!inactive) {
+            continue;
+        }
+        size_t at = (i & ~(size_t) 63) + __builtin_ctzll(inactive) + 1;
+        if (at >= to) {
+            break;
+        }
+        s.clkLevel = bp.bit(cfg.clk, at - 1);
+        s.csLevel = cfg.csActiveLow;
+        s.selected = false;
+        s.first = true;
+        return at;
+    }
+    return to;
+}
+
+SpiDecoder::State SpiDecoder::decode(const Bitplanes &bp, size_t from, size_t to, State state,
+                                     vector<SpiEvent> &out) const {
+    if (from >= to) {
+        return state;
+    }
+    size_t n = maxEvents(to - from);
+    vector<uint32_t> idx(n);
+    vector<uint8_t> mosi(n), miso(n);
+    size_t first = out.size();
+    out.resize(first + n);
+    size_t count = decodeRange(bp, from, to, state, idx.data(), mosi.data(), miso.data(), &out[first]);
+    out.resize(first + count);
+    return state;
+}
+
+size_t SpiDecoder::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+    reserve(planes.samples());
+    return decode(planes, eventBuffer.data());
+}
@@ -0,0 +1,118 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_SPIDECODER_H
+#define TTT_SPIDECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "sigrok_wrapper.h"
+
+#define SPI_NO_CHANNEL (-1)
+
+/* First word after chip select went active */
+#define SPI_FLAG_FIRST   0x01
+/* Chip select went inactive before the word was complete */
+#define SPI_FLAG_PARTIAL 0x02
+
+struct SpiConfig {
+    int clk;
+    int mosi;
+    /** SPI_NO_CHANNEL if not captured */
+    int miso;
+    /** SPI_NO_CHANNEL for a bus without chip select */
+    int cs;
+    uint8_t cpol;
+    uint8_t cpha;
+    /** 1 to 32 */
+    uint8_t wordBits;
+    bool msbFirst;
+    bool csActiveLow;
+};
+
+struct SpiEvent {
+    /** Absolute sample of the clock edge the first bit was taken on */
+    uint64_t sample;
+    uint32_t mosi;
+    uint32_t miso;
+    uint8_t bits;
+    uint8_t flags;
+};
+
+/*
+ * SPI decoder on bit planes. Per block the sampling clock edges (rising
+ * when CPOL == CPHA, falling otherwise) are extracted with the SSE edge
+ * scan into an index list, MOSI and MISO are gathered at those indices
+ * in one pass each, and the bits are then framed into words by chip
+ * select. Index, bit and event buffers are sized up front, so steady
+ * state decoding does not allocate.
+ */
+class SpiDecoder {
+public:
+    explicit SpiDecoder(const SpiConfig &config, unsigned numChannels = 8, size_t maxBlockSamples = 160256);
+
+    void reset();
+
+    /* Upper bound of the events one block of samples produces */
+    static size_t maxEvents(size_t samples) { return samples / 2 + 2; }
+
+    /* Decode a block into out, which holds maxEvents(bp.samples()); returns the count */
+    size_t decode(const Bitplanes &bp, SpiEvent *out);
+
+    /* Capture callback side: gather a Logic16 packet and decode it into events() */
+    size_t process(const sr_wrap_packet_t *packet);
+    const SpiEvent *events() const { return eventBuffer.data(); }
+
+    /*
+     * Decoder side of parallel_decode() (ParallelDecode.h), for a stored
+     * capture in one Bitplanes. Chunks resync where chip select is
+     * inactive: no word is open there and the clock level is in the data,
+     * so the guess is exact. A bus without chip select has no resync
+     * point and decodes as one chunk.
+     */
+    typedef SpiEvent Event;
+    struct State {
+        bool clkLevel;
+        bool csLevel;
+        bool selected;
+        bool first;
+        /* Word being shifted in while selected */
+        SpiEvent word;
+
+        bool operator == (const State &o) const {
+            if (clkLevel != o.clkLevel || csLevel != o.csLevel || selected != o.selected) {
+                return false;
+            }
+            return !selected || (first == o.first && word.bits == o.word.bits &&
+                                 (!word.bits || (word.sample == o.word.sample &&
+                                                 word.mosi == o.word.mosi && word.miso == o.word.miso)));
+        }
+    };
+
+    State initialState() const;
+    size_t resync(const Bitplanes &bp, size_t from, size_t to, State &state) const;
+    State decode(const Bitplanes &bp, size_t from, size_t to, State state, std::vector<SpiEvent> &out) const;
+
+private:
+    void reserve(size_t samples);
+    /* Samples [from, to) of bp; idx, mosiBits and misoBits hold maxEvents(to - from) */
+    size_t decodeRange(const Bitplanes &bp, size_t from, size_t to, State &s, uint32_t *idx,
+                       uint8_t *mosiBits, uint8_t *misoBits, SpiEvent *out) const;
+    void bit(State &s, uint64_t sample, unsigned mosi, unsigned miso, SpiEvent *out, size_t &n) const;
+    void chipSelect(State &s, bool active, SpiEvent *out, size_t &n) const;
+
+    SpiConfig cfg;
+    unsigned numChannels;
+    Bitplanes planes;
+    std::vector<uint32_t> edges;
+    std::vector<uint8_t> mosiBits;
+    std::vector<uint8_t> misoBits;
+    std::vector<uint32_t> csEdges;
+    std::vector<SpiEvent> eventBuffer;
+    State state;
+};
+
+#endif //TTT_SPIDECODER_H
@@ -0,0 +1,271 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "TimingCorrelator.h"
+#include <assert.h>
+#include <string.h>
+
+using namespace std;
+
+#define PICOSECONDS 1000000000000ull
+
+TimingCorrelator::TimingCorrelator(size_t queueCapacity)
+    : capacity(queueCapacity)
+    , evaluated(0)
+    , lost(0) {
+    assert(queueCapacity > 0);
+}
+
+unsigned TimingCorrelator::addDevice(uint64_t samplerate, unsigned numChannels, int64_t offset) {
+    assert(devices.size() < CORRELATE_MAX_DEVICES);
+    assert(samplerate > 0 && numChannels > 0 && numChannels <= BITPLANE_MAX_CHANNELS);
+    Device d;
+    d.samplerate = samplerate;
+    d.numChannels = numChannels;
+    d.offset = offset;
+    for (auto &q : d.queue) {
+        q = -1;
+    }
+    d.started = false;
+    d.closed = false;
+    d.next = 0;
+    d.progress = 0;
+    d.level = 0;
+    d.planes = Bitplanes(numChannels);
+    devices.push_back(d);
+    return (unsigned) devices.size() - 1;
+}
+
+unsigned TimingCorrelator::watch(const EdgeSource &source) {
+    assert(source.device < devices.size() && source.channel < devices[source.device].numChannels);
+    int &q = devices[source.device].queue[source.channel];
+    if (q < 0) {
+        EdgeQueue e;
+        e.ring.resize(capacity);
+        e.head = 0;
+        e.count = 0;
+        q = (int) queues.size();
+        queues.push_back(e);
+    }
+    return (unsigned) q;
+}
+
+unsigned TimingCorrelator::addMeasurement(const TimingMeasurement &def) {
+    assert(def.from.edge & EDGE_BOTH && def.to.edge & EDGE_BOTH);
+    measurements.emplace_back();
+    Measurement &m = measurements.back();
+    memset(m.histogram, 0, sizeof(m.histogram));
+    m.def = def;
+    m.from = watch(def.from);
+    m.to = watch(def.to);
+    m.pending.resize(capacity);
+    m.head = 0;
+    m.waiting = 0;
+    m.count = 0;
+    m.min = UINT64_MAX;
+    m.max = 0;
+    m.sum = 0;
+    m.missed = 0;
+    m.orphans = 0;
+    return (unsigned) measurements.size() - 1;
+}
+
+uint64_t TimingCorrelator::time(unsigned device, uint64_t sample) const {
+    const Device &d = devices[device];
+    __int128 t = (__int128) ((unsigned __int128) sample * PICOSECONDS / d.samplerate) + d.offset;
+    /* A device that started before the timeline has its early samples at 0 */
+    return t < 0 ? 0 : t > (__int128) UINT64_MAX ? UINT64_MAX : (uint64_t) t;
+}
+
+void TimingCorrelator::push(unsigned queue, uint64_t time, bool rising) {
+    EdgeQueue &q = queues[queue];
+    if (q.count == q.ring.size()) {
+        /* Another device is holding the horizon back, lose the oldest */
+        q.head = (q.head + 1) % q.ring.size();
+        q.count--;
+        lost++;
+    }
+    Edge &e = q.ring[(q.head + q.count) % q.ring.size()];
+    e.time = time;
+    e.rising = rising;
+    q.count++;
+}
+
+void TimingCorrelator::add(unsigned device, const Bitplanes &bp) {
+    Device &d = devices[device];
+    size_t n = bp.samples();
+    if (n == 0) {
+        return;
+    }
+    assert(bp.channels() >= d.numChannels);
+
+    if (!d.started || bp.firstSample != d.next) {
+        /* Nothing is known about the line before, so no edge at sample 0 */
+        d.level = 0;
+        for (unsigned ch = 0; ch < d.numChannels; ch++) {
+            d.level |= (uint64_t) (bp.plane(ch)[0] & 1) << ch;
+        }
+        d.started = true;
+    }
+    for (unsigned ch = 0; ch < d.numChannels; ch++) {
+        if (d.queue[ch] < 0) {
+            continue;
+        }
+        bool level = (d.level >> ch) & 1;
+        unsigned q = (unsigned) d.queue[ch];
+        edge_scan(bp.plane(ch), n, level, EDGE_BOTH, [&](size_t i, bool rising) {
+            push(q, time(device, bp.firstSample + i), rising);
+        });
+    }
+    d.level = 0;
+    for (unsigned ch = 0; ch < d.numChannels; ch++) {
+        d.level |= (uint64_t) bp.bit(ch, n - 1) << ch;
+    }
+    d.next = bp.firstSample + n;
+    advance(device, d.next);
+}
+
+void TimingCorrelator::process(unsigned device, const sr_wrap_packet_t *packet) {
+    Device &d = devices[device];
+    bitplane_from_logic16(packet->data, packet->size, d.numChannels, d.planes);
+    d.planes.firstSample = packet->sample;
+    add(device, d.planes);
+}
+
+void TimingCorrelator::advance(unsigned device, uint64_t sample) {
+    Device &d = devices[device];
+    uint64_t t = time(device, sample);
+    if (t > d.progress) {
+        d.progress = t;
+        evaluate();
+    }
+}
+
+void TimingCorrelator::close(unsigned device) {
+    devices[device].closed = true;
+    evaluate();
+}
+
+void TimingCorrelator::expire(Measurement &m, uint64_t now) {
+    while (m.waiting && now - m.pending[m.head] > m.def.timeout) {
+        m.head = (m.head + 1) % m.pending.size();
+        m.waiting--;
+        m.missed++;
+    }
+}
+
+void TimingCorrelator::start(Measurement &m, uint64_t time) {
+    if (m.waiting == m.pending.size()) {
+        m.head = (m.head + 1) % m.pending.size();
+        m.waiting--;
+        m.missed++;
+    }
+    m.pending[(m.head + m.waiting) % m.pending.size()] = time;
+    m.waiting++;
+}
+
+void TimingCorrelator::end(Measurement &m, uint64_t time) {
+    expire(m, time);
+    if (!m.waiting) {
+        m.orphans++;
+        return;
+    }
+    uint64_t from;
+    if (m.def.match == MATCH_OLDEST) {
+        from = m.pending[m.head];
+        m.head = (m.head + 1) % m.pending.size();
+        m.waiting--;
+    } else {
+        from = m.pending[(m.head + m.waiting - 1) % m.pending.size()];
+        m.missed += m.waiting - 1;
+        m.waiting = 0;
+    }
+
+    uint64_t latency = time - from;
+    m.histogram[ChannelStats::bucket(latency)]++;
+    m.count++;
+    m.sum += (double) latency;
+    if (latency < m.min) {
+        m.min = latency;
+    }
+    if (latency > m.max) {
+        m.max = latency;
+    }
+}
+
+static bool selected(unsigned which, bool rising) {
+    return (which & (rising ? EDGE_RISING : EDGE_FALLING)) != 0;
+}
+
+void TimingCorrelator::evaluate() {
+    uint64_t horizon = UINT64_MAX;
+    for (auto &d : devices) {
+        if (!d.closed && d.progress < horizon) {
+            horizon = d.progress;
+        }
+    }
+    if (horizon <= evaluated) {
+        return;
+    }
+
+    for (auto &m : measurements) {
+        const EdgeQueue &a = queues[m.from];
+        const EdgeQueue &b = queues[m.to];
+        size_t i = 0, j = 0;
+
+        if (m.from == m.to) {
+            /* One channel: an edge first ends the pulse before it, then starts one */
+            for (; i < a.count && a.at(i).time < horizon; i++) {
+                const Edge &e = a.at(i);
+                if (selected(m.def.to.edge, e.rising)) {
+                    end(m, e.time);
+                }
+                if (selected(m.def.from.edge, e.rising)) {
+                    start(m, e.time);
+                }
+            }
+        } else {
+            /* Merge both queues in time order, starts first on a tie */
+            for (;;) {
+                bool moreA = i < a.count && a.at(i).time < horizon;
+                bool moreB = j < b.count && b.at(j).time < horizon;
+                if (moreA && (!moreB || a.at(i).time <= b.at(j).time)) {
+                    const Edge &e = a.at(i++);
+                    if (selected(m.def.from.edge, e.rising)) {
+                        start(m, e.time);
+                    }
+                } else if (moreB) {
+                    const Edge &e = b.at(j++);
+                    if (selected(m.def.to.edge, e.rising)) {
+                        end(m, e.time);
+                    }
+                } else {
+                    break;
+                }
+            }
+        }
+        expire(m, horizon);
+    }
+
+    for (auto &q : queues) {
+        while (q.count && q.at(0).time < horizon) {
+            q.head = (q.head + 1) % q.ring.size();
+            q.count--;
+        }
+    }
+    evaluated = horizon;
+}
+
+LatencySummary TimingCorrelator::summary(unsigned measurement) const {
+    const Measurement &m = measurements[measurement];
+    LatencySummary s;
+    s.count = m.count;
+    s.min = m.count ? m.min : 0;
+    s.max = m.max;
+    s.mean = m.count ? m.sum / m.count : 0;
+    s.missed = m.missed;
+    s.orphans = m.orphans;
+    ChannelStats::percentiles(m.histogram, m.count, m.min, m.max, s.p50, s.p99);
+    return s;
+}
@@ -0,0 +1,158 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_TIMINGCORRELATOR_H
+#define TTT_TIMINGCORRELATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "ChannelStats.h"
+#include "EdgeScan.h"
+#include "sigrok_wrapper.h"
+
+#define CORRELATE_MAX_DEVICES 8
+#define CORRELATE_DEFAULT_QUEUE 4096
+
+/* One edge kind on one channel of one device; edge is EDGE_RISING etc. */
+struct EdgeSource {
+    unsigned device;
+    unsigned channel;
+    unsigned edge;
+};
+
+enum CorrelateMatch {
+    /* Each end edge pairs with the oldest start still waiting (pipelined requests) */
+    MATCH_OLDEST,
+    /* Each end edge pairs with the newest start, older ones are missed */
+    MATCH_NEWEST
+};
+
+/*
+ * Latency from a start edge to the end edge that answers it. Starts that
+ * see no end within timeout picoseconds count as missed.
+ */
+struct TimingMeasurement {
+    EdgeSource from;
+    EdgeSource to;
+    uint64_t timeout;
+    CorrelateMatch match;
+};
+
+/* Latencies in picoseconds since the measurement was added */
+struct LatencySummary {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p99;
+    double mean;
+    /** Starts without an end in time, and ends without a start */
+    uint64_t missed;
+    uint64_t orphans;
+};
+
+/*
+ * Edge-to-edge timing across the channels of several devices on a common
+ * timeline: sample / samplerate plus a per-device offset, in picoseconds.
+ *
+ * Edges of the watched channels are kept in one bounded queue per channel.
+ * Devices deliver independently, so a measurement is only evaluated up to
+ * the horizon, the earliest time every open device has delivered (or
+ * promised through advance()) up to; edges behind it are matched and
+ * dropped. Latencies go into log-linear histograms of fixed size, so
+ * memory stays bounded however long the capture runs. A queue that fills
+ * while another device lags loses its oldest edges, counted by dropped().
+ *
+ * Not thread safe: feed it from the one stage that sees every device.
+ */
+class TimingCorrelator {
+public:
+    explicit TimingCorrelator(size_t queueCapacity = CORRELATE_DEFAULT_QUEUE);
+
+    /* Returns the device id; offset in picoseconds is added to its times, which clamp at 0 */
+    unsigned addDevice(uint64_t samplerate, unsigned numChannels, int64_t offset = 0);
+    /* Returns the measurement id; all measurements before the first block */
+    unsigned addMeasurement(const TimingMeasurement &m);
+
+    /* Blocks of a device follow each other; a gap ends nothing but loses the edges in it */
+    void add(unsigned device, const Bitplanes &bp);
+    /* Capture callback side: gather a Logic16 packet and add it */
+    void process(unsigned device, const sr_wrap_packet_t *packet);
+    /* Promise that the device has nothing before sample */
+    void advance(unsigned device, uint64_t sample);
+    /* No more blocks from the device, it no longer holds the horizon back */
+    void close(unsigned device);
+
+    LatencySummary summary(unsigned measurement) const;
+    uint64_t horizon() const { return evaluated; }
+    uint64_t dropped() const { return lost; }
+
+    /* Picoseconds on the common timeline of a device sample */
+    uint64_t time(unsigned device, uint64_t sample) const;
+
+private:
+    struct Edge {
+        uint64_t time;
+        bool rising;
+    };
+
+    /* Bounded ring of the edges of one channel not yet behind the horizon */
+    struct EdgeQueue {
+        std::vector<Edge> ring;
+        size_t head;
+        size_t count;
+
+        const Edge &at(size_t i) const { return ring[(head + i) % ring.size()]; }
+    };
+
+    struct Device {
+        uint64_t samplerate;
+        unsigned numChannels;
+        int64_t offset;
+        /* Queue index per channel, -1 when not watched */
+        int queue[BITPLANE_MAX_CHANNELS];
+        bool started;
+        bool closed;
+        uint64_t next;
+        /* Time everything before has been delivered */
+        uint64_t progress;
+        uint64_t level;
+        Bitplanes planes;
+    };
+
+    struct Measurement {
+        TimingMeasurement def;
+        unsigned from;
+        unsigned to;
+        /* Bounded ring of start times waiting for an end */
+        std::vector<uint64_t> pending;
+        size_t head;
+        size_t waiting;
+        uint64_t count;
+        uint64_t min;
+        uint64_t max;
+        double sum;
+        uint64_t missed;
+        uint64_t orphans;
+        uint64_t histogram[STATS_WIDTH_BUCKETS];
+    };
+
+    unsigned watch(const EdgeSource &source);
+    void push(unsigned queue, uint64_t time, bool rising);
+    void start(Measurement &m, uint64_t time);
+    void end(Measurement &m, uint64_t time);
+    void expire(Measurement &m, uint64_t now);
+    void evaluate();
+
+    size_t capacity;
+    std::vector<Device> devices;
+    std::vector<EdgeQueue> queues;
+    std::vector<Measurement> measurements;
+    uint64_t evaluated;
+    uint64_t lost;
+};
+
+#endif //TTT_TIMINGCORRELATOR_H
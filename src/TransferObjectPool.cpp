@@ -3,10 +3,12 @@
 //
 
 #include "TransferObjectPool.h"
+#include "PacketHandle.h"
 
 using namespace std;
 
-TransferObjectPool::TransferObjectPool(uint32_t cnt, uint32_t sizeOfPacket) {
+TransferObjectPool::TransferObjectPool(uint32_t cnt, uint32_t sizeOfPacket)
+    : refs(cnt) {
     /* Preallocate */
     for(int i = 0; i < cnt; i++){
         objects.push_back(sr_warp_transfer_t());
@@ -18,6 +20,7 @@ TransferObjectPool::TransferObjectPool(uint32_t cnt, uint32_t sizeOfPacket) {
         objects.at(i).packet.data = new uint8_t[sizeOfPacket];
         objects.at(i).packet.size = sizeOfPacket;
         objects.at(i).packet.ref = &objects.at(i);
+        refs[i].store(0, memory_order_relaxed);
         free(&objects.at(i));
     }
 }
@@ -32,6 +35,9 @@ void TransferObjectPool::free(sr_warp_transfer_t *ptr) {
 sr_warp_transfer_t* TransferObjectPool::alloc() {
     /* Aquire lock */
     lock_guard<mutex> lock(mtx);
+    if (freeObjects.empty()) {
+        return nullptr;
+    }
     /* Get next free transfer object */
     auto ret = freeObjects.front();
     /* Remove object from free list */
@@ -39,6 +45,21 @@ sr_warp_transfer_t* TransferObjectPool::alloc() {
     return ret;
 }
 
+PacketHandle TransferObjectPool::acquire() {
+    sr_warp_transfer_t *obj = alloc();
+    if (!obj) {
+        return PacketHandle();
+    }
+    refs[obj - &objects[0]].store(1, memory_order_relaxed);
+    return PacketHandle(this, obj);
+}
+
 unsigned long TransferObjectPool::size() {
     return objects.size();
 }
+
+unsigned long TransferObjectPool::available() {
+    /* Aquire lock */
+    lock_guard<mutex> lock(mtx);
+    return freeObjects.size();
+}
@@ -8,8 +8,10 @@
 #include <list>
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include "sigrok_wrapper.h"
 
+class PacketHandle;
 
 class TransferObjectPool {
 public:
@@ -17,10 +19,33 @@ public:
     void free(sr_warp_transfer_t *ptr);
     sr_warp_transfer_t* alloc();
     unsigned long size();
+    unsigned long available();
+
+    /* Allocate an object owned by the returned handle, empty if exhausted */
+    PacketHandle acquire();
+
+    void retain(sr_warp_transfer_t *ptr) {
+        refs[ptr - &objects[0]].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release(sr_warp_transfer_t *ptr) {
+        std::atomic<uint32_t> &r = refs[ptr - &objects[0]];
+        /* A sole owner can skip the read-modify-write */
+        if (r.load(std::memory_order_acquire) == 1 || r.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            r.store(0, std::memory_order_relaxed);
+            free(ptr);
+        }
+    }
+
+    uint32_t refCount(sr_warp_transfer_t *ptr) {
+        return refs[ptr - &objects[0]].load(std::memory_order_relaxed);
+    }
+
 private:
     std::mutex mtx;
     std::list<sr_warp_transfer_t *> freeObjects;
     std::vector<sr_warp_transfer_t> objects;
+    std::vector<std::atomic<uint32_t>> refs;
 };
 
 
@@ -0,0 +1,149 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "Trigger.h"
+#include <assert.h>
+#include <tmmintrin.h>
+
+Trigger::Trigger(uint32_t preSamples, uint32_t postSamples)
+    : pre(preSamples)
+    , post(postSamples)
+    , current(0)
+    , next(0)
+    , holdoff(0)
+    , last(0)
+    , inPulse(false)
+    , pulseStart(0) {
+}
+
+void Trigger::addStage(const TriggerCondition &cond) {
+    assert(stages.size() < TRIGGER_MAX_STAGES);
+    assert((cond.levelValue & ~cond.levelMask) == 0);
+    stages.push_back(cond);
+}
+
+void Trigger::reset() {
+    current = 0;
+    holdoff = next;
+    inPulse = false;
+}
+
+/* Bit i set when sample i matches the level and edge part of c */
+uint64_t Trigger::match(const TriggerCondition &c, const uint16_t *s, size_t n, uint16_t prev) {
+    const __m128i lm = _mm_set1_epi16((short) c.levelMask);
+    const __m128i lv = _mm_set1_epi16((short) c.levelValue);
+    const __m128i rm = _mm_set1_epi16((short) c.riseMask);
+    const __m128i fm = _mm_set1_epi16((short) c.fallMask);
+    const __m128i zero = _mm_setzero_si128();
+    const bool edges = !c.pulse && (c.riseMask | c.fallMask);
+    __m128i pv = _mm_set1_epi16((short) prev);
+    uint64_t out = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (s + i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (s + i + 8));
+        __m128i ma = _mm_cmpeq_epi16(_mm_and_si128(a, lm), lv);
+        __m128i mb = _mm_cmpeq_epi16(_mm_and_si128(b, lm), lv);
+
+        if (edges) {
+            /* Each lane next to the sample before it */
+            __m128i pa = _mm_alignr_epi8(a, pv, 14);
+            __m128i pb = _mm_alignr_epi8(b, a, 14);
+            __m128i ea = _mm_or_si128(_mm_and_si128(_mm_andnot_si128(pa, a), rm),
+                                      _mm_and_si128(_mm_andnot_si128(a, pa), fm));
+            __m128i eb = _mm_or_si128(_mm_and_si128(_mm_andnot_si128(pb, b), rm),
+                                      _mm_and_si128(_mm_andnot_si128(b, pb), fm));
+            ma = _mm_andnot_si128(_mm_cmpeq_epi16(ea, zero), ma);
+            mb = _mm_andnot_si128(_mm_cmpeq_epi16(eb, zero), mb);
+        }
+
+        out |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_packs_epi16(ma, mb)) << i;
+        pv = b;
+    }
+
+    for (; i < n; i++) {
+        uint16_t p = i ? s[i - 1] : prev;
+        bool hit = (s[i] & c.levelMask) == c.levelValue;
+        if (edges) {
+            hit = hit && (((~p & s[i]) & c.riseMask) | ((p & ~s[i]) & c.fallMask));
+        }
+        out |= (uint64_t) hit << i;
+    }
+    return out;
+}
+
+/* Turn level bits into pulse end matches, tracking pulses across calls */
+uint64_t Trigger::pulses(const TriggerCondition &c, uint64_t level, size_t n, uint64_t base) {
+    uint64_t valid = n == 64 ? ~(uint64_t) 0 : (((uint64_t) 1 << n) - 1);
+    uint64_t t = (level ^ ((level << 1) | (inPulse ? 1 : 0))) & valid;
+    uint64_t out = 0;
+
+    while (t) {
+        unsigned p = __builtin_ctzll(t);
+        if ((level >> p) & 1) {
+            inPulse = true;
+            pulseStart = base + p;
+        } else {
+            uint64_t width = base + p - pulseStart;
+            inPulse = false;
+            if (width >= c.minWidth && width <= c.maxWidth) {
+                out |= (uint64_t) 1 << p;
+            }
+        }
+        t &= t - 1;
+    }
+    return out;
+}
+
+size_t Trigger::process(const uint16_t *samples, size_t count, std::vector<TriggerEvent> &events) {
+    size_t fired = 0;
+
+    for (size_t off = 0; off < count; off += 64) {
+        size_t n = count - off < 64 ? count - off : 64;
+        const uint16_t *s = samples + off;
+        uint64_t base = next;
+        unsigned from = holdoff > base ? (unsigned) (holdoff - base < 64 ? holdoff - base : 64) : 0;
+
+        while (!stages.empty() && from < n) {
+            const TriggerCondition &c = stages[current];
+            uint64_t m = match(c, s, n, last);
+            if (c.pulse) {
+                if (from) {
+                    /* Stage armed mid block, pulses start no earlier */
+                    m &= ~(uint64_t) 0 << from;
+                    inPulse = false;
+                }
+                m = pulses(c, m, n, base);
+            }
+            m &= ~(uint64_t) 0 << from;
+            if (!m) {
+                break;
+            }
+
+            unsigned p = __builtin_ctzll(m);
+            inPulse = false;
+            if (current + 1 < stages.size()) {
+                current++;
+                from = p + 1;
+                continue;
+            }
+
+            TriggerEvent ev;
+            ev.sample = base + p;
+            ev.windowStart = ev.sample > pre ? ev.sample - pre : 0;
+            ev.windowEnd = ev.sample + 1 + post;
+            events.push_back(ev);
+            fired++;
+
+            current = 0;
+            holdoff = ev.windowEnd;
+            from = holdoff - base < 64 ? (unsigned) (holdoff - base) : 64;
+        }
+
+        last = s[n - 1];
+        next += n;
+    }
+    return fired;
+}
@@ -0,0 +1,82 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_TRIGGER_H
+#define TTT_TRIGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define TRIGGER_MAX_STAGES 8
+
+/*
+ * One trigger stage. A sample matches when the channels in levelMask equal
+ * levelValue and, if riseMask or fallMask is set, at least one of those
+ * channels has the requested edge at that sample.
+ *
+ * With pulse set, levelMask/levelValue describe the pulse instead: the
+ * stage matches on the first sample after the level held for between
+ * minWidth and maxWidth samples.
+ */
+struct TriggerCondition {
+    uint16_t levelMask;
+    uint16_t levelValue;
+    uint16_t riseMask;
+    uint16_t fallMask;
+    bool pulse;
+    uint32_t minWidth;
+    uint32_t maxWidth;
+};
+
+struct TriggerEvent {
+    /** Sample at which the last stage matched */
+    uint64_t sample;
+    /** Capture window [windowStart, windowEnd) around the trigger */
+    uint64_t windowStart;
+    uint64_t windowEnd;
+};
+
+/*
+ * Software trigger over interleaved 16-bit sample words. Stages must match
+ * in order, each at a later sample than the previous one. Conditions are
+ * evaluated 64 samples at a time with SSE compares; only the current stage
+ * is evaluated, so an armed trigger costs a few vector ops per 8 samples.
+ */
+class Trigger {
+public:
+    Trigger(uint32_t preSamples = 0, uint32_t postSamples = 0);
+
+    void addStage(const TriggerCondition &cond);
+    /* Re-arm at the first stage */
+    void reset();
+
+    /*
+     * Scan count samples that follow everything passed so far. Fired
+     * triggers are appended to events; returns the number fired. A fired
+     * trigger re-arms once its post window has passed.
+     */
+    size_t process(const uint16_t *samples, size_t count, std::vector<TriggerEvent> &events);
+
+    uint64_t position() const { return next; }
+    unsigned stage() const { return current; }
+
+private:
+    uint64_t match(const TriggerCondition &c, const uint16_t *s, size_t n, uint16_t prev);
+    uint64_t pulses(const TriggerCondition &c, uint64_t level, size_t n, uint64_t base);
+
+    uint32_t pre;
+    uint32_t post;
+    std::vector<TriggerCondition> stages;
+    unsigned current;
+    /* Absolute index of the next sample to process */
+    uint64_t next;
+    uint64_t holdoff;
+    uint16_t last;
+    /* Pulse tracking for the current stage */
+    bool inPulse;
+    uint64_t pulseStart;
+};
+
+#endif //TTT_TRIGGER_H
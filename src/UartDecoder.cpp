@@ -0,0 +1,406 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "UartDecoder.h"
+#include "EdgeScan.h"
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+using namespace std;
+
+static const uint32_t standard_rates[] = {
+    300, 600, 1200, 2400, 4800, 9600, 14400, 19200, 28800, 38400, 57600, 76800, 115200,
+    230400, 250000, 460800, 500000, 921600, 1000000, 1500000, 2000000, 3000000, 4000000
+};
+
+UartDecoder::UartDecoder(unsigned numChannels, uint64_t samplerate, unsigned threads)
+    : numChannels(numChannels)
+    , samplerate(samplerate)
+    , planes(numChannels)
+    , job(NULL)
+    , generation(0)
+    , busy(0)
+    , stopping(false)
+    , nextChannel(0) {
+    assert(samplerate > 0 && threads > 0);
+    for (unsigned t = 1; t < threads; t++) {
+        workers.push_back(std::thread(&UartDecoder::run, this));
+    }
+}
+
+UartDecoder::~UartDecoder() {
+    {
+        lock_guard<mutex> lock(workMtx);
+        stopping = true;
+    }
+    workCv.notify_all();
+    for (auto &t : workers) {
+        t.join();
+    }
+}
+
+void UartDecoder::share(const Bitplanes &bp) {
+    for (size_t k; (k = nextChannel.fetch_add(1, memory_order_relaxed)) < channels.size();) {
+        decodeChannel(channels[k], bp);
+    }
+}
+
+void UartDecoder::run() {
+    uint64_t seen = 0;
+    for (;;) {
+        const Bitplanes *bp;
+        {
+            unique_lock<mutex> lock(workMtx);
+            workCv.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            bp = job;
+        }
+        share(*bp);
+        {
+            lock_guard<mutex> lock(workMtx);
+            if (--busy == 0) {
+                doneCv.notify_one();
+            }
+        }
+    }
+}
+
+void UartDecoder::addChannel(unsigned channel, const UartConfig &config) {
+    assert(channel < numChannels);
+    assert(config.dataBits >= 5 && config.dataBits <= 9);
+    assert(config.stopBits >= 1 && config.stopBits <= 2);
+    assert(config.parity <= UART_PARITY_EVEN);
+
+    Channel c = Channel();
+    c.channel = channel;
+    c.config = config;
+    c.frameBits = 1 + config.dataBits + (config.parity != UART_PARITY_NONE) + config.stopBits;
+    channels.push_back(c);
+    reset();
+}
+
+void UartDecoder::reset() {
+    for (auto &c : channels) {
+        c.bitLen = 0;
+        c.detected = 0;
+        if (c.config.baud) {
+            setBaud(c, c.config.baud);
+        }
+        c.line = Line();
+        c.line.level = true;
+        c.line.highSince = UINT64_MAX;
+        c.edges = 0;
+        c.out.clear();
+    }
+    pending.clear();
+}
+
+uint32_t UartDecoder::baud(unsigned channel) const {
+    for (auto &c : channels) {
+        if (c.channel == channel) {
+            return c.detected;
+        }
+    }
+    return 0;
+}
+
+void UartDecoder::setBaud(Channel &c, uint32_t baud) {
+    c.detected = baud;
+    c.bitLen = samplerate * 256 / baud;
+}
+
+/*
+ * Short pulses are whole bits: the shortest gives the bit length roughly,
+ * pulses of up to four bits refine it. Rates near a standard one snap.
+ */
+void UartDecoder::measure(Channel &c, const Bitplanes &bp) {
+    bool level = c.line.level;
+    edge_scan(bp.plane(c.channel), bp.samples(), level, EDGE_BOTH, [&](size_t i, bool) {
+        uint64_t s = bp.firstSample + i;
+        if (c.edges > 0 && c.edges <= UART_AUTOBAUD_EDGES) {
+            c.widths[c.edges - 1] = (uint32_t) min<uint64_t>(s - c.lastEdge, UINT32_MAX);
+        }
+        c.edges++;
+        c.lastEdge = s;
+    });
+    if (c.edges <= UART_AUTOBAUD_EDGES) {
+        return;
+    }
+
+    uint32_t shortest = *min_element(c.widths, c.widths + UART_AUTOBAUD_EDGES);
+    if (shortest == 0) {
+        c.edges = 0;
+        return;
+    }
+    uint64_t total = 0, bits = 0;
+    for (uint32_t w : c.widths) {
+        if (w <= 4 * shortest) {
+            total += w;
+            bits += (w + shortest / 2) / shortest;
+        }
+    }
+    double rate = (double) samplerate * bits / total;
+    uint32_t baud = (uint32_t) lround(rate);
+    for (uint32_t r : standard_rates) {
+        if (fabs(rate / r - 1) < 0.05) {
+            baud = r;
+        }
+    }
+    setBaud(c, baud);
+}
+
+void UartDecoder::finish(const Channel &c, Line &l, vector<UartEvent> &out) const {
+    const UartConfig &cfg = c.config;
+    uint32_t data = (l.bits >> 1) & ((1u << cfg.dataBits) - 1);
+    unsigned pos = 1 + cfg.dataBits;
+    uint8_t flags = 0;
+
+    if (cfg.parity != UART_PARITY_NONE) {
+        unsigned ones = __builtin_popcount(data) + ((l.bits >> pos) & 1);
+        if ((ones & 1) != (cfg.parity == UART_PARITY_ODD)) {
+            flags |= UART_FLAG_PARITY;
+        }
+        pos++;
+    }
+    uint32_t stop = ((1u << cfg.stopBits) - 1) << pos;
+    if ((l.bits & stop) != stop) {
+        flags |= UART_FLAG_FRAMING;
+        /* Wait for a gap; the stop bit was low, a rising edge will follow */
+        l.synced = false;
+        l.highSince = l.resume;
+    }
+    if (l.bits == 0) {
+        flags |= UART_FLAG_BREAK;
+    }
+
+    UartEvent e;
+    e.sample = l.start;
+    e.data = (uint16_t) data;
+    e.channel = (uint8_t) c.channel;
+    e.flags = flags;
+    out.push_back(e);
+}
+
+void UartDecoder::decodeChannel(Channel &c, const Bitplanes &bp) {
+    const size_t n = bp.samples();
+
+    if (n == 0) {
+        return;
+    }
+    if (!c.bitLen) {
+        measure(c, bp);
+        if (!c.bitLen) {
+            c.line.level = bp.bit(c.channel, n - 1);
+            return;
+        }
+        /* Locked within this block, decode it from its start */
+        c.line.highSince = bp.firstSample;
+    }
+    decodeLine(c, c.line, bp, 0, n, c.out);
+}
+
+void UartDecoder::decodeLine(const Channel &c, Line &l, const Bitplanes &bp, size_t from, size_t to,
+                             vector<UartEvent> &out) const {
+    const uint64_t *plane = bp.plane(c.channel);
+    const uint64_t base = bp.firstSample;
+
+    if (from >= to) {
+        return;
+    }
+    if (l.highSince == UINT64_MAX) {
+        l.highSince = base + from;
+    }
+
+    const uint64_t frameLen = c.frameLen();
+    for (;;) {
+        if (l.inFrame) {
+            for (; l.bit < c.frameBits; l.bit++) {
+                uint64_t mid = l.start + ((2 * l.bit + 1) * c.bitLen >> 9);
+                if (mid >= base + to) {
+                    l.level = bp.bit(c.channel, to - 1);
+                    return;
+                }
+                l.bits |= (uint32_t) bp.bit(c.channel, mid - base) << l.bit;
+                l.resume = mid + 1;
+                if (l.bit == 0 && l.bits) {
+                    /* Glitch, not a start bit */
+                    break;
+                }
+            }
+            if (l.bit == c.frameBits) {
+                finish(c, l, out);
+            }
+            l.inFrame = false;
+        }
+
+        size_t at = l.resume > base + from ? l.resume - base : from;
+        size_t i = edge_find(plane, to, at, l.level, l.synced ? EDGE_FALLING : EDGE_BOTH);
+        if (i >= to) {
+            break;
+        }
+        uint64_t s = base + i;
+        if (!l.synced) {
+            l.resume = s + 1;
+            if (bp.bit(c.channel, i)) {
+                l.highSince = s;
+                continue;
+            }
+            if (s - l.highSince < frameLen) {
+                continue;
+            }
+            l.synced = true;
+        }
+        l.inFrame = true;
+        l.start = s;
+        l.bit = 0;
+        l.bits = 0;
+    }
+    l.level = bp.bit(c.channel, to - 1);
+}
+
+static bool event_order(const UartEvent &a, const UartEvent &b) {
+    return a.sample != b.sample ? a.sample < b.sample : a.channel < b.channel;
+}
+
+size_t UartDecoder::decode(const Bitplanes &bp, vector<UartEvent> &out) {
+    if (!workers.empty() && channels.size() > 1) {
+        {
+            lock_guard<mutex> lock(workMtx);
+            job = &bp;
+            nextChannel.store(0, memory_order_relaxed);
+            busy = (unsigned) workers.size();
+            generation++;
+        }
+        workCv.notify_all();
+        share(bp);
+        unique_lock<mutex> lock(workMtx);
+        doneCv.wait(lock, [&] { return busy == 0; });
+    } else {
+        for (auto &c : channels) {
+            decodeChannel(c, bp);
+        }
+    }
+
+    for (auto &c : channels) {
+        pending.insert(pending.end(), c.out.begin(), c.out.end());
+        c.out.clear();
+    }
+    sort(pending.begin(), pending.end(), event_order);
+
+    /* Frames not started yet will start after the block */
+    uint64_t watermark = bp.firstSample + bp.samples();
+    for (auto &c : channels) {
+        if (c.line.inFrame && c.line.start < watermark) {
+            watermark = c.line.start;
+        }
+    }
+    size_t ready = 0;
+    while (ready < pending.size() && pending[ready].sample < watermark) {
+        ready++;
+    }
+    out.insert(out.end(), pending.begin(), pending.begin() + ready);
+    pending.erase(pending.begin(), pending.begin() + ready);
+    return ready;
+}
+
+size_t UartDecoder::flush(vector<UartEvent> &out) {
+    size_t n = pending.size();
+    out.insert(out.end(), pending.begin(), pending.end());
+    pending.clear();
+    return n;
+}
+
+size_t UartDecoder::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+    eventList.clear();
+    return decode(planes, eventList);
+}
+
+UartDecoder::State UartDecoder::initialState() const {
+    State s;
+    for (auto &l : s.line) {
+        l = Line();
+        l.level = true;
+        l.highSince = UINT64_MAX;
+    }
+    assert(all_of(channels.begin(), channels.end(), [](const Channel &c) { return c.config.baud != 0; }));
+    return s;
+}
+
+/* First sample s that every line was high for a whole frame before */
+size_t UartDecoder::resync(const Bitplanes &bp, size_t from, size_t to, State &state) const {
+    state = initialState();
+    uint64_t need = 0;
+    for (auto &c : channels) {
+        need = max(need, c.frameLen());
+    }
+
+    size_t begin = from > need ? from - need : 0;
+    /* Start of the stretch where no line was low */
+    size_t quiet = begin;
+    for (size_t w = begin / 64; w * 64 < to; w++) {
+        uint64_t low = 0;
+        for (auto &c : channels) {
+            low |= ~bp.plane(c.channel)[w];
+        }
+        if (w == begin / 64) {
+            low &= ~(uint64_t) 0 << (begin & 63);
+        }
+        for (;;) {
+            size_t s = (size_t) max<uint64_t>(quiet + need, from);
+            size_t p = low ? w * 64 + __builtin_ctzll(low) : (w + 1) * 64;
+            if (s < to && (low ? s <= p : s < p)) {
+                for (size_t k = 0; k < channels.size(); k++) {
+                    Line &l = state.line[k];
+                    l.level = true;
+                    l.synced = true;
+                    l.highSince = 0;
+                    l.resume = bp.firstSample + s;
+                }
+                return s;
+            }
+            if (!low) {
+                break;
+            }
+            quiet = p + 1;
+            low &= low - 1;
+        }
+    }
+    return to;
+}
+
+UartDecoder::State UartDecoder::decode(const Bitplanes &bp, size_t from, size_t to, State state,
+                                       vector<UartEvent> &out) const {
+    if (from >= to) {
+        return state;
+    }
+    size_t first = out.size();
+    const uint64_t now = bp.firstSample + to;
+    for (size_t k = 0; k < channels.size(); k++) {
+        const Channel &c = channels[k];
+        Line &l = state.line[k];
+        decodeLine(c, l, bp, from, to, out);
+        if (l.inFrame) {
+            continue;
+        }
+        /* One form per line state, so a resync guess compares equal */
+        if (!l.synced && l.level && now - l.highSince >= c.frameLen()) {
+            l.synced = true;
+        }
+        if (l.synced) {
+            l.highSince = 0;
+        }
+        l.start = 0;
+        l.bit = 0;
+        l.bits = 0;
+        l.resume = now;
+    }
+    sort(out.begin() + first, out.end(), event_order);
+    return state;
+}
@@ -0,0 +1,179 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_UARTDECODER_H
+#define TTT_UARTDECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Bitplane.h"
+#include "sigrok_wrapper.h"
+
+#define UART_PARITY_NONE 0
+#define UART_PARITY_ODD  1
+#define UART_PARITY_EVEN 2
+
+#define UART_FLAG_FRAMING 0x01
+#define UART_FLAG_PARITY  0x02
+/* Start, data and stop bits all low */
+#define UART_FLAG_BREAK   0x04
+
+/* Edges measured before an auto-baud channel locks */
+#define UART_AUTOBAUD_EDGES 32
+
+struct UartConfig {
+    /** 0 measures the rate from the shortest pulse */
+    uint32_t baud;
+    uint8_t dataBits;
+    uint8_t parity;
+    uint8_t stopBits;
+};
+
+struct UartEvent {
+    /** Absolute sample of the start bit's falling edge */
+    uint64_t sample;
+    uint16_t data;
+    uint8_t channel;
+    uint8_t flags;
+};
+
+/*
+ * Asynchronous serial decoder on bit planes. Idle line is never looked at
+ * sample by sample: the next start bit is found with the SSE edge search,
+ * then every bit of the frame is read at its centre, computed from the
+ * falling edge. A frame may straddle blocks.
+ *
+ * A channel only takes a start bit after the line was high for a whole
+ * frame, so decoding that starts mid-stream, and a framing error, resync
+ * on the next gap instead of decoding shifted frames.
+ *
+ * Channels are independent and can be decoded on several threads, kept
+ * by the decoder and woken for each block. Events
+ * come out ordered by sample: a frame is held back while another channel
+ * is still inside a frame that started earlier.
+ */
+class UartDecoder {
+public:
+    /* Where one line is in its frames, carried from one block to the next */
+    struct Line {
+        /* Line level after the last block */
+        bool level;
+        bool synced;
+        uint64_t highSince;
+        /* Frame being sampled */
+        bool inFrame;
+        uint64_t start;
+        unsigned bit;
+        uint32_t bits;
+        /* No start bit is looked for before this sample */
+        uint64_t resume;
+
+        bool operator == (const Line &o) const {
+            return level == o.level && synced == o.synced && highSince == o.highSince &&
+                   inFrame == o.inFrame && start == o.start && bit == o.bit && bits == o.bits &&
+                   resume == o.resume;
+        }
+    };
+
+    UartDecoder(unsigned numChannels, uint64_t samplerate, unsigned threads = 1);
+    ~UartDecoder();
+
+    UartDecoder(const UartDecoder&) = delete;
+    UartDecoder& operator = (const UartDecoder&) = delete;
+
+    void addChannel(unsigned channel, const UartConfig &config);
+    void reset();
+
+    /* Append the frames completed in bp, returns how many */
+    size_t decode(const Bitplanes &bp, std::vector<UartEvent> &out);
+    /* Append the frames still held back, at the end of a capture */
+    size_t flush(std::vector<UartEvent> &out);
+
+    /* Capture callback side: gather a Logic16 packet and decode it */
+    size_t process(const sr_wrap_packet_t *packet);
+    const std::vector<UartEvent> &events() const { return eventList; }
+
+    /* Configured or detected rate of a channel, 0 while still measuring */
+    uint32_t baud(unsigned channel) const;
+
+    /*
+     * Decoder side of parallel_decode() (ParallelDecode.h), for a stored
+     * capture in one Bitplanes. Every channel needs a configured baud.
+     * Chunks resync where all channels were idle high for a whole frame:
+     * no frame can be open there and the next falling edge starts one, so
+     * the guess is exact.
+     */
+    typedef UartEvent Event;
+    struct State {
+        /* Indexed like the channels were added */
+        Line line[BITPLANE_MAX_CHANNELS];
+
+        bool operator == (const State &o) const {
+            for (unsigned k = 0; k < BITPLANE_MAX_CHANNELS; k++) {
+                if (!(line[k] == o.line[k])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    State initialState() const;
+    size_t resync(const Bitplanes &bp, size_t from, size_t to, State &state) const;
+    State decode(const Bitplanes &bp, size_t from, size_t to, State state, std::vector<UartEvent> &out) const;
+
+private:
+    struct Channel {
+        unsigned channel;
+        UartConfig config;
+        unsigned frameBits;
+        /* Samples per bit in 1/256 */
+        uint64_t bitLen;
+        uint32_t detected;
+        Line line;
+        /* Auto-baud: pulse widths between the first edges */
+        uint64_t lastEdge;
+        unsigned edges;
+        uint32_t widths[UART_AUTOBAUD_EDGES];
+        std::vector<UartEvent> out;
+
+        uint64_t frameLen() const { return frameBits * bitLen >> 8; }
+    };
+
+    void decodeChannel(Channel &c, const Bitplanes &bp);
+    /* Frames of samples [from, to) of bp on one line */
+    void decodeLine(const Channel &c, Line &l, const Bitplanes &bp, size_t from, size_t to,
+                    std::vector<UartEvent> &out) const;
+    void measure(Channel &c, const Bitplanes &bp);
+    void finish(const Channel &c, Line &l, std::vector<UartEvent> &out) const;
+    void setBaud(Channel &c, uint32_t baud);
+    /* Decode channels of the current block until none is left */
+    void share(const Bitplanes &bp);
+    void run();
+
+    unsigned numChannels;
+    uint64_t samplerate;
+    std::vector<Channel> channels;
+    std::vector<UartEvent> pending;
+    Bitplanes planes;
+    std::vector<UartEvent> eventList;
+
+    /* threads - 1 workers; decode() is the last one */
+    std::vector<std::thread> workers;
+    std::mutex workMtx;
+    std::condition_variable workCv;
+    std::condition_variable doneCv;
+    const Bitplanes *job;
+    uint64_t generation;
+    unsigned busy;
+    bool stopping;
+    std::atomic<size_t> nextChannel;
+};
+
+#endif //TTT_UARTDECODER_H
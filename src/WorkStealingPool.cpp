@@ -0,0 +1,160 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "WorkStealingPool.h"
+#include <assert.h>
+
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+    : pending(0)
+    , outstanding(0)
+    , idle(0)
+    , stopping(false)
+    , stolenCount(0) {
+    assert(threads > 0);
+    for (unsigned i = 0; i < threads; i++) {
+        workers.push_back(unique_ptr<Worker>(new Worker));
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers[i]->thread = thread(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        lock_guard<mutex> lock(sleepMtx);
+        stopping = true;
+    }
+    wakeCv.notify_all();
+    for (auto &w : workers) {
+        w->thread.join();
+    }
+}
+
+int WorkStealingPool::addStream(Work work, Commit commit, uint32_t window) {
+    assert(window > 0);
+    unique_ptr<Stream> s(new Stream);
+    s->work = work;
+    s->commit = commit;
+    s->window = window;
+    s->nextSeq = 0;
+    s->inFlight = 0;
+    s->nextCommit = 0;
+    s->committing = false;
+    s->done.resize(window);
+    s->ready.resize(window, false);
+    streams.push_back(std::move(s));
+    return (int) streams.size() - 1;
+}
+
+bool WorkStealingPool::submit(int stream, PacketHandle &&packet) {
+    Stream &s = *streams[stream];
+
+    if (s.inFlight.load(memory_order_acquire) == s.window) {
+        return false;
+    }
+    s.inFlight.fetch_add(1, memory_order_relaxed);
+    outstanding.fetch_add(1, memory_order_relaxed);
+
+    Worker &w = *workers[stream % workers.size()];
+    {
+        lock_guard<mutex> lock(w.mtx);
+        w.tasks.push_back(Task{&s, s.nextSeq++, std::move(packet)});
+    }
+
+    /* Pairs with the idle check in run(), one of the two sees the other */
+    pending.fetch_add(1, memory_order_seq_cst);
+    if (idle.load(memory_order_seq_cst) > 0) {
+        lock_guard<mutex> lock(sleepMtx);
+        wakeCv.notify_one();
+    }
+    return true;
+}
+
+void WorkStealingPool::wait() {
+    unique_lock<mutex> lock(sleepMtx);
+    doneCv.wait(lock, [this]() { return outstanding.load(memory_order_acquire) == 0; });
+}
+
+bool WorkStealingPool::take(unsigned index, Task &task) {
+    Worker &own = *workers[index];
+    {
+        lock_guard<mutex> lock(own.mtx);
+        if (!own.tasks.empty()) {
+            /* Oldest first, so streams can commit early */
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (unsigned i = 1; i < workers.size(); i++) {
+        Worker &victim = *workers[(index + i) % workers.size()];
+        lock_guard<mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            stolenCount.fetch_add(1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::complete(Stream &s, uint64_t seq, PacketHandle &&packet) {
+    unique_lock<mutex> lock(s.mtx);
+    uint32_t slot = seq % s.window;
+    s.done[slot] = std::move(packet);
+    s.ready[slot] = true;
+
+    /* Someone else is committing, they will pick this one up */
+    if (s.committing) {
+        return;
+    }
+    s.committing = true;
+    for (;;) {
+        slot = s.nextCommit % s.window;
+        if (!s.ready[slot]) {
+            break;
+        }
+        PacketHandle h = std::move(s.done[slot]);
+        s.ready[slot] = false;
+        s.nextCommit++;
+
+        lock.unlock();
+        s.commit(h);
+        h.reset();
+        s.inFlight.fetch_sub(1, memory_order_release);
+        if (outstanding.fetch_sub(1, memory_order_acq_rel) == 1) {
+            lock_guard<mutex> sleepLock(sleepMtx);
+            doneCv.notify_all();
+        }
+        lock.lock();
+    }
+    s.committing = false;
+}
+
+void WorkStealingPool::run(unsigned index) {
+    Task task;
+
+    for (;;) {
+        if (take(index, task)) {
+            pending.fetch_sub(1, memory_order_relaxed);
+            task.stream->work(task.packet);
+            complete(*task.stream, task.seq, std::move(task.packet));
+            continue;
+        }
+
+        unique_lock<mutex> lock(sleepMtx);
+        idle.fetch_add(1, memory_order_seq_cst);
+        while (pending.load(memory_order_seq_cst) <= 0 && !stopping) {
+            wakeCv.wait(lock);
+        }
+        idle.fetch_sub(1, memory_order_relaxed);
+        if (stopping && pending.load(memory_order_relaxed) <= 0) {
+            return;
+        }
+    }
+}
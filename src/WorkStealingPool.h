@@ -0,0 +1,98 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_WORKSTEALINGPOOL_H
+#define TTT_WORKSTEALINGPOOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PacketHandle.h"
+
+/*
+ * WorkStealingPool runs decode work off the USB event thread. Work is
+ * grouped in streams, one per (device, channel group). Chunks of a stream
+ * are decoded in parallel on any worker, but their results are committed
+ * strictly in submit order: each chunk gets a sequence number and whoever
+ * finishes the oldest outstanding one commits it and everything ready
+ * behind it. The packet is released once its commit returns.
+ *
+ * Every worker has its own deque. A stream's chunks start on the worker it
+ * maps to, so a quiet system keeps streams on one core; a worker that runs
+ * dry steals from the far end of a busy one's deque.
+ */
+class WorkStealingPool {
+public:
+    /* Runs on any worker, possibly alongside other chunks of the stream */
+    typedef std::function<void(PacketHandle &packet)> Work;
+    /* Runs in submit order, never concurrently for one stream */
+    typedef std::function<void(PacketHandle &packet)> Commit;
+
+    explicit WorkStealingPool(unsigned threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator = (const WorkStealingPool&) = delete;
+
+    /* window bounds the chunks in flight for the stream. Returns the stream id */
+    int addStream(Work work, Commit commit, uint32_t window = 64);
+
+    /* False if the stream already has window chunks in flight */
+    bool submit(int stream, PacketHandle &&packet);
+    /* Block until everything submitted so far is committed */
+    void wait();
+
+    unsigned threads() const { return workers.size(); }
+    uint64_t stolen() const { return stolenCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Stream {
+        Work work;
+        Commit commit;
+        uint32_t window;
+        uint64_t nextSeq;                    /* submitter only */
+        std::atomic<uint32_t> inFlight;
+        std::mutex mtx;
+        uint64_t nextCommit;
+        bool committing;
+        std::vector<PacketHandle> done;      /* indexed by seq % window */
+        std::vector<bool> ready;
+    };
+
+    struct Task {
+        Stream *stream;
+        uint64_t seq;
+        PacketHandle packet;
+    };
+
+    struct Worker {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void run(unsigned index);
+    bool take(unsigned index, Task &task);
+    void complete(Stream &s, uint64_t seq, PacketHandle &&packet);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::unique_ptr<Stream>> streams;
+
+    std::atomic<int64_t> pending;            /* queued, not yet taken */
+    std::atomic<int64_t> outstanding;        /* submitted, not yet committed */
+    std::atomic<int> idle;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> stolenCount;
+    std::mutex sleepMtx;
+    std::condition_variable wakeCv;
+    std::condition_variable doneCv;
+};
+
+#endif //TTT_WORKSTEALINGPOOL_H
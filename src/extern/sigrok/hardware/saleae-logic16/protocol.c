@@ -550,11 +550,13 @@ static int abort_acquisition_sync(const struct sr_dev_inst *sdi){
 
 int logic16_setup_acquisition(const struct sr_dev_inst *sdi, uint64_t samplerate){
 	uint8_t clock_select, sta_con_reg, mode_reg;
+	uint16_t channel_mask;
 	uint64_t div;
 	int ret;
 	struct dev_context *devc;
 
 	devc = sdi->ctx;
+	channel_mask = devc->channel_mask ? devc->channel_mask : 0x00ff;
 
 
 	if (BASE_CLOCK_0_FREQ % samplerate == 0 &&
@@ -589,12 +591,17 @@ int logic16_setup_acquisition(const struct sr_dev_inst *sdi, uint64_t samplerate
 	if ((ret = write_fpga_register(sdi, FPGA_REG(SAMPLE_RATE_DIVISOR), (uint8_t)(div - 1))) != SR_OK)
 		return ret;
 
-	if ((ret = write_fpga_register(sdi, FPGA_REG(CHANNEL_SELECT_LOW), (uint8_t)(0xff))) != SR_OK)
+	if ((ret = write_fpga_register(sdi, FPGA_REG(CHANNEL_SELECT_LOW), (uint8_t)(channel_mask & 0xff))) != SR_OK)
 		return ret;
 
-	if ((ret = write_fpga_register(sdi, FPGA_REG(CHANNEL_SELECT_HIGH), (uint8_t)(0x00))) != SR_OK)
+	if ((ret = write_fpga_register(sdi, FPGA_REG(CHANNEL_SELECT_HIGH), (uint8_t)(channel_mask >> 8))) != SR_OK)
 		return ret;
 
+	/* Transfers carry one word per selected channel per 16 samples */
+	devc->num_channels = __builtin_popcount(channel_mask);
+	devc->sample_count = 0;
+	devc->partial_len = 0;
+
 	if ((ret = write_fpga_register(sdi, FPGA_REG(STATUS_CONTROL), FPGA_STATUS_CONTROL(UNKNOWN2) | FPGA_STATUS_CONTROL(UPDATE))) != SR_OK)
 		return ret;
 
@@ -675,27 +682,58 @@ SR_PRIV int logic16_init_device(const struct sr_dev_inst *sdi){
 
 extern volatile int throughput;
 
+/* Hand whole 16 sample blocks on, so every sample number is seen once */
+static void send_blocks(const struct sr_dev_inst *sdi, struct dev_context *devc, uint8_t *data, size_t size){
+	sr_wrap_packet_t packet;
 
+	packet.data = data;
+	packet.size = size;
+	packet.id = sdi->id;
+	packet.ref = NULL;
+	packet.sample = devc->sample_count;
+	/* Each enabled channel sends one 16 bit word per 16 samples */
+	devc->sample_count += size / (2 * devc->num_channels) * 16;
+	sdi->cb(&packet);
+}
 
 SR_PRIV void LIBUSB_CALL logic16_receive_transfer(struct libusb_transfer *transfer){
 	int ret;
-	sr_wrap_packet_t packet;
 	const struct sr_dev_inst *sdi = transfer->user_data;
+	struct dev_context *devc = sdi->ctx;
+	unsigned int block_bytes, head;
+	uint8_t *data;
+	size_t length, whole;
 
 
     if(transfer->status == LIBUSB_TRANSFER_TIMED_OUT){
         sr_err("Timed out");
     }
 
-    packet.data = (void *)transfer->buffer;
-    packet.size = transfer->length;
-    packet.id = sdi->id;
-
-	for(int i= 0; i < transfer->length; i++){
-		if(transfer->buffer[i] != 0){
-			sdi->cb(&packet);
+	/*
+	 * With a channel count other than 8 or 16 a block can straddle two
+	 * transfers: complete the one left over from the last transfer first
+	 * and keep the start of the one this transfer ends in.
+	 */
+	block_bytes = 2 * devc->num_channels;
+	data = transfer->buffer;
+	length = transfer->actual_length > 0 ? transfer->actual_length : 0;
+	if(devc->partial_len > 0 && length > 0){
+		head = MIN(block_bytes - devc->partial_len, length);
+		memcpy(devc->partial + devc->partial_len, data, head);
+		devc->partial_len += head;
+		data += head;
+		length -= head;
+		if(devc->partial_len == block_bytes){
+			send_blocks(sdi, devc, devc->partial, block_bytes);
+			devc->partial_len = 0;
 		}
 	}
+	whole = length - length % block_bytes;
+	if(whole > 0){
+		send_blocks(sdi, devc, data, whole);
+	}
+	memcpy(devc->partial + devc->partial_len, data + whole, length - whole);
+	devc->partial_len += length - whole;
 
 	/* Get new transfer buffer */
 
@@ -58,6 +58,16 @@ struct dev_context {
 	unsigned int num_transfers;
 	struct sr_context *ctx;
 
+	/** Channels to acquire, bit n for channel n; 0 means channels 0-7. */
+	uint16_t channel_mask;
+	/** Number of enabled channels. */
+	unsigned int num_channels;
+	/** Samples received since acquisition start. */
+	uint64_t sample_count;
+	/** Start of a block cut off at the end of the last transfer. */
+	uint8_t partial[2 * 16];
+	unsigned int partial_len;
+
 	const uint8_t *fpga_register_map;
 	const uint8_t *fpga_status_control_bit_map;
 	const uint8_t *fpga_mode_bit_map;
@@ -0,0 +1,153 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "raw_sampler.h"
+#include <string.h>
+#include <assert.h>
+#include <tmmintrin.h>
+
+/* Keep the even bits of every 16 bit lane, packed into the low half */
+static inline uint16_t compress2(uint16_t x) {
+    x &= 0x5555;
+    x = (x | x >> 1) & 0x3333;
+    x = (x | x >> 2) & 0x0f0f;
+    x = (x | x >> 4) & 0x00ff;
+    return x;
+}
+
+static inline __m128i compress2_epi16(__m128i x) {
+    x = _mm_and_si128(x, _mm_set1_epi16(0x5555));
+    x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi16(x, 1)), _mm_set1_epi16(0x3333));
+    x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi16(x, 2)), _mm_set1_epi16(0x0f0f));
+    x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi16(x, 4)), _mm_set1_epi16(0x00ff));
+    return x;
+}
+
+RawSampler::RawSampler(unsigned numChannels, uint16_t channelMask, unsigned decimation)
+    : numChannels(numChannels)
+    , numSelected(0)
+    , factor(decimation)
+    , shift(-1) {
+    assert(numChannels > 0 && numChannels <= 16 && decimation > 0);
+
+    memset(shuffle, 0x80, sizeof(shuffle));
+    for (unsigned ch = 0; ch < numChannels; ch++) {
+        if (channelMask & (1 << ch)) {
+            shuffle[2 * numSelected] = (uint8_t) (2 * ch);
+            shuffle[2 * numSelected + 1] = (uint8_t) (2 * ch + 1);
+            selected[numSelected++] = (uint8_t) ch;
+        }
+    }
+    assert(numSelected > 0);
+    for (int s = 0; s <= 4; s++) {
+        if (decimation == 1u << s) {
+            shift = s;
+        }
+    }
+    reset();
+}
+
+void RawSampler::reset() {
+    memset(acc, 0, sizeof(acc));
+    fill = 0;
+    next = 0;
+}
+
+size_t RawSampler::outputBound(size_t length) const {
+    return (length / inputBlock() / factor + 1) * outputBlock() + 16;
+}
+
+size_t RawSampler::sample(const uint8_t *raw, size_t length, uint8_t *dst) {
+    assert(length % inputBlock() == 0);
+    if (shift < 0) {
+        return sampleGeneric(raw, length, dst);
+    }
+    if (numChannels == 8) {
+        return sampleSse(raw, length, dst);
+    }
+    return sampleWords(raw, length, dst);
+}
+
+size_t RawSampler::sampleSse(const uint8_t *raw, size_t length, uint8_t *dst) {
+    const __m128i select = _mm_loadu_si128((const __m128i *) shuffle);
+    const size_t out = outputBlock();
+    uint8_t *start = dst;
+
+    if (shift == 0) {
+        /* The stores overlap by the unselected words, hence the slack */
+        for (size_t i = 0; i < length; i += 16) {
+            __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (raw + i)), select);
+            _mm_storeu_si128((__m128i *) dst, x);
+            dst += out;
+        }
+        return dst - start;
+    }
+
+    const unsigned kept = 16 >> shift;
+    __m128i bits = _mm_loadu_si128((const __m128i *) acc);
+    for (size_t i = 0; i < length; i += 16) {
+        __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (raw + i)), select);
+        for (int s = 0; s < shift; s++) {
+            x = compress2_epi16(x);
+        }
+        bits = _mm_or_si128(bits, _mm_sll_epi16(x, _mm_cvtsi32_si128(fill)));
+        fill += kept;
+        if (fill == 16) {
+            _mm_storeu_si128((__m128i *) dst, bits);
+            dst += out;
+            bits = _mm_setzero_si128();
+            fill = 0;
+        }
+    }
+    _mm_storeu_si128((__m128i *) acc, bits);
+    return dst - start;
+}
+
+size_t RawSampler::sampleWords(const uint8_t *raw, size_t length, uint8_t *dst) {
+    const size_t in = inputBlock(), out = outputBlock();
+    const unsigned kept = 16 >> shift;
+    uint8_t *start = dst;
+
+    for (size_t i = 0; i < length; i += in) {
+        for (unsigned c = 0; c < numSelected; c++) {
+            uint16_t x;
+            memcpy(&x, raw + i + 2 * selected[c], 2);
+            for (int s = 0; s < shift; s++) {
+                x = compress2(x);
+            }
+            acc[c] |= x << fill;
+        }
+        fill += kept;
+        if (fill == 16) {
+            memcpy(dst, acc, out);
+            memset(acc, 0, out);
+            dst += out;
+            fill = 0;
+        }
+    }
+    return dst - start;
+}
+
+size_t RawSampler::sampleGeneric(const uint8_t *raw, size_t length, uint8_t *dst) {
+    const size_t in = inputBlock(), out = outputBlock();
+    uint8_t *start = dst;
+
+    for (size_t i = 0; i < length; i += in) {
+        for (; next < 16; next += factor) {
+            for (unsigned c = 0; c < numSelected; c++) {
+                uint16_t x;
+                memcpy(&x, raw + i + 2 * selected[c], 2);
+                acc[c] |= ((x >> next) & 1) << fill;
+            }
+            if (++fill == 16) {
+                memcpy(dst, acc, out);
+                memset(acc, 0, out);
+                dst += out;
+                fill = 0;
+            }
+        }
+        next -= 16;
+    }
+    return dst - start;
+}
@@ -0,0 +1,62 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_RAW_SAMPLER_H
+#define TTT_RAW_SAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Channel selection and decimation on Logic16 transfer data. The output
+ * keeps the transfer layout, one little endian word per selected channel
+ * per 16 kept samples, so it is again valid transfer data for a device
+ * with fewer channels and a lower samplerate. Every decimation-th sample
+ * is kept, counting from the first one after reset().
+ *
+ * The live 8 channel layout is one SSE register per block: a shuffle
+ * selects, shifts and masks decimate, and the result is stored as is.
+ */
+class RawSampler {
+public:
+    RawSampler(unsigned numChannels, uint16_t channelMask = 0xffff, unsigned decimation = 1);
+
+    /* Drop kept samples that did not fill a block yet */
+    void reset();
+
+    unsigned inputChannels() const { return numChannels; }
+    unsigned outputChannels() const { return numSelected; }
+    unsigned decimation() const { return factor; }
+    size_t inputBlock() const { return 2 * numChannels; }
+    size_t outputBlock() const { return 2 * numSelected; }
+
+    /* Bytes sample() may write for length input bytes, including store slack */
+    size_t outputBound(size_t length) const;
+
+    /*
+     * Convert length bytes (whole blocks) of transfer data into dst,
+     * returns the bytes written. Only whole output blocks are written.
+     */
+    size_t sample(const uint8_t *raw, size_t length, uint8_t *dst);
+
+private:
+    size_t sampleSse(const uint8_t *raw, size_t length, uint8_t *dst);
+    size_t sampleWords(const uint8_t *raw, size_t length, uint8_t *dst);
+    size_t sampleGeneric(const uint8_t *raw, size_t length, uint8_t *dst);
+
+    unsigned numChannels;
+    unsigned numSelected;
+    unsigned factor;
+    /* log2 of the factor for the power of two paths, -1 otherwise */
+    int shift;
+    uint8_t selected[16];
+    uint8_t shuffle[16];
+    /* Kept bits not yet forming a block, and how many */
+    uint16_t acc[16];
+    unsigned fill;
+    /* Offset of the next kept sample into the next block */
+    unsigned next;
+};
+
+#endif //TTT_RAW_SAMPLER_H
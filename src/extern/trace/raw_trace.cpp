@@ -0,0 +1,184 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "raw_trace.h"
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static bool write_all(int fd, const uint8_t *data, size_t length) {
+    while (length) {
+        ssize_t n = ::write(fd, data, length);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+RawTrace::RawTrace(unsigned numChannels, uint16_t channelMask, unsigned decimation,
+                   uint64_t samplerate, size_t bufferSize)
+    : sampler(numChannels, channelMask, decimation)
+    , samplerate(samplerate)
+    , active(0)
+    , record(-1)
+    , nextIn(0)
+    , nextOut(0)
+    , totalBytes(0)
+    , stallCount(0)
+    , fd(-1)
+    , inFlight(-1)
+    , stopping(false)
+    , failed(false) {
+    /* Room for a record header and at least one decimated block */
+    assert(bufferSize >= sizeof(capture_record_header_t) + sampler.outputBound(sampler.inputBlock() * decimation));
+    for (auto &b : buffers) {
+        b.data.resize(bufferSize);
+        b.fill = 0;
+    }
+}
+
+RawTrace::~RawTrace() {
+    close();
+}
+
+bool RawTrace::open(const char *path) {
+    close();
+    fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    capture_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC));
+    header.version = CAPTURE_FILE_VERSION;
+    header.numChannels = sampler.outputChannels();
+    header.samplerate = samplerate / sampler.decimation();
+    if (!write_all(fd, (const uint8_t *) &header, sizeof(header))) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    sampler.reset();
+    record = -1;
+    nextIn = 0;
+    nextOut = 0;
+    stopping = false;
+    failed = false;
+    writer = thread(&RawTrace::run, this);
+    return true;
+}
+
+bool RawTrace::close() {
+    if (fd < 0) {
+        return true;
+    }
+    submit();
+    {
+        unique_lock<mutex> l(lock);
+        done.wait(l, [&] { return inFlight < 0; });
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    bool ok = !failed;
+    ok = ::close(fd) == 0 && ok;
+    fd = -1;
+    return ok;
+}
+
+void RawTrace::submit() {
+    Buffer &b = buffers[active];
+    record = -1;
+    if (b.fill == 0) {
+        return;
+    }
+    {
+        unique_lock<mutex> l(lock);
+        if (inFlight >= 0) {
+            stallCount++;
+            done.wait(l, [&] { return inFlight < 0; });
+        }
+        inFlight = active;
+    }
+    wake.notify_one();
+    active ^= 1;
+}
+
+void RawTrace::run() {
+    unique_lock<mutex> l(lock);
+    for (;;) {
+        wake.wait(l, [&] { return inFlight >= 0 || stopping; });
+        if (inFlight < 0) {
+            return;
+        }
+        Buffer &b = buffers[inFlight];
+        l.unlock();
+        bool ok = write_all(fd, b.data.data(), b.fill);
+        l.lock();
+        failed = failed || !ok;
+        b.fill = 0;
+        inFlight = -1;
+        done.notify_all();
+    }
+}
+
+size_t RawTrace::process(const sr_wrap_packet_t *packet) {
+    const size_t in = sampler.inputBlock(), out = sampler.outputBlock();
+    const uint8_t *data = packet->data;
+    size_t length = packet->size - packet->size % in;
+    size_t produced = 0;
+
+    assert(fd >= 0);
+    if (packet->sample != nextIn || (record >= 0 && packet->id != recordHeader.id)) {
+        sampler.reset();
+        record = -1;
+        nextOut = packet->sample / sampler.decimation();
+    }
+    nextIn = packet->sample + length / in * 16;
+
+    while (length) {
+        Buffer &b = buffers[active];
+        size_t room = b.data.size() - b.fill - (record < 0 ? sizeof(recordHeader) : 0);
+        /* Whole input blocks whose output surely fits */
+        size_t blocks = room > sampler.outputBound(0) ? (room - sampler.outputBound(0)) / out * sampler.decimation() : 0;
+        size_t chunk = min(length, blocks * in);
+        if (chunk == 0) {
+            submit();
+            continue;
+        }
+
+        if (record < 0) {
+            record = b.fill;
+            recordHeader.size = 0;
+            recordHeader.id = packet->id;
+            recordHeader.sample = nextOut;
+            b.fill += sizeof(recordHeader);
+        }
+        size_t n = sampler.sample(data, chunk, &b.data[b.fill]);
+        b.fill += n;
+        recordHeader.size += n;
+        memcpy(&b.data[record], &recordHeader, sizeof(recordHeader));
+        if (recordHeader.size == 0) {
+            /* Nothing decimated out yet, no empty records */
+            b.fill -= sizeof(recordHeader);
+            record = -1;
+        }
+
+        nextOut += n / out * 16;
+        produced += n;
+        data += chunk;
+        length -= chunk;
+    }
+    totalBytes += produced;
+    return produced;
+}
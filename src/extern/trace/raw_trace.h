@@ -0,0 +1,85 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_RAW_TRACE_H
+#define TTT_RAW_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CaptureFile.h"
+#include "sigrok_wrapper.h"
+#include "raw_sampler.h"
+
+#define RAW_TRACE_BUFFER_SIZE (4 << 20)
+
+/*
+ * Baseline trace stage: Logic16 packets in, an indexed capture file out,
+ * optionally reduced to some channels and decimated on the way. The file
+ * describes the reduced stream, so ReplaySource plays it back like any
+ * other capture.
+ *
+ * Packet data is converted straight into one of two buffers; a full
+ * buffer goes to a writer thread while the other one fills. process()
+ * only waits when the disk falls a whole buffer behind. Contiguous
+ * packets share a record, a gap in the sample count starts a new one.
+ */
+class RawTrace {
+public:
+    RawTrace(unsigned numChannels, uint16_t channelMask = 0xffff, unsigned decimation = 1,
+             uint64_t samplerate = 16000000, size_t bufferSize = RAW_TRACE_BUFFER_SIZE);
+    ~RawTrace();
+
+    RawTrace(const RawTrace&) = delete;
+    RawTrace& operator = (const RawTrace&) = delete;
+
+    bool open(const char *path);
+    /* Write out what is buffered, false if any write failed */
+    bool close();
+
+    /* Convert one packet, returns the bytes of transfer data it produced */
+    size_t process(const sr_wrap_packet_t *packet);
+
+    /* Transfer data bytes produced so far */
+    uint64_t total() const { return totalBytes; }
+    /* Times process() had to wait for the writer */
+    uint64_t stalls() const { return stallCount; }
+
+private:
+    struct Buffer {
+        std::vector<uint8_t> data;
+        size_t fill;
+    };
+
+    /* Hand the active buffer to the writer and take the other one */
+    void submit();
+    void run();
+
+    RawSampler sampler;
+    uint64_t samplerate;
+    Buffer buffers[2];
+    int active;
+    /* Offset of the open record's header in the active buffer, -1 if none */
+    ssize_t record;
+    capture_record_header_t recordHeader;
+    uint64_t nextIn;
+    uint64_t nextOut;
+    uint64_t totalBytes;
+    uint64_t stallCount;
+    int fd;
+
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    /* Buffer being written, -1 if the writer is idle */
+    int inFlight;
+    bool stopping;
+    bool failed;
+};
+
+#endif //TTT_RAW_TRACE_H
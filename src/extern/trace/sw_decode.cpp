@@ -0,0 +1,372 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "sw_decode.h"
+#include "EdgeScan.h"
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+using namespace std;
+
+SwdDecoder::SwdDecoder(unsigned turnaround)
+    : trn(turnaround)
+    , clk(BITPLANE_MAX_CHANNELS)
+    , dio(BITPLANE_MAX_CHANNELS) {
+    assert(turnaround >= 1 && turnaround <= 4);
+    reset();
+}
+
+SwdDecoder::SwdDecoder(unsigned clkChannel, unsigned dioChannel, unsigned turnaround)
+    : trn(turnaround)
+    , clk(clkChannel)
+    , dio(dioChannel) {
+    assert(turnaround >= 1 && turnaround <= 4);
+    reset();
+}
+
+void SwdDecoder::reset() {
+    state = initialState();
+}
+
+SwdDecoder::State SwdDecoder::initialState() const {
+    State s;
+    memset(&s, 0, sizeof(s));
+    s.phase = HUNT;
+    return s;
+}
+
+/* Equal if they decode the rest of a capture alike: stale fields are skipped */
+bool SwdDecoder::State::operator == (const State &o) const {
+    if (clkLevel != o.clkLevel || pending != o.pending || phase != o.phase || count != o.count ||
+        window != o.window || ones != o.ones || std::min(seen, 9u) != std::min(o.seen, 9u)) {
+        return false;
+    }
+    if (pending && (cycle.sample != o.cycle.sample || cycle.host != o.cycle.host)) {
+        return false;
+    }
+    if (ones && onesStart != o.onesStart) {
+        return false;
+    }
+    /* Only the samples of the last 8 hunted cycles can become a request's */
+    for (unsigned k = 0; k < std::min(seen, 8u); k++) {
+        if (starts[(seen - 1 - k) & 7] != o.starts[(o.seen - 1 - k) & 7]) {
+            return false;
+        }
+    }
+    if (phase == HUNT) {
+        return true;
+    }
+    return event.sample == o.event.sample && event.request == o.event.request && event.ack == o.event.ack &&
+           (phase != DATA || data == o.data);
+}
+
+void SwdDecoder::hunt(State &s, const SwCycle &c, vector<SwEvent> &out) const {
+    uint32_t bit = c.host;
+
+    if (bit) {
+        if (s.ones++ == 0) {
+            s.onesStart = c.sample;
+        }
+    } else {
+        if (s.ones >= SWD_LINE_RESET_CYCLES) {
+            SwEvent e = SwEvent();
+            e.sample = s.onesStart;
+            e.type = SW_EVENT_LINE_RESET;
+            e.data = s.ones;
+            out.push_back(e);
+        }
+        s.ones = 0;
+    }
+
+    /* Bits 1..8 are the candidate request, bit 0 the cycle before it */
+    s.window = (s.window >> 1) | (bit << 8);
+    s.starts[s.seen++ & 7] = c.sample;
+    uint32_t request = s.window >> 1;
+
+    /* Start 1, stop 0, park 1, even parity over APnDP, RnW and A[2:3] */
+    if (s.seen < 8 || (request & 0xc1) != 0x81 ||
+        (__builtin_popcount(request & 0x1e) & 1) != ((request >> 5) & 1)) {
+        return;
+    }
+    /* Unless it follows a packet directly, a request starts after an idle cycle */
+    if (s.seen > 8 && (s.window & 1)) {
+        return;
+    }
+
+    s.event = SwEvent();
+    s.event.sample = s.starts[s.seen & 7];
+    s.event.request = (uint8_t) request;
+    s.phase = TURN_ACK;
+    s.count = 0;
+    s.window = 0;
+    s.seen = 0;
+    s.ones = 0;
+}
+
+void SwdDecoder::step(State &s, const SwCycle &c, vector<SwEvent> &out) const {
+    bool read = sw_request_read(s.event.request);
+
+    switch (s.phase) {
+        case HUNT:
+            hunt(s, c, out);
+            break;
+        case TURN_ACK:
+            if (++s.count == trn) {
+                s.phase = ACK;
+                s.count = 0;
+            }
+            break;
+        case ACK:
+            s.event.ack |= c.target << s.count;
+            if (++s.count < 3) {
+                break;
+            }
+            s.count = 0;
+            s.data = 0;
+            if (s.event.ack == SWD_ACK_OK) {
+                s.phase = read ? DATA : TURN_WRITE;
+                break;
+            }
+            s.event.type = s.event.ack == SWD_ACK_WAIT ? SW_EVENT_WAIT :
+                           s.event.ack == SWD_ACK_FAULT ? SW_EVENT_FAULT : SW_EVENT_NO_ACK;
+            out.push_back(s.event);
+            /* Nobody drives the line without an ACK, go straight back to hunting */
+            s.phase = s.event.type == SW_EVENT_NO_ACK ? HUNT : TURN_END;
+            break;
+        case TURN_WRITE:
+            if (++s.count == trn) {
+                s.phase = DATA;
+                s.count = 0;
+            }
+            break;
+        case DATA:
+            s.data |= (uint64_t) (read ? c.target : c.host) << s.count;
+            if (++s.count < 33) {
+                break;
+            }
+            s.event.type = SW_EVENT_OK;
+            s.event.data = (uint32_t) s.data;
+            if ((unsigned) (__builtin_popcount(s.event.data) & 1) != (unsigned) (s.data >> 32)) {
+                s.event.flags |= SW_FLAG_PARITY;
+            }
+            out.push_back(s.event);
+            s.count = 0;
+            s.phase = read ? TURN_END : HUNT;
+            break;
+        case TURN_END:
+            if (++s.count == trn) {
+                s.phase = HUNT;
+                s.count = 0;
+            }
+            break;
+    }
+}
+
+size_t SwdDecoder::decode(const SwCycle *cycles, size_t n, vector<SwEvent> &out) {
+    size_t before = out.size();
+
+    for (size_t i = 0; i < n; i++) {
+        step(state, cycles[i], out);
+    }
+    return out.size() - before;
+}
+
+/*
+ * Rising edge of the cycle after a low one that ended a line reset or an
+ * idle run. The state there is hunting with the last 9 host bits in the
+ * window; a request cannot have started in either run.
+ */
+size_t SwdDecoder::resync(const Bitplanes &bp, size_t from, size_t to, State &s) const {
+    assert(clk < bp.channels() && dio < bp.channels());
+    s = initialState();
+
+    const uint64_t *clock = bp.plane(clk);
+    uint32_t window = 0;
+    uint64_t starts[8];
+    unsigned cycles = 0, ones = 0, zeros = 0;
+    bool found = false;
+    for (size_t i = edge_find(clock, to, from, false, EDGE_RISING); i < to;
+         i = edge_find(clock, to, i + 1, false, EDGE_RISING)) {
+        if (found) {
+            s.window = window;
+            /* seen is only compared up to 9, 16 keeps starts in order */
+            s.seen = 16;
+            for (unsigned k = 0; k < 8; k++) {
+                s.starts[k] = starts[(cycles + k) & 7];
+            }
+            return i;
+        }
+        uint32_t bit = bp.bit(dio, i);
+        window = (window >> 1) | (bit << 8);
+        starts[cycles++ & 7] = bp.firstSample + i;
+        if (bit) {
+            ones++;
+            zeros = 0;
+        } else {
+            found = ones >= SWD_LINE_RESET_CYCLES || ++zeros >= SWD_IDLE_RESYNC_CYCLES;
+            ones = 0;
+        }
+    }
+    return to;
+}
+
+SwdDecoder::State SwdDecoder::decode(const Bitplanes &bp, size_t from, size_t to, State s,
+                                     vector<SwEvent> &out) const {
+    assert(clk < bp.channels() && dio < bp.channels());
+    if (from >= to) {
+        return s;
+    }
+
+    /* The sampler, from the word from is in */
+    const uint64_t *data = bp.plane(dio);
+    const size_t skip = from & ~(size_t) 63;
+    edge_scan(bp.plane(clk) + skip / 64, to - skip, s.clkLevel, EDGE_BOTH, [&](size_t i, bool rising) {
+        i += skip;
+        if (i < from) {
+            return;
+        }
+        uint8_t bit = (data[i >> 6] >> (i & 63)) & 1;
+        if (rising) {
+            s.cycle.sample = bp.firstSample + i;
+            s.cycle.host = bit;
+            s.pending = true;
+        } else if (s.pending) {
+            s.cycle.target = bit;
+            step(s, s.cycle, out);
+            s.pending = false;
+        }
+    });
+    return s;
+}
+
+#define ITM_OVERFLOW 0x70
+#define ITM_GTS1     0x94
+#define ITM_GTS2     0xb4
+/* Continuation payloads carry 7 bits per byte, GTS2 takes up to 7 */
+#define ITM_MAX_CONTINUED 7
+
+ItmDecoder::ItmDecoder() {
+    reset();
+}
+
+void ItmDecoder::reset() {
+    phase = HEADER;
+    header = 0;
+    count = 0;
+    expect = 0;
+    zeros = 0;
+    event = SwoEvent();
+    localTime = 0;
+    memset(software, 0, sizeof(software));
+    memset(hardware, 0, sizeof(hardware));
+    overflowCount = 0;
+    syncCount = 0;
+    errorCount = 0;
+}
+
+const ItmPortStats &ItmDecoder::stats(unsigned port, bool hw) const {
+    assert(port < ITM_PORTS);
+    return hw ? hardware[port] : software[port];
+}
+
+void ItmDecoder::emit(vector<SwoEvent> &out) {
+    if (event.type == SWO_EVENT_TIMESTAMP) {
+        localTime += event.data;
+    }
+    event.timestamp = localTime;
+    if (event.type == SWO_EVENT_ITM || event.type == SWO_EVENT_DWT) {
+        ItmPortStats &s = event.type == SWO_EVENT_ITM ? software[event.port] : hardware[event.port];
+        if (s.packets++ == 0) {
+            s.firstSample = event.sample;
+        }
+        s.bytes += event.size;
+        s.lastSample = event.sample;
+    }
+    /* Extension packets only end the payload */
+    if (event.type) {
+        out.push_back(event);
+    }
+    phase = HEADER;
+}
+
+size_t ItmDecoder::decode(const SwoByte *bytes, size_t n, vector<SwoEvent> &out) {
+    size_t before = out.size();
+
+    for (size_t i = 0; i < n; i++) {
+        uint8_t b = bytes[i].data;
+
+        switch (phase) {
+            case HEADER:
+                if (b == 0) {
+                    zeros++;
+                    break;
+                }
+                if (b == 0x80 && zeros >= 5) {
+                    syncCount++;
+                    zeros = 0;
+                    break;
+                }
+                zeros = 0;
+                event = SwoEvent();
+                event.sample = bytes[i].sample;
+                header = b;
+                count = 0;
+
+                if (b & 3) {
+                    /* Source packet: 1, 2 or 4 payload bytes */
+                    event.type = (b & 4) ? SWO_EVENT_DWT : SWO_EVENT_ITM;
+                    event.port = b >> 3;
+                    expect = (b & 3) == 3 ? 4 : (b & 3);
+                    event.size = (uint8_t) expect;
+                    phase = PAYLOAD;
+                } else if (b == ITM_OVERFLOW) {
+                    overflowCount++;
+                    event.type = SWO_EVENT_OVERFLOW;
+                    emit(out);
+                } else if ((b & 0x8f) == 0 && b) {
+                    /* Short local timestamp, the delta is in the header */
+                    event.type = SWO_EVENT_TIMESTAMP;
+                    event.data = b >> 4;
+                    emit(out);
+                } else if ((b & 0xcf) == 0xc0) {
+                    event.type = SWO_EVENT_TIMESTAMP;
+                    event.port = (b >> 4) & 3;
+                    phase = CONTINUED;
+                } else if (b == ITM_GTS1 || b == ITM_GTS2) {
+                    event.type = SWO_EVENT_GLOBAL_TIME;
+                    event.port = b == ITM_GTS1 ? 1 : 2;
+                    phase = CONTINUED;
+                } else if ((b & 0x0b) == 0x08) {
+                    /* Extension, continued while bit 7 is set */
+                    if (b & 0x80) {
+                        phase = CONTINUED;
+                    }
+                } else {
+                    errorCount++;
+                }
+                break;
+            case PAYLOAD:
+                event.data |= (uint32_t) b << (8 * count);
+                if (++count == expect) {
+                    emit(out);
+                }
+                break;
+            case CONTINUED:
+                if (count < 5) {
+                    event.data |= (uint32_t) (b & 0x7f) << (7 * count);
+                }
+                count++;
+                event.size = (uint8_t) count;
+                if (!(b & 0x80)) {
+                    emit(out);
+                } else if (count == ITM_MAX_CONTINUED) {
+                    errorCount++;
+                    phase = HEADER;
+                }
+                break;
+        }
+    }
+    return out.size() - before;
+}
@@ -0,0 +1,202 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_SW_DECODE_H
+#define TTT_SW_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "sw_sampler.h"
+
+enum SwEventType {
+    SW_EVENT_LINE_RESET = 1,
+    SW_EVENT_OK,
+    SW_EVENT_WAIT,
+    SW_EVENT_FAULT,
+    SW_EVENT_NO_ACK
+};
+
+#define SW_FLAG_PARITY 0x01
+
+/*
+ * Record of the sw_* event stream, 16 bytes. For SWD transfers request is
+ * the raw request byte, ack the raw ACK and data the transferred word.
+ * A line reset carries its length in cycles in data.
+ */
+struct SwEvent {
+    uint64_t sample;
+    uint32_t data;
+    uint8_t type;
+    uint8_t request;
+    uint8_t ack;
+    uint8_t flags;
+};
+
+inline bool sw_request_ap(uint8_t request) { return (request >> 1) & 1; }
+inline bool sw_request_read(uint8_t request) { return (request >> 2) & 1; }
+inline unsigned sw_request_addr(uint8_t request) { return (request >> 1) & 0x0c; }
+
+#define SWD_ACK_OK    1
+#define SWD_ACK_WAIT  2
+#define SWD_ACK_FAULT 4
+
+#define SWD_LINE_RESET_CYCLES 50
+/*
+ * Low host cycles after which the decoder is hunting for sure: longer than
+ * the rest of any packet after its park bit (44 cycles with a turnaround
+ * of 4) plus the 9 bit request window.
+ */
+#define SWD_IDLE_RESYNC_CYCLES 64
+
+/*
+ * SWD packet decoder over sampler cycles: request, turnaround, ACK, then
+ * data and parity in whichever direction the request asked for. Between
+ * packets it hunts for a valid request (start, stop and park bits plus
+ * parity, after an idle cycle or right behind the last packet) one cycle
+ * at a time, and reports runs of 50 or more high cycles as line resets.
+ */
+class SwdDecoder {
+public:
+    explicit SwdDecoder(unsigned turnaround = 1);
+    /* Also decodes SWCLK/SWDIO bit planes, for parallel_decode() */
+    SwdDecoder(unsigned clkChannel, unsigned dioChannel, unsigned turnaround);
+
+    void reset();
+
+    /* Append the events completed by these cycles, returns how many */
+    size_t decode(const SwCycle *cycles, size_t count, std::vector<SwEvent> &out);
+
+    enum Phase {
+        HUNT,
+        TURN_ACK,
+        ACK,
+        TURN_WRITE,
+        DATA,
+        TURN_END
+    };
+
+    /*
+     * Decoder side of parallel_decode() (ParallelDecode.h), for a stored
+     * capture in one Bitplanes; needs the channel constructor. Chunks
+     * resync on the cycle after a line reset or after an idle run of
+     * SWD_IDLE_RESYNC_CYCLES. No packet holds either, so the decoder is
+     * hunting there and its window is in the data. The guess only misses
+     * when a line reset starts inside a packet.
+     */
+    typedef SwEvent Event;
+    struct State {
+        /* Sampler: a cycle is pending between its rising and falling edge */
+        bool clkLevel;
+        bool pending;
+        SwCycle cycle;
+        Phase phase;
+        unsigned count;
+        /* Hunting: last 9 host bits and the samples of the last 8 */
+        uint32_t window;
+        unsigned seen;
+        uint64_t starts[8];
+        uint64_t onesStart;
+        uint32_t ones;
+        /* Packet in flight */
+        SwEvent event;
+        uint64_t data;
+
+        bool operator == (const State &o) const;
+    };
+
+    State initialState() const;
+    size_t resync(const Bitplanes &bp, size_t from, size_t to, State &state) const;
+    State decode(const Bitplanes &bp, size_t from, size_t to, State state, std::vector<SwEvent> &out) const;
+
+private:
+    void hunt(State &s, const SwCycle &c, std::vector<SwEvent> &out) const;
+    void step(State &s, const SwCycle &c, std::vector<SwEvent> &out) const;
+
+    unsigned trn;
+    unsigned clk;
+    unsigned dio;
+    State state;
+};
+
+enum SwoEventType {
+    /** Software write to a stimulus port */
+    SWO_EVENT_ITM = 1,
+    /** DWT hardware source packet, port is the discriminator */
+    SWO_EVENT_DWT,
+    /** Local timestamp: data is the delta, port the TC field */
+    SWO_EVENT_TIMESTAMP,
+    /** Global timestamp: port 1 has the low bits, 2 the high ones */
+    SWO_EVENT_GLOBAL_TIME,
+    SWO_EVENT_OVERFLOW
+};
+
+/*
+ * Record of the SWO event stream, 24 bytes. timestamp is the target's
+ * local time, the sum of all local timestamp deltas up to the packet.
+ */
+struct SwoEvent {
+    uint64_t sample;
+    uint64_t timestamp;
+    uint32_t data;
+    uint8_t type;
+    uint8_t port;
+    uint8_t size;
+    uint8_t flags;
+};
+
+#define ITM_PORTS 32
+
+struct ItmPortStats {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t firstSample;
+    uint64_t lastSample;
+};
+
+/*
+ * ITM/DWT packet parser over SWO bytes. Source packets become events per
+ * stimulus port or DWT discriminator and are counted per port; timestamp
+ * packets advance the local time that later events carry. A sync packet
+ * (47 zero bits and a one) is consumed, extension packets are skipped.
+ */
+class ItmDecoder {
+public:
+    ItmDecoder();
+
+    void reset();
+
+    /* Append the events completed by these bytes, returns how many */
+    size_t decode(const SwoByte *bytes, size_t count, std::vector<SwoEvent> &out);
+
+    const ItmPortStats &stats(unsigned port, bool hardware = false) const;
+    uint64_t overflows() const { return overflowCount; }
+    uint64_t syncs() const { return syncCount; }
+    /* Reserved headers and overlong continuations */
+    uint64_t errors() const { return errorCount; }
+
+private:
+    enum Phase {
+        HEADER,
+        PAYLOAD,
+        CONTINUED
+    };
+
+    void emit(std::vector<SwoEvent> &out);
+
+    Phase phase;
+    uint8_t header;
+    unsigned count;
+    unsigned expect;
+    unsigned zeros;
+    SwoEvent event;
+    uint64_t localTime;
+    ItmPortStats software[ITM_PORTS];
+    ItmPortStats hardware[ITM_PORTS];
+    uint64_t overflowCount;
+    uint64_t syncCount;
+    uint64_t errorCount;
+};
+
+#endif //TTT_SW_DECODE_H
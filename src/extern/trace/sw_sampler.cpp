@@ -0,0 +1,162 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "sw_sampler.h"
+#include "EdgeScan.h"
+#include <assert.h>
+
+using namespace std;
+
+SwSampler::SwSampler(unsigned clkChannel, unsigned dioChannel)
+    : clk(clkChannel)
+    , dio(dioChannel) {
+    reset();
+}
+
+void SwSampler::reset() {
+    clkLevel = false;
+    pending = false;
+    cycle.sample = 0;
+    cycle.host = 0;
+    cycle.target = 0;
+}
+
+size_t SwSampler::sample(const Bitplanes &bp, vector<SwCycle> &out) {
+    const uint64_t *data = bp.plane(dio);
+    size_t before = out.size();
+
+    edge_scan(bp.plane(clk), bp.samples(), clkLevel, EDGE_BOTH, [&](size_t i, bool rising) {
+        uint8_t bit = (data[i >> 6] >> (i & 63)) & 1;
+        if (rising) {
+            cycle.sample = bp.firstSample + i;
+            cycle.host = bit;
+            pending = true;
+        } else if (pending) {
+            cycle.target = bit;
+            out.push_back(cycle);
+            pending = false;
+        }
+    });
+    return out.size() - before;
+}
+
+SwoSampler::SwoSampler(unsigned channel, unsigned encoding, uint64_t samplerate, uint32_t bitrate)
+    : channel(channel)
+    , encoding(encoding)
+    , samplerate(samplerate)
+    , bitrate(bitrate)
+    , uart(channel + 1, samplerate) {
+    assert(encoding == SWO_MANCHESTER || encoding == SWO_NRZ);
+    if (encoding == SWO_NRZ) {
+        UartConfig cfg;
+        cfg.baud = bitrate;
+        cfg.dataBits = 8;
+        cfg.parity = UART_PARITY_NONE;
+        cfg.stopBits = 1;
+        uart.addChannel(channel, cfg);
+    }
+    reset();
+}
+
+void SwoSampler::reset() {
+    level = encoding == SWO_NRZ;
+    inPacket = false;
+    started = false;
+    last = 0;
+    period = bitrate ? samplerate * 256 / bitrate : 0;
+    bits = 0;
+    shift = 0;
+    first = false;
+    byteSample = 0;
+    uart.reset();
+}
+
+double SwoSampler::bitPeriod() const {
+    if (encoding == SWO_NRZ) {
+        uint32_t baud = uart.baud(channel);
+        return baud ? (double) samplerate / baud : 0;
+    }
+    return period / 256.0;
+}
+
+void SwoSampler::edge(uint64_t t, bool rising, vector<SwoByte> &out) {
+    if (!inPacket) {
+        if (rising) {
+            inPacket = true;
+            started = false;
+            last = t;
+        }
+        return;
+    }
+    if (!started) {
+        if (rising) {
+            last = t;
+            return;
+        }
+        /* Middle of the start bit */
+        uint64_t half = (t - last) * 256;
+        if (!bitrate) {
+            period = 2 * half;
+        } else if (half < period / 4 || half > period * 3 / 4) {
+            inPacket = false;
+            return;
+        }
+        started = true;
+        last = t;
+        bits = 0;
+        shift = 0;
+        first = true;
+        return;
+    }
+
+    uint64_t d = (t - last) * 256;
+    if (d < period * 3 / 4) {
+        /* Between two equal bits */
+        return;
+    }
+    if (d > period * 3 / 2) {
+        /* The line went idle, a partial byte is dropped */
+        inPacket = false;
+        edge(t, rising, out);
+        return;
+    }
+    period = (period * 7 + d) / 8;
+    last = t;
+    if (bits == 0) {
+        byteSample = t;
+    }
+    shift |= (rising ? 0 : 1) << bits;
+    if (++bits == 8) {
+        SwoByte b;
+        b.sample = byteSample;
+        b.data = shift;
+        b.flags = first ? SWO_FLAG_PACKET : 0;
+        out.push_back(b);
+        first = false;
+        bits = 0;
+        shift = 0;
+    }
+}
+
+size_t SwoSampler::sample(const Bitplanes &bp, vector<SwoByte> &out) {
+    size_t before = out.size();
+
+    if (encoding == SWO_NRZ) {
+        frames.clear();
+        uart.decode(bp, frames);
+        for (auto &f : frames) {
+            SwoByte b;
+            b.sample = f.sample;
+            b.data = (uint8_t) f.data;
+            b.flags = (f.flags & (UART_FLAG_FRAMING | UART_FLAG_BREAK)) ? SWO_FLAG_FRAMING : 0;
+            out.push_back(b);
+        }
+        return out.size() - before;
+    }
+
+    edge_scan(bp.plane(channel), bp.samples(), level, EDGE_BOTH, [&](size_t i, bool rising) {
+        edge(bp.firstSample + i, rising, out);
+    });
+    return out.size() - before;
+}
@@ -0,0 +1,109 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_SW_SAMPLER_H
+#define TTT_SW_SAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+#include "UartDecoder.h"
+
+/*
+ * One SWCLK period. The host changes SWDIO on the falling edge and the
+ * target on the rising edge, so a host bit is read at the rising edge and
+ * a target bit at the falling edge that follows it.
+ */
+struct SwCycle {
+    /** Absolute sample of the rising edge */
+    uint64_t sample;
+    uint8_t host;
+    uint8_t target;
+};
+
+/*
+ * Turns SWCLK/SWDIO bit planes into clock cycles. Clock edges are found
+ * with the SSE edge scan; SWDIO is only looked at on those edges. Blocks
+ * must follow each other, a cycle may straddle two of them.
+ */
+class SwSampler {
+public:
+    SwSampler(unsigned clkChannel, unsigned dioChannel);
+
+    void reset();
+
+    /* Append the cycles completed in bp to out, returns how many */
+    size_t sample(const Bitplanes &bp, std::vector<SwCycle> &out);
+
+private:
+    unsigned clk;
+    unsigned dio;
+    bool clkLevel;
+    bool pending;
+    SwCycle cycle;
+};
+
+#define SWO_MANCHESTER 0
+#define SWO_NRZ        1
+
+/* First byte of a Manchester packet */
+#define SWO_FLAG_PACKET  0x01
+/* NRZ stop bit missing */
+#define SWO_FLAG_FRAMING 0x02
+
+struct SwoByte {
+    /** First bit's mid transition (Manchester) or start bit edge (NRZ) */
+    uint64_t sample;
+    uint8_t data;
+    uint8_t flags;
+};
+
+/*
+ * Recovers the bytes sent on a SWO pin, LSB first. A Manchester packet
+ * starts with a 1 bit on an idle low line (a 1 is high then low) and ends
+ * when no mid-bit transition comes for a bit and a half. The start bit's
+ * half width sets the bit period and every mid-bit transition re-times the
+ * next one, so a target clock that drifts is followed. NRZ is 8N1
+ * asynchronous serial and goes through the UART decoder.
+ *
+ * Only edges are looked at, found with the SSE edge scan.
+ */
+class SwoSampler {
+public:
+    /* bitrate 0 measures Manchester from each start bit, NRZ from the shortest pulses */
+    SwoSampler(unsigned channel, unsigned encoding, uint64_t samplerate, uint32_t bitrate = 0);
+
+    void reset();
+
+    /* Append the bytes completed in bp to out, returns how many */
+    size_t sample(const Bitplanes &bp, std::vector<SwoByte> &out);
+
+    /* Samples per bit, 0 before the rate is known */
+    double bitPeriod() const;
+
+private:
+    void edge(uint64_t t, bool rising, std::vector<SwoByte> &out);
+
+    unsigned channel;
+    unsigned encoding;
+    uint64_t samplerate;
+    uint32_t bitrate;
+    bool level;
+    /* Manchester: rising edge of the start bit, then the last mid-bit transition */
+    bool inPacket;
+    bool started;
+    uint64_t last;
+    /* Samples per bit in 1/256 */
+    uint64_t period;
+    unsigned bits;
+    uint8_t shift;
+    bool first;
+    uint64_t byteSample;
+    /* NRZ */
+    UartDecoder uart;
+    std::vector<UartEvent> frames;
+};
+
+#endif //TTT_SW_SAMPLER_H
@@ -0,0 +1,146 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "sw_trace.h"
+#include <string.h>
+
+using namespace std;
+
+static FILE *open_trace(const char *path, const char *magic, size_t magicSize, uint32_t recordSize, uint64_t samplerate) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return NULL;
+    }
+
+    sw_trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, magicSize);
+    header.version = SW_TRACE_VERSION;
+    header.recordSize = recordSize;
+    header.samplerate = samplerate;
+    if (fwrite(&header, sizeof(header), 1, f) != 1) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+template<class T>
+static bool load_trace(const char *path, const char *magic, size_t magicSize, vector<T> &events) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    sw_trace_header_t header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, magic, magicSize) == 0 &&
+              header.recordSize == sizeof(T);
+    T e;
+    while (ok && fread(&e, sizeof(e), 1, f) == 1) {
+        events.push_back(e);
+    }
+    fclose(f);
+    return ok;
+}
+
+SwTrace::SwTrace(unsigned numChannels, unsigned clkChannel, unsigned dioChannel, uint64_t samplerate)
+    : numChannels(numChannels)
+    , samplerate(samplerate)
+    , planes(numChannels)
+    , sampler(clkChannel, dioChannel)
+    , totalEvents(0)
+    , file(NULL)
+    , failed(false) {
+}
+
+SwTrace::~SwTrace() {
+    close();
+}
+
+bool SwTrace::open(const char *path) {
+    close();
+    failed = false;
+    file = open_trace(path, SW_TRACE_MAGIC, sizeof(SW_TRACE_MAGIC), sizeof(SwEvent), samplerate);
+    return file != NULL;
+}
+
+bool SwTrace::close() {
+    if (!file) {
+        return true;
+    }
+    failed = fclose(file) != 0 || failed;
+    file = NULL;
+    return !failed;
+}
+
+size_t SwTrace::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+
+    cycles.clear();
+    eventList.clear();
+    sampler.sample(planes, cycles);
+    size_t n = decoder.decode(cycles.data(), cycles.size(), eventList);
+
+    if (file && n && !failed) {
+        failed = fwrite(eventList.data(), sizeof(SwEvent), n, file) != n;
+    }
+    totalEvents += n;
+    return n;
+}
+
+bool sw_trace_load(const char *path, vector<SwEvent> &events) {
+    return load_trace(path, SW_TRACE_MAGIC, sizeof(SW_TRACE_MAGIC), events);
+}
+
+SwoTrace::SwoTrace(unsigned numChannels, unsigned channel, unsigned encoding, uint64_t samplerate, uint32_t bitrate)
+    : numChannels(numChannels)
+    , samplerate(samplerate)
+    , planes(numChannels)
+    , sampler(channel, encoding, samplerate, bitrate)
+    , totalEvents(0)
+    , file(NULL)
+    , failed(false) {
+}
+
+SwoTrace::~SwoTrace() {
+    close();
+}
+
+bool SwoTrace::open(const char *path) {
+    close();
+    failed = false;
+    file = open_trace(path, SWO_TRACE_MAGIC, sizeof(SWO_TRACE_MAGIC), sizeof(SwoEvent), samplerate);
+    return file != NULL;
+}
+
+bool SwoTrace::close() {
+    if (!file) {
+        return true;
+    }
+    failed = fclose(file) != 0 || failed;
+    file = NULL;
+    return !failed;
+}
+
+size_t SwoTrace::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+
+    bytes.clear();
+    eventList.clear();
+    sampler.sample(planes, bytes);
+    size_t n = decoder.decode(bytes.data(), bytes.size(), eventList);
+
+    if (file && n && !failed) {
+        failed = fwrite(eventList.data(), sizeof(SwoEvent), n, file) != n;
+    }
+    totalEvents += n;
+    return n;
+}
+
+bool swo_trace_load(const char *path, vector<SwoEvent> &events) {
+    return load_trace(path, SWO_TRACE_MAGIC, sizeof(SWO_TRACE_MAGIC), events);
+}
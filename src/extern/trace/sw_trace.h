@@ -0,0 +1,114 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_SW_TRACE_H
+#define TTT_SW_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "Bitplane.h"
+#include "sigrok_wrapper.h"
+#include "sw_decode.h"
+#include "sw_sampler.h"
+
+#define SW_TRACE_MAGIC   "TTTSW1"
+#define SW_TRACE_VERSION 1
+#define SWO_TRACE_MAGIC  "TTTSWO1"
+
+/* Event files are this header followed by packed SwEvent records */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t samplerate;
+} sw_trace_header_t;
+
+/*
+ * SWD trace stage: Logic16 packets in, SwEvents out. Each packet is
+ * gathered into bit planes, sampled on SWCLK and decoded. Events of the
+ * last packet are kept for in-process consumers and, if a file is open,
+ * appended to it.
+ */
+class SwTrace {
+public:
+    SwTrace(unsigned numChannels, unsigned clkChannel, unsigned dioChannel, uint64_t samplerate = 16000000);
+    ~SwTrace();
+
+    SwTrace(const SwTrace&) = delete;
+    SwTrace& operator = (const SwTrace&) = delete;
+
+    bool open(const char *path);
+    /* False if any write to the file failed */
+    bool close();
+    /* A write failed since open(); records after it are not written */
+    bool writeFailed() const { return failed; }
+
+    /* Decode one packet, returns the events it completed */
+    size_t process(const sr_wrap_packet_t *packet);
+
+    const std::vector<SwEvent> &events() const { return eventList; }
+    uint64_t total() const { return totalEvents; }
+
+private:
+    unsigned numChannels;
+    uint64_t samplerate;
+    Bitplanes planes;
+    SwSampler sampler;
+    SwdDecoder decoder;
+    std::vector<SwCycle> cycles;
+    std::vector<SwEvent> eventList;
+    uint64_t totalEvents;
+    FILE *file;
+    bool failed;
+};
+
+/* Read an event file written by SwTrace, false if it is not one */
+bool sw_trace_load(const char *path, std::vector<SwEvent> &events);
+
+/*
+ * SWO trace stage: Logic16 packets in, ITM SwoEvents out, written with the
+ * same header as SwTrace files but SWO_TRACE_MAGIC and SwoEvent records.
+ * Per-port statistics are kept by the decoder for the whole capture.
+ */
+class SwoTrace {
+public:
+    SwoTrace(unsigned numChannels, unsigned channel, unsigned encoding,
+             uint64_t samplerate = 16000000, uint32_t bitrate = 0);
+    ~SwoTrace();
+
+    SwoTrace(const SwoTrace&) = delete;
+    SwoTrace& operator = (const SwoTrace&) = delete;
+
+    bool open(const char *path);
+    /* False if any write to the file failed */
+    bool close();
+    /* A write failed since open(); records after it are not written */
+    bool writeFailed() const { return failed; }
+
+    /* Decode one packet, returns the events it completed */
+    size_t process(const sr_wrap_packet_t *packet);
+
+    const std::vector<SwoEvent> &events() const { return eventList; }
+    uint64_t total() const { return totalEvents; }
+    const SwoSampler &swo() const { return sampler; }
+    const ItmDecoder &itm() const { return decoder; }
+
+private:
+    unsigned numChannels;
+    uint64_t samplerate;
+    Bitplanes planes;
+    SwoSampler sampler;
+    ItmDecoder decoder;
+    std::vector<SwoByte> bytes;
+    std::vector<SwoEvent> eventList;
+    uint64_t totalEvents;
+    FILE *file;
+    bool failed;
+};
+
+/* Read an event file written by SwoTrace, false if it is not one */
+bool swo_trace_load(const char *path, std::vector<SwoEvent> &events);
+
+#endif //TTT_SW_TRACE_H
@@ -0,0 +1,81 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "xble_common.h"
+#include <assert.h>
+
+namespace {
+
+/* Whitening is a fixed byte sequence per channel, CRC a byte table */
+struct Tables {
+    uint8_t whitening[XBLE_CHANNELS][2 + XBLE_MAX_PAYLOAD + 3];
+    uint32_t crc[256];
+
+    Tables() {
+        for (unsigned ch = 0; ch < XBLE_CHANNELS; ch++) {
+            /* x^7 + x^4 + 1, preset with 1 and the channel index */
+            uint8_t lfsr = reverse8((uint8_t) ch) | 2;
+            for (unsigned i = 0; i < sizeof(whitening[ch]); i++) {
+                uint8_t mask = 0;
+                for (unsigned bit = 0; bit < 8; bit++) {
+                    if (lfsr & 0x80) {
+                        lfsr ^= 0x11;
+                        mask |= 1 << bit;
+                    }
+                    lfsr <<= 1;
+                }
+                whitening[ch][i] = mask;
+            }
+        }
+
+        /* x^24 + x^10 + x^9 + x^6 + x^4 + x^3 + x + 1, shifted LSB first */
+        for (unsigned i = 0; i < 256; i++) {
+            uint32_t state = i;
+            for (unsigned bit = 0; bit < 8; bit++) {
+                bool feedback = state & 1;
+                state >>= 1;
+                if (feedback) {
+                    state |= 1 << 23;
+                    state ^= 0x5a6000;
+                }
+            }
+            crc[i] = state;
+        }
+    }
+
+    static uint8_t reverse8(uint8_t v) {
+        v = (v & 0xf0) >> 4 | (v & 0x0f) << 4;
+        v = (v & 0xcc) >> 2 | (v & 0x33) << 2;
+        v = (v & 0xaa) >> 1 | (v & 0x55) << 1;
+        return v;
+    }
+};
+
+const Tables tables;
+
+uint32_t reverse24(uint32_t v) {
+    uint32_t r = 0;
+    for (unsigned i = 0; i < 24; i++) {
+        r |= ((v >> i) & 1) << (23 - i);
+    }
+    return r;
+}
+
+}
+
+void xble_whiten(uint8_t *data, size_t length, unsigned channel) {
+    assert(channel < XBLE_CHANNELS && length <= sizeof(tables.whitening[0]));
+    const uint8_t *w = tables.whitening[channel];
+    for (size_t i = 0; i < length; i++) {
+        data[i] ^= w[i];
+    }
+}
+
+uint32_t xble_crc24(uint32_t init, const uint8_t *data, size_t length) {
+    uint32_t state = reverse24(init);
+    for (size_t i = 0; i < length; i++) {
+        state = (state >> 8) ^ tables.crc[(state ^ data[i]) & 0xff];
+    }
+    return state;
+}
@@ -0,0 +1,86 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_XBLE_COMMON_H
+#define TTT_XBLE_COMMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Shared pieces of the BLE link-layer trace (1M PHY): burst and PDU
+ * records, whitening and CRC. Bits go over the air LSB first and are
+ * stored that way, bit i of a burst is bit (i % 8) of byte i / 8.
+ */
+
+#define XBLE_ADV_ACCESS_ADDRESS 0x8e89bed6u
+#define XBLE_ADV_CRC_INIT       0x555555u
+#define XBLE_DATA_CHANNELS      37
+#define XBLE_CHANNELS           40
+
+#define XBLE_MAX_PAYLOAD 255
+/* Access address, header, payload and CRC */
+#define XBLE_MAX_PACKET  (4 + 2 + XBLE_MAX_PAYLOAD + 3)
+/* A burst holds the preamble and some slack on top */
+#define XBLE_MAX_BURST_BYTES (XBLE_MAX_PACKET + 8)
+
+#define XBLE_RX 0
+#define XBLE_TX 1
+
+/* Advertising PDU types */
+#define XBLE_ADV_IND         0
+#define XBLE_ADV_DIRECT_IND  1
+#define XBLE_ADV_NONCONN_IND 2
+#define XBLE_SCAN_REQ        3
+#define XBLE_SCAN_RSP        4
+#define XBLE_CONNECT_IND     5
+#define XBLE_ADV_SCAN_IND    6
+
+/* Data PDU LLID and the control opcodes the link tracker follows */
+#define XBLE_LLID_CONTROL            3
+#define XBLE_LL_CONNECTION_UPDATE_IND 0x00
+#define XBLE_LL_CHANNEL_MAP_IND       0x01
+#define XBLE_LL_TERMINATE_IND         0x02
+
+#define XBLE_FLAG_CRC_OK    0x01
+#define XBLE_FLAG_TRUNCATED 0x02
+
+/* Bits a sampler recovered from one transmission or reception */
+struct XbleBurst {
+    /** Absolute sample of the first bit */
+    uint64_t sample;
+    /** Samples per bit, to time bits within the burst */
+    uint32_t bitSamples;
+    uint16_t bits;
+    uint8_t direction;
+    uint8_t data[XBLE_MAX_BURST_BYTES];
+};
+
+struct XblePdu {
+    /** Absolute sample of the first access address bit */
+    uint64_t sample;
+    uint32_t accessAddress;
+    uint32_t crc;
+    /** Connection event counter, 0 for advertising */
+    uint16_t event;
+    uint8_t channel;
+    uint8_t direction;
+    uint8_t flags;
+    uint8_t length;
+    /** First header byte: PDU type or LLID/NESN/SN/MD */
+    uint8_t header;
+    uint8_t payload[XBLE_MAX_PAYLOAD];
+};
+
+inline bool xble_advertising(const XblePdu &pdu) {
+    return pdu.accessAddress == XBLE_ADV_ACCESS_ADDRESS;
+}
+
+/* XOR the whitening sequence of channel over data, starting at the header */
+void xble_whiten(uint8_t *data, size_t length, unsigned channel);
+
+/* CRC over header and payload, comparable to the received bytes read little endian */
+uint32_t xble_crc24(uint32_t init, const uint8_t *data, size_t length);
+
+#endif //TTT_XBLE_COMMON_H
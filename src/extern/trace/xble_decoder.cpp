@@ -0,0 +1,121 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "xble_decoder.h"
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+
+/* Shortest PDU: header and CRC */
+#define XBLE_MIN_PDU_BITS ((2 + 3) * 8)
+
+static unsigned bit_at(const XbleBurst &burst, size_t i) {
+    return (burst.data[i >> 3] >> (i & 7)) & 1;
+}
+
+static uint8_t byte_at(const XbleBurst &burst, size_t i) {
+    size_t index = i >> 3;
+    unsigned shift = i & 7;
+    unsigned v = burst.data[index] >> shift;
+    if (shift && index + 1 < sizeof(burst.data)) {
+        v |= burst.data[index + 1] << (8 - shift);
+    }
+    return (uint8_t) v;
+}
+
+XbleDecoder::XbleDecoder(XbleLinkTracker &links)
+    : links(links)
+    , channelMisses(0) {
+}
+
+bool XbleDecoder::dewhiten(unsigned channel, uint32_t crcInit, size_t available, XblePdu &pdu) {
+    /* The header gives the length, then only that much is dewhitened */
+    memcpy(work, raw, 2);
+    xble_whiten(work, 2, channel);
+    size_t length = work[1];
+    size_t n = min(available, 2 + length + 3);
+    memcpy(work, raw, n);
+    xble_whiten(work, n, channel);
+
+    size_t copied = min(n - 2, length);
+    pdu.channel = (uint8_t) channel;
+    pdu.header = work[0];
+    pdu.length = (uint8_t) length;
+    memcpy(pdu.payload, work + 2, copied);
+    memset(pdu.payload + copied, 0, length - copied);
+
+    if (2 + length + 3 > available) {
+        pdu.crc = 0;
+        pdu.flags = XBLE_FLAG_TRUNCATED;
+        return false;
+    }
+    const uint8_t *crc = work + 2 + length;
+    pdu.crc = crc[0] | crc[1] << 8 | crc[2] << 16;
+    bool ok = xble_crc24(crcInit, work, 2 + length) == pdu.crc;
+    pdu.flags = ok ? XBLE_FLAG_CRC_OK : 0;
+    return ok;
+}
+
+bool XbleDecoder::decode(const XbleBurst &burst, XblePdu &pdu) {
+    if (burst.bits < 32 + XBLE_MIN_PDU_BITS) {
+        return false;
+    }
+
+    /* Slide a 32 bit window until it holds a known access address */
+    uint32_t window = 0;
+    for (unsigned i = 0; i < 32; i++) {
+        window |= (uint32_t) bit_at(burst, i) << i;
+    }
+    const XbleConnection *c = NULL;
+    size_t offset = 0;
+    while (window != XBLE_ADV_ACCESS_ADDRESS && !(c = links.find(window))) {
+        if (offset + 32 + XBLE_MIN_PDU_BITS >= burst.bits) {
+            return false;
+        }
+        window = window >> 1 | (uint32_t) bit_at(burst, offset + 32) << 31;
+        offset++;
+    }
+
+    size_t start = offset + 32;
+    size_t available = min((size_t) (burst.bits - start) / 8, sizeof(raw));
+    for (size_t i = 0; i < available; i++) {
+        raw[i] = byte_at(burst, start + i * 8);
+    }
+
+    pdu.sample = burst.sample + offset * burst.bitSamples;
+    pdu.accessAddress = window;
+    pdu.direction = burst.direction;
+    pdu.event = 0;
+
+    uint32_t event = 0;
+    if (!c) {
+        bool found = false;
+        for (unsigned ch = XBLE_DATA_CHANNELS; !found && ch < XBLE_CHANNELS; ch++) {
+            found = dewhiten(ch, XBLE_ADV_CRC_INIT, available, pdu);
+        }
+        if (!found) {
+            dewhiten(XBLE_DATA_CHANNELS, XBLE_ADV_CRC_INIT, available, pdu);
+        }
+    } else {
+        event = links.eventAt(*c, pdu.sample);
+        unsigned expected = links.channelFor(*c, event);
+        bool found = dewhiten(expected, c->crcInit, available, pdu);
+        for (unsigned ch = 0; !found && ch < XBLE_DATA_CHANNELS; ch++) {
+            if (ch != expected) {
+                found = dewhiten(ch, c->crcInit, available, pdu);
+            }
+        }
+        if (found && pdu.channel != expected) {
+            channelMisses++;
+        }
+        if (!found) {
+            dewhiten(expected, c->crcInit, available, pdu);
+        }
+        pdu.event = (uint16_t) event;
+    }
+
+    links.observe(pdu, event);
+    return true;
+}
@@ -0,0 +1,39 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_XBLE_DECODER_H
+#define TTT_XBLE_DECODER_H
+
+#include <stdint.h>
+#include "xble_common.h"
+#include "xble_link.h"
+
+/*
+ * Reassembles link-layer PDUs from sampler bursts. The access address is
+ * searched bit by bit, the rest is taken bytewise from that offset. A
+ * burst carries no channel, so advertising packets are dewhitened for
+ * 37, 38 and 39 and connection packets first for the channel the link
+ * tracker expects, then for every other data channel until the CRC fits.
+ */
+class XbleDecoder {
+public:
+    explicit XbleDecoder(XbleLinkTracker &links);
+
+    /* False if no known access address is in the burst */
+    bool decode(const XbleBurst &burst, XblePdu &pdu);
+
+    /* Connection packets whose CRC only fit off the expected channel */
+    uint64_t misses() const { return channelMisses; }
+
+private:
+    /* Try one channel, true if the CRC matched */
+    bool dewhiten(unsigned channel, uint32_t crcInit, size_t available, XblePdu &pdu);
+
+    XbleLinkTracker &links;
+    uint8_t raw[XBLE_MAX_PACKET - 4];
+    uint8_t work[XBLE_MAX_PACKET - 4];
+    uint64_t channelMisses;
+};
+
+#endif //TTT_XBLE_DECODER_H
@@ -0,0 +1,191 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "xble_link.h"
+#include <string.h>
+
+using namespace std;
+
+static uint32_t le16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t le24(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16;
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return le24(p) | (uint32_t) p[3] << 24;
+}
+
+static bool used(const uint8_t *map, unsigned channel) {
+    return (map[channel >> 3] >> (channel & 7)) & 1;
+}
+
+/* A 16-bit instant is always ahead of the current event */
+static uint32_t unwrap(uint32_t event, uint32_t instant) {
+    return event + ((instant - event) & 0xffff);
+}
+
+XbleLinkTracker::XbleLinkTracker(uint64_t samplerate)
+    : samplerate(samplerate) {
+}
+
+void XbleLinkTracker::reset() {
+    links.clear();
+}
+
+/* Link layer times come in 1.25 ms units */
+uint64_t XbleLinkTracker::units(uint32_t n) const {
+    return n * samplerate / 800;
+}
+
+const XbleConnection *XbleLinkTracker::find(uint32_t accessAddress) const {
+    for (auto &c : links) {
+        if (c.accessAddress == accessAddress) {
+            return &c;
+        }
+    }
+    return NULL;
+}
+
+uint32_t XbleLinkTracker::eventAt(const XbleConnection &c, uint64_t sample) const {
+    /* The first packet after CONNECT_IND opens event 0 */
+    if (!c.anchored || sample <= c.anchor) {
+        return c.anchored ? c.anchorEvent : 0;
+    }
+    uint64_t interval = c.intervalSamples;
+    uint32_t event = c.anchorEvent + (uint32_t) ((sample - c.anchor + interval / 2) / interval);
+
+    if (c.updatePending && event >= c.updateInstant) {
+        /* The instant's anchor moves by the window offset, the new interval runs from there */
+        uint64_t at = c.anchor + (uint64_t) (c.updateInstant - c.anchorEvent) * interval +
+                      units(1) + c.updateOffset;
+        if (sample <= at) {
+            return c.updateInstant;
+        }
+        return c.updateInstant + (uint32_t) ((sample - at + c.updateInterval / 2) / c.updateInterval);
+    }
+    return event;
+}
+
+unsigned XbleLinkTracker::channelFor(const XbleConnection &c, uint32_t event) const {
+    const uint8_t *map = c.mapPending && event >= c.mapInstant ? c.nextMap : c.channelMap;
+    unsigned unmapped = (unsigned) (((uint64_t) event + 1) * c.hop % XBLE_DATA_CHANNELS);
+
+    if (used(map, unmapped)) {
+        return unmapped;
+    }
+    unsigned count = 0;
+    for (unsigned ch = 0; ch < XBLE_DATA_CHANNELS; ch++) {
+        count += used(map, ch);
+    }
+    if (count == 0) {
+        return unmapped;
+    }
+    unsigned index = unmapped % count;
+    for (unsigned ch = 0; ch < XBLE_DATA_CHANNELS; ch++) {
+        if (used(map, ch) && index-- == 0) {
+            return ch;
+        }
+    }
+    return unmapped;
+}
+
+void XbleLinkTracker::connect(const XblePdu &pdu) {
+    /* InitA, AdvA, then the LLData */
+    const uint8_t *ll = pdu.payload + 12;
+    XbleConnection c;
+
+    memset(&c, 0, sizeof(c));
+    c.accessAddress = le32(ll);
+    c.crcInit = le24(ll + 4);
+    c.intervalSamples = units(le16(ll + 10));
+    c.timeoutSamples = le16(ll + 14) * samplerate / 100;
+    memcpy(c.channelMap, ll + 16, 5);
+    c.hop = ll[21] & 0x1f;
+    c.lastSeen = pdu.sample;
+    if (c.intervalSamples == 0) {
+        return;
+    }
+
+    for (auto &l : links) {
+        if (l.accessAddress == c.accessAddress) {
+            l = c;
+            return;
+        }
+    }
+    links.push_back(c);
+}
+
+void XbleLinkTracker::control(XbleConnection &c, const XblePdu &pdu, uint32_t event) {
+    const uint8_t *p = pdu.payload;
+
+    switch (p[0]) {
+        case XBLE_LL_CONNECTION_UPDATE_IND:
+            if (pdu.length == 12) {
+                c.updateOffset = units(le16(p + 2));
+                c.updateInterval = units(le16(p + 4));
+                c.updateTimeout = le16(p + 8) * samplerate / 100;
+                c.updateInstant = unwrap(event, le16(p + 10));
+                c.updatePending = c.updateInterval > 0;
+            }
+            break;
+        case XBLE_LL_CHANNEL_MAP_IND:
+            if (pdu.length == 8) {
+                memcpy(c.nextMap, p + 1, 5);
+                c.mapInstant = unwrap(event, le16(p + 6));
+                c.mapPending = true;
+            }
+            break;
+        case XBLE_LL_TERMINATE_IND:
+            links.erase(links.begin() + (&c - &links[0]));
+            break;
+    }
+}
+
+void XbleLinkTracker::observe(const XblePdu &pdu, uint32_t event) {
+    if (!(pdu.flags & XBLE_FLAG_CRC_OK)) {
+        return;
+    }
+    if (xble_advertising(pdu)) {
+        if ((pdu.header & 0x0f) == XBLE_CONNECT_IND && pdu.length == 34) {
+            connect(pdu);
+        }
+        return;
+    }
+
+    XbleConnection *c = const_cast<XbleConnection*>(find(pdu.accessAddress));
+    if (!c) {
+        return;
+    }
+    c->lastSeen = pdu.sample;
+    if (!c->anchored || event > c->anchorEvent) {
+        c->anchored = true;
+        c->anchor = pdu.sample;
+        c->anchorEvent = event;
+    }
+    if (c->mapPending && event >= c->mapInstant) {
+        memcpy(c->channelMap, c->nextMap, 5);
+        c->mapPending = false;
+    }
+    if (c->updatePending && event >= c->updateInstant) {
+        c->intervalSamples = c->updateInterval;
+        c->timeoutSamples = c->updateTimeout;
+        c->updatePending = false;
+    }
+    if ((pdu.header & 0x03) == XBLE_LLID_CONTROL && pdu.length > 0) {
+        control(*c, pdu, event);
+    }
+}
+
+void XbleLinkTracker::expire(uint64_t now) {
+    for (size_t i = 0; i < links.size();) {
+        if (now > links[i].lastSeen + links[i].timeoutSamples) {
+            links.erase(links.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_XBLE_LINK_H
+#define TTT_XBLE_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "xble_common.h"
+
+/* State of one followed connection; event counters are kept unwrapped */
+struct XbleConnection {
+    uint32_t accessAddress;
+    uint32_t crcInit;
+    uint8_t hop;
+    uint8_t channelMap[5];
+    uint64_t intervalSamples;
+    uint64_t timeoutSamples;
+    /* Sample of the first packet of event anchorEvent */
+    bool anchored;
+    uint64_t anchor;
+    uint32_t anchorEvent;
+    uint64_t lastSeen;
+    /* LL_CHANNEL_MAP_IND waiting for its instant */
+    bool mapPending;
+    uint8_t nextMap[5];
+    uint32_t mapInstant;
+    /* LL_CONNECTION_UPDATE_IND waiting for its instant */
+    bool updatePending;
+    uint32_t updateInstant;
+    uint64_t updateOffset;
+    uint64_t updateInterval;
+    uint64_t updateTimeout;
+};
+
+/*
+ * Follows connections from their CONNECT_IND: access address, CRC init,
+ * channel map and hop increment (channel selection #1), and the event
+ * timing, so the decoder knows which channel to dewhiten a connection
+ * packet with. Channel map and connection updates take effect at their
+ * instants, LL_TERMINATE_IND and the supervision timeout end a connection.
+ */
+class XbleLinkTracker {
+public:
+    explicit XbleLinkTracker(uint64_t samplerate);
+
+    void reset();
+
+    /* Connection using this access address, NULL if none */
+    const XbleConnection *find(uint32_t accessAddress) const;
+    size_t connections() const { return links.size(); }
+
+    /* Event a packet of the connection starting at sample belongs to */
+    uint32_t eventAt(const XbleConnection &c, uint64_t sample) const;
+    /* Data channel of an event */
+    unsigned channelFor(const XbleConnection &c, uint32_t event) const;
+
+    /* Follow a decoded PDU; event is the unwrapped event it was decoded for */
+    void observe(const XblePdu &pdu, uint32_t event);
+    /* Drop connections silent for longer than their supervision timeout */
+    void expire(uint64_t now);
+
+private:
+    void connect(const XblePdu &pdu);
+    void control(XbleConnection &c, const XblePdu &pdu, uint32_t event);
+    uint64_t units(uint32_t n) const;
+
+    uint64_t samplerate;
+    std::vector<XbleConnection> links;
+};
+
+#endif //TTT_XBLE_LINK_H
@@ -0,0 +1,60 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "xble_rx_sampler.h"
+#include "EdgeScan.h"
+#include <string.h>
+
+using namespace std;
+
+XbleRxSampler::XbleRxSampler(unsigned clkChannel, unsigned dataChannel, uint32_t gapSamples)
+    : clk(clkChannel)
+    , data(dataChannel)
+    , gap(gapSamples) {
+    reset();
+}
+
+void XbleRxSampler::reset() {
+    clkLevel = false;
+    active = false;
+    lastEdge = 0;
+}
+
+void XbleRxSampler::flush(vector<XbleBurst> &out) {
+    out.push_back(burst);
+    active = false;
+}
+
+size_t XbleRxSampler::sample(const Bitplanes &bp, vector<XbleBurst> &out) {
+    const uint64_t *plane = bp.plane(data);
+    size_t before = out.size();
+
+    edge_scan(bp.plane(clk), bp.samples(), clkLevel, EDGE_RISING, [&](size_t i, bool) {
+        uint64_t s = bp.firstSample + i;
+        if (active && s - lastEdge > gap) {
+            flush(out);
+        }
+        if (!active) {
+            active = true;
+            burst.sample = s;
+            burst.bitSamples = 0;
+            burst.bits = 0;
+            burst.direction = XBLE_RX;
+            memset(burst.data, 0, sizeof(burst.data));
+        } else if (burst.bits == 1) {
+            burst.bitSamples = (uint32_t) (s - lastEdge);
+        }
+        burst.data[burst.bits >> 3] |= ((plane[i >> 6] >> (i & 63)) & 1) << (burst.bits & 7);
+        burst.bits++;
+        lastEdge = s;
+        if (burst.bits == XBLE_MAX_BURST_BYTES * 8) {
+            flush(out);
+        }
+    });
+
+    if (active && bp.firstSample + bp.samples() - lastEdge > gap) {
+        flush(out);
+    }
+    return out.size() - before;
+}
@@ -0,0 +1,40 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_XBLE_RX_SAMPLER_H
+#define TTT_XBLE_RX_SAMPLER_H
+
+#include <stdint.h>
+#include <vector>
+#include "Bitplane.h"
+#include "xble_common.h"
+
+/*
+ * Receive side of the radio debug port: the demodulator puts out data
+ * with a recovered bit clock that only runs while it receives. Data is
+ * taken on rising clock edges, found with the SSE edge scan, and a clock
+ * pause longer than gapSamples ends the burst.
+ */
+class XbleRxSampler {
+public:
+    XbleRxSampler(unsigned clkChannel, unsigned dataChannel, uint32_t gapSamples);
+
+    void reset();
+
+    /* Append the bursts completed in bp, returns how many */
+    size_t sample(const Bitplanes &bp, std::vector<XbleBurst> &out);
+
+private:
+    void flush(std::vector<XbleBurst> &out);
+
+    unsigned clk;
+    unsigned data;
+    uint32_t gap;
+    bool clkLevel;
+    bool active;
+    uint64_t lastEdge;
+    XbleBurst burst;
+};
+
+#endif //TTT_XBLE_RX_SAMPLER_H
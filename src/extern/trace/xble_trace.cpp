@@ -0,0 +1,119 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "xble_trace.h"
+#include <stddef.h>
+#include <string.h>
+
+using namespace std;
+
+#define XBLE_RECORD_SIZE offsetof(XblePdu, payload)
+
+XbleTrace::XbleTrace(unsigned numChannels, unsigned rxClkChannel, unsigned rxDataChannel,
+                     unsigned txEnableChannel, unsigned txDataChannel, uint64_t samplerate)
+    : numChannels(numChannels)
+    , samplerate(samplerate)
+    , planes(numChannels)
+    /* A burst ends after four quiet bit times */
+    , rx(rxClkChannel, rxDataChannel, (uint32_t) (samplerate / 250000))
+    , tx(txEnableChannel, txDataChannel, samplerate)
+    , tracker(samplerate)
+    , pduDecoder(tracker)
+    , totalPdus(0)
+    , file(NULL)
+    , failed(false) {
+}
+
+XbleTrace::~XbleTrace() {
+    close();
+}
+
+bool XbleTrace::open(const char *path) {
+    close();
+    failed = false;
+    file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    xble_trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, XBLE_TRACE_MAGIC, sizeof(XBLE_TRACE_MAGIC));
+    header.version = XBLE_TRACE_VERSION;
+    header.recordSize = XBLE_RECORD_SIZE;
+    header.samplerate = samplerate;
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool XbleTrace::close() {
+    if (!file) {
+        return true;
+    }
+    failed = fclose(file) != 0 || failed;
+    file = NULL;
+    return !failed;
+}
+
+void XbleTrace::emit(const XbleBurst &burst) {
+    pduList.emplace_back();
+    XblePdu &pdu = pduList.back();
+    if (!pduDecoder.decode(burst, pdu)) {
+        pduList.pop_back();
+        return;
+    }
+    if (file && !failed) {
+        failed = fwrite(&pdu, XBLE_RECORD_SIZE + pdu.length, 1, file) != 1;
+    }
+}
+
+size_t XbleTrace::process(const sr_wrap_packet_t *packet) {
+    bitplane_from_logic16(packet->data, packet->size, numChannels, planes);
+    planes.firstSample = packet->sample;
+
+    rxBursts.clear();
+    txBursts.clear();
+    pduList.clear();
+    rx.sample(planes, rxBursts);
+    tx.sample(planes, txBursts);
+
+    /* Each sampler's bursts are in order already, merge them */
+    size_t r = 0, t = 0;
+    while (r < rxBursts.size() || t < txBursts.size()) {
+        if (t == txBursts.size() || (r < rxBursts.size() && rxBursts[r].sample < txBursts[t].sample)) {
+            emit(rxBursts[r++]);
+        } else {
+            emit(txBursts[t++]);
+        }
+    }
+    tracker.expire(planes.firstSample + planes.samples());
+
+    totalPdus += pduList.size();
+    return pduList.size();
+}
+
+bool xble_trace_load(const char *path, vector<XblePdu> &pdus) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    xble_trace_header_t header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, XBLE_TRACE_MAGIC, sizeof(XBLE_TRACE_MAGIC)) == 0 &&
+              header.recordSize == XBLE_RECORD_SIZE;
+    XblePdu pdu;
+    while (ok && fread(&pdu, XBLE_RECORD_SIZE, 1, f) == 1) {
+        if (pdu.length && fread(pdu.payload, pdu.length, 1, f) != 1) {
+            ok = false;
+            break;
+        }
+        pdus.push_back(pdu);
+    }
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,82 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_XBLE_TRACE_H
+#define TTT_XBLE_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "Bitplane.h"
+#include "sigrok_wrapper.h"
+#include "xble_decoder.h"
+#include "xble_link.h"
+#include "xble_rx_sampler.h"
+#include "xble_tx_sampler.h"
+
+#define XBLE_TRACE_MAGIC   "TTTBLE1"
+#define XBLE_TRACE_VERSION 1
+
+/*
+ * PDU files are this header followed by records of recordSize fixed bytes
+ * (XblePdu up to the payload) and then length payload bytes.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t samplerate;
+} xble_trace_header_t;
+
+/*
+ * BLE trace stage: Logic16 packets in, PDUs out. The receive side comes
+ * as a bit clock and data, the transmit side as an enable and data line.
+ * Bursts of both samplers are decoded in sample order so the link tracker
+ * sees master and slave packets of an event in turn.
+ */
+class XbleTrace {
+public:
+    XbleTrace(unsigned numChannels, unsigned rxClkChannel, unsigned rxDataChannel,
+              unsigned txEnableChannel, unsigned txDataChannel, uint64_t samplerate = 16000000);
+    ~XbleTrace();
+
+    XbleTrace(const XbleTrace&) = delete;
+    XbleTrace& operator = (const XbleTrace&) = delete;
+
+    bool open(const char *path);
+    /* False if any write to the file failed */
+    bool close();
+    /* A write failed since open(); PDUs after it are not written */
+    bool writeFailed() const { return failed; }
+
+    /* Decode one packet, returns the PDUs it completed */
+    size_t process(const sr_wrap_packet_t *packet);
+
+    const std::vector<XblePdu> &pdus() const { return pduList; }
+    uint64_t total() const { return totalPdus; }
+    const XbleLinkTracker &links() const { return tracker; }
+    const XbleDecoder &decoder() const { return pduDecoder; }
+
+private:
+    void emit(const XbleBurst &burst);
+
+    unsigned numChannels;
+    uint64_t samplerate;
+    Bitplanes planes;
+    XbleRxSampler rx;
+    XbleTxSampler tx;
+    XbleLinkTracker tracker;
+    XbleDecoder pduDecoder;
+    std::vector<XbleBurst> rxBursts;
+    std::vector<XbleBurst> txBursts;
+    std::vector<XblePdu> pduList;
+    uint64_t totalPdus;
+    FILE *file;
+    bool failed;
+};
+
+/* Read a PDU file written by XbleTrace, false if it is not one */
+bool xble_trace_load(const char *path, std::vector<XblePdu> &pdus);
+
+#endif //TTT_XBLE_TRACE_H
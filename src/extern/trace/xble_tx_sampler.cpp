@@ -0,0 +1,63 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "xble_tx_sampler.h"
+#include "EdgeScan.h"
+#include <string.h>
+
+using namespace std;
+
+XbleTxSampler::XbleTxSampler(unsigned enableChannel, unsigned dataChannel, uint64_t samplerate, uint32_t bitrate)
+    : enable(enableChannel)
+    , data(dataChannel)
+    , samplerate(samplerate)
+    , bitrate(bitrate) {
+    reset();
+}
+
+void XbleTxSampler::reset() {
+    enableLevel = false;
+    active = false;
+}
+
+uint64_t XbleTxSampler::centre(uint32_t bit) const {
+    return burst.sample + (2 * (uint64_t) bit + 1) * samplerate / (2 * bitrate);
+}
+
+void XbleTxSampler::take(const Bitplanes &bp, uint64_t end) {
+    const uint64_t *plane = bp.plane(data);
+    uint64_t s;
+
+    while (burst.bits < XBLE_MAX_BURST_BYTES * 8 && (s = centre(burst.bits)) < end) {
+        /* Centres before this block were taken with the last one */
+        size_t i = s - bp.firstSample;
+        burst.data[burst.bits >> 3] |= ((plane[i >> 6] >> (i & 63)) & 1) << (burst.bits & 7);
+        burst.bits++;
+    }
+}
+
+size_t XbleTxSampler::sample(const Bitplanes &bp, vector<XbleBurst> &out) {
+    size_t before = out.size();
+
+    edge_scan(bp.plane(enable), bp.samples(), enableLevel, EDGE_BOTH, [&](size_t i, bool rising) {
+        uint64_t s = bp.firstSample + i;
+        if (rising) {
+            active = true;
+            burst.sample = s;
+            burst.bitSamples = (uint32_t) (samplerate / bitrate);
+            burst.bits = 0;
+            burst.direction = XBLE_TX;
+            memset(burst.data, 0, sizeof(burst.data));
+        } else if (active) {
+            take(bp, s);
+            out.push_back(burst);
+            active = false;
+        }
+    });
+
+    if (active) {
+        take(bp, bp.firstSample + bp.samples());
+    }
+    return out.size() - before;
+}
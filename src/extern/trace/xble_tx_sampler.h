@@ -0,0 +1,42 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_XBLE_TX_SAMPLER_H
+#define TTT_XBLE_TX_SAMPLER_H
+
+#include <stdint.h>
+#include <vector>
+#include "Bitplane.h"
+#include "xble_common.h"
+
+/*
+ * Transmit side of the radio debug port: an enable line that is high
+ * while the modulator sends and the data going into it, without a clock.
+ * Bits are read at their centres, computed from the enable edge and the
+ * bitrate, so only the enable line is scanned.
+ */
+class XbleTxSampler {
+public:
+    XbleTxSampler(unsigned enableChannel, unsigned dataChannel, uint64_t samplerate, uint32_t bitrate = 1000000);
+
+    void reset();
+
+    /* Append the bursts completed in bp, returns how many */
+    size_t sample(const Bitplanes &bp, std::vector<XbleBurst> &out);
+
+private:
+    /* Take every bit centred before end */
+    void take(const Bitplanes &bp, uint64_t end);
+    uint64_t centre(uint32_t bit) const;
+
+    unsigned enable;
+    unsigned data;
+    uint64_t samplerate;
+    uint32_t bitrate;
+    bool enableLevel;
+    bool active;
+    XbleBurst burst;
+};
+
+#endif //TTT_XBLE_TX_SAMPLER_H
@@ -6,6 +6,7 @@
 #include <tmmintrin.h>
 #include <assert.h>
 #include "saleae.h"
+#include "ReplaySource.h"
 
 #define LOG_PREFIX "main"
 
@@ -26,7 +27,37 @@ void loop(){
     sigrok_init(&ctx);
 }
 
-int main(){
+static void replay_recv(sr_wrap_packet_t *packet){
+    throughput += packet->size;
+    sr_data_recv_cb(packet);
+}
+
+/* ttt [--fast] capture... replays captures instead of opening devices */
+static int replay(int argc, char **argv){
+    ReplaySource source(replay_recv);
+    ReplaySource::Mode mode = ReplaySource::REPLAY_REALTIME;
+    int id = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--fast") {
+            mode = ReplaySource::REPLAY_FAST;
+        } else if (!source.open(argv[i], id++)) {
+            cerr << "Unable to open capture " << argv[i] << endl;
+            return 1;
+        }
+    }
+
+    thread t1(consumer_recv);
+    t1.detach();
+    source.run(mode);
+    return 0;
+}
+
+int main(int argc, char **argv){
+    if (argc > 1) {
+        return replay(argc, argv);
+    }
+
     Saleae saleae;
     thread t0(loop);
     thread t1(consumer_recv);
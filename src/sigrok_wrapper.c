@@ -16,7 +16,6 @@
 #define USB_INTERFACE        0
 #define USB_CONFIGURATION    1
 #define FX2_FIRMWARE        "saleae-logic16-fx2.fw"
-static void sr_data_recv_cb(sr_wrap_packet_t *packet);
 static int dev_open(struct sr_dev_inst *sdi);
 GSList *scan(struct sr_dev_driver *di);
 int sigrok_start(const struct sr_dev_inst *sdi);
@@ -135,7 +134,7 @@ int sigrok_start(const struct sr_dev_inst *sdi) {
     return SR_OK;
 }
 
-static void sr_data_recv_cb(sr_wrap_packet_t *packet){
+void sr_data_recv_cb(sr_wrap_packet_t *packet){
     for(int i=0; i< packet->size; i++){
         //printf("%s\n", byte2bin(((uint8_t*)packet->data)[i], buf));
         if(((uint8_t*)packet->data)[i] != 0) {
@@ -20,6 +20,8 @@ typedef struct {
     uint8_t *data;
     ssize_t size;
     void *ref;
+    /** Absolute index of the first sample in data */
+    uint64_t sample;
 } sr_wrap_packet_t;
 
 typedef struct {
@@ -33,6 +35,7 @@ typedef void (*sr_callback_t)(sr_wrap_packet_t *packet);
 #include "libsigrok-internal.h"
 
 void sigrok_init(struct sr_context **ctx);
+void sr_data_recv_cb(sr_wrap_packet_t *packet);
 
 
 
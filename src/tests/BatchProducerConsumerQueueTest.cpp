@@ -0,0 +1,230 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "BatchProducerConsumerQueue.h"
+#include "ProducerConsumerQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+SCENARIO( "BatchProducerConsumerQueue batches", "[spsc]" ) {
+
+    GIVEN( "A queue of 8" ) {
+        BatchProducerConsumerQueue<int> q(8);
+        int in[12], out[12];
+        for (int i = 0; i < 12; i++) {
+            in[i] = i;
+        }
+
+        WHEN( "more is written than fits" ) {
+            size_t n = q.writeN(in, 12);
+
+            THEN( "every slot is used and the rest is refused" ) {
+                REQUIRE( n == 8 );
+                REQUIRE( q.isFull() );
+                REQUIRE_FALSE( q.write(99) );
+                REQUIRE( q.readN(out, 3) == 3 );
+                REQUIRE( out[0] == 0 );
+                REQUIRE( out[2] == 2 );
+                REQUIRE( q.writeN(in + 8, 4) == 3 );
+                REQUIRE( q.sizeGuess() == 8 );
+            }
+        }
+        WHEN( "batches wrap around the end" ) {
+            int next = 0, expect = 0;
+            bool ok = true;
+            for (int round = 0; round < 20; round++) {
+                int batch[5];
+                for (int i = 0; i < 5; i++) {
+                    batch[i] = next + i;
+                }
+                next += (int) q.writeN(batch, 5);
+                size_t got = q.readN(out, 4);
+                for (size_t i = 0; i < got; i++) {
+                    ok = ok && out[i] == expect++;
+                }
+            }
+            int v;
+            while (q.read(v)) {
+                ok = ok && v == expect++;
+            }
+
+            THEN( "records come out in order" ) {
+                REQUIRE( ok );
+                REQUIRE( expect == next );
+                REQUIRE( q.isEmpty() );
+                REQUIRE( q.readN(out, 4) == 0 );
+            }
+        }
+    }
+
+    GIVEN( "A queue of owning records" ) {
+        std::shared_ptr<int> p(new int(1));
+        {
+            BatchProducerConsumerQueue<std::shared_ptr<int>> q(4);
+            std::shared_ptr<int> batch[3] = { p, p, p };
+            q.writeN(batch, 3);
+            std::shared_ptr<int> out;
+            q.read(out);
+
+            THEN( "records are moved in and left ones are destroyed with the queue" ) {
+                REQUIRE( !batch[0] );
+                REQUIRE( p.use_count() == 4 );
+            }
+        }
+        REQUIRE( p.use_count() == 1 );
+    }
+
+    GIVEN( "A blocking queue between two threads" ) {
+        BatchProducerConsumerQueue<uint64_t, true> q(64);
+        const uint64_t count = 200000;
+        bool inOrder = true;
+
+        WHEN( "both sides sleep when they cannot go on" ) {
+            std::thread consumer([&]() {
+                uint64_t buf[16], expect = 0;
+                while (expect < count) {
+                    q.waitNotEmpty();
+                    size_t n = q.readN(buf, 16);
+                    for (size_t i = 0; i < n; i++) {
+                        inOrder = inOrder && buf[i] == expect++;
+                    }
+                }
+            });
+            uint64_t buf[24];
+            for (uint64_t i = 0; i < count;) {
+                size_t n = std::min<uint64_t>(24, count - i);
+                for (size_t k = 0; k < n; k++) {
+                    buf[k] = i + k;
+                }
+                size_t done = 0;
+                while (done < n) {
+                    q.waitNotFull();
+                    done += q.writeN(buf + done, n - done);
+                }
+                i += n;
+            }
+            consumer.join();
+
+            THEN( "everything arrives in order" ) {
+                REQUIRE( inOrder );
+                REQUIRE( q.isEmpty() );
+            }
+        }
+    }
+}
+
+template<class Queue>
+static double bench_single(Queue &q, uint64_t count) {
+    std::thread consumer([&q, count]() {
+        uint64_t v;
+        for (uint64_t n = 0; n < count;) {
+            if (q.read(v)) {
+                n++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++) {
+        while (!q.write(i)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    auto t1 = std::chrono::steady_clock::now();
+    return count / std::chrono::duration<double>(t1 - t0).count();
+}
+
+static double bench_batch(BatchProducerConsumerQueue<uint64_t> &q, uint64_t count) {
+    const size_t batch = 64;
+    std::thread consumer([&q, count]() {
+        uint64_t buf[batch];
+        for (uint64_t n = 0; n < count;) {
+            size_t got = q.readN(buf, batch);
+            if (got) {
+                n += got;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint64_t buf[batch];
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count;) {
+        size_t n = q.writeN(buf, std::min<uint64_t>(batch, count - i));
+        if (n) {
+            i += n;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    auto t1 = std::chrono::steady_clock::now();
+    return count / std::chrono::duration<double>(t1 - t0).count();
+}
+
+/* Producer stamps a record, the consumer notes how long it took to see it */
+template<class Wait>
+static double bench_wakeup(Wait wait, std::function<bool(uint64_t&)> read,
+                           std::function<void(uint64_t)> write, unsigned rounds) {
+    std::vector<double> latency;
+    std::thread consumer([&]() {
+        uint64_t stamp;
+        for (unsigned i = 0; i < rounds; i++) {
+            while (!read(stamp)) {
+                wait();
+            }
+            auto now = std::chrono::steady_clock::now().time_since_epoch();
+            latency.push_back((double) (std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - stamp));
+        }
+    });
+    for (unsigned i = 0; i < rounds; i++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        write(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+    }
+    consumer.join();
+    std::sort(latency.begin(), latency.end());
+    return latency[latency.size() / 2] / 1e3;
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "BatchProducerConsumerQueue versus folly queue", "[.][bench]" ) {
+    const uint64_t count = 20000000;
+    const unsigned rounds = 500;
+
+    {
+        folly::ProducerConsumerQueue<uint64_t> q(1024);
+        printf("folly write/read     %7.1f Mops/s\n", bench_single(q, count) / 1e6);
+    }
+    {
+        BatchProducerConsumerQueue<uint64_t> q(1024);
+        printf("batch write/read     %7.1f Mops/s\n", bench_single(q, count) / 1e6);
+    }
+    {
+        BatchProducerConsumerQueue<uint64_t> q(1024);
+        printf("batch writeN/readN   %7.1f Mops/s\n", bench_batch(q, count) / 1e6);
+    }
+    {
+        folly::ProducerConsumerQueue<uint64_t> q(1024);
+        double us = bench_wakeup([]() { std::this_thread::sleep_for(std::chrono::microseconds(100)); },
+                                 [&q](uint64_t &v) { return q.read(v); },
+                                 [&q](uint64_t v) { q.write(v); }, rounds);
+        printf("folly sleep-poll     %7.1f us median wake-up\n", us);
+    }
+    {
+        BatchProducerConsumerQueue<uint64_t, true> q(1024);
+        double us = bench_wakeup([&q]() { q.waitNotEmpty(); },
+                                 [&q](uint64_t &v) { return q.read(v); },
+                                 [&q](uint64_t v) { q.write(v); }, rounds);
+        printf("batch futex wait     %7.1f us median wake-up\n", us);
+    }
+}
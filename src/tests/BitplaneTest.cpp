@@ -0,0 +1,67 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "Bitplane.h"
+#include <stdlib.h>
+
+SCENARIO( "Bitplane transposition", "[bitplane]" ) {
+
+    GIVEN( "A block of sample words" ) {
+        std::vector<uint16_t> samples(1000);
+        srand(1);
+        for (size_t i = 0; i < samples.size(); i++) {
+            samples[i] = (uint16_t) rand();
+        }
+        Bitplanes planes;
+
+        WHEN( "it is transposed to bit planes" ) {
+            bitplane_from_samples(&samples[0], samples.size(), planes);
+
+            THEN( "every bit lands in its channel plane" ) {
+                REQUIRE( planes.samples() == 1000 );
+                REQUIRE( planes.words() == 16 );
+                for (size_t i = 0; i < samples.size(); i++) {
+                    for (unsigned ch = 0; ch < 16; ch++) {
+                        REQUIRE( planes.bit(ch, i) == (((samples[i] >> ch) & 1) != 0) );
+                    }
+                }
+            }
+            THEN( "transposing back restores the samples" ) {
+                std::vector<uint16_t> out(samples.size());
+                bitplane_to_samples(planes, &out[0]);
+                REQUIRE( out == samples );
+            }
+        }
+    }
+
+    GIVEN( "Logic16 transfer data with 8 channels enabled" ) {
+        std::vector<uint8_t> raw(2 * 8 * 8);
+        for (size_t i = 0; i < raw.size(); i++) {
+            raw[i] = (uint8_t) (i * 7);
+        }
+        Bitplanes planes(8);
+
+        WHEN( "it is gathered to bit planes" ) {
+            bitplane_from_logic16(&raw[0], raw.size(), 8, planes);
+
+            THEN( "each channel word holds 16 consecutive samples" ) {
+                REQUIRE( planes.samples() == 128 );
+                for (size_t b = 0; b < 8; b++) {
+                    for (unsigned ch = 0; ch < 8; ch++) {
+                        uint16_t word = (uint16_t) (raw[b * 16 + 2 * ch] | (raw[b * 16 + 2 * ch + 1] << 8));
+                        for (unsigned i = 0; i < 16; i++) {
+                            REQUIRE( planes.bit(ch, b * 16 + i) == (((word >> i) & 1) != 0) );
+                        }
+                    }
+                }
+            }
+            THEN( "scattering the planes back restores the transfer data" ) {
+                std::vector<uint8_t> out(raw.size());
+                bitplane_to_logic16(planes, &out[0]);
+                REQUIRE( out == raw );
+            }
+        }
+    }
+}
@@ -0,0 +1,169 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "BlockCodec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+/* Clock on channel 0, a slow counter on 1..4, a sparse strobe and idle channels */
+static std::vector<uint16_t> synthetic_capture(size_t count) {
+    std::vector<uint16_t> samples(count);
+    for (size_t i = 0; i < count; i++) {
+        uint16_t s = (uint16_t) ((i >> 2) & 1);
+        s |= (uint16_t) (((i >> 9) & 0xf) << 1);
+        s |= (i % 5000) < 3 ? 0x100 : 0;
+        s |= 0x8000;
+        samples[i] = s;
+    }
+    return samples;
+}
+
+static std::vector<uint16_t> roundtrip(BlockCodec &codec, const std::vector<uint16_t> &samples, size_t *compressed) {
+    std::vector<uint8_t> buf(codec.maxCompressedSize(samples.size()));
+    size_t n = codec.compress(&samples[0], samples.size(), &buf[0], buf.size());
+    std::vector<uint16_t> out(samples.size());
+    size_t m = codec.decompress(&buf[0], n, &out[0], out.size());
+    out.resize(m);
+    if (compressed) {
+        *compressed = n;
+    }
+    return out;
+}
+
+SCENARIO( "BlockCodec round trips", "[codec]" ) {
+
+    GIVEN( "A synthetic logic capture" ) {
+        std::vector<uint16_t> samples = synthetic_capture(100000);
+
+        WHEN( "it is compressed without LZ" ) {
+            BlockCodec codec;
+            size_t n;
+            std::vector<uint16_t> out = roundtrip(codec, samples, &n);
+
+            THEN( "decoding restores every sample and the data shrinks" ) {
+                REQUIRE( out == samples );
+                REQUIRE( n * 10 < samples.size() * 2 );
+            }
+        }
+        WHEN( "it is compressed with LZ" ) {
+            BlockCodec codec(4096, true);
+            std::vector<uint16_t> out = roundtrip(codec, samples, NULL);
+
+            THEN( "decoding restores every sample" ) {
+                REQUIRE( out == samples );
+            }
+        }
+    }
+
+    GIVEN( "Random data that does not compress" ) {
+        std::vector<uint16_t> samples(10000 + 37);
+        srand(2);
+        for (size_t i = 0; i < samples.size(); i++) {
+            samples[i] = (uint16_t) rand();
+        }
+
+        WHEN( "it is compressed" ) {
+            BlockCodec codec(1000, true);
+            size_t n;
+            std::vector<uint16_t> out = roundtrip(codec, samples, &n);
+
+            THEN( "it round trips within the worst case bound" ) {
+                REQUIRE( out == samples );
+                REQUIRE( n <= codec.maxCompressedSize(samples.size()) );
+            }
+        }
+    }
+
+    GIVEN( "Byte strings of every length up to 600 with repeats and noise" ) {
+        std::vector<uint32_t> table(1 << 12);
+        srand(4);
+
+        THEN( "the LZ stage restores each one it shrinks" ) {
+            for (size_t length = 1; length <= 600; length++) {
+                std::vector<uint8_t> src(length);
+                size_t period = 1 + rand() % 40;
+                for (size_t i = 0; i < length; i++) {
+                    src[i] = rand() % 16 == 0 ? (uint8_t) rand() : (uint8_t) (i % period * 7);
+                }
+                std::vector<uint8_t> packed(length), out(length);
+                size_t n = lz_compress(&src[0], length, &packed[0], packed.size(), &table[0]);
+                if (n) {
+                    INFO( "length " << length );
+                    REQUIRE( n < length );
+                    REQUIRE( lz_decompress(&packed[0], n, &out[0], out.size()) == length );
+                    REQUIRE( out == src );
+                }
+            }
+        }
+    }
+
+    GIVEN( "A corrupt stream" ) {
+        std::vector<uint16_t> samples = synthetic_capture(4096);
+        BlockCodec codec(4096);
+        std::vector<uint8_t> buf(codec.maxCompressedSize(samples.size()));
+        size_t n = codec.compress(&samples[0], samples.size(), &buf[0], buf.size());
+        std::vector<uint16_t> out(samples.size());
+
+        THEN( "decoding a truncated block throws" ) {
+            REQUIRE_THROWS( codec.decompress(&buf[0], n - 1, &out[0], out.size()) );
+        }
+    }
+}
+
+static void bench(const char *name, const std::vector<uint16_t> &samples, bool lz) {
+    BlockCodec codec(BLOCK_CODEC_DEFAULT_SAMPLES, lz);
+    std::vector<uint8_t> buf(codec.maxCompressedSize(samples.size()));
+    std::vector<uint16_t> out(samples.size());
+    double bytes = samples.size() * 2.0;
+    size_t n = 0;
+    const int rounds = 20;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        n = codec.compress(&samples[0], samples.size(), &buf[0], buf.size());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        codec.decompress(&buf[0], n, &out[0], out.size());
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double c = std::chrono::duration<double>(t1 - t0).count() / rounds;
+    double d = std::chrono::duration<double>(t2 - t1).count() / rounds;
+    printf("%-12s lz=%d ratio %7.2f  compress %7.1f MB/s  decompress %7.1f MB/s\n",
+           name, lz, bytes / n, bytes / c / 1e6, bytes / d / 1e6);
+    REQUIRE( out == samples );
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "BlockCodec benchmark", "[.][bench]" ) {
+    std::vector<uint16_t> synthetic = synthetic_capture(8 << 20);
+    bench("synthetic", synthetic, false);
+    bench("synthetic", synthetic, true);
+
+    std::vector<uint16_t> noisy = synthetic;
+    srand(3);
+    for (size_t i = 0; i < noisy.size(); i++) {
+        noisy[i] ^= (uint16_t) ((rand() & 1) << 12);
+    }
+    bench("noisy", noisy, false);
+
+    /* Recorded capture of sample words, e.g. TTT_BENCH_CAPTURE=capture.bin */
+    const char *path = getenv("TTT_BENCH_CAPTURE");
+    if (path) {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::vector<uint16_t> recorded(bytes.size() / 2);
+        memcpy(&recorded[0], &bytes[0], recorded.size() * 2);
+        if (!recorded.empty()) {
+            bench("recorded", recorded, false);
+            bench("recorded", recorded, true);
+        }
+    }
+}
@@ -0,0 +1,208 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "BroadcastRing.h"
+#include "ProducerConsumerQueue.h"
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+
+SCENARIO( "BroadcastRing lag policies", "[broadcast]" ) {
+
+    GIVEN( "A ring with a blocking and a dropping consumer" ) {
+        BroadcastRing<int> ring(4, 4);
+        int block = ring.addConsumer(BroadcastRing<int>::BROADCAST_BLOCK);
+        int drop = ring.addConsumer(BroadcastRing<int>::BROADCAST_DROP_OLDEST);
+        int v;
+
+        WHEN( "the dropping consumer falls behind" ) {
+            for (int i = 0; i < 10; i++) {
+                REQUIRE( ring.write(i) );
+                REQUIRE( ring.read(block, v) == BroadcastRing<int>::READ_OK );
+                REQUIRE( v == i );
+            }
+
+            THEN( "it skips to the oldest record still held" ) {
+                REQUIRE( ring.dropped(drop) == 6 );
+                REQUIRE( ring.read(drop, v) == BroadcastRing<int>::READ_OK );
+                REQUIRE( v == 6 );
+                REQUIRE( ring.sizeGuess(drop) == 3 );
+            }
+        }
+        WHEN( "the blocking consumer falls behind" ) {
+            for (int i = 0; i < 4; i++) {
+                REQUIRE( ring.write(i) );
+            }
+
+            THEN( "the producer is held back until it reads" ) {
+                REQUIRE_FALSE( ring.write(4) );
+                REQUIRE( ring.read(block, v) == BroadcastRing<int>::READ_OK );
+                REQUIRE( ring.write(4) );
+            }
+        }
+    }
+
+    GIVEN( "A consumer that detaches when it lags" ) {
+        BroadcastRing<int> ring(2, 1);
+        int c = ring.addConsumer(BroadcastRing<int>::BROADCAST_DETACH);
+        int v;
+
+        WHEN( "it is lapped" ) {
+            for (int i = 0; i < 3; i++) {
+                REQUIRE( ring.write(i) );
+            }
+
+            THEN( "its reads fail from then on" ) {
+                REQUIRE( ring.detached(c) );
+                REQUIRE( ring.read(c, v) == BroadcastRing<int>::READ_DETACHED );
+            }
+        }
+    }
+
+    GIVEN( "Packet handles broadcast to two consumers" ) {
+        TransferObjectPool pool(8, 64);
+        BroadcastRing<PacketHandle> ring(2, 2);
+        int a = ring.addConsumer(BroadcastRing<PacketHandle>::BROADCAST_BLOCK);
+        int b = ring.addConsumer(BroadcastRing<PacketHandle>::BROADCAST_BLOCK);
+
+        WHEN( "both read the same record" ) {
+            REQUIRE( ring.write(pool.acquire()) );
+            PacketHandle ha, hb;
+            ring.read(a, ha);
+            ring.read(b, hb);
+
+            THEN( "they share one buffer until the ring and both let go" ) {
+                REQUIRE( ha.packet() == hb.packet() );
+                REQUIRE( ha.refCount() == 3 );
+                ha.reset();
+                hb.reset();
+                REQUIRE( pool.available() == 7 );
+                ring.write(pool.acquire());
+                ring.read(a, ha);
+                ring.read(b, hb);
+                ring.write(pool.acquire());
+                REQUIRE( pool.available() == 6 );
+            }
+        }
+    }
+
+    GIVEN( "Consumers on their own threads" ) {
+        BroadcastRing<uint64_t> ring(64, 3);
+        int block1 = ring.addConsumer(BroadcastRing<uint64_t>::BROADCAST_BLOCK);
+        int block2 = ring.addConsumer(BroadcastRing<uint64_t>::BROADCAST_BLOCK);
+        int drop = ring.addConsumer(BroadcastRing<uint64_t>::BROADCAST_DROP_OLDEST);
+        const uint64_t count = 200000;
+        bool inOrder[3] = { true, true, true };
+        uint64_t received[3] = { 0, 0, 0 };
+
+        WHEN( "a stream is written" ) {
+            auto consume = [&](int id) {
+                uint64_t v, expect = 0;
+                while (expect < count) {
+                    auto r = ring.read(id, v);
+                    if (r != BroadcastRing<uint64_t>::READ_OK) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    bool ok = id == drop ? v >= expect : v == expect;
+                    inOrder[id] = inOrder[id] && ok;
+                    received[id]++;
+                    expect = v + 1;
+                }
+            };
+            std::thread t1(consume, block1), t2(consume, block2), t3(consume, drop);
+            for (uint64_t i = 0; i < count; i++) {
+                while (!ring.write(i)) {
+                    std::this_thread::yield();
+                }
+            }
+            t1.join();
+            t2.join();
+            t3.join();
+
+            THEN( "blocking consumers see all of it and the dropping one stays ordered" ) {
+                REQUIRE( inOrder[block1] );
+                REQUIRE( inOrder[block2] );
+                REQUIRE( inOrder[drop] );
+                REQUIRE( received[block1] == count );
+                REQUIRE( received[block2] == count );
+                REQUIRE( received[drop] + ring.dropped(drop) == count );
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "BroadcastRing versus SPSC queues", "[.][bench]" ) {
+    const unsigned consumers = 3;
+    const uint64_t count = 2000000;
+    TransferObjectPool pool(4, 64);
+    PacketHandle h = pool.acquire();
+
+    {
+        BroadcastRing<PacketHandle> ring(1024, consumers);
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < consumers; i++) {
+            int id = ring.addConsumer(BroadcastRing<PacketHandle>::BROADCAST_BLOCK);
+            threads.push_back(std::thread([&ring, id, count]() {
+                PacketHandle p;
+                for (uint64_t n = 0; n < count;) {
+                    if (ring.read(id, p) == BroadcastRing<PacketHandle>::READ_OK) {
+                        n++;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            }));
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < count; i++) {
+            while (!ring.write(h.share())) {
+                std::this_thread::yield();
+            }
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        printf("broadcast ring      %6.1f Mrec/s\n", count / std::chrono::duration<double>(t1 - t0).count() / 1e6);
+    }
+
+    {
+        std::vector<folly::ProducerConsumerQueue<PacketHandle> *> queues;
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < consumers; i++) {
+            queues.push_back(new folly::ProducerConsumerQueue<PacketHandle>(1024));
+            folly::ProducerConsumerQueue<PacketHandle> *q = queues.back();
+            threads.push_back(std::thread([q, count]() {
+                PacketHandle p;
+                for (uint64_t n = 0; n < count;) {
+                    if (q->read(p)) {
+                        n++;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            }));
+        }
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < count; i++) {
+            for (auto q : queues) {
+                while (!q->write(h.share())) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        printf("%u SPSC queues       %6.1f Mrec/s\n", consumers, count / std::chrono::duration<double>(t1 - t0).count() / 1e6);
+        for (auto q : queues) {
+            delete q;
+        }
+    }
+    REQUIRE( h.refCount() == 1 );
+}
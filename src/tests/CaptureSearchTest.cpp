@@ -0,0 +1,277 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "CaptureSearch.h"
+#include "CaptureFile.h"
+#include "Logic16.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+/* A slow bus on channels 0-7 that shows 0xa5 only now and then, noise above */
+static std::vector<uint16_t> bus_samples(size_t count, unsigned seed) {
+    std::vector<uint16_t> samples(count);
+    srand(seed);
+    uint16_t bus = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i % 97 == 0) {
+            bus = rand() % 3000 == 0 ? 0xa5 : rand() % 0x80;
+        }
+        samples[i] = (uint16_t) (bus | (rand() & 0xff00));
+    }
+    return samples;
+}
+
+struct Capture {
+    int id;
+    uint64_t sample;
+    size_t from;
+    size_t count;
+};
+
+struct CaptureFixture {
+    std::vector<uint16_t> samples[2];
+    std::vector<Capture> records;
+    std::string path;
+    std::string indexPath;
+    uint16_t channelMask;
+
+    /* Two devices interleaved, device 1 with a gap; the index is built while writing */
+    CaptureFixture(size_t perDevice, uint64_t chunkSamples, unsigned channels = 16)
+        : channelMask((uint16_t) ((1u << channels) - 1)) {
+        samples[0] = bus_samples(perDevice, 1);
+        samples[1] = bus_samples(perDevice, 2);
+        /* Runs across a record and a chunk boundary */
+        for (size_t i = 4090; i < 4200; i++) {
+            samples[0][i] = (uint16_t) ((samples[0][i] & 0xff00) | 0xa5);
+        }
+        path = "/tmp/ttt_search_test.cap";
+        indexPath = path + ".idx";
+
+        FILE *f = fopen(path.c_str(), "wb");
+        REQUIRE( f );
+        capture_file_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC));
+        header.version = CAPTURE_FILE_VERSION;
+        header.numChannels = channels;
+        header.samplerate = 16000000;
+        fwrite(&header, sizeof(header), 1, f);
+
+        CaptureIndex index(channels, chunkSamples);
+        size_t at[2] = { 0, 0 };
+        size_t size = 1008;
+        while (at[0] < perDevice || at[1] < perDevice) {
+            for (int id = 1; id >= 0; id--) {
+                size_t n = std::min(size, perDevice - at[id]);
+                if (n == 0) {
+                    continue;
+                }
+                uint64_t sample = at[id] + (id == 1 && at[1] >= perDevice / 2 ? 100000 : 0);
+                std::vector<uint8_t> raw = to_logic16(&samples[id][at[id]], n, channels);
+                capture_record_header_t rec = { (uint32_t) raw.size(), id, sample };
+                fwrite(&rec, sizeof(rec), 1, f);
+                fwrite(raw.data(), 1, raw.size(), f);
+                sr_wrap_packet_t packet = { id, raw.data(), (ssize_t) raw.size(), NULL, sample };
+                index.process(&packet);
+                records.push_back(Capture{ id, sample, at[id], n });
+                at[id] += n;
+            }
+            size = size * 5 % 4099 / 16 * 16 + 16;
+        }
+        fclose(f);
+        REQUIRE( index.save(indexPath.c_str()) );
+    }
+
+    ~CaptureFixture() {
+        remove(path.c_str());
+        remove(indexPath.c_str());
+    }
+
+    /* Sample by sample: where the pattern starts to hold, per device in order */
+    std::vector<std::pair<int, uint64_t>> reference(const SearchPattern &p) const {
+        std::vector<std::pair<int, uint64_t>> out;
+        for (int id = 0; id < 2; id++) {
+            bool before = false;
+            uint64_t next = 0;
+            for (auto &r : records) {
+                if (r.id != id) {
+                    continue;
+                }
+                if (r.sample != next) {
+                    before = false;
+                }
+                for (size_t i = 0; i < r.count; i++) {
+                    bool m = (samples[id][r.from + i] & p.mask & channelMask) == (p.value & p.mask & channelMask);
+                    if (m && !before) {
+                        out.push_back(std::make_pair(id, r.sample + i));
+                    }
+                    before = m;
+                }
+                next = r.sample + r.count;
+            }
+        }
+        return out;
+    }
+};
+
+static std::vector<std::pair<int, uint64_t>> run_search(CaptureSearch &search, const SearchPattern &p,
+                                                       unsigned threads) {
+    std::vector<std::pair<int, uint64_t>> found;
+    uint64_t n = search.search(p, threads, [&](int id, uint64_t sample) {
+        found.push_back(std::make_pair(id, sample));
+    });
+    REQUIRE( n == found.size() );
+    return found;
+}
+
+SCENARIO( "Pattern search over a stored capture", "[search]" ) {
+
+    GIVEN( "A capture of two devices with an index written alongside" ) {
+        CaptureFixture fixture(1 << 20, 4096);
+        const SearchPattern patterns[] = {
+            { 0x00a5, 0x00ff }, { 0x0025, 0x00ef }, { 0xa500, 0xff00 }, { 0x80a5, 0x80ff }, { 0, 0 }
+        };
+
+        for (const SearchPattern &p : patterns) {
+            for (unsigned threads : { 1, 4 }) {
+                WHEN( "searching " << std::hex << p.value << "/" << p.mask << std::dec << " on " << threads << " threads" ) {
+                    CaptureSearch search;
+                    REQUIRE( search.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+                    REQUIRE( search.index().chunkSize() == 4096 );
+                    std::vector<std::pair<int, uint64_t>> found = run_search(search, p, threads);
+
+                    THEN( "every run start is reported once, in capture order" ) {
+                        std::vector<std::pair<int, uint64_t>> expect = fixture.reference(p);
+                        REQUIRE( expect.size() > 0 );
+                        REQUIRE( found.size() == expect.size() );
+                        REQUIRE( found == expect );
+                        if (p.mask == 0x00ff) {
+                            /* The rare bus value leaves most chunks out */
+                            REQUIRE( search.skipped() > 4 * search.scanned() );
+                        }
+                    }
+                }
+            }
+        }
+
+        WHEN( "the capture is opened without its index" ) {
+            CaptureSearch search;
+            REQUIRE( search.open(fixture.path.c_str()) );
+            SearchPattern p = { 0x00a5, 0x00ff };
+
+            THEN( "one is built from the file and gives the same results" ) {
+                REQUIRE( search.index().chunkSize() == SEARCH_CHUNK_SAMPLES );
+                REQUIRE( search.index().chunks() > 0 );
+                REQUIRE( run_search(search, p, 2) == fixture.reference(p) );
+            }
+        }
+
+        WHEN( "the index next to it belongs to another capture" ) {
+            CaptureIndex other(16, 4096);
+            std::vector<uint8_t> raw = to_logic16(&fixture.samples[0][0], 1008, 16);
+            other.add(0, 0, raw.data(), raw.size());
+            REQUIRE( other.save(fixture.indexPath.c_str()) );
+            CaptureSearch search;
+            REQUIRE( search.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+            SearchPattern p = { 0x00a5, 0x00ff };
+
+            THEN( "it is ignored and one is built from the file" ) {
+                REQUIRE( search.index().chunkSize() == SEARCH_CHUNK_SAMPLES );
+                REQUIRE( search.index().records() == fixture.records.size() );
+                REQUIRE( run_search(search, p, 2) == fixture.reference(p) );
+            }
+        }
+
+        WHEN( "the index claims more summaries than it holds" ) {
+            FILE *f = fopen(fixture.indexPath.c_str(), "r+b");
+            REQUIRE( f );
+            /* The count field of the header */
+            uint64_t count = UINT64_MAX / 64;
+            fseek(f, 24, SEEK_SET);
+            fwrite(&count, sizeof(count), 1, f);
+            fclose(f);
+
+            THEN( "loading it fails without allocating for them" ) {
+                CaptureIndex index(16);
+                REQUIRE_FALSE( index.load(fixture.indexPath.c_str()) );
+                CaptureSearch search;
+                REQUIRE( search.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+                REQUIRE( search.index().chunkSize() == SEARCH_CHUNK_SAMPLES );
+            }
+        }
+
+        WHEN( "one search opens the capture twice, then files it can not use" ) {
+            CaptureSearch search;
+            SearchPattern p = { 0x00a5, 0x00ff };
+            REQUIRE( search.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+            size_t chunks = search.index().chunks();
+            REQUIRE( search.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+
+            THEN( "the second open replaces the first, and a failed open leaves nothing open" ) {
+                REQUIRE( search.index().chunks() == chunks );
+                REQUIRE( run_search(search, p, 2) == fixture.reference(p) );
+                REQUIRE_FALSE( search.open("/tmp/ttt_search_test.missing", NULL) );
+                REQUIRE( search.index().chunks() == 0 );
+                REQUIRE( run_search(search, p, 2).empty() );
+
+                /* Mapped, then found malformed */
+                REQUIRE( search.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+                FILE *f = fopen("/tmp/ttt_search_test.bad", "wb");
+                REQUIRE( f );
+                std::vector<uint8_t> zeros(4096, 0);
+                fwrite(zeros.data(), 1, zeros.size(), f);
+                fclose(f);
+                REQUIRE_FALSE( search.open("/tmp/ttt_search_test.bad", NULL) );
+                remove("/tmp/ttt_search_test.bad");
+                REQUIRE( search.index().chunks() == 0 );
+                REQUIRE( run_search(search, p, 2).empty() );
+            }
+        }
+    }
+}
+
+SCENARIO( "Pattern search ignores channels the capture does not have", "[search]" ) {
+
+    GIVEN( "A capture of eight channels" ) {
+        CaptureFixture fixture(1 << 18, 4096, 8);
+        const SearchPattern patterns[] = { { 0x0100, 0x0100 }, { 0x01a5, 0x01ff } };
+
+        for (const SearchPattern &p : patterns) {
+            WHEN( "searching " << std::hex << p.value << "/" << p.mask << std::dec << " with and without the index" ) {
+                CaptureSearch indexed, scanned;
+                REQUIRE( indexed.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+                REQUIRE( scanned.open(fixture.path.c_str()) );
+
+                THEN( "both find where the pattern holds on channels 0-7" ) {
+                    std::vector<std::pair<int, uint64_t>> expect = fixture.reference(p);
+                    REQUIRE( expect.size() > 0 );
+                    REQUIRE( run_search(indexed, p, 2) == expect );
+                    REQUIRE( run_search(scanned, p, 2) == expect );
+                }
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Capture search throughput", "[.][bench]" ) {
+    CaptureFixture fixture(64u << 20, SEARCH_CHUNK_SAMPLES);
+    SearchPattern rare = { 0x00a5, 0x00ff }, busy = { 0x0025, 0x006f };
+
+    for (const SearchPattern &p : { rare, busy }) {
+        CaptureSearch search;
+        REQUIRE( search.open(fixture.path.c_str(), fixture.indexPath.c_str()) );
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t n = search.search(p, std::thread::hardware_concurrency(), [](int, uint64_t) {});
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        printf("search %04x/%04x  %7.1f MB/s  %llu matches  %llu chunks skipped  %llu scanned\n", p.value, p.mask,
+               2 * 2 * 64.0 * (1 << 20) / s / 1e6, (unsigned long long) n,
+               (unsigned long long) search.skipped(), (unsigned long long) search.scanned());
+    }
+}
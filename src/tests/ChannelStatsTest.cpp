@@ -0,0 +1,199 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "ChannelStats.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+/* Channel 0 a 12.5 MHz clock, 1 a 30% PWM, 2 random pulses, 3 stuck high */
+static std::vector<uint16_t> board_samples(size_t count, unsigned seed) {
+    std::vector<uint16_t> samples(count);
+    srand(seed);
+    bool random = false;
+    unsigned left = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (--left == 0) {
+            random = !random;
+            left = 1 + rand() % (rand() % 4 == 0 ? 3000 : 40);
+        }
+        samples[i] = (uint16_t) (((i / 4) & 1) | ((i % 1000) < 300) << 1 | random << 2 | 1 << 3);
+    }
+    return samples;
+}
+
+struct Reference {
+    uint64_t high = 0, edges = 0, rising = 0, firstRise = 0, lastRise = 0;
+    std::vector<uint64_t> widths[2];
+};
+
+/* Sample by sample over [from, to), edges after the capture start only */
+static Reference naive_window(const std::vector<uint16_t> &samples, unsigned ch, size_t from, size_t to) {
+    Reference r;
+    size_t lastEdge = SIZE_MAX;
+    for (size_t i = 1; i < to; i++) {
+        unsigned prev = (samples[i - 1] >> ch) & 1, now = (samples[i] >> ch) & 1;
+        if (prev != now) {
+            if (i >= from) {
+                r.edges++;
+                if (now) {
+                    r.firstRise = r.rising++ ? r.firstRise : i;
+                    r.lastRise = i;
+                }
+                if (lastEdge != SIZE_MAX) {
+                    r.widths[now ? 1 : 0].push_back(i - lastEdge);
+                }
+            }
+            lastEdge = i;
+        }
+        if (i >= from) {
+            r.high += now;
+        }
+    }
+    if (from == 0) {
+        r.high += samples[0] >> ch & 1;
+    }
+    for (auto &w : r.widths) {
+        std::sort(w.begin(), w.end());
+    }
+    return r;
+}
+
+static void check_pulses(const PulseSummary &p, const std::vector<uint64_t> &w) {
+    REQUIRE( p.count == w.size() );
+    if (w.empty()) {
+        return;
+    }
+    REQUIRE( p.min == w.front() );
+    REQUIRE( p.max == w.back() );
+    /* Exact below 16 samples, within a bucket above */
+    uint64_t p50 = w[(size_t) ((w.size() - 1) * 0.5)];
+    uint64_t p99 = w[(size_t) ((w.size() - 1) * 0.99)];
+    REQUIRE( ChannelStats::bucket(p.p50) == ChannelStats::bucket(p50) );
+    REQUIRE( (double) p.p99 == Approx((double) p99).epsilon(0.07) );
+}
+
+SCENARIO( "Channel statistics over a sliding window", "[stats]" ) {
+
+    GIVEN( "Pulse width buckets" ) {
+        THEN( "every width falls in the bucket that starts at or below it" ) {
+            for (uint64_t w = 0; w < 100000; w = w * 9 / 8 + 1) {
+                unsigned b = ChannelStats::bucket(w);
+                REQUIRE( ChannelStats::bucketLow(b) <= w );
+                REQUIRE( ChannelStats::bucketLow(b + 1) > w );
+            }
+        }
+    }
+
+    GIVEN( "A clock, a PWM and random pulses in blocks of odd sizes" ) {
+        const uint64_t samplerate = 100000000;
+        std::vector<uint16_t> samples = board_samples(400000, 4);
+        ChannelStatsConfig cfg = { samplerate, 10000, 8, 3 };
+        ChannelStats stats(4, cfg);
+        StatsSnapshot snap;
+        REQUIRE_FALSE( stats.snapshot(snap) );
+
+        Bitplanes bp(4);
+        size_t offset = 0, block = 13;
+        while (offset < samples.size()) {
+            size_t n = std::min(block, samples.size() - offset);
+            bitplane_from_samples(&samples[offset], n, bp);
+            bp.firstSample = offset;
+            stats.add(bp);
+            offset += n;
+            block = block * 7 % 3001 + 16;
+        }
+
+        THEN( "the last snapshot covers the newest slices" ) {
+            REQUIRE( stats.published() == 40 / 3 );
+            REQUIRE( stats.snapshot(snap) );
+            REQUIRE( snap.sample == 390000 );
+            REQUIRE( snap.window == 80000 );
+            REQUIRE( snap.channels == 4 );
+
+            REQUIRE( snap.channel[0].frequency == Approx(12500000.0) );
+            REQUIRE( snap.channel[0].duty == Approx(0.5) );
+            REQUIRE( snap.channel[0].high.p50 == 4 );
+            REQUIRE( snap.channel[1].frequency == Approx(100000.0) );
+            REQUIRE( snap.channel[1].duty == Approx(0.3) );
+            REQUIRE( snap.channel[1].high.min == 300 );
+            REQUIRE( snap.channel[1].low.max == 700 );
+            REQUIRE( snap.channel[3].edges == 0 );
+            REQUIRE( snap.channel[3].duty == 1.0 );
+            REQUIRE( snap.channel[3].frequency == 0 );
+        }
+        THEN( "every channel matches a per-sample reference" ) {
+            REQUIRE( stats.snapshot(snap) );
+            for (unsigned ch = 0; ch < 4; ch++) {
+                INFO( "channel " << ch );
+                Reference r = naive_window(samples, ch, snap.sample - snap.window, snap.sample);
+                const ChannelSummary &c = snap.channel[ch];
+                REQUIRE( c.edges == r.edges );
+                REQUIRE( c.rising == r.rising );
+                REQUIRE( c.duty == Approx((double) r.high / snap.window) );
+                if (r.rising >= 2) {
+                    REQUIRE( c.frequency == Approx((r.rising - 1) * (double) samplerate / (r.lastRise - r.firstRise)) );
+                }
+                check_pulses(c.high, r.widths[0]);
+                check_pulses(c.low, r.widths[1]);
+            }
+        }
+    }
+
+    GIVEN( "Packets with a gap in the sample numbers" ) {
+        std::vector<uint16_t> samples = board_samples(64000, 8);
+        ChannelStatsConfig cfg = { 1000000, 16000, 4, 1 };
+        ChannelStats stats(4, cfg);
+        Bitplanes bp(4);
+
+        bitplane_from_samples(&samples[0], 24000, bp);
+        bp.firstSample = 0;
+        stats.add(bp);
+        bitplane_from_samples(&samples[24000], 40000, bp);
+        bp.firstSample = 100000;
+        stats.add(bp);
+
+        THEN( "the short slice before the gap is closed and no pulse spans the gap" ) {
+            StatsSnapshot snap;
+            REQUIRE( stats.published() == 4 );
+            REQUIRE( stats.snapshot(snap) );
+            REQUIRE( snap.sample == 132000 );
+            REQUIRE( snap.window == 16000 + 8000 + 32000 );
+            REQUIRE( snap.channel[1].high.max == 300 );
+            REQUIRE( snap.channel[1].low.max == 700 );
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Channel statistics throughput", "[.][bench]" ) {
+    std::vector<uint16_t> samples(32u << 20);
+    srand(1);
+    for (size_t i = 0; i < samples.size(); i++) {
+        /* Clocks of several rates on 8 channels, slow lines on the rest */
+        uint16_t v = 0;
+        for (unsigned ch = 0; ch < 8; ch++) {
+            v |= ((i >> (ch + 2)) & 1) << ch;
+        }
+        samples[i] = v | (uint16_t) ((i >> 12) * 2654435761u & 0xff00);
+    }
+    std::vector<uint8_t> raw = to_logic16(samples, 16);
+
+    ChannelStatsConfig cfg = { 100000000, 1000000, 10, 10 };
+    ChannelStats stats(16, cfg);
+    const size_t packetSize = 16 * 2 * 5000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+        sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset / 2 };
+        stats.process(&packet);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    StatsSnapshot snap = StatsSnapshot();
+    REQUIRE( stats.snapshot(snap) );
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    printf("stats 16ch  %7.1f Msamples/s  %u snapshots  ch0 %.3f MHz duty %.2f\n", samples.size() / s / 1e6,
+           stats.published(), snap.channel[0].frequency / 1e6, snap.channel[0].duty);
+}
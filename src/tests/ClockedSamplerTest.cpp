@@ -0,0 +1,178 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "ClockedSampler.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+#define BUS_CLK 0
+#define BUS_EN  15
+
+/* Random bus: the clock toggles every 1 to maxHalf samples, data changes at will */
+static std::vector<uint16_t> bus_samples(size_t count, unsigned maxHalf, unsigned seed) {
+    std::vector<uint16_t> samples(count);
+    srand(seed);
+    bool clk = false;
+    unsigned left = 1;
+    for (auto &s : samples) {
+        if (--left == 0) {
+            clk = !clk;
+            left = 1 + rand() % maxHalf;
+        }
+        s = (uint16_t) ((rand() & ~(1 << BUS_CLK)) | clk << BUS_CLK);
+    }
+    return samples;
+}
+
+/* Sample by sample reference */
+static void naive_clocked(const std::vector<uint16_t> &samples, const ClockedConfig &cfg,
+                          std::vector<uint16_t> &words, std::vector<uint64_t> &at) {
+    for (size_t i = 1; i < samples.size(); i++) {
+        bool prev = (samples[i - 1] >> cfg.clock) & 1, now = (samples[i] >> cfg.clock) & 1;
+        bool hit = (now && !prev && (cfg.edge & EDGE_RISING)) || (!now && prev && (cfg.edge & EDGE_FALLING));
+        if (cfg.enable >= 0) {
+            hit = hit && ((((samples[i] >> cfg.enable) & 1) != 0) != cfg.enableActiveLow);
+        }
+        if (!hit) {
+            continue;
+        }
+        uint16_t v = 0;
+        unsigned k = 0;
+        for (unsigned ch = 0; ch < 16; ch++) {
+            if (cfg.dataMask & (1 << ch)) {
+                v |= ((samples[i] >> ch) & 1) << k++;
+            }
+        }
+        words.push_back(v);
+        at.push_back(i);
+    }
+}
+
+static ClockedConfig bus_config(unsigned edge, uint16_t dataMask, int enable = CLOCKED_NO_ENABLE, bool activeLow = false) {
+    ClockedConfig c;
+    c.clock = BUS_CLK;
+    c.edge = edge;
+    c.dataMask = dataMask;
+    c.enable = enable;
+    c.enableActiveLow = activeLow;
+    return c;
+}
+
+SCENARIO( "Clocked sampling matches a per-sample reference", "[clocked]" ) {
+
+    const unsigned halves[] = { 1, 3, 40 };
+    for (unsigned maxHalf : halves) {
+        GIVEN( "A clock with half periods of up to " << maxHalf << " samples" ) {
+            std::vector<uint16_t> samples = bus_samples(20000, maxHalf, maxHalf);
+            const ClockedConfig configs[] = {
+                bus_config(EDGE_RISING, 0xfffe),
+                bus_config(EDGE_FALLING, 0x7ffe),
+                bus_config(EDGE_BOTH, 0x00f0),
+                bus_config(EDGE_RISING, 0x7ffe, BUS_EN),
+                bus_config(EDGE_BOTH, 0x0a0a, BUS_EN, true),
+            };
+
+            WHEN( "the samples are sampled in blocks of odd sizes" ) {
+                for (auto &cfg : configs) {
+                    std::vector<uint16_t> expectWords, words;
+                    std::vector<uint64_t> expectAt, at;
+                    naive_clocked(samples, cfg, expectWords, expectAt);
+
+                    ClockedSampler sampler(cfg);
+                    Bitplanes bp(16);
+                    size_t offset = 0, block = 1;
+                    while (offset < samples.size()) {
+                        size_t n = std::min(block, samples.size() - offset);
+                        bitplane_from_samples(&samples[offset], n, bp);
+                        bp.firstSample = offset;
+                        sampler.sample(bp, words, at);
+                        offset += n;
+                        block = block * 5 % 701 + 1;
+                    }
+
+                    INFO( "edge " << cfg.edge << " mask " << cfg.dataMask << " enable " << cfg.enable );
+                    REQUIRE( sampler.bits() == (unsigned) __builtin_popcount(cfg.dataMask) );
+                    REQUIRE( at.size() == expectAt.size() );
+                    REQUIRE( at == expectAt );
+                    REQUIRE( words == expectWords );
+                }
+            }
+        }
+    }
+
+    GIVEN( "A clock that is high on the first sample" ) {
+        std::vector<uint16_t> samples(256, 0);
+        for (size_t i = 0; i < 100; i++) {
+            samples[i] = 1 << BUS_CLK;
+        }
+        samples[64] |= 0x8000;
+        samples[100] |= 0x0006;
+
+        THEN( "the first sample is not an edge, the next one is" ) {
+            ClockedSampler sampler(bus_config(EDGE_BOTH, 0x8006));
+            Bitplanes bp(16);
+            std::vector<uint16_t> words;
+            std::vector<uint64_t> at;
+            bitplane_from_samples(samples.data(), samples.size(), bp);
+            bp.firstSample = 1000;
+            REQUIRE( sampler.sample(bp, words, at) == 1 );
+            REQUIRE( at[0] == 1100 );
+            REQUIRE( words[0] == 0x3 );
+        }
+    }
+
+    GIVEN( "All 16 channels in Logic16 packets" ) {
+        std::vector<uint16_t> samples = bus_samples(16 * 3000, 2, 9);
+        std::vector<uint8_t> raw = to_logic16(samples, 16);
+        ClockedConfig cfg = bus_config(EDGE_RISING, 0xfffe);
+
+        THEN( "packets give the same words as the reference" ) {
+            std::vector<uint16_t> expectWords, words;
+            std::vector<uint64_t> expectAt, at;
+            naive_clocked(samples, cfg, expectWords, expectAt);
+
+            ClockedSampler sampler(cfg);
+            for (size_t offset = 0; offset < raw.size(); offset += 32 * 37) {
+                size_t size = std::min<size_t>(32 * 37, raw.size() - offset);
+                sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset / 2 };
+                sampler.process(&packet);
+                words.insert(words.end(), sampler.words().begin(), sampler.words().end());
+                at.insert(at.end(), sampler.samples().begin(), sampler.samples().end());
+            }
+            REQUIRE( at == expectAt );
+            REQUIRE( words == expectWords );
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Clocked sampler throughput", "[.][bench]" ) {
+    const unsigned halves[] = { 2, 8, 100 };
+    for (unsigned maxHalf : halves) {
+        std::vector<uint16_t> samples = bus_samples(16u << 20, maxHalf, 5);
+        std::vector<uint8_t> raw = to_logic16(samples, 16);
+        ClockedSampler sampler(bus_config(EDGE_RISING, 0xfffe));
+        const size_t packetSize = 16 * 2 * 5000;
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<uint16_t> words;
+        std::vector<uint64_t> at;
+        naive_clocked(samples, bus_config(EDGE_RISING, 0xfffe), words, at);
+        auto t1 = std::chrono::steady_clock::now();
+        size_t total = 0;
+        for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+            sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset / 2 };
+            total += sampler.process(&packet);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double s0 = std::chrono::duration<double>(t1 - t0).count();
+        double s1 = std::chrono::duration<double>(t2 - t1).count();
+        printf("clocked 16ch half<=%-3u naive %7.1f Msamples/s  planes %7.1f Msamples/s  %zu words\n",
+               maxHalf, samples.size() / s0 / 1e6, samples.size() / s1 / 1e6, total);
+    }
+}
@@ -0,0 +1,176 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "GlitchDetector.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+/* Random lines with spikes and dropouts of 1 to 80 samples */
+static std::vector<uint16_t> glitchy_samples(size_t count, unsigned seed) {
+    std::vector<uint16_t> samples(count);
+    srand(seed);
+    uint16_t v = 0;
+    for (size_t i = 0; i < count;) {
+        uint16_t bit = (uint16_t) (1 << (rand() % 16));
+        v ^= bit;
+        size_t run = 1 + rand() % 80;
+        for (size_t k = 0; k < run && i < count; k++) {
+            samples[i++] = v;
+        }
+        /* Every other edge is followed back by the same line */
+        if (rand() % 2) {
+            v ^= bit;
+        }
+    }
+    return samples;
+}
+
+static bool glitch_order(const Glitch &a, const Glitch &b) {
+    return a.channel != b.channel ? a.channel < b.channel : a.sample < b.sample;
+}
+
+/* Sample by sample: every pulse between two seen edges, narrower than the threshold */
+static std::vector<Glitch> reference(const std::vector<uint16_t> &samples, const std::vector<size_t> &gaps,
+                                     const unsigned *thresholds) {
+    std::vector<Glitch> out;
+    for (unsigned ch = 0; ch < 16; ch++) {
+        size_t lastEdge = SIZE_MAX;
+        for (size_t i = 1; i < samples.size(); i++) {
+            if (std::find(gaps.begin(), gaps.end(), i) != gaps.end()) {
+                lastEdge = SIZE_MAX;
+                continue;
+            }
+            unsigned prev = (samples[i - 1] >> ch) & 1, now = (samples[i] >> ch) & 1;
+            if (prev == now) {
+                continue;
+            }
+            if (lastEdge != SIZE_MAX && i - lastEdge < thresholds[ch]) {
+                out.push_back(Glitch{ lastEdge, (uint32_t) (i - lastEdge), (uint8_t) ch, (uint8_t) prev });
+            }
+            lastEdge = i;
+        }
+    }
+    return out;
+}
+
+SCENARIO( "Glitches match a per-sample reference", "[glitch]" ) {
+
+    GIVEN( "Random lines with per-channel thresholds in blocks of odd sizes" ) {
+        std::vector<uint16_t> samples = glitchy_samples(200000, 6);
+        const unsigned thresholds[16] = { 2, 3, 4, 5, 8, 16, 17, 31, 32, 33, 63, 64, 0, 1, 3, 50 };
+        /* Samples 120000 on are numbered as if 5000 were lost */
+        const size_t gapAt = 120000, lost = 5000;
+        GlitchDetector detector(16);
+        for (unsigned ch = 0; ch < 16; ch++) {
+            detector.setThreshold(ch, thresholds[ch]);
+        }
+
+        std::vector<Glitch> found;
+        Bitplanes bp(16);
+        size_t offset = 0, block = 7;
+        while (offset < samples.size()) {
+            size_t n = std::min(block, samples.size() - offset);
+            if (offset < gapAt) {
+                n = std::min(n, gapAt - offset);
+            }
+            bitplane_from_samples(&samples[offset], n, bp);
+            bp.firstSample = offset + (offset >= gapAt ? lost : 0);
+            detector.add(bp, found);
+            offset += n;
+            block = block * 11 % 997 + 1;
+        }
+
+        THEN( "the same pulses are reported with their start, width and level" ) {
+            std::vector<Glitch> expect = reference(samples, { gapAt }, thresholds);
+            for (auto &g : expect) {
+                g.sample += g.sample >= gapAt ? lost : 0;
+            }
+            std::stable_sort(found.begin(), found.end(), glitch_order);
+            REQUIRE( expect.size() > 500 );
+            REQUIRE( found.size() == expect.size() );
+            for (size_t i = 0; i < expect.size(); i++) {
+                INFO( "glitch " << i << " channel " << (int) expect[i].channel );
+                REQUIRE( found[i].sample == expect[i].sample );
+                REQUIRE( found[i].width == expect[i].width );
+                REQUIRE( found[i].channel == expect[i].channel );
+                REQUIRE( found[i].level == expect[i].level );
+            }
+        }
+        THEN( "totals add up per channel" ) {
+            REQUIRE( detector.glitches() == found.size() );
+            REQUIRE( detector.samples() == samples.size() );
+            for (unsigned ch = 0; ch < 16; ch++) {
+                uint64_t high = 0, low = 0;
+                uint32_t narrowest = 0;
+                for (auto &g : found) {
+                    if (g.channel == ch) {
+                        (g.level ? high : low)++;
+                        narrowest = narrowest && narrowest < g.width ? narrowest : g.width;
+                    }
+                }
+                INFO( "channel " << ch );
+                REQUIRE( detector.totals(ch).high == high );
+                REQUIRE( detector.totals(ch).low == low );
+                REQUIRE( detector.totals(ch).narrowest == narrowest );
+            }
+            REQUIRE( detector.totals(12).high + detector.totals(12).low == 0 );
+            REQUIRE( detector.totals(13).high + detector.totals(13).low == 0 );
+        }
+    }
+
+    GIVEN( "A clean clock with a single one-sample spike" ) {
+        std::vector<uint16_t> samples(4096);
+        for (size_t i = 0; i < samples.size(); i++) {
+            samples[i] = (uint16_t) ((i / 8) & 1);
+        }
+        samples[1000] ^= 2;
+        GlitchDetector detector(2);
+        Bitplanes bp(2);
+        bitplane_from_samples(samples.data(), samples.size(), bp);
+        bp.firstSample = 0;
+        std::vector<Glitch> found;
+
+        THEN( "only the spike is reported, and a pulse at the capture start is not" ) {
+            REQUIRE( detector.add(bp, found) == 1 );
+            REQUIRE( found[0].sample == 1000 );
+            REQUIRE( found[0].width == 1 );
+            REQUIRE( found[0].channel == 1 );
+            REQUIRE( found[0].level == 1 );
+            REQUIRE( detector.totals(1).lastSample == 1000 );
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Glitch detector throughput", "[.][bench]" ) {
+    std::vector<uint16_t> samples(32u << 20);
+    srand(2);
+    for (size_t i = 0; i < samples.size(); i++) {
+        uint16_t v = 0;
+        for (unsigned ch = 0; ch < 8; ch++) {
+            v |= ((i >> (ch + 2)) & 1) << ch;
+        }
+        samples[i] = v | (uint16_t) ((i >> 12) * 2654435761u & 0xff00);
+        if (rand() % 100000 == 0) {
+            samples[i] ^= (uint16_t) (1 << (rand() % 16));
+        }
+    }
+    std::vector<uint8_t> raw = to_logic16(samples, 16);
+
+    GlitchDetector detector(16, 3);
+    std::vector<Glitch> found;
+    const size_t packetSize = 16 * 2 * 5000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+        sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset / 2 };
+        detector.process(&packet, found);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    printf("glitch 16ch  %7.1f Msamples/s  %llu glitches\n", samples.size() / s / 1e6,
+           (unsigned long long) detector.glitches());
+}
@@ -0,0 +1,61 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "HistoryRing.h"
+
+static void push_packets(HistoryRing &ring, TransferObjectPool &pool, int n, uint64_t samplesPerPacket) {
+    for (int i = 0; i < n; i++) {
+        PacketHandle packet = pool.acquire();
+        packet->sample = i * samplesPerPacket;
+        ring.push(std::move(packet));
+    }
+}
+
+SCENARIO( "HistoryRing keeps a bounded window of transfers", "[history]" ) {
+
+    GIVEN( "A pool and a five second history at 1 kHz" ) {
+        TransferObjectPool pool(20, 1024);
+        HistoryRing ring(3, 1000, 5.0, 8);
+
+        WHEN( "twelve one second packets arrive" ) {
+            push_packets(ring, pool, 12, 1000);
+
+            THEN( "only the last five seconds are held" ) {
+                REQUIRE( ring.buffers() == 5 );
+                REQUIRE( ring.span() == 5000 );
+                REQUIRE( pool.available() == 15 );
+            }
+
+            AND_WHEN( "a trigger freezes the window before it" ) {
+                HistoryWindow window = ring.freeze(10500, 2000);
+
+                THEN( "the overlapping buffers are handed over without copies" ) {
+                    REQUIRE( window.id == 3 );
+                    REQUIRE( window.buffers.size() == 3 );
+                    REQUIRE( window.firstSample == 8000 );
+                    REQUIRE( ring.buffers() == 0 );
+                    REQUIRE( pool.available() == 17 );
+
+                    window.buffers.clear();
+                    REQUIRE( pool.available() == 20 );
+                }
+            }
+        }
+    }
+
+    GIVEN( "A long history limited by buffer count" ) {
+        TransferObjectPool pool(20, 1024);
+        HistoryRing ring(0, 1000, 3600.0, 8);
+
+        WHEN( "more packets arrive than it may hold" ) {
+            push_packets(ring, pool, 12, 1000);
+
+            THEN( "the oldest buffers go back to the pool" ) {
+                REQUIRE( ring.buffers() == 8 );
+                REQUIRE( pool.available() == 12 );
+            }
+        }
+    }
+}
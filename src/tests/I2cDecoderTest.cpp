@@ -0,0 +1,357 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "I2cDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+#define I2C_SCL 0
+#define I2C_SDA 1
+
+/* Master and slave on an open drain bus, quarter clock periods of q samples */
+struct I2cWave {
+    unsigned q;
+    bool scl, sda;
+    std::vector<uint16_t> samples;
+
+    explicit I2cWave(unsigned q = 3) : q(q), scl(true), sda(true) {}
+
+    void hold(unsigned n) {
+        uint16_t v = scl << I2C_SCL | sda << I2C_SDA | 0xf0;
+        samples.insert(samples.end(), n, v);
+    }
+    void idle(unsigned n) { hold(n); }
+    /* From idle or after a byte, SCL low: a repeated START first releases both */
+    uint64_t start() {
+        if (!scl) {
+            sda = true; hold(q);
+            scl = true; hold(q);
+        }
+        sda = false;
+        uint64_t at = samples.size();
+        hold(2 * q);
+        scl = false; hold(q);
+        return at;
+    }
+    uint64_t stop() {
+        sda = false; hold(q);
+        scl = true; hold(2 * q);
+        sda = true;
+        uint64_t at = samples.size();
+        hold(2 * q);
+        return at;
+    }
+    void bit(bool b) {
+        sda = b; hold(q);
+        scl = true; hold(2 * q);
+        scl = false; hold(q);
+    }
+    void byte(uint8_t b, bool ack) {
+        for (int k = 7; k >= 0; k--) {
+            bit((b >> k) & 1);
+        }
+        bit(!ack);
+    }
+};
+
+/* Sample by sample reference */
+static void naive_i2c(const std::vector<uint16_t> &samples, std::vector<I2cTransaction> &out, std::vector<uint8_t> &data) {
+    bool scl = true, sda = true, active = false, clocked = false, level = false;
+    I2cTransaction t = I2cTransaction();
+    unsigned bits = 0, bytes = 0, shift = 0;
+    /* The full 10-bit address of the transaction, and one a read after Sr continues */
+    bool known = false;
+    int pending = -1;
+    for (size_t i = 0; i < samples.size(); i++) {
+        bool c = (samples[i] >> I2C_SCL) & 1, d = (samples[i] >> I2C_SDA) & 1;
+        if (scl && c && sda != d) {
+            pending = active && known && !d ? t.address : -1;
+            known = false;
+            if (active && bytes) {
+                t.end = i;
+                t.flags |= (d ? 0 : I2C_FLAG_RESTART) | (bits ? I2C_FLAG_PARTIAL : 0);
+                out.push_back(t);
+            }
+            active = !d;
+            clocked = false;
+            t = I2cTransaction();
+            t.start = i;
+            t.dataOffset = (uint32_t) data.size();
+            bits = bytes = shift = 0;
+        } else if (!scl && c) {
+            clocked = active;
+            level = d;
+        } else if (scl && !c && clocked) {
+            clocked = false;
+            if (bits < 8) {
+                shift = (shift << 1 | level) & 0xff;
+                bits++;
+            } else {
+                if (bytes == 0) {
+                    bool ten = (shift & 0xf8) == 0xf0;
+                    t.address = ten ? (shift >> 1 & 3) << 8 : shift >> 1;
+                    t.flags = (shift & 1 ? I2C_FLAG_READ : 0) | (level ? I2C_FLAG_NACK : 0) | (ten ? I2C_FLAG_TENBIT : 0);
+                    if (ten && (shift & 1) && pending >= 0 && pending >> 8 == t.address >> 8) {
+                        t.address = (uint16_t) pending;
+                        known = true;
+                    }
+                } else if (bytes == 1 && (t.flags & I2C_FLAG_TENBIT) && !(t.flags & I2C_FLAG_READ)) {
+                    t.address |= shift;
+                    known = true;
+                } else {
+                    data.push_back(shift);
+                    t.length++;
+                    t.acked += !level;
+                }
+                bytes++;
+                bits = shift = 0;
+            }
+        }
+        scl = c;
+        sda = d;
+    }
+}
+
+static void decode_blocks(I2cDecoder &d, const std::vector<uint16_t> &samples, size_t first) {
+    Bitplanes bp(8);
+    size_t offset = 0, block = first;
+    while (offset < samples.size()) {
+        size_t n = std::min(block, samples.size() - offset);
+        bitplane_from_samples(&samples[offset], n, bp);
+        bp.firstSample = offset;
+        d.decode(bp);
+        offset += n;
+        block = block * 7 % 1013 + 1;
+    }
+}
+
+static void random_traffic(I2cWave &w, size_t transactions) {
+    const uint8_t devices[] = { 0x50, 0x51, 0x68, 0x1d, 0x3c };
+    const uint16_t wide[] = { 0x2a5, 0x0f3 };
+    for (size_t k = 0; k < transactions; k++) {
+        w.start();
+        if (rand() % 6 == 0) {
+            /* 10-bit write header; a read repeats only the top bits after Sr */
+            uint16_t addr = wide[rand() % 2];
+            uint8_t high = (uint8_t) (0xf0 | (addr >> 8) << 1);
+            w.byte(high, true);
+            w.byte((uint8_t) addr, true);
+            if (rand() & 1) {
+                w.start();
+                w.byte((uint8_t) (high | 1), true);
+            }
+        } else {
+            uint8_t addr = devices[rand() % 5];
+            w.byte((uint8_t) (addr << 1 | (rand() & 1)), rand() % 8 != 0);
+        }
+        unsigned n = rand() % 6;
+        for (unsigned i = 0; i < n; i++) {
+            w.byte((uint8_t) rand(), i + 1 < n || rand() & 1);
+        }
+        if (rand() % 4 == 0) {
+            continue;
+        }
+        w.stop();
+        w.idle(rand() % 300);
+    }
+    w.stop();
+}
+
+SCENARIO( "I2C transactions are decoded with their addresses", "[i2c]" ) {
+
+    GIVEN( "An EEPROM write, a register read with repeated START and a 10-bit write" ) {
+        I2cWave w;
+        w.idle(100);
+        uint64_t s0 = w.start();
+        w.byte(0x50 << 1, true);
+        w.byte(0x00, true);
+        w.byte(0x10, true);
+        w.byte(0xab, true);
+        uint64_t e0 = w.stop();
+        w.idle(77);
+        uint64_t s1 = w.start();
+        w.byte(0x68 << 1, true);
+        w.byte(0x75, true);
+        uint64_t s2 = w.start();
+        w.byte(0x68 << 1 | 1, true);
+        w.byte(0x71, true);
+        w.byte(0x19, false);
+        uint64_t e2 = w.stop();
+        w.idle(40);
+        w.start();
+        w.byte(0x22 << 1, false);
+        w.stop();
+        w.start();
+        w.byte(0xf0 | 2 << 1, true);
+        w.byte(0xa5, true);
+        w.byte(0x42, true);
+        w.stop();
+        w.idle(64);
+
+        WHEN( "the capture is decoded in odd blocks" ) {
+            I2cDecoder d(I2C_SCL, I2C_SDA);
+            decode_blocks(d, w.samples, 61);
+
+            THEN( "every transaction carries its address, data and acknowledges" ) {
+                REQUIRE( d.transactions() == 5 );
+                const I2cTransaction &a = d.transaction(0);
+                CHECK( a.start == s0 );
+                CHECK( a.end == e0 );
+                CHECK( a.address == 0x50 );
+                CHECK( a.flags == 0 );
+                REQUIRE( a.length == 3 );
+                CHECK( a.acked == 3 );
+                CHECK( d.data(a)[0] == 0x00 );
+                CHECK( d.data(a)[1] == 0x10 );
+                CHECK( d.data(a)[2] == 0xab );
+
+                const I2cTransaction &b = d.transaction(1);
+                CHECK( b.start == s1 );
+                CHECK( b.end == s2 );
+                CHECK( b.flags == I2C_FLAG_RESTART );
+                CHECK( b.length == 1 );
+
+                const I2cTransaction &c = d.transaction(2);
+                CHECK( c.end == e2 );
+                CHECK( c.address == 0x68 );
+                CHECK( c.flags == I2C_FLAG_READ );
+                REQUIRE( c.length == 2 );
+                CHECK( c.acked == 1 );
+                CHECK( d.data(c)[1] == 0x19 );
+
+                CHECK( d.transaction(3).address == 0x22 );
+                CHECK( d.transaction(3).flags == I2C_FLAG_NACK );
+                CHECK( d.transaction(4).address == 0x2a5 );
+                CHECK( d.transaction(4).flags == I2C_FLAG_TENBIT );
+                CHECK( d.data(d.transaction(4))[0] == 0x42 );
+            }
+            THEN( "the index answers per address and direction" ) {
+                REQUIRE( d.find(0x50, false) == std::vector<uint32_t>{ 0 } );
+                REQUIRE( d.find(0x50, true).empty() );
+                REQUIRE( d.find(0x68, false) == std::vector<uint32_t>{ 1 } );
+                REQUIRE( d.find(0x68, true) == std::vector<uint32_t>{ 2 } );
+                REQUIRE( d.find(0x2a5, false, true) == std::vector<uint32_t>{ 4 } );
+                REQUIRE( d.find(0x25, false).empty() );
+                REQUIRE( d.find(0x400, false, true).empty() );
+            }
+        }
+    }
+
+    GIVEN( "Random traffic with NACKs and transactions cut by repeated STARTs" ) {
+        srand(17);
+        I2cWave w(2);
+        w.idle(50);
+        random_traffic(w, 600);
+        std::vector<I2cTransaction> expect;
+        std::vector<uint8_t> data;
+        naive_i2c(w.samples, expect, data);
+
+        const size_t blocks[] = { w.samples.size(), 1, 64, 127 };
+        for (size_t first : blocks) {
+            WHEN( "decoded in odd blocks, the first of " << first << " samples" ) {
+                I2cDecoder d(I2C_SCL, I2C_SDA);
+                decode_blocks(d, w.samples, first);
+
+                THEN( "transactions and data match the per-sample reference" ) {
+                    REQUIRE( d.transactions() == expect.size() );
+                    for (size_t i = 0; i < expect.size(); i++) {
+                        const I2cTransaction &t = d.transaction(i);
+                        INFO( "transaction " << i );
+                        REQUIRE( t.start == expect[i].start );
+                        REQUIRE( t.end == expect[i].end );
+                        REQUIRE( t.address == expect[i].address );
+                        REQUIRE( t.flags == expect[i].flags );
+                        REQUIRE( t.length == expect[i].length );
+                        REQUIRE( t.acked == expect[i].acked );
+                        REQUIRE( std::equal(d.data(t), d.data(t) + t.length, &data[expect[i].dataOffset]) );
+                    }
+                }
+                THEN( "the index lists what a scan over the transactions finds" ) {
+                    for (unsigned addr = 0; addr < 128; addr++) {
+                        for (int read = 0; read < 2; read++) {
+                            std::vector<uint32_t> scan;
+                            for (size_t i = 0; i < expect.size(); i++) {
+                                if (!(expect[i].flags & I2C_FLAG_TENBIT) && expect[i].address == addr &&
+                                    !!(expect[i].flags & I2C_FLAG_READ) == !!read) {
+                                    scan.push_back((uint32_t) i);
+                                }
+                            }
+                            REQUIRE( d.find((uint16_t) addr, read != 0) == scan );
+                        }
+                    }
+                    for (unsigned addr = 0; addr < 1024; addr++) {
+                        for (int read = 0; read < 2; read++) {
+                            std::vector<uint32_t> scan;
+                            for (size_t i = 0; i < expect.size(); i++) {
+                                if ((expect[i].flags & I2C_FLAG_TENBIT) && expect[i].address == addr &&
+                                    !!(expect[i].flags & I2C_FLAG_READ) == !!read) {
+                                    scan.push_back((uint32_t) i);
+                                }
+                            }
+                            REQUIRE( d.find((uint16_t) addr, read != 0, true) == scan );
+                        }
+                    }
+                    /* 10-bit reads are filed under the full address */
+                    REQUIRE_FALSE( d.find(0x2a5, true, true).empty() );
+                    REQUIRE_FALSE( d.find(0x0f3, true, true).empty() );
+                }
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "I2C decoder throughput", "[.][bench]" ) {
+    srand(7);
+    I2cWave w(10);
+    while (w.samples.size() < (32u << 20)) {
+        random_traffic(w, 16);
+        w.idle(2000);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<I2cTransaction> reference;
+    std::vector<uint8_t> data;
+    naive_i2c(w.samples, reference, data);
+    auto t1 = std::chrono::steady_clock::now();
+
+    const size_t block = 160256;
+    I2cDecoder d(I2C_SCL, I2C_SDA);
+    Bitplanes bp(8);
+    double decode = 0;
+    for (size_t offset = 0; offset < w.samples.size(); offset += block) {
+        size_t n = std::min(block, w.samples.size() - offset);
+        bitplane_from_samples(&w.samples[offset], n, bp);
+        bp.firstSample = offset;
+        auto a = std::chrono::steady_clock::now();
+        d.decode(bp);
+        decode += std::chrono::duration<double>(std::chrono::steady_clock::now() - a).count();
+    }
+
+    /* All writes to one device: index lookup against a scan */
+    auto t2 = std::chrono::steady_clock::now();
+    size_t scanned = 0;
+    for (int rep = 0; rep < 100; rep++) {
+        for (size_t i = 0; i < d.transactions(); i++) {
+            const I2cTransaction &t = d.transaction(i);
+            scanned += t.address == 0x50 && !(t.flags & I2C_FLAG_READ);
+        }
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (int rep = 0; rep < 100; rep++) {
+        found += d.find(0x50, false).size();
+    }
+    auto t4 = std::chrono::steady_clock::now();
+    REQUIRE( found == scanned );
+
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    printf("I2C naive   %7.1f Msamples/s  %zu transactions\n", w.samples.size() / s / 1e6, reference.size());
+    printf("I2C planes  %7.1f Msamples/s  %zu transactions\n", w.samples.size() / decode / 1e6, d.transactions());
+    printf("I2C writes to 0x50: scan %.2f us  index %.3f us\n",
+           std::chrono::duration<double>(t3 - t2).count() * 1e4,
+           std::chrono::duration<double>(t4 - t3).count() * 1e4);
+}
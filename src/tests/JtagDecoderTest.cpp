@@ -0,0 +1,310 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "JtagDecoder.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+#define J_TCK 0
+#define J_TMS 1
+#define J_TDI 2
+#define J_TDO 3
+
+struct ExpectedScan {
+    uint8_t type;
+    uint64_t start;
+    uint64_t end;
+    std::vector<bool> tdi;
+    std::vector<bool> tdo;
+};
+
+/* Host and target on a JTAG port, half TCK periods of h samples */
+struct JtagWave {
+    unsigned h;
+    bool tck = false, tms = true, tdi = false, tdo = false;
+    JtagState state = JTAG_TEST_LOGIC_RESET;
+    std::vector<uint16_t> samples;
+    std::vector<ExpectedScan> expect;
+
+    explicit JtagWave(unsigned h = 2) : h(h) {}
+
+    void hold(unsigned n) {
+        uint16_t v = tck << J_TCK | tms << J_TMS | tdi << J_TDI | tdo << J_TDO | 0xf0;
+        samples.insert(samples.end(), n, v);
+    }
+    /* One TCK cycle, returns the sample of its rising edge */
+    uint64_t cycle(bool m, bool in = false, bool out = false) {
+        tck = false;
+        tms = m; tdi = in; tdo = out;
+        hold(h);
+        tck = true;
+        uint64_t at = samples.size();
+        hold(h);
+        JtagState n = JtagDecoder::next(state, m);
+        if (n == JTAG_TEST_LOGIC_RESET && state != JTAG_TEST_LOGIC_RESET) {
+            expect.push_back({ JTAG_RESET, at, at, {}, {} });
+        }
+        state = n;
+        return at;
+    }
+    void reset() { for (int i = 0; i < 5; i++) cycle(true); }
+    void idle(unsigned n) { for (unsigned i = 0; i < n; i++) cycle(false); }
+
+    /* From Run-Test/Idle through a scan and back, pausing after some bits */
+    void scan(bool ir, const std::vector<bool> &in, const std::vector<bool> &out, size_t pauseAt = 0, unsigned pause = 0) {
+        ExpectedScan e = { (uint8_t) (ir ? JTAG_SCAN_IR : JTAG_SCAN_DR), 0, 0, in, out };
+        cycle(true);
+        if (ir) {
+            cycle(true);
+        }
+        cycle(false);
+        /* Capture, then Shift unless there is nothing to shift */
+        e.start = cycle(in.empty());
+        for (size_t i = 0; i < in.size(); i++) {
+            bool last = i + 1 == in.size();
+            bool pauseHere = pause && i + 1 == pauseAt && !last;
+            cycle(last || pauseHere, in[i], out[i]);
+            if (pauseHere) {
+                for (unsigned p = 0; p < pause; p++) {
+                    cycle(false);
+                }
+                cycle(true);
+                cycle(false);
+            }
+        }
+        cycle(true);
+        e.end = cycle(false);
+        expect.push_back(e);
+    }
+};
+
+static std::vector<bool> random_bits(size_t n) {
+    std::vector<bool> v(n);
+    for (size_t i = 0; i < n; i++) {
+        v[i] = rand() & 1;
+    }
+    return v;
+}
+
+static std::vector<bool> word_bits(uint64_t value, unsigned n) {
+    std::vector<bool> v(n);
+    for (unsigned i = 0; i < n; i++) {
+        v[i] = (value >> i) & 1;
+    }
+    return v;
+}
+
+static JtagConfig jtag_config() {
+    JtagConfig c;
+    c.tck = J_TCK;
+    c.tms = J_TMS;
+    c.tdi = J_TDI;
+    c.tdo = J_TDO;
+    return c;
+}
+
+static std::vector<bool> scan_bits(const JtagDecoder &d, const JtagScan &s, bool out) {
+    std::vector<bool> v;
+    for (size_t i = 0; i < s.bits; i += 64) {
+        unsigned n = (unsigned) std::min<size_t>(64, s.bits - i);
+        uint64_t w = out ? d.tdo(s, i, n) : d.tdi(s, i, n);
+        for (unsigned k = 0; k < n; k++) {
+            v.push_back((w >> k) & 1);
+        }
+    }
+    return v;
+}
+
+static void random_session(JtagWave &w, size_t scans) {
+    w.reset();
+    w.idle(3);
+    for (size_t k = 0; k < scans; k++) {
+        unsigned kind = rand() % 10;
+        if (kind == 0) {
+            w.reset();
+            w.idle(1 + rand() % 4);
+        } else if (kind < 4) {
+            size_t n = 4 + rand() % 5;
+            w.scan(true, random_bits(n), random_bits(n));
+        } else {
+            size_t n = rand() % 8 == 0 ? 1 + rand() % 3000 : rand() % 80;
+            w.scan(false, random_bits(n), random_bits(n), n ? 1 + rand() % n : 0, rand() % 3 ? 0 : 1 + rand() % 20);
+            w.idle(rand() % 3);
+        }
+    }
+}
+
+static void check_scans(const JtagDecoder &d, const std::vector<ExpectedScan> &expect) {
+    REQUIRE( d.scans().size() == expect.size() );
+    for (size_t i = 0; i < expect.size(); i++) {
+        const JtagScan &s = d.scans()[i];
+        INFO( "scan " << i );
+        REQUIRE( s.type == expect[i].type );
+        REQUIRE( s.start == expect[i].start );
+        REQUIRE( s.end == expect[i].end );
+        REQUIRE( s.bits == expect[i].tdi.size() );
+        REQUIRE( scan_bits(d, s, false) == expect[i].tdi );
+        REQUIRE( scan_bits(d, s, true) == expect[i].tdo );
+    }
+}
+
+SCENARIO( "The TAP state machine follows TMS", "[jtag]" ) {
+
+    GIVEN( "Five cycles of TMS high from any state" ) {
+        THEN( "the TAP is in Test-Logic-Reset" ) {
+            for (unsigned s = 0; s < JTAG_STATES; s++) {
+                JtagState state = (JtagState) s;
+                for (int i = 0; i < 5; i++) {
+                    state = JtagDecoder::next(state, 1);
+                }
+                INFO( JtagDecoder::name((JtagState) s) );
+                REQUIRE( state == JTAG_TEST_LOGIC_RESET );
+            }
+        }
+    }
+
+    GIVEN( "An IDCODE read after reset and an IR scan selecting BYPASS" ) {
+        JtagWave w;
+        w.reset();
+        w.idle(2);
+        w.scan(false, word_bits(0, 32), word_bits(0x4ba00477, 32));
+        w.scan(true, word_bits(0xf, 4), word_bits(0x1, 4));
+        w.scan(false, word_bits(0xa5, 8), word_bits(0x4a, 8), 3, 5);
+        w.idle(4);
+
+        WHEN( "decoded in one block" ) {
+            JtagDecoder d(jtag_config());
+            Bitplanes bp(8);
+            bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+            bp.firstSample = 0;
+            d.decode(bp);
+
+            THEN( "every scan is there with its bits" ) {
+                REQUIRE( d.scans().size() == 3 );
+                REQUIRE( d.scans()[0].type == JTAG_SCAN_DR );
+                REQUIRE( d.tdo(d.scans()[0], 0, 32) == 0x4ba00477 );
+                REQUIRE( d.scans()[1].type == JTAG_SCAN_IR );
+                REQUIRE( d.tdi(d.scans()[1], 0, 4) == 0xf );
+                REQUIRE( d.tdi(d.scans()[2], 0, 8) == 0xa5 );
+                REQUIRE( d.tdo(d.scans()[2], 2, 6) == 0x12 );
+                REQUIRE( d.state() == JTAG_RUN_TEST_IDLE );
+                check_scans(d, w.expect);
+            }
+        }
+    }
+}
+
+SCENARIO( "JTAG scans decode across blocks", "[jtag]" ) {
+
+    srand(21);
+    JtagWave w;
+    w.idle(3);
+    random_session(w, 400);
+
+    const size_t blocks[] = { 1, 64, 333 };
+    for (size_t first : blocks) {
+        GIVEN( "Random scans with pauses and resets, blocks from " << first << " samples" ) {
+            JtagDecoder d(jtag_config());
+            Bitplanes bp(8);
+            size_t offset = 0, block = first;
+            while (offset < w.samples.size()) {
+                size_t n = std::min(block, w.samples.size() - offset);
+                bitplane_from_samples(&w.samples[offset], n, bp);
+                bp.firstSample = offset;
+                d.decode(bp);
+                offset += n;
+                block = block * 7 % 4099 + 1;
+            }
+
+            THEN( "scans and bits are those sent" ) {
+                check_scans(d, w.expect);
+            }
+        }
+    }
+
+    GIVEN( "The session as Logic16 packets" ) {
+        std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+
+        THEN( "each packet's scans can be read before the next clears them" ) {
+            JtagDecoder d(jtag_config());
+            size_t seen = 0;
+            for (size_t offset = 0; offset < raw.size(); offset += 16 * 40) {
+                size_t size = std::min<size_t>(16 * 40, raw.size() - offset);
+                sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset };
+                d.process(&packet);
+                for (auto &s : d.scans()) {
+                    REQUIRE( seen < w.expect.size() );
+                    REQUIRE( s.start == w.expect[seen].start );
+                    REQUIRE( scan_bits(d, s, true) == w.expect[seen].tdo );
+                    seen++;
+                }
+            }
+            /* The last scans may be cut off with the partial packet */
+            REQUIRE( seen + 2 >= w.expect.size() );
+        }
+    }
+}
+
+/* Sample by sample, one TAP step per cycle */
+static size_t naive_jtag(const std::vector<uint16_t> &samples, std::vector<bool> &tdi, std::vector<bool> &tdo) {
+    JtagState state = JTAG_TEST_LOGIC_RESET;
+    size_t scans = 0;
+    bool tck = false;
+    for (size_t i = 0; i < samples.size(); i++) {
+        bool now = (samples[i] >> J_TCK) & 1;
+        if (now && !tck) {
+            if (state == JTAG_SHIFT_DR || state == JTAG_SHIFT_IR) {
+                tdi.push_back((samples[i] >> J_TDI) & 1);
+                tdo.push_back((samples[i] >> J_TDO) & 1);
+            }
+            scans += state == JTAG_UPDATE_DR || state == JTAG_UPDATE_IR;
+            state = JtagDecoder::next(state, (samples[i] >> J_TMS) & 1);
+        }
+        tck = now;
+    }
+    return scans;
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "JTAG decoder throughput", "[.][bench]" ) {
+    srand(3);
+    JtagWave w(2);
+    w.reset();
+    w.idle(2);
+    while (w.samples.size() < (32u << 20)) {
+        w.scan(true, random_bits(8), random_bits(8));
+        size_t n = 2000 + rand() % 2000;
+        w.scan(false, random_bits(n), random_bits(n));
+        w.idle(rand() % 10);
+    }
+
+    std::vector<bool> tdi, tdo;
+    auto t0 = std::chrono::steady_clock::now();
+    size_t reference = naive_jtag(w.samples, tdi, tdo);
+    auto t1 = std::chrono::steady_clock::now();
+
+    const size_t block = 160256;
+    JtagDecoder d(jtag_config());
+    Bitplanes bp(8);
+    double decode = 0;
+    size_t scans = 0;
+    for (size_t offset = 0; offset < w.samples.size(); offset += block) {
+        size_t n = std::min(block, w.samples.size() - offset);
+        bitplane_from_samples(&w.samples[offset], n, bp);
+        bp.firstSample = offset;
+        auto a = std::chrono::steady_clock::now();
+        d.clear();
+        d.decode(bp);
+        decode += std::chrono::duration<double>(std::chrono::steady_clock::now() - a).count();
+        scans += d.scans().size();
+    }
+    REQUIRE( scans == reference );
+
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    printf("JTAG naive  %7.1f Msamples/s  %zu scans\n", w.samples.size() / s / 1e6, reference);
+    printf("JTAG table  %7.1f Msamples/s  %zu scans\n", w.samples.size() / decode / 1e6, scans);
+}
@@ -0,0 +1,88 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "LatestValue.h"
+#include <thread>
+#include <vector>
+
+/* Every field holds the publish count, a torn read mixes two of them */
+struct Counters {
+    uint64_t a;
+    uint32_t b;
+    uint16_t c[11];
+};
+
+SCENARIO( "LatestValue hands out whole values", "[latest]" ) {
+
+    GIVEN( "A value nothing was published to" ) {
+        LatestValue<Counters> latest;
+        Counters v;
+
+        THEN( "reads fail" ) {
+            REQUIRE_FALSE( latest.read(v) );
+            REQUIRE( latest.version() == 0 );
+        }
+        WHEN( "two values are published" ) {
+            latest.publish(Counters{ 1, 1, { 1 } });
+            latest.publish(Counters{ 2, 2, { 2, 2 } });
+
+            THEN( "only the last one is seen" ) {
+                REQUIRE( latest.read(v) );
+                REQUIRE( v.a == 2 );
+                REQUIRE( v.c[1] == 2 );
+                REQUIRE( v.c[2] == 0 );
+                REQUIRE( latest.version() == 2 );
+            }
+        }
+    }
+
+    GIVEN( "One writer publishing as fast as it can" ) {
+        LatestValue<Counters> latest;
+        const uint32_t count = 200000;
+
+        THEN( "readers never see a torn or older value" ) {
+            std::thread writer([&]() {
+                for (uint32_t n = 1; n <= count; n++) {
+                    Counters v;
+                    v.a = n;
+                    v.b = n;
+                    for (auto &c : v.c) {
+                        c = (uint16_t) n;
+                    }
+                    latest.publish(v);
+                }
+            });
+            std::vector<std::thread> readers;
+            std::vector<int> torn(3, 0), backwards(3, 0);
+            for (int r = 0; r < 3; r++) {
+                readers.emplace_back([&, r]() {
+                    uint64_t last = 0;
+                    Counters v;
+                    while (last < count) {
+                        if (!latest.read(v)) {
+                            continue;
+                        }
+                        bool same = v.b == v.a;
+                        for (auto c : v.c) {
+                            same = same && c == (uint16_t) v.a;
+                        }
+                        torn[r] += !same;
+                        backwards[r] += v.a < last;
+                        last = v.a;
+                    }
+                });
+            }
+            writer.join();
+            for (auto &t : readers) {
+                t.join();
+            }
+            for (int r = 0; r < 3; r++) {
+                REQUIRE( torn[r] == 0 );
+                REQUIRE( backwards[r] == 0 );
+            }
+            REQUIRE( latest.version() == count );
+        }
+    }
+}
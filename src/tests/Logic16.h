@@ -0,0 +1,26 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#ifndef TTT_LOGIC16_H
+#define TTT_LOGIC16_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Bitplane.h"
+
+/* Interleaved sample words as Logic16 transfer data, whole 16-sample blocks only */
+inline std::vector<uint8_t> to_logic16(const uint16_t *samples, size_t count, unsigned channels) {
+    Bitplanes bp(channels);
+    bitplane_from_samples(samples, count - count % 16, bp);
+    std::vector<uint8_t> raw(count / 16 * 2 * channels);
+    bitplane_to_logic16(bp, raw.data());
+    return raw;
+}
+
+inline std::vector<uint8_t> to_logic16(const std::vector<uint16_t> &samples, unsigned channels) {
+    return to_logic16(samples.data(), samples.size(), channels);
+}
+
+#endif //TTT_LOGIC16_H
@@ -0,0 +1,117 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "MergeQueue.h"
+#include <thread>
+
+static PacketHandle packet_at(TransferObjectPool &pool, int id, uint64_t sample) {
+    PacketHandle h = pool.acquire();
+    h->id = id;
+    h->sample = sample;
+    return h;
+}
+
+SCENARIO( "MergeQueue orders devices by sample time", "[merge]" ) {
+
+    GIVEN( "Two devices at different samplerates" ) {
+        TransferObjectPool pool(16, 64);
+        MergeQueue merge(2, 8);
+        merge.setSamplerate(0, 16000000);
+        merge.setSamplerate(1, 8000000);
+        PacketHandle out;
+
+        WHEN( "only one lane has data" ) {
+            merge.push(0, packet_at(pool, 0, 1000));
+
+            THEN( "nothing is released until the other lane vouches for it" ) {
+                REQUIRE_FALSE( merge.pop(out) );
+                merge.advance(1, 499);
+                REQUIRE_FALSE( merge.pop(out) );
+                merge.advance(1, 500);
+                REQUIRE( merge.pop(out) );
+                REQUIRE( out->sample == 1000 );
+            }
+        }
+        WHEN( "both lanes deliver" ) {
+            /* Device 1 sample 600 is at 75 us, device 0 sample 1000 at 62.5 us */
+            merge.push(0, packet_at(pool, 0, 1000));
+            merge.push(0, packet_at(pool, 0, 2000));
+            merge.push(1, packet_at(pool, 1, 600));
+            merge.push(1, packet_at(pool, 1, 700));
+            merge.close(0);
+            merge.close(1);
+
+            THEN( "packets come out in time order without copies" ) {
+                int ids[4];
+                uint64_t samples[4];
+                for (int i = 0; i < 4; i++) {
+                    REQUIRE( merge.pop(out) );
+                    ids[i] = out->id;
+                    samples[i] = out->sample;
+                }
+                REQUIRE( ids[0] == 0 );
+                REQUIRE( samples[0] == 1000 );
+                REQUIRE( samples[1] == 600 );
+                REQUIRE( samples[2] == 700 );
+                REQUIRE( samples[3] == 2000 );
+                REQUIRE_FALSE( merge.pop(out) );
+                REQUIRE( merge.drained() );
+                out.reset();
+                REQUIRE( pool.available() == 16 );
+            }
+        }
+    }
+
+    GIVEN( "Three producer threads" ) {
+        TransferObjectPool pool(64, 16);
+        MergeQueue merge(3, 16);
+        const uint64_t perLane = 5000;
+
+        WHEN( "they push concurrently" ) {
+            std::vector<std::thread> producers;
+            for (unsigned lane = 0; lane < 3; lane++) {
+                merge.setSamplerate(lane, 1000 * (lane + 1));
+                producers.push_back(std::thread([&merge, &pool, lane, perLane]() {
+                    for (uint64_t i = 0; i < perLane; i++) {
+                        PacketHandle h;
+                        while (!(h = pool.acquire())) {
+                            std::this_thread::yield();
+                        }
+                        h->id = lane;
+                        h->sample = i * 10 * (lane + 1) + lane;
+                        while (!merge.push(lane, std::move(h))) {
+                            std::this_thread::yield();
+                        }
+                    }
+                    merge.close(lane);
+                }));
+            }
+
+            double last = -1;
+            bool ordered = true;
+            uint64_t received = 0;
+            PacketHandle out;
+            while (!merge.drained()) {
+                if (merge.pop(out)) {
+                    double t = (double) out->sample / (1000 * (out->id + 1));
+                    ordered = ordered && t >= last;
+                    last = t;
+                    received++;
+                    out.reset();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            for (auto &t : producers) {
+                t.join();
+            }
+
+            THEN( "the merged stream is complete and time ordered" ) {
+                REQUIRE( ordered );
+                REQUIRE( received == 3 * perLane );
+            }
+        }
+    }
+}
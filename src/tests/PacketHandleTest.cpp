@@ -0,0 +1,87 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "PacketHandle.h"
+#include <chrono>
+#include <stdio.h>
+
+#define TRANSFER_OBJ_BUF_SIZE 160256
+
+SCENARIO( "PacketHandle shares pooled transfers", "[handle]" ) {
+
+    GIVEN( "A handle to a pooled transfer" ) {
+        TransferObjectPool pool(4, TRANSFER_OBJ_BUF_SIZE);
+        PacketHandle h = pool.acquire();
+
+        REQUIRE( h );
+        REQUIRE( h.refCount() == 1 );
+        REQUIRE( pool.available() == 3 );
+
+        WHEN( "it is shared with two consumers" ) {
+            PacketHandle a = h.share();
+            PacketHandle b = a.share();
+
+            THEN( "all of them see the same buffer" ) {
+                REQUIRE( h.refCount() == 3 );
+                REQUIRE( a->data == h->data );
+                REQUIRE( b.packet() == h.packet() );
+            }
+            AND_WHEN( "the consumers release in any order" ) {
+                h.reset();
+                b.reset();
+                REQUIRE( pool.available() == 3 );
+                a.reset();
+
+                THEN( "the transfer returns to the pool after the last one" ) {
+                    REQUIRE( pool.available() == 4 );
+                }
+            }
+        }
+        WHEN( "it is moved" ) {
+            PacketHandle moved = std::move(h);
+
+            THEN( "ownership moves without counting" ) {
+                REQUIRE_FALSE( h );
+                REQUIRE( moved.refCount() == 1 );
+            }
+        }
+    }
+
+    GIVEN( "An exhausted pool" ) {
+        TransferObjectPool pool(1, TRANSFER_OBJ_BUF_SIZE);
+        PacketHandle h = pool.acquire();
+
+        THEN( "acquire returns an empty handle" ) {
+            REQUIRE_FALSE( pool.acquire() );
+        }
+    }
+
+    GIVEN( "A packet outside any pool" ) {
+        uint8_t data[16];
+        sr_wrap_packet_t packet = { 0, data, sizeof(data), NULL, 0 };
+        PacketHandle h(&packet);
+
+        THEN( "shares are not counted" ) {
+            PacketHandle s = h.share();
+            REQUIRE( s->data == data );
+            REQUIRE( s.refCount() == 0 );
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "PacketHandle share/release cost", "[.][bench]" ) {
+    TransferObjectPool pool(4, 64);
+    PacketHandle h = pool.acquire();
+    const int rounds = 10000000;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        PacketHandle s = h.share();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    printf("share+release %.1f ns\n", std::chrono::duration<double, std::nano>(t1 - t0).count() / rounds);
+    REQUIRE( h.refCount() == 1 );
+}
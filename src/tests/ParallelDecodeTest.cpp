@@ -0,0 +1,145 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "ParallelDecode.h"
+#include <chrono>
+#include <random>
+#include <stdio.h>
+
+/* Reports high pulses on channel 0; sloppy resyncs without looking */
+struct PulseDecoder {
+    struct State {
+        bool high;
+        size_t rise;
+        bool operator == (const State &o) const {
+            return high == o.high && (!high || rise == o.rise);
+        }
+    };
+    struct Event {
+        size_t rise;
+        size_t fall;
+    };
+
+    bool sloppy;
+
+    State initialState() const {
+        State s = { false, 0 };
+        return s;
+    }
+
+    size_t resync(const Bitplanes &bp, size_t from, size_t to, State &state) const {
+        state = initialState();
+        if (sloppy) {
+            return from;
+        }
+        /* The state at i holds the level of sample i - 1 */
+        for (size_t i = from; i < to; i++) {
+            if (i > 0 && !bp.bit(0, i - 1)) {
+                return i;
+            }
+        }
+        return to;
+    }
+
+    State decode(const Bitplanes &bp, size_t from, size_t to, State state, std::vector<Event> &out) const {
+        for (size_t i = from; i < to; i++) {
+            bool level = bp.bit(0, i);
+            if (level && !state.high) {
+                state.rise = i;
+            } else if (!level && state.high) {
+                Event e = { state.rise, i };
+                out.push_back(e);
+            }
+            state.high = level;
+        }
+        return state;
+    }
+};
+
+static void random_pulses(Bitplanes &bp, size_t samples, size_t maxRun, unsigned seed) {
+    std::mt19937 rng(seed);
+    bp.reset(samples);
+    bool level = false;
+    for (size_t i = 0; i < samples;) {
+        size_t run = 1 + rng() % maxRun;
+        for (size_t k = 0; k < run && i < samples; k++, i++) {
+            if (level) {
+                bp.plane(0)[i >> 6] |= (uint64_t) 1 << (i & 63);
+            }
+        }
+        level = !level;
+    }
+}
+
+static bool same(const std::vector<PulseDecoder::Event> &a, const std::vector<PulseDecoder::Event> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].rise != b[i].rise || a[i].fall != b[i].fall) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SCENARIO( "Chunk parallel decode matches a sequential one", "[paralleldecode]" ) {
+
+    GIVEN( "A capture of random pulses" ) {
+        Bitplanes bp(1);
+        random_pulses(bp, 100000, 300, 7);
+        PulseDecoder decoder = { false };
+        std::vector<PulseDecoder::Event> expect;
+        decoder.decode(bp, 0, bp.samples(), decoder.initialState(), expect);
+        ParallelDecodeStats stats;
+
+        WHEN( "chunks resync on an idle line" ) {
+            auto events = parallel_decode(decoder, bp, 4, 1000, &stats);
+
+            THEN( "every guess holds and the events match" ) {
+                REQUIRE( same(events, expect) );
+                REQUIRE( stats.chunks == 100 );
+                REQUIRE( stats.redecoded == 0 );
+            }
+        }
+        WHEN( "chunks start blind" ) {
+            decoder.sloppy = true;
+            auto events = parallel_decode(decoder, bp, 4, 1000, &stats);
+
+            THEN( "chunks that started mid pulse are decoded again" ) {
+                REQUIRE( same(events, expect) );
+                REQUIRE( stats.redecoded > 0 );
+                REQUIRE( stats.redecoded < stats.chunks );
+            }
+        }
+        WHEN( "pulses outlast whole chunks" ) {
+            random_pulses(bp, 100000, 5000, 9);
+            expect.clear();
+            decoder.decode(bp, 0, bp.samples(), decoder.initialState(), expect);
+            auto events = parallel_decode(decoder, bp, 3, 1000, &stats);
+
+            THEN( "chunks without a resync point fold into their neighbour" ) {
+                REQUIRE( same(events, expect) );
+                REQUIRE( stats.redecoded == 0 );
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Chunk parallel decode scaling", "[.][bench]" ) {
+    Bitplanes bp(1);
+    random_pulses(bp, (size_t) 64 << 20, 200, 1);
+    PulseDecoder decoder = { false };
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto events = parallel_decode(decoder, bp, threads, 1 << 20);
+        auto t1 = std::chrono::steady_clock::now();
+        printf("%2u threads  %7.1f Msamples/s  %zu pulses\n", threads,
+               bp.samples() / std::chrono::duration<double>(t1 - t0).count() / 1e6, events.size());
+    }
+}
@@ -0,0 +1,108 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "Pipeline.h"
+#include <chrono>
+#include <thread>
+
+SCENARIO( "Pipeline moves packets through its stages", "[pipeline]" ) {
+
+    GIVEN( "A two thread convert stage feeding a sink" ) {
+        TransferObjectPool pool(64, 16);
+        Pipeline pipeline;
+        std::atomic<int> converted(0);
+        uint64_t next[2] = { 0, 0 };
+        bool inOrder = true;
+
+        int convert = pipeline.addStage("convert", Pipeline::SOURCE, [&](PacketHandle &p) {
+            p->size = 1;
+            converted++;
+            return true;
+        }, 8, 2);
+        int sink = pipeline.addStage("sink", convert, [&](PacketHandle &p) {
+            inOrder = inOrder && p->size == 1 && p->sample == next[p->id]++;
+            return false;
+        }, 8);
+
+        WHEN( "two devices stream through it" ) {
+            pipeline.start();
+            for (uint64_t i = 0; i < 1000; i++) {
+                for (int id = 0; id < 2; id++) {
+                    /* A refused packet is gone, send it again */
+                    for (;;) {
+                        PacketHandle h = pool.acquire();
+                        if (h) {
+                            h->id = id;
+                            h->sample = i;
+                            if (pipeline.push(std::move(h))) {
+                                break;
+                            }
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            pipeline.stop();
+
+            THEN( "every packet arrives, each device in order, and buffers return" ) {
+                REQUIRE( converted == 2000 );
+                REQUIRE( inOrder );
+                REQUIRE( next[0] == 1000 );
+                REQUIRE( next[1] == 1000 );
+                REQUIRE( pipeline.metrics(sink).processed == 2000 );
+                REQUIRE( pipeline.metrics(sink).occupancy == 0 );
+                REQUIRE( pool.available() == 64 );
+            }
+        }
+    }
+
+    GIVEN( "A stalled sink next to a non-critical decoder" ) {
+        TransferObjectPool pool(256, 16);
+        Pipeline pipeline;
+        std::atomic<bool> stalled(true);
+
+        int convert = pipeline.addStage("convert", Pipeline::SOURCE, [](PacketHandle &) {
+            return true;
+        }, 4);
+        int sink = pipeline.addStage("sink", convert, [&](PacketHandle &) {
+            while (stalled) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            return false;
+        }, 4);
+        int decode = pipeline.addStage("decode", convert, [](PacketHandle &) {
+            return false;
+        }, 4, 1, false);
+
+        WHEN( "the source keeps pushing" ) {
+            pipeline.start();
+            int accepted = 0;
+            for (int i = 0; i < 200; i++) {
+                PacketHandle h = pool.acquire();
+                h->id = 0;
+                if (pipeline.push(std::move(h))) {
+                    accepted++;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            bool degraded = pipeline.degraded();
+            StageMetrics c = pipeline.metrics(convert);
+            stalled = false;
+            pipeline.stop();
+
+            THEN( "the source is refused, not blocked, and decode is shed first" ) {
+                REQUIRE( accepted < 200 );
+                REQUIRE( degraded );
+                REQUIRE( c.dropped == (uint64_t) (200 - accepted) );
+                REQUIRE( c.occupancy == 4 );
+                REQUIRE( c.peakOccupancy == 4 );
+                REQUIRE( pipeline.metrics(decode).dropped > 0 );
+                REQUIRE( pipeline.metrics(sink).stallNs > 0 );
+                REQUIRE( pipeline.metrics(sink).processed == (uint64_t) accepted );
+                REQUIRE( pool.available() == 256 );
+            }
+        }
+    }
+}
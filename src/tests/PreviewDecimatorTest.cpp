@@ -0,0 +1,138 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "PreviewDecimator.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+/* Slow lines with single-sample glitches */
+static std::vector<uint16_t> preview_samples(size_t count, unsigned seed) {
+    std::vector<uint16_t> samples(count);
+    srand(seed);
+    uint16_t v = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (rand() % 50 == 0) {
+            v ^= (uint16_t) (1 << (rand() % 16));
+        }
+        samples[i] = v;
+        if (rand() % 400 == 0) {
+            samples[i] ^= (uint16_t) (1 << (rand() % 16));
+        }
+    }
+    return samples;
+}
+
+SCENARIO( "Preview envelopes match a per-sample reference", "[preview]" ) {
+
+    GIVEN( "Lines with glitches fed in packets of odd sizes" ) {
+        std::vector<uint16_t> samples = preview_samples(16 * 6000, 4);
+        struct Case { unsigned channels; uint64_t perPoint; unsigned framePoints; } cases[] = {
+            { 16, 1, 500 }, { 16, 7, 300 }, { 16, 16, 200 }, { 8, 40, 100 }, { 3, 64, 50 }, { 16, 1000, 20 }, { 9, 23, 77 }
+        };
+
+        for (auto &c : cases) {
+            WHEN( c.channels << " channels, " << c.perPoint << " samples per point" ) {
+                PreviewConfig cfg = { 100000000, 100000000 / c.perPoint, c.framePoints };
+                PreviewDecimator preview(c.channels, cfg);
+                REQUIRE( preview.samplesPerPoint() == c.perPoint );
+                std::vector<uint8_t> raw = to_logic16(samples.data(), samples.size(), c.channels);
+                const size_t blockBytes = 2 * c.channels;
+                const uint16_t mask = (uint16_t) ((1u << c.channels) - 1);
+
+                size_t offset = 0, blocks = 3;
+                uint32_t frames = 0;
+                bool checked = true;
+                while (offset < raw.size() && checked) {
+                    size_t size = std::min(raw.size() - offset, blocks * blockBytes);
+                    preview.add(offset / blockBytes * 16, &raw[offset], size);
+                    offset += size;
+                    blocks = blocks * 7 % 113 + 1;
+
+                    /* Every frame published since the last packet is the newest one at most */
+                    if (preview.published() == frames) {
+                        continue;
+                    }
+                    frames = preview.published();
+                    PreviewFrame frame;
+                    REQUIRE( preview.frame(frame) );
+                    REQUIRE( frame.points == c.framePoints );
+                    REQUIRE( frame.channels == c.channels );
+                    for (unsigned i = 0; i < frame.points && checked; i++) {
+                        uint16_t lo = mask, hi = 0;
+                        for (uint64_t s = frame.sample + i * c.perPoint; s < frame.sample + (i + 1) * c.perPoint; s++) {
+                            lo &= samples[s];
+                            hi |= samples[s] & mask;
+                        }
+                        checked = frame.min[i] == lo && frame.max[i] == hi;
+                        INFO( "frame at " << frame.sample << " point " << i );
+                        REQUIRE( frame.min[i] == lo );
+                        REQUIRE( frame.max[i] == hi );
+                    }
+                }
+
+                THEN( "every whole frame came out" ) {
+                    REQUIRE( checked );
+                    REQUIRE( frames == samples.size() / c.perPoint / c.framePoints );
+                }
+            }
+        }
+    }
+
+    GIVEN( "A gap in the middle of a point" ) {
+        std::vector<uint16_t> samples(16 * 100, 0);
+        samples[40] = 1;
+        samples[70] = 2;
+        std::vector<uint8_t> raw = to_logic16(samples.data(), samples.size(), 8);
+        PreviewConfig cfg = { 6400, 100, 100 };
+        PreviewDecimator preview(8, cfg);
+        preview.add(0, raw.data(), 16 * 6);
+        preview.add(5000, raw.data() + 16 * 6, 16 * 4);
+
+        THEN( "the short point and the frame so far are published" ) {
+            PreviewFrame frame;
+            REQUIRE( preview.published() == 1 );
+            REQUIRE( preview.frame(frame) );
+            REQUIRE( frame.sample == 0 );
+            REQUIRE( frame.points == 2 );
+            REQUIRE( frame.max[0] == 1 );
+            REQUIRE( frame.min[0] == 0 );
+            REQUIRE( frame.max[1] == 2 );
+        }
+        THEN( "points after the gap start from the new data" ) {
+            PreviewFrame frame;
+            preview.add(5064, raw.data() + 16 * 10, 16 * 90);
+            preview.add(20000, raw.data(), 16);
+            REQUIRE( preview.published() == 2 );
+            REQUIRE( preview.frame(frame) );
+            REQUIRE( frame.sample == 5000 );
+            REQUIRE( frame.points == 24 );
+            REQUIRE( frame.max[0] == 0 );
+            REQUIRE( frame.min[0] == 0 );
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Preview decimator throughput", "[.][bench]" ) {
+    std::vector<uint16_t> samples = preview_samples(16u << 20, 7);
+    std::vector<uint8_t> raw = to_logic16(samples.data(), samples.size(), 16);
+    const size_t packetSize = 160256 / 32 * 32;
+
+    for (uint64_t perPoint : { 1000, 40, 5 }) {
+        PreviewConfig cfg = { 100000000, 100000000 / perPoint, 4000 };
+        PreviewDecimator preview(16, cfg);
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+            sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset / 2 };
+            preview.process(&packet);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        printf("preview 16ch /%-4llu  %7.1f Msamples/s  %u frames\n", (unsigned long long) perPoint,
+               samples.size() / s / 1e6, preview.published());
+    }
+}
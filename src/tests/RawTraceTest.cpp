@@ -0,0 +1,191 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "raw_trace.h"
+#include "ReplaySource.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+/* Sample by sample: keep every decimation-th one, move the selected bits down */
+static std::vector<uint8_t> reference(const std::vector<uint16_t> &samples, unsigned channels,
+                                      uint16_t mask, unsigned decimation) {
+    std::vector<uint16_t> kept;
+    unsigned selected = 0;
+    for (size_t i = 0; i < samples.size(); i += decimation) {
+        uint16_t v = 0;
+        selected = 0;
+        for (unsigned ch = 0; ch < channels; ch++) {
+            if (mask & (1 << ch)) {
+                v |= ((samples[i] >> ch) & 1) << selected++;
+            }
+        }
+        kept.push_back(v);
+    }
+    return to_logic16(kept, selected);
+}
+
+static std::vector<uint16_t> random_samples(size_t count, unsigned seed) {
+    std::vector<uint16_t> samples(count);
+    srand(seed);
+    for (auto &s : samples) {
+        s = (uint16_t) rand();
+    }
+    return samples;
+}
+
+struct ReplayedRecord {
+    uint64_t sample;
+    std::vector<uint8_t> data;
+};
+
+static std::vector<ReplayedRecord> replayed;
+
+static void replay_recv(sr_wrap_packet_t *packet) {
+    ReplayedRecord r;
+    r.sample = packet->sample;
+    r.data.assign(packet->data, packet->data + packet->size);
+    replayed.push_back(r);
+}
+
+SCENARIO( "Channel selection and decimation match a per-sample reference", "[raw]" ) {
+
+    GIVEN( "Random samples cut into packets of odd sizes" ) {
+        std::vector<uint16_t> samples = random_samples(16 * 1000, 3);
+        const unsigned channelCounts[] = { 8, 4, 16 };
+        const uint16_t masks[] = { 0xffff, 0x0001, 0x00a5, 0x0f0e };
+        const unsigned factors[] = { 1, 2, 3, 4, 5, 8, 16, 32 };
+
+        for (unsigned channels : channelCounts) {
+            std::vector<uint8_t> raw = to_logic16(samples, channels);
+            for (uint16_t mask : masks) {
+                if ((mask & ((1 << channels) - 1)) == 0) {
+                    continue;
+                }
+                for (unsigned factor : factors) {
+                    RawSampler sampler(channels, mask, factor);
+                    std::vector<uint8_t> out(sampler.outputBound(raw.size()));
+                    size_t n = 0, offset = 0, blocks = 1;
+                    while (offset < raw.size()) {
+                        size_t size = std::min(raw.size() - offset, blocks * sampler.inputBlock());
+                        n += sampler.sample(&raw[offset], size, &out[n]);
+                        offset += size;
+                        blocks = blocks * 7 % 61 + 1;
+                    }
+                    out.resize(n);
+
+                    INFO( "channels " << channels << " mask " << mask << " decimation " << factor );
+                    std::vector<uint8_t> expect = reference(samples, channels, mask, factor);
+                    /* Only whole output blocks come out */
+                    expect.resize(expect.size() - expect.size() % sampler.outputBlock());
+                    REQUIRE( out.size() == expect.size() );
+                    REQUIRE( out == expect );
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "Raw traces replay as captures of the reduced stream", "[raw]" ) {
+
+    GIVEN( "Packets with a gap, written through small buffers" ) {
+        std::vector<uint16_t> samples = random_samples(16 * 4000, 5);
+        std::vector<uint8_t> raw = to_logic16(samples, 8);
+        const char *path = "/tmp/ttt_raw_trace_test.cap";
+        /* Channels 1, 2 and 6 at a quarter of the rate */
+        RawTrace trace(8, 0x46, 4, 16000000, 1024);
+        REQUIRE( trace.open(path) );
+
+        /* The second half is recorded as if 1600 samples were lost */
+        const size_t half = raw.size() / 2;
+        const uint64_t gap = 1600;
+        size_t offset = 0, blocks = 3;
+        while (offset < raw.size()) {
+            size_t size = std::min(raw.size() - offset, blocks * 16);
+            if (offset < half) {
+                size = std::min(size, half - offset);
+            }
+            sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset + (offset >= half ? gap : 0) };
+            trace.process(&packet);
+            offset += size;
+            blocks = blocks * 5 % 97 + 1;
+        }
+        REQUIRE( trace.close() );
+
+        WHEN( "the file is replayed" ) {
+            replayed.clear();
+            ReplaySource source(replay_recv);
+            REQUIRE( source.open(path) );
+            source.run(ReplaySource::REPLAY_FAST);
+            remove(path);
+
+            THEN( "records hold the reference data at the decimated sample positions" ) {
+                std::vector<uint16_t> first(samples.begin(), samples.begin() + half);
+                std::vector<uint16_t> second(samples.begin() + half, samples.end());
+                std::vector<uint8_t> a = reference(first, 8, 0x46, 4);
+                std::vector<uint8_t> b = reference(second, 8, 0x46, 4);
+
+                /* Several buffers went out, the gap splits a record */
+                REQUIRE( replayed.size() > 4 );
+                std::vector<uint8_t> before, after;
+                uint64_t expectSample = 0;
+                bool gapSeen = false;
+                for (auto &r : replayed) {
+                    if (r.sample != expectSample) {
+                        REQUIRE_FALSE( gapSeen );
+                        REQUIRE( r.sample == (half + gap) / 4 );
+                        gapSeen = true;
+                    }
+                    (gapSeen ? after : before).insert((gapSeen ? after : before).end(), r.data.begin(), r.data.end());
+                    expectSample = r.sample + r.data.size() / 6 * 16;
+                }
+                REQUIRE( gapSeen );
+                REQUIRE( before == a );
+                REQUIRE( after == b );
+                REQUIRE( trace.total() == a.size() + b.size() );
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Raw trace throughput", "[.][bench]" ) {
+    std::vector<uint16_t> samples = random_samples(16u << 20, 9);
+    std::vector<uint8_t> raw = to_logic16(samples, 8);
+    const size_t packetSize = 160256;
+    struct Config { uint16_t mask; unsigned decimation; } configs[] = {
+        { 0xff, 1 }, { 0x0f, 1 }, { 0xff, 4 }, { 0x03, 3 }
+    };
+
+    for (auto &c : configs) {
+        RawSampler sampler(8, c.mask, c.decimation);
+        std::vector<uint8_t> out(sampler.outputBound(packetSize));
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+            sampler.sample(&raw[offset], packetSize, out.data());
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        RawTrace trace(8, c.mask, c.decimation);
+        const char *path = "/tmp/ttt_raw_trace_bench.cap";
+        REQUIRE( trace.open(path) );
+        auto t2 = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+            sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset };
+            trace.process(&packet);
+        }
+        REQUIRE( trace.close() );
+        auto t3 = std::chrono::steady_clock::now();
+        remove(path);
+
+        double s0 = std::chrono::duration<double>(t1 - t0).count();
+        double s1 = std::chrono::duration<double>(t3 - t2).count();
+        printf("raw mask %02x /%u  sampler %7.1f Msamples/s  trace to file %7.1f Msamples/s  %llu stalls\n",
+               c.mask, c.decimation, samples.size() / s0 / 1e6, samples.size() / s1 / 1e6,
+               (unsigned long long) trace.stalls());
+    }
+}
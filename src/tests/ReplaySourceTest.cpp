@@ -0,0 +1,154 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "ReplaySource.h"
+#include "CaptureFile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct ReplayedPacket {
+    int id;
+    uint64_t sample;
+    ssize_t size;
+    uint8_t first;
+};
+
+static std::vector<ReplayedPacket> replayed;
+
+static void replay_recv(sr_wrap_packet_t *packet) {
+    ReplayedPacket p = { packet->id, packet->sample, packet->size, packet->data[0] };
+    replayed.push_back(p);
+}
+
+static std::string temp_file(const void *data, size_t length) {
+    char path[] = "/tmp/ttt_replayXXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE( fd >= 0 );
+    REQUIRE( write(fd, data, length) == (ssize_t) length );
+    close(fd);
+    return path;
+}
+
+static void append_record(std::vector<uint8_t> &file, int id, uint64_t sample, uint32_t size, uint8_t fill) {
+    capture_record_header_t rec = { size, id, sample };
+    const uint8_t *p = (const uint8_t *) &rec;
+    file.insert(file.end(), p, p + sizeof(rec));
+    file.insert(file.end(), size, fill);
+}
+
+SCENARIO( "ReplaySource delivers recorded captures", "[replay]" ) {
+
+    GIVEN( "An indexed capture with two devices" ) {
+        std::vector<uint8_t> file(sizeof(capture_file_header_t));
+        capture_file_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC));
+        header.version = CAPTURE_FILE_VERSION;
+        header.numChannels = 8;
+        header.samplerate = 16000000;
+        memcpy(&file[0], &header, sizeof(header));
+
+        /* Device 1 is recorded ahead of device 0 */
+        append_record(file, 1, 0, 256, 0x11);
+        append_record(file, 1, 256, 256, 0x12);
+        append_record(file, 0, 128, 256, 0x01);
+        std::string path = temp_file(&file[0], file.size());
+
+        ReplaySource source(replay_recv);
+        REQUIRE( source.open(path.c_str()) );
+        REQUIRE( source.tracks() == 2 );
+
+        WHEN( "it is replayed as fast as possible" ) {
+            replayed.clear();
+            uint64_t n = source.run(ReplaySource::REPLAY_FAST);
+
+            THEN( "packets of both devices arrive interleaved by sample time" ) {
+                REQUIRE( n == 3 );
+                REQUIRE( replayed.size() == 3 );
+                REQUIRE( replayed[0].first == 0x11 );
+                REQUIRE( replayed[1].first == 0x01 );
+                REQUIRE( replayed[1].id == 0 );
+                REQUIRE( replayed[1].sample == 128 );
+                REQUIRE( replayed[2].first == 0x12 );
+            }
+        }
+        unlink(path.c_str());
+    }
+
+    GIVEN( "A raw capture" ) {
+        std::vector<uint8_t> raw(1010 * 16);
+        for (size_t i = 0; i < raw.size(); i++) {
+            raw[i] = (uint8_t) (i / 16);
+        }
+        std::string path = temp_file(&raw[0], raw.size());
+
+        ReplaySource source(replay_recv);
+        REQUIRE( source.open(path.c_str(), 2, 16000000, 8, 4000) );
+
+        WHEN( "it is replayed in real time" ) {
+            replayed.clear();
+            source.run(ReplaySource::REPLAY_REALTIME);
+
+            THEN( "it is cut into whole blocks with running sample indices" ) {
+                REQUIRE( replayed.size() == 5 );
+                REQUIRE( replayed[0].size == 4000 );
+                REQUIRE( replayed[1].sample == 4000 );
+                REQUIRE( replayed[1].first == 250 );
+                REQUIRE( replayed[4].size == 160 );
+                REQUIRE( replayed[4].id == 2 );
+            }
+        }
+        unlink(path.c_str());
+    }
+
+    GIVEN( "Indexed captures that are cut short or malformed" ) {
+        capture_file_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CAPTURE_FILE_MAGIC, sizeof(CAPTURE_FILE_MAGIC));
+        header.version = CAPTURE_FILE_VERSION;
+        header.numChannels = 8;
+        header.samplerate = 16000000;
+        std::vector<uint8_t> file((const uint8_t *) &header, (const uint8_t *) (&header + 1));
+        append_record(file, 0, 0, 256, 0x01);
+        append_record(file, 1, 0, 256, 0x11);
+
+        std::vector<uint8_t> truncated(file.begin(), file.end() - 100);
+        std::vector<uint8_t> partialBlock = file;
+        append_record(partialBlock, 0, 128, 250, 0x02);
+        std::vector<uint8_t> tooWide = file;
+        ((capture_file_header_t *) &tooWide[0])->numChannels = 17;
+
+        const std::vector<uint8_t> *bad[] = { &truncated, &partialBlock, &tooWide };
+        const char *what[] = { "truncated", "with a partial block", "with too many channels" };
+        for (unsigned i = 0; i < 3; i++) {
+            std::string path = temp_file(&(*bad[i])[0], bad[i]->size());
+            ReplaySource source(replay_recv);
+
+            WHEN( "one " << what[i] << " is opened" ) {
+                bool opened = source.open(path.c_str());
+                replayed.clear();
+                uint64_t n = source.run(ReplaySource::REPLAY_FAST);
+
+                THEN( "open fails and none of its records are replayed" ) {
+                    REQUIRE_FALSE( opened );
+                    REQUIRE( source.tracks() == 0 );
+                    REQUIRE( n == 0 );
+                    REQUIRE( replayed.empty() );
+                }
+            }
+            unlink(path.c_str());
+        }
+    }
+
+    GIVEN( "A missing file" ) {
+        ReplaySource source(replay_recv);
+
+        THEN( "open fails" ) {
+            REQUIRE_FALSE( source.open("/nonexistent/capture.bin") );
+        }
+    }
+}
@@ -0,0 +1,345 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "SpiDecoder.h"
+#include "ParallelDecode.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+#define SPI_CLK  0
+#define SPI_MOSI 1
+#define SPI_MISO 2
+#define SPI_CS   3
+
+static SpiConfig spi_config(unsigned mode, unsigned wordBits = 8, bool msbFirst = true, bool cs = true) {
+    SpiConfig c;
+    c.clk = SPI_CLK;
+    c.mosi = SPI_MOSI;
+    c.miso = SPI_MISO;
+    c.cs = cs ? SPI_CS : SPI_NO_CHANNEL;
+    c.cpol = (mode >> 1) & 1;
+    c.cpha = mode & 1;
+    c.wordBits = (uint8_t) wordBits;
+    c.msbFirst = msbFirst;
+    c.csActiveLow = true;
+    return c;
+}
+
+/* Master and slave driving the bus, half clock periods of h samples */
+struct SpiWave {
+    SpiConfig cfg;
+    unsigned h;
+    bool clk, mosi, miso, cs;
+    std::vector<uint16_t> samples;
+    std::vector<SpiEvent> expect;
+
+    SpiWave(const SpiConfig &cfg, unsigned h = 4)
+        : cfg(cfg), h(h), clk(cfg.cpol), mosi(false), miso(false), cs(true) {}
+
+    void phase(unsigned n) {
+        uint16_t v = clk << SPI_CLK | mosi << SPI_MOSI | miso << SPI_MISO | cs << SPI_CS | 0xf0;
+        samples.insert(samples.end(), n, v);
+    }
+    void idle(unsigned n) { clk = cfg.cpol; phase(n); }
+    /* CPHA 0 samples on the leading edge, CPHA 1 on the trailing one */
+    uint64_t bit(bool out, bool in) {
+        uint64_t at;
+        if (!cfg.cpha) {
+            mosi = out; miso = in;
+            phase(h);
+            clk = !cfg.cpol;
+            at = samples.size();
+            phase(h);
+            clk = cfg.cpol;
+        } else {
+            clk = !cfg.cpol;
+            mosi = out; miso = in;
+            phase(h);
+            clk = cfg.cpol;
+            at = samples.size();
+            phase(h);
+        }
+        return at;
+    }
+    void transfer(const std::vector<uint32_t> &out, const std::vector<uint32_t> &in, unsigned partialBits = 0) {
+        cs = false;
+        phase(h);
+        unsigned n = cfg.wordBits;
+        for (size_t w = 0; w <= out.size(); w++) {
+            unsigned bits = w < out.size() ? n : partialBits;
+            if (!bits) {
+                break;
+            }
+            uint32_t o = w < out.size() ? out[w] : 0x5a5a5a5a, i = w < out.size() ? in[w] : 0x3c3c3c3c;
+            SpiEvent e = SpiEvent();
+            for (unsigned b = 0; b < bits; b++) {
+                unsigned k = cfg.msbFirst ? n - 1 - b : b;
+                uint64_t at = bit((o >> k) & 1, (i >> k) & 1);
+                if (b == 0) {
+                    e.sample = at;
+                }
+            }
+            uint32_t mask = n == 32 ? ~0u : (1u << n) - 1;
+            e.mosi = o & mask;
+            e.miso = i & mask;
+            e.bits = (uint8_t) n;
+            e.flags = w == 0 ? SPI_FLAG_FIRST : 0;
+            if (w == out.size()) {
+                /* Only the bits clocked so far, as shifted in */
+                e.mosi = cfg.msbFirst ? e.mosi >> (n - bits) : e.mosi & ((1u << bits) - 1);
+                e.miso = cfg.msbFirst ? e.miso >> (n - bits) : e.miso & ((1u << bits) - 1);
+                e.bits = (uint8_t) bits;
+                e.flags |= SPI_FLAG_PARTIAL;
+            }
+            expect.push_back(e);
+        }
+        phase(h);
+        cs = true;
+        idle(3 * h);
+    }
+};
+
+/* Per-sample state machine on interleaved words, the reference */
+static std::vector<SpiEvent> naive_spi(const std::vector<uint16_t> &samples, const SpiConfig &c) {
+    std::vector<SpiEvent> events;
+    bool clk = c.cpol, cs = c.csActiveLow, selected = c.cs == SPI_NO_CHANNEL, first = false;
+    SpiEvent w = SpiEvent();
+    for (size_t i = 0; i < samples.size(); i++) {
+        uint16_t v = samples[i];
+        if (c.cs != SPI_NO_CHANNEL && ((v >> c.cs) & 1) != cs) {
+            cs = !cs;
+            if (selected && cs == c.csActiveLow && w.bits) {
+                w.flags = SPI_FLAG_PARTIAL | (first ? SPI_FLAG_FIRST : 0);
+                events.push_back(w);
+            }
+            selected = cs != c.csActiveLow;
+            first = true;
+            w.bits = 0;
+        }
+        bool k = (v >> c.clk) & 1;
+        if (k != clk) {
+            clk = k;
+            if (clk == (c.cpol == c.cpha) && selected) {
+                unsigned mo = (v >> c.mosi) & 1, mi = c.miso == SPI_NO_CHANNEL ? 0 : (v >> c.miso) & 1;
+                if (w.bits == 0) {
+                    w.sample = i;
+                    w.mosi = w.miso = 0;
+                }
+                if (c.msbFirst) {
+                    w.mosi = w.mosi << 1 | mo;
+                    w.miso = w.miso << 1 | mi;
+                } else {
+                    w.mosi |= mo << w.bits;
+                    w.miso |= mi << w.bits;
+                }
+                if (++w.bits == c.wordBits) {
+                    w.flags = first ? SPI_FLAG_FIRST : 0;
+                    events.push_back(w);
+                    first = false;
+                    w.bits = 0;
+                }
+            }
+        }
+    }
+    return events;
+}
+
+static std::vector<SpiEvent> decode_blocks(SpiDecoder &d, const std::vector<uint16_t> &samples) {
+    std::vector<SpiEvent> events;
+    std::vector<SpiEvent> buffer(SpiDecoder::maxEvents(20011 + 64));
+    Bitplanes bp(8);
+    size_t offset = 0, size = 333;
+    while (offset < samples.size()) {
+        size_t n = std::min(samples.size() - offset, size);
+        bitplane_from_samples(&samples[offset], n, bp);
+        bp.firstSample = offset;
+        size_t count = d.decode(bp, buffer.data());
+        events.insert(events.end(), buffer.begin(), buffer.begin() + count);
+        offset += n;
+        size = size * 3 % 20011 + 64;
+    }
+    return events;
+}
+
+static void require_same(const std::vector<SpiEvent> &a, const std::vector<SpiEvent> &b) {
+    REQUIRE( a.size() == b.size() );
+    for (size_t i = 0; i < a.size(); i++) {
+        INFO( "event " << i );
+        REQUIRE( a[i].sample == b[i].sample );
+        REQUIRE( a[i].mosi == b[i].mosi );
+        REQUIRE( a[i].miso == b[i].miso );
+        REQUIRE( a[i].bits == b[i].bits );
+        REQUIRE( a[i].flags == b[i].flags );
+    }
+}
+
+static std::vector<uint32_t> random_words(size_t n, unsigned bits) {
+    std::vector<uint32_t> v(n);
+    for (auto &w : v) {
+        w = ((uint32_t) rand() << 16 ^ rand()) & (bits == 32 ? ~0u : (1u << bits) - 1);
+    }
+    return v;
+}
+
+SCENARIO( "SPI transfers decode in all four modes", "[spi]" ) {
+
+    for (unsigned mode = 0; mode < 4; mode++) {
+        for (unsigned bits : { 8, 12, 32 }) {
+            GIVEN( "Mode " << mode << ", " << bits << " bit words" ) {
+                srand(mode * 100 + bits);
+                bool msbFirst = bits != 12;
+                SpiWave w(spi_config(mode, bits, msbFirst), 2 + mode);
+                w.idle(100);
+                for (unsigned t = 0; t < 20; t++) {
+                    size_t n = 1 + rand() % 8;
+                    w.transfer(random_words(n, bits), random_words(n, bits), t % 5 == 4 ? 1 + t % 7 : 0);
+                    w.idle(rand() % 50);
+                }
+                w.idle(100);
+
+                WHEN( "decoded in odd sized blocks" ) {
+                    SpiDecoder d(w.cfg);
+                    std::vector<SpiEvent> events = decode_blocks(d, w.samples);
+
+                    THEN( "words, first and partial flags match the transfers" ) {
+                        require_same(events, w.expect);
+                    }
+                    THEN( "the per-sample reference agrees" ) {
+                        require_same(events, naive_spi(w.samples, w.cfg));
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "SPI without chip select frames by bit count", "[spi]" ) {
+
+    GIVEN( "A clocked stream with no CS line" ) {
+        SpiWave w(spi_config(0, 8, true, false));
+        w.idle(10);
+        std::vector<uint32_t> out = { 0x12, 0x34, 0x56 }, in = { 0xfe, 0xdc, 0xba };
+        w.transfer(out, in);
+
+        WHEN( "decoded" ) {
+            SpiDecoder d(w.cfg);
+            std::vector<SpiEvent> events = decode_blocks(d, w.samples);
+
+            THEN( "words come out back to back without flags" ) {
+                REQUIRE( events.size() == 3 );
+                REQUIRE( events[1].mosi == 0x34 );
+                REQUIRE( events[2].miso == 0xba );
+                REQUIRE( events[0].flags == 0 );
+            }
+        }
+    }
+}
+
+SCENARIO( "SPI decodes a stored capture in parallel chunks", "[spi][paralleldecode]" ) {
+
+    for (unsigned mode = 0; mode < 4; mode++) {
+        GIVEN( "Mode " << mode << " transfers with partial words" ) {
+            srand(mode + 40);
+            SpiWave w(spi_config(mode, 12, mode & 1), 3);
+            w.idle(100);
+            while (w.samples.size() < 200000) {
+                size_t n = 1 + rand() % 20;
+                w.transfer(random_words(n, 12), random_words(n, 12), rand() % 4 ? 0 : 1 + rand() % 11);
+                w.idle(rand() % 30);
+            }
+            Bitplanes bp(8);
+            bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+            bp.firstSample = 0;
+            ParallelDecodeStats stats;
+
+            WHEN( "chunks start on an inactive chip select" ) {
+                SpiDecoder d(w.cfg);
+                std::vector<SpiEvent> events = parallel_decode(d, bp, 4, 997, &stats);
+
+                THEN( "the events match a sequential decode and every resync guess holds" ) {
+                    require_same(events, decode_blocks(d, w.samples));
+                    REQUIRE( stats.chunks > 200 );
+                    REQUIRE( stats.redecoded == 0 );
+                }
+            }
+            WHEN( "the bus has no chip select" ) {
+                SpiConfig cfg = w.cfg;
+                cfg.cs = SPI_NO_CHANNEL;
+                SpiDecoder d(cfg);
+                std::vector<SpiEvent> events = parallel_decode(d, bp, 4, 997, &stats);
+
+                THEN( "it decodes as one chunk" ) {
+                    require_same(events, decode_blocks(d, w.samples));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "SPI decoding plugs into the capture callback path", "[spi]" ) {
+
+    GIVEN( "A Logic16 stream" ) {
+        srand(11);
+        SpiWave w(spi_config(3));
+        w.idle(64);
+        for (int t = 0; t < 50; t++) {
+            w.transfer(random_words(4, 8), random_words(4, 8));
+        }
+        w.idle(16 - w.samples.size() % 16 + 16);
+        std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+
+        WHEN( "packets are processed into the decoder's own buffer" ) {
+            SpiDecoder d(w.cfg, 8, 16 * 64);
+            std::vector<SpiEvent> events;
+            for (size_t offset = 0; offset < raw.size(); offset += 16 * 64) {
+                size_t size = std::min(raw.size() - offset, (size_t) 16 * 64);
+                sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset };
+                size_t n = d.process(&packet);
+                events.insert(events.end(), d.events(), d.events() + n);
+            }
+
+            THEN( "the transfers come out" ) {
+                require_same(events, w.expect);
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "SPI decoder throughput", "[.][bench]" ) {
+    srand(5);
+    SpiConfig cfg = spi_config(0);
+    SpiWave w(cfg, 4);
+    while (w.samples.size() < (32u << 20)) {
+        w.transfer(random_words(32, 8), random_words(32, 8));
+        w.idle(200);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<SpiEvent> reference = naive_spi(w.samples, cfg);
+    auto t1 = std::chrono::steady_clock::now();
+
+    const size_t block = 160256;
+    SpiDecoder d(cfg, 8, block);
+    std::vector<SpiEvent> buffer(SpiDecoder::maxEvents(block));
+    Bitplanes bp(8);
+    size_t total = 0;
+    double decode = 0;
+    for (size_t offset = 0; offset < w.samples.size(); offset += block) {
+        size_t n = std::min(block, w.samples.size() - offset);
+        bitplane_from_samples(&w.samples[offset], n, bp);
+        bp.firstSample = offset;
+        auto a = std::chrono::steady_clock::now();
+        total += d.decode(bp, buffer.data());
+        decode += std::chrono::duration<double>(std::chrono::steady_clock::now() - a).count();
+    }
+
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    printf("SPI naive   %7.1f Msamples/s  %zu words\n", w.samples.size() / s / 1e6, reference.size());
+    printf("SPI planes  %7.1f Msamples/s  %zu words\n", w.samples.size() / decode / 1e6, total);
+    REQUIRE( total == reference.size() );
+}
@@ -0,0 +1,581 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "sw_trace.h"
+#include "Logic16.h"
+#include "ParallelDecode.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <stdlib.h>
+#include <string>
+
+#define SW_CLK 0
+#define SW_DIO 1
+#define SW_SWO 2
+
+/* SWD waveform, four samples per clock phase, SWCLK on channel 0 */
+struct SwdWave {
+    std::vector<uint16_t> samples;
+    uint16_t dio = 1;
+
+    void phase(bool clk) {
+        for (int i = 0; i < 4; i++) {
+            samples.push_back((uint16_t) ((clk << SW_CLK) | (dio << SW_DIO) | 0xf0));
+        }
+    }
+    /* The host drives on the falling edge, the target on the rising one */
+    void host(unsigned bit) { dio = bit; phase(false); phase(true); }
+    void target(unsigned bit) { phase(false); dio = bit; phase(true); }
+    void turn() { phase(false); phase(true); }
+
+    void hostBits(uint32_t v, unsigned n) { for (unsigned i = 0; i < n; i++) host((v >> i) & 1); }
+    void targetBits(uint32_t v, unsigned n) { for (unsigned i = 0; i < n; i++) target((v >> i) & 1); }
+
+    void lineReset(unsigned n = 56) { hostBits(0xffffffff, 32); hostBits(0xffffffff, n - 32); }
+    void idle(unsigned n) { hostBits(0, n); }
+
+    void request(bool ap, bool read, unsigned addr) {
+        unsigned a2 = (addr >> 2) & 1, a3 = (addr >> 3) & 1;
+        unsigned parity = (ap + read + a2 + a3) & 1;
+        hostBits(1 | ap << 1 | read << 2 | a2 << 3 | a3 << 4 | parity << 5 | 0 << 6 | 1 << 7, 8);
+        turn();
+    }
+    void read(bool ap, unsigned addr, uint32_t value, bool badParity = false) {
+        request(ap, true, addr);
+        targetBits(SWD_ACK_OK, 3);
+        targetBits(value, 32);
+        target((__builtin_popcount(value) & 1) ^ badParity);
+        turn();
+    }
+    void write(bool ap, unsigned addr, uint32_t value) {
+        request(ap, false, addr);
+        targetBits(SWD_ACK_OK, 3);
+        turn();
+        hostBits(value, 32);
+        host(__builtin_popcount(value) & 1);
+    }
+    void refused(bool ap, bool read, unsigned addr, unsigned ack) {
+        request(ap, read, addr);
+        targetBits(ack, 3);
+        turn();
+    }
+};
+
+static SwdWave swd_session() {
+    SwdWave w;
+    w.lineReset();
+    w.hostBits(0xe79e, 16);
+    w.lineReset();
+    w.idle(2);
+    w.read(false, 0x0, 0x2ba01477);
+    w.write(false, 0x0, 0x1e);
+    w.write(false, 0x8, 0x0);
+    w.refused(true, true, 0xc, SWD_ACK_WAIT);
+    w.read(true, 0xc, 0x12345678);
+    w.read(true, 0x4, 0xdeadbeef, true);
+    w.refused(true, false, 0x0, SWD_ACK_FAULT);
+    w.idle(3);
+    /* Target gone, the pulled up line reads as ACK 7 */
+    w.request(false, true, 0x0);
+    w.targetBits(7, 3);
+    w.lineReset(60);
+    w.idle(8);
+    return w;
+}
+
+static std::string describe(const std::vector<SwEvent> &events) {
+    static const char *names[] = { "?", "LINE_RESET", "OK", "WAIT", "FAULT", "NO_ACK" };
+    std::string text;
+    char line[128];
+    for (auto &e : events) {
+        snprintf(line, sizeof(line), "%llu %s req=%02x ack=%u data=%08x flags=%u\n",
+                 (unsigned long long) e.sample, names[e.type <= SW_EVENT_NO_ACK ? e.type : 0],
+                 e.request, e.ack, e.data, e.flags);
+        text += line;
+    }
+    return text;
+}
+
+/* Compare with a file next to this one; TTT_UPDATE_GOLDEN=1 rewrites it */
+static std::string golden(const char *name, const std::string &actual) {
+    std::string path = __FILE__;
+    path = path.substr(0, path.find_last_of('/') + 1) + "golden/" + name;
+    if (getenv("TTT_UPDATE_GOLDEN")) {
+        std::ofstream(path) << actual;
+    }
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+SCENARIO( "SWD sessions decode to the golden event stream", "[swd]" ) {
+
+    GIVEN( "A recorded session of reads, writes, retries and resets" ) {
+        SwdWave w = swd_session();
+        Bitplanes bp(16);
+        bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+        bp.firstSample = 0;
+
+        WHEN( "the block is sampled and decoded" ) {
+            SwSampler sampler(SW_CLK, SW_DIO);
+            SwdDecoder decoder;
+            std::vector<SwCycle> cycles;
+            std::vector<SwEvent> events;
+            sampler.sample(bp, cycles);
+            decoder.decode(cycles.data(), cycles.size(), events);
+
+            THEN( "the events match the golden file" ) {
+                INFO( describe(events) );
+                REQUIRE( events.size() == 11 );
+                REQUIRE( events[2].type == SW_EVENT_OK );
+                REQUIRE( sw_request_read(events[2].request) );
+                REQUIRE( events[2].data == 0x2ba01477 );
+                REQUIRE( sw_request_addr(events[4].request) == 0x8 );
+                REQUIRE( events[7].flags == SW_FLAG_PARITY );
+                std::string text = describe(events);
+                REQUIRE( text == golden("swd_session.txt", text) );
+            }
+        }
+
+        WHEN( "Logic16 packets of odd sizes go through the trace stage to a file" ) {
+            std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+            SwTrace trace(8, SW_CLK, SW_DIO);
+            const char *path = "/tmp/ttt_swd_test.sw";
+            REQUIRE( trace.open(path) );
+
+            size_t offset = 0, blocks = 1;
+            uint64_t sample = 0;
+            while (offset < raw.size()) {
+                size_t size = std::min(raw.size() - offset, blocks * 16);
+                sr_wrap_packet_t packet;
+                packet.id = 0;
+                packet.data = &raw[offset];
+                packet.size = size;
+                packet.ref = NULL;
+                packet.sample = sample;
+                trace.process(&packet);
+                offset += size;
+                sample += size;
+                blocks = blocks * 3 % 17 + 1;
+            }
+            REQUIRE( trace.close() );
+            std::vector<SwEvent> events;
+            REQUIRE( sw_trace_load(path, events) );
+            remove(path);
+
+            THEN( "the stream is the same as from one block" ) {
+                REQUIRE( trace.total() == 11 );
+                std::string text = describe(events);
+                REQUIRE( text == golden("swd_session.txt", text) );
+            }
+        }
+    }
+}
+
+SCENARIO( "SWD decodes a stored capture in parallel chunks", "[swd][paralleldecode]" ) {
+
+    GIVEN( "Sessions with line resets and transfers with idle runs between them" ) {
+        srand(23);
+        SwdWave w;
+        for (unsigned i = 0; i < 40; i++) {
+            std::vector<uint16_t> session = swd_session().samples;
+            w.samples.insert(w.samples.end(), session.begin(), session.end());
+            for (unsigned t = 0; t < 30; t++) {
+                unsigned addr = (rand() % 4) * 4;
+                if (rand() % 2) {
+                    w.read(rand() % 2, addr, (uint32_t) rand());
+                } else {
+                    w.write(rand() % 2, addr, (uint32_t) rand());
+                }
+                w.idle(rand() % 8 ? rand() % 3 : SWD_IDLE_RESYNC_CYCLES + rand() % 10);
+            }
+        }
+        Bitplanes bp(16);
+        bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+        bp.firstSample = 0;
+
+        SwSampler sampler(SW_CLK, SW_DIO);
+        SwdDecoder sequential;
+        std::vector<SwCycle> cycles;
+        std::vector<SwEvent> expected;
+        sampler.sample(bp, cycles);
+        sequential.decode(cycles.data(), cycles.size(), expected);
+
+        WHEN( "resync points are searched through the whole capture" ) {
+            SwdDecoder d(SW_CLK, SW_DIO, 1);
+            SwdDecoder::State real = d.initialState(), guess;
+            std::vector<SwEvent> events;
+            size_t points = 0, wrong = 0, at = 0, decoded = 0;
+            while ((at = d.resync(bp, at + 1, bp.samples(), guess)) < bp.samples()) {
+                real = d.decode(bp, decoded, at, real, events);
+                decoded = at;
+                points++;
+                wrong += !(real == guess);
+            }
+
+            THEN( "every line reset and long idle run is one and the state guessed there is right" ) {
+                REQUIRE( points >= 40 * 3 );
+                REQUIRE( wrong == 0 );
+            }
+        }
+
+        for (size_t chunk : { (size_t) 1000, (size_t) 4093, (size_t) 65536 }) {
+            WHEN( "it is cut into chunks of " << chunk << " samples" ) {
+                SwdDecoder d(SW_CLK, SW_DIO, 1);
+                ParallelDecodeStats stats;
+                std::vector<SwEvent> events = parallel_decode(d, bp, 4, chunk, &stats);
+
+                THEN( "the events match a sequential decode and every resync guess holds" ) {
+                    REQUIRE( expected.size() == 40 * 41 );
+                    REQUIRE( describe(events) == describe(expected) );
+                    REQUIRE( stats.redecoded == 0 );
+                }
+            }
+        }
+    }
+
+    GIVEN( "Back to back reads without a resync point" ) {
+        SwdWave w;
+        for (unsigned i = 0; i < 500; i++) {
+            w.read(true, 0xc, i);
+        }
+        w.idle(8);
+        Bitplanes bp(16);
+        bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+        bp.firstSample = 0;
+
+        WHEN( "it is decoded in parallel" ) {
+            SwdDecoder d(SW_CLK, SW_DIO, 1);
+            std::vector<SwEvent> events = parallel_decode(d, bp, 4, 4096);
+
+            THEN( "it decodes as one chunk" ) {
+                REQUIRE( events.size() == 500 );
+                REQUIRE( events[499].data == 499 );
+            }
+        }
+    }
+}
+
+SCENARIO( "A failed event file write is latched", "[swd]" ) {
+
+    GIVEN( "A long run of reads and an event file on a full device" ) {
+        SwdWave w;
+        for (unsigned i = 0; i < 2000; i++) {
+            w.read(true, 0xc, i);
+        }
+        w.idle(64);
+        std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+        SwTrace trace(8, SW_CLK, SW_DIO);
+        REQUIRE( trace.open("/dev/full") );
+
+        WHEN( "the events are written out" ) {
+            for (size_t offset = 0; offset < raw.size(); offset += 16 * 1000) {
+                size_t size = std::min<size_t>(raw.size() - offset, 16 * 1000);
+                sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset };
+                trace.process(&packet);
+            }
+
+            THEN( "the stage reports it during capture and on close" ) {
+                REQUIRE( trace.total() >= 2000 );
+                REQUIRE( trace.writeFailed() );
+                REQUIRE_FALSE( trace.close() );
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "SWD trace throughput", "[.][bench]" ) {
+    SwdWave w;
+    while (w.samples.size() < (16u << 20)) {
+        w.read(true, 0xc, (uint32_t) w.samples.size());
+        w.write(true, 0x4, 0x20000000);
+        w.idle(2);
+    }
+    std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+    SwTrace trace(8, SW_CLK, SW_DIO);
+    const size_t packetSize = 160256;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+        sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset };
+        trace.process(&packet);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    printf("SWD trace   %7.1f Msamples/s  %llu events\n", w.samples.size() / s / 1e6,
+           (unsigned long long) trace.total());
+}
+
+/* SWO pin driven at a bit period that may drift, first bit times of each byte kept */
+struct SwoWave {
+    unsigned encoding;
+    double period;
+    double drift;
+    double at = 0;
+    std::vector<uint16_t> samples;
+    std::vector<uint64_t> byteAt;
+
+    SwoWave(unsigned encoding, double period, double drift = 1)
+        : encoding(encoding), period(period), drift(drift) {}
+
+    void level(bool v, double duration) {
+        at += duration;
+        while (samples.size() < (size_t) llround(at)) {
+            samples.push_back((uint16_t) ((v << SW_SWO) | 0xf0));
+        }
+    }
+    void idle(double bits) { level(encoding == SWO_NRZ, bits * period); }
+
+    /* Manchester: one packet, a 1 is high then low */
+    void packet(const std::vector<uint8_t> &bytes) {
+        level(true, period / 2);
+        level(false, period / 2);
+        for (uint8_t b : bytes) {
+            for (unsigned i = 0; i < 8; i++) {
+                bool one = (b >> i) & 1;
+                level(one, period / 2);
+                if (i == 0) {
+                    byteAt.push_back(samples.size());
+                }
+                level(!one, period / 2);
+            }
+            period *= drift;
+        }
+        idle(2);
+    }
+    /* NRZ: 8N1 frames back to back */
+    void frames(const std::vector<uint8_t> &bytes) {
+        for (uint8_t b : bytes) {
+            byteAt.push_back((uint64_t) llround(at));
+            level(false, period);
+            for (unsigned i = 0; i < 8; i++) {
+                level((b >> i) & 1, period);
+            }
+            level(true, period);
+            period *= drift;
+        }
+    }
+    void send(const std::vector<uint8_t> &bytes) {
+        if (encoding == SWO_MANCHESTER) {
+            packet(bytes);
+        } else {
+            frames(bytes);
+        }
+    }
+};
+
+static std::vector<uint8_t> itm_write(unsigned port, uint32_t value, unsigned size) {
+    std::vector<uint8_t> p(1, (uint8_t) (port << 3 | (size == 4 ? 3 : size)));
+    for (unsigned i = 0; i < size; i++) {
+        p.push_back((uint8_t) (value >> (8 * i)));
+    }
+    return p;
+}
+
+static std::vector<uint8_t> itm_session() {
+    std::vector<uint8_t> s = { 0, 0, 0, 0, 0, 0x80 };
+    auto add = [&](const std::vector<uint8_t> &p) { s.insert(s.end(), p.begin(), p.end()); };
+    for (char c : std::string("Hi!\n")) {
+        add(itm_write(0, (uint8_t) c, 1));
+    }
+    add(itm_write(1, 0xdeadbeef, 4));
+    add(itm_write(31, 0x1234, 2));
+    /* Short local timestamp of 3, then a long one of 1000 */
+    add({ 0x30, 0xc0 | 0x80, 0x80 | (1000 & 0x7f), 1000 >> 7 });
+    add(itm_write(0, 'x', 1));
+    /* DWT PC sample: discriminator 2, four bytes */
+    add({ 2 << 3 | 4 | 3, 0x34, 0x12, 0x00, 0x08 });
+    add({ 0x70 });
+    add({ 0x94, 0x85, 0x01 });
+    /* Extension with one continuation byte */
+    add({ 0x88, 0x02 });
+    add(itm_write(2, 0x55, 1));
+    return s;
+}
+
+static std::string describe(const std::vector<SwoEvent> &events) {
+    static const char *names[] = { "?", "ITM", "DWT", "TIMESTAMP", "GLOBAL_TIME", "OVERFLOW" };
+    std::string text;
+    char line[128];
+    for (auto &e : events) {
+        snprintf(line, sizeof(line), "%s port=%u size=%u data=%08x time=%llu\n",
+                 names[e.type <= SWO_EVENT_OVERFLOW ? e.type : 0], e.port, e.size, e.data,
+                 (unsigned long long) e.timestamp);
+        text += line;
+    }
+    return text;
+}
+
+static void check_itm_session(const std::vector<SwoEvent> &events, const ItmDecoder &d) {
+    INFO( describe(events) );
+    REQUIRE( events.size() == 13 );
+    REQUIRE( events[0].type == SWO_EVENT_ITM );
+    REQUIRE( events[1].data == 'i' );
+    REQUIRE( events[4].port == 1 );
+    REQUIRE( events[4].data == 0xdeadbeef );
+    REQUIRE( events[5].port == 31 );
+    REQUIRE( events[5].data == 0x1234 );
+    REQUIRE( events[5].size == 2 );
+    REQUIRE( events[6].type == SWO_EVENT_TIMESTAMP );
+    REQUIRE( events[6].timestamp == 3 );
+    REQUIRE( events[7].data == 1000 );
+    REQUIRE( events[8].data == 'x' );
+    REQUIRE( events[8].timestamp == 1003 );
+    REQUIRE( events[9].type == SWO_EVENT_DWT );
+    REQUIRE( events[9].port == 2 );
+    REQUIRE( events[9].data == 0x08001234 );
+    REQUIRE( events[10].type == SWO_EVENT_OVERFLOW );
+    REQUIRE( events[11].type == SWO_EVENT_GLOBAL_TIME );
+    REQUIRE( events[11].data == 133 );
+    REQUIRE( events[12].port == 2 );
+
+    REQUIRE( d.stats(0).packets == 5 );
+    REQUIRE( d.stats(0).bytes == 5 );
+    REQUIRE( d.stats(1).bytes == 4 );
+    REQUIRE( d.stats(31).packets == 1 );
+    REQUIRE( d.stats(2, true).packets == 1 );
+    REQUIRE( d.stats(0).firstSample == events[0].sample );
+    REQUIRE( d.stats(0).lastSample == events[8].sample );
+    REQUIRE( d.syncs() == 1 );
+    REQUIRE( d.overflows() == 1 );
+    REQUIRE( d.errors() == 0 );
+}
+
+SCENARIO( "SWO streams decode to ITM events per port", "[swo]" ) {
+
+    const unsigned encodings[] = { SWO_MANCHESTER, SWO_NRZ };
+    for (unsigned encoding : encodings) {
+        GIVEN( "An ITM session sent " << (encoding == SWO_NRZ ? "NRZ" : "Manchester") << " in pieces" ) {
+            std::vector<uint8_t> itm = itm_session();
+            SwoWave w(encoding, 8);
+            w.idle(20);
+            for (size_t i = 0; i < itm.size(); i += 7) {
+                w.send(std::vector<uint8_t>(itm.begin() + i, itm.begin() + std::min(itm.size(), i + 7)));
+                w.idle(3);
+            }
+            w.idle(20);
+
+            WHEN( "sampled and decoded as one block" ) {
+                Bitplanes bp(16);
+                bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+                bp.firstSample = 0;
+                SwoSampler sampler(SW_SWO, encoding, 16000000, encoding == SWO_NRZ ? 2000000 : 0);
+                ItmDecoder decoder;
+                std::vector<SwoByte> bytes;
+                std::vector<SwoEvent> events;
+                sampler.sample(bp, bytes);
+                decoder.decode(bytes.data(), bytes.size(), events);
+
+                THEN( "every byte is recovered where it was sent and parsed" ) {
+                    REQUIRE( bytes.size() == itm.size() );
+                    for (size_t i = 0; i < bytes.size(); i++) {
+                        REQUIRE( bytes[i].data == itm[i] );
+                        REQUIRE( bytes[i].sample <= w.byteAt[i] + 1 );
+                        REQUIRE( bytes[i].sample + 1 >= w.byteAt[i] );
+                        REQUIRE( (bytes[i].flags & SWO_FLAG_FRAMING) == 0 );
+                    }
+                    if (encoding == SWO_MANCHESTER) {
+                        REQUIRE( bytes[0].flags == SWO_FLAG_PACKET );
+                        REQUIRE( bytes[7].flags == SWO_FLAG_PACKET );
+                        REQUIRE( bytes[8].flags == 0 );
+                    }
+                    REQUIRE( sampler.bitPeriod() == Approx(8).epsilon(0.05) );
+                    check_itm_session(events, decoder);
+                }
+            }
+
+            WHEN( "Logic16 packets of odd sizes go through the trace stage to a file" ) {
+                std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+                SwoTrace trace(8, SW_SWO, encoding, 16000000, encoding == SWO_NRZ ? 2000000 : 0);
+                const char *path = "/tmp/ttt_swo_test.swo";
+                REQUIRE( trace.open(path) );
+
+                size_t offset = 0, blocks = 1;
+                while (offset < raw.size()) {
+                    size_t size = std::min(raw.size() - offset, blocks * 16);
+                    sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset };
+                    trace.process(&packet);
+                    offset += size;
+                    blocks = blocks * 3 % 17 + 1;
+                }
+                REQUIRE( trace.close() );
+                std::vector<SwoEvent> events;
+                REQUIRE( swo_trace_load(path, events) );
+                std::vector<SwEvent> wrong;
+                REQUIRE_FALSE( sw_trace_load(path, wrong) );
+                remove(path);
+
+                THEN( "the stream and the statistics are the same as from one block" ) {
+                    REQUIRE( trace.total() == 13 );
+                    check_itm_session(events, trace.itm());
+                }
+            }
+        }
+    }
+
+    GIVEN( "Manchester packets from a target clock drifting by 15 percent" ) {
+        srand(11);
+        SwoWave w(SWO_MANCHESTER, 6, 1.0002);
+        std::vector<uint8_t> sent;
+        w.idle(10);
+        while (sent.size() < 700) {
+            std::vector<uint8_t> p = itm_write(rand() % 32, (uint32_t) rand(), 4);
+            sent.insert(sent.end(), p.begin(), p.end());
+            w.packet(p);
+            w.idle(rand() % 20);
+        }
+
+        WHEN( "decoded without a configured rate" ) {
+            Bitplanes bp(16);
+            bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+            bp.firstSample = 0;
+            SwoSampler sampler(SW_SWO, SWO_MANCHESTER, 16000000);
+            std::vector<SwoByte> bytes;
+            sampler.sample(bp, bytes);
+
+            THEN( "the bit period follows the target" ) {
+                REQUIRE( w.period > 6.8 );
+                REQUIRE( bytes.size() == sent.size() );
+                for (size_t i = 0; i < bytes.size(); i++) {
+                    REQUIRE( bytes[i].data == sent[i] );
+                }
+                REQUIRE( sampler.bitPeriod() == Approx(w.period).epsilon(0.05) );
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "SWO trace throughput", "[.][bench]" ) {
+    const unsigned encodings[] = { SWO_MANCHESTER, SWO_NRZ };
+    for (unsigned encoding : encodings) {
+        srand(3);
+        SwoWave w(encoding, 8);
+        w.idle(10);
+        while (w.samples.size() < (16u << 20)) {
+            std::vector<uint8_t> p;
+            for (int k = 0; k < 8; k++) {
+                std::vector<uint8_t> q = itm_write(rand() % 4, (uint32_t) rand(), 1 + rand() % 2);
+                p.insert(p.end(), q.begin(), q.end());
+            }
+            w.send(p);
+            w.idle(20 + rand() % 200);
+        }
+        std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+        SwoTrace trace(8, SW_SWO, encoding, 16000000, encoding == SWO_NRZ ? 2000000 : 0);
+        const size_t packetSize = 160256;
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+            sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset };
+            trace.process(&packet);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        printf("SWO %-10s %7.1f Msamples/s  %llu events\n", encoding == SWO_NRZ ? "NRZ" : "Manchester",
+               w.samples.size() / s / 1e6, (unsigned long long) trace.total());
+    }
+}
@@ -0,0 +1,234 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "TimingCorrelator.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+
+/* IRQ pulses on device 0 channel 3, each answered by a CS low on device 1 channel 0 */
+struct TwoBoards {
+    std::vector<uint16_t> dev0;
+    std::vector<uint16_t> dev1;
+    std::vector<uint64_t> latencies;
+    std::vector<uint64_t> widths;
+    unsigned unanswered;
+};
+
+static const uint64_t RATE0 = 100000000, RATE1 = 24000000;
+static const int64_t OFFSET1 = 1000;
+
+static uint64_t to_ps(uint64_t sample, uint64_t rate, int64_t offset) {
+    return (uint64_t) ((unsigned __int128) sample * 1000000000000ull / rate) + offset;
+}
+
+static TwoBoards two_boards(unsigned events, unsigned seed) {
+    TwoBoards b;
+    srand(seed);
+    b.dev0.assign((size_t) events * 25000 + 10000, 0);
+    b.dev1.assign(b.dev0.size() * RATE1 / RATE0, 1);
+    b.unanswered = 0;
+    for (unsigned k = 0; k < events; k++) {
+        size_t irq = 5000 + (size_t) k * 25000 + rand() % 5000;
+        size_t width = 100 + rand() % 500;
+        for (size_t i = irq; i < irq + width; i++) {
+            b.dev0[i] |= 1 << 3;
+        }
+        b.widths.push_back(to_ps(irq + width, RATE0, 0) - to_ps(irq, RATE0, 0));
+        if (k % 17 == 5) {
+            b.unanswered++;
+            continue;
+        }
+        /* 2 to 40 us later, on the first device 1 sample at or after it */
+        uint64_t at = to_ps(irq, RATE0, 0) + 2000000 + (uint64_t) (rand() % 38000) * 1000;
+        size_t cs = (size_t) (((unsigned __int128) (at - OFFSET1) * RATE1 + 999999999999ull) / 1000000000000ull);
+        for (size_t i = cs; i < cs + 50; i++) {
+            b.dev1[i] &= ~1;
+        }
+        b.latencies.push_back(to_ps(cs, RATE1, OFFSET1) - to_ps(irq, RATE0, 0));
+    }
+    return b;
+}
+
+static void check_latencies(const LatencySummary &s, std::vector<uint64_t> expect) {
+    std::sort(expect.begin(), expect.end());
+    REQUIRE( s.count == expect.size() );
+    REQUIRE( s.min == expect.front() );
+    REQUIRE( s.max == expect.back() );
+    REQUIRE( (double) s.p50 == Approx((double) expect[(expect.size() - 1) / 2]).epsilon(0.07) );
+    REQUIRE( (double) s.p99 == Approx((double) expect[(size_t) ((expect.size() - 1) * 0.99)]).epsilon(0.07) );
+}
+
+/* Feed both devices in blocks of unrelated sizes, device 0 running ahead */
+static void feed(TimingCorrelator &c, const TwoBoards &b) {
+    Bitplanes bp(4);
+    size_t at0 = 0, at1 = 0, block0 = 30011, block1 = 997;
+    while (at0 < b.dev0.size() || at1 < b.dev1.size()) {
+        if (at0 < b.dev0.size()) {
+            size_t n = std::min(block0, b.dev0.size() - at0);
+            bitplane_from_samples(&b.dev0[at0], n, bp);
+            bp.firstSample = at0;
+            c.add(0, bp);
+            at0 += n;
+        }
+        if (at1 < b.dev1.size()) {
+            size_t n = std::min(block1, b.dev1.size() - at1);
+            bitplane_from_samples(&b.dev1[at1], n, bp);
+            bp.firstSample = at1;
+            c.add(1, bp);
+            at1 += n;
+            block1 = block1 * 13 % 4099 + 64;
+        }
+    }
+}
+
+SCENARIO( "Edge to edge latencies across two devices", "[correlate]" ) {
+
+    GIVEN( "An IRQ on one device answered by a chip select on another" ) {
+        TwoBoards boards = two_boards(120, 3);
+        TimingCorrelator c;
+        REQUIRE( c.addDevice(RATE0, 4) == 0 );
+        REQUIRE( c.addDevice(RATE1, 4, OFFSET1) == 1 );
+        TimingMeasurement irqToCs = { { 0, 3, EDGE_RISING }, { 1, 0, EDGE_FALLING }, 100000000, MATCH_OLDEST };
+        TimingMeasurement irqWidth = { { 0, 3, EDGE_RISING }, { 0, 3, EDGE_FALLING }, 100000000, MATCH_OLDEST };
+        REQUIRE( c.addMeasurement(irqToCs) == 0 );
+        REQUIRE( c.addMeasurement(irqWidth) == 1 );
+
+        WHEN( "both are fed at their own pace" ) {
+            feed(c, boards);
+
+            THEN( "nothing past the device that ends first is evaluated yet" ) {
+                REQUIRE( c.horizon() == std::min(to_ps(boards.dev0.size(), RATE0, 0),
+                                                 to_ps(boards.dev1.size(), RATE1, OFFSET1)) );
+                REQUIRE( c.dropped() == 0 );
+            }
+            THEN( "latencies match the times the edges were placed at" ) {
+                c.close(0);
+                c.close(1);
+                LatencySummary s = c.summary(0);
+                check_latencies(s, boards.latencies);
+                REQUIRE( s.missed == boards.unanswered );
+                REQUIRE( s.orphans == 0 );
+                check_latencies(c.summary(1), boards.widths);
+            }
+        }
+        WHEN( "device 1 lags further than the queues hold" ) {
+            TimingCorrelator small(64);
+            small.addDevice(RATE0, 4);
+            small.addDevice(RATE1, 4, OFFSET1);
+            small.addMeasurement(irqToCs);
+            Bitplanes bp(4);
+            bitplane_from_samples(boards.dev0.data(), boards.dev0.size(), bp);
+            bp.firstSample = 0;
+            small.add(0, bp);
+
+            THEN( "the oldest edges are dropped and counted" ) {
+                REQUIRE( small.dropped() == 2 * 120 - 64 );
+                REQUIRE( small.horizon() == 0 );
+            }
+        }
+    }
+
+    GIVEN( "Several requests in flight before the answers come" ) {
+        /* Starts at 0, 10, 20; ends at 25, 32, 41 on a second channel */
+        std::vector<uint16_t> samples(100, 0);
+        for (size_t s : { 0, 10, 20 }) {
+            samples[s + 1] |= 1;
+        }
+        for (size_t s : { 25, 32, 41 }) {
+            samples[s] |= 2;
+        }
+
+        for (int match = MATCH_OLDEST; match <= MATCH_NEWEST; match++) {
+            WHEN( "matching with policy " << match ) {
+                TimingCorrelator c;
+                c.addDevice(1000000000000ull, 2);
+                c.addMeasurement(TimingMeasurement{ { 0, 0, EDGE_RISING }, { 0, 1, EDGE_RISING }, 1000, (CorrelateMatch) match });
+                Bitplanes bp(2);
+                bitplane_from_samples(samples.data(), samples.size(), bp);
+                bp.firstSample = 0;
+                c.add(0, bp);
+                c.close(0);
+                LatencySummary s = c.summary(0);
+
+                THEN( "starts pair with ends by the policy" ) {
+                    if (match == MATCH_OLDEST) {
+                        /* 25-1, 32-11, 41-21 */
+                        REQUIRE( s.count == 3 );
+                        REQUIRE( s.min == 20 );
+                        REQUIRE( s.max == 24 );
+                        REQUIRE( s.missed == 0 );
+                        REQUIRE( s.orphans == 0 );
+                    } else {
+                        /* 25-21, then nothing left to answer */
+                        REQUIRE( s.count == 1 );
+                        REQUIRE( s.min == 4 );
+                        REQUIRE( s.missed == 2 );
+                        REQUIRE( s.orphans == 2 );
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "Devices placed earlier on the timeline", "[correlate]" ) {
+
+    GIVEN( "A second device with a negative offset" ) {
+        /* One sample per picosecond; device 1 started 30 ps before the timeline */
+        TimingCorrelator c;
+        c.addDevice(1000000000000ull, 1);
+        c.addDevice(1000000000000ull, 1, -30);
+        c.addMeasurement(TimingMeasurement{ { 0, 0, EDGE_RISING }, { 1, 0, EDGE_RISING }, 1000, MATCH_OLDEST });
+
+        THEN( "its times move back and clamp at the start" ) {
+            REQUIRE( c.time(1, 100) == 70 );
+            REQUIRE( c.time(1, 31) == 1 );
+            REQUIRE( c.time(1, 30) == 0 );
+            REQUIRE( c.time(1, 10) == 0 );
+        }
+
+        WHEN( "an edge on it answers one on the first device" ) {
+            std::vector<uint16_t> start(200, 0), answer(200, 0);
+            std::fill(start.begin() + 40, start.end(), 1);
+            std::fill(answer.begin() + 100, answer.end(), 1);
+            Bitplanes bp(1);
+            bitplane_from_samples(start.data(), start.size(), bp);
+            bp.firstSample = 0;
+            c.add(0, bp);
+            bitplane_from_samples(answer.data(), answer.size(), bp);
+            c.add(1, bp);
+            c.close(0);
+            c.close(1);
+            LatencySummary s = c.summary(0);
+
+            THEN( "the latency is measured on the common timeline" ) {
+                REQUIRE( s.count == 1 );
+                REQUIRE( s.min == 30 );
+                REQUIRE( s.orphans == 0 );
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "Timing correlator throughput", "[.][bench]" ) {
+    TwoBoards boards = two_boards(4000, 5);
+    TimingCorrelator c;
+    c.addDevice(RATE0, 4);
+    c.addDevice(RATE1, 4, OFFSET1);
+    c.addMeasurement(TimingMeasurement{ { 0, 3, EDGE_RISING }, { 1, 0, EDGE_FALLING }, 100000000, MATCH_OLDEST });
+    c.addMeasurement(TimingMeasurement{ { 0, 3, EDGE_RISING }, { 0, 3, EDGE_FALLING }, 100000000, MATCH_OLDEST });
+
+    auto t0 = std::chrono::steady_clock::now();
+    feed(c, boards);
+    c.close(0);
+    c.close(1);
+    auto t1 = std::chrono::steady_clock::now();
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    LatencySummary l = c.summary(0);
+    printf("correlate 2 devices  %7.1f Msamples/s  p50 %.2f us  p99 %.2f us  max %.2f us\n",
+           (boards.dev0.size() + boards.dev1.size()) / s / 1e6, l.p50 / 1e6, l.p99 / 1e6, l.max / 1e6);
+}
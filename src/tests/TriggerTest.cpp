@@ -0,0 +1,111 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "Trigger.h"
+
+static TriggerCondition condition(uint16_t levelMask, uint16_t levelValue, uint16_t riseMask, uint16_t fallMask) {
+    TriggerCondition c = { levelMask, levelValue, riseMask, fallMask, false, 0, 0 };
+    return c;
+}
+
+/* Feed samples in uneven slices so conditions straddle block boundaries */
+static std::vector<TriggerEvent> run(Trigger &trigger, const std::vector<uint16_t> &samples, size_t slice) {
+    std::vector<TriggerEvent> events;
+    for (size_t pos = 0; pos < samples.size(); pos += slice) {
+        size_t n = samples.size() - pos < slice ? samples.size() - pos : slice;
+        trigger.process(&samples[pos], n, events);
+    }
+    return events;
+}
+
+SCENARIO( "Trigger conditions", "[trigger]" ) {
+
+    GIVEN( "A capture with a bus value and a few edges" ) {
+        std::vector<uint16_t> samples(5000, 0x0002);
+        samples[1000] = 0x0005 | 0x0002;
+        for (size_t i = 777; i < 2000; i++) {
+            samples[i] |= 0x0008;
+        }
+        for (size_t i = 2500; i < 5000; i++) {
+            samples[i] &= ~0x0002;
+        }
+        /* Short then long pulse on channel 4 */
+        for (size_t i = 3000; i < 3005; i++) {
+            samples[i] |= 0x0010;
+        }
+        for (size_t i = 3600; i < 3612; i++) {
+            samples[i] |= 0x0010;
+        }
+
+        WHEN( "a level trigger is armed" ) {
+            Trigger trigger(100, 50);
+            trigger.addStage(condition(0x0005, 0x0005, 0, 0));
+            std::vector<TriggerEvent> events = run(trigger, samples, 100);
+
+            THEN( "it fires on the exact sample with its window" ) {
+                REQUIRE( events.size() == 1 );
+                REQUIRE( events[0].sample == 1000 );
+                REQUIRE( events[0].windowStart == 900 );
+                REQUIRE( events[0].windowEnd == 1051 );
+            }
+        }
+        WHEN( "a rising edge trigger is armed" ) {
+            Trigger trigger;
+            trigger.addStage(condition(0, 0, 0x0008, 0));
+            std::vector<TriggerEvent> events = run(trigger, samples, 37);
+
+            THEN( "it fires once on the edge" ) {
+                REQUIRE( events.size() == 1 );
+                REQUIRE( events[0].sample == 777 );
+            }
+        }
+        WHEN( "a two stage sequence is armed" ) {
+            Trigger trigger;
+            trigger.addStage(condition(0, 0, 0, 0x0008));
+            trigger.addStage(condition(0x0008, 0x0000, 0, 0x0002));
+            std::vector<TriggerEvent> events = run(trigger, samples, 64);
+
+            THEN( "it fires on the second stage after the first" ) {
+                REQUIRE( events.size() == 1 );
+                REQUIRE( events[0].sample == 2500 );
+                REQUIRE( trigger.stage() == 0 );
+            }
+        }
+        WHEN( "a pulse width trigger is armed" ) {
+            Trigger trigger;
+            TriggerCondition c = condition(0x0010, 0x0010, 0, 0);
+            c.pulse = true;
+            c.minWidth = 10;
+            c.maxWidth = 20;
+            trigger.addStage(c);
+            std::vector<TriggerEvent> events = run(trigger, samples, 50);
+
+            THEN( "only the long pulse fires, at its end" ) {
+                REQUIRE( events.size() == 1 );
+                REQUIRE( events[0].sample == 3612 );
+            }
+        }
+    }
+
+    GIVEN( "A repeating edge" ) {
+        std::vector<uint16_t> samples(1000);
+        for (size_t i = 0; i < samples.size(); i++) {
+            samples[i] = (i / 10) & 1;
+        }
+
+        WHEN( "the post window spans several edges" ) {
+            Trigger trigger(0, 45);
+            trigger.addStage(condition(0, 0, 0x0001, 0));
+            std::vector<TriggerEvent> events = run(trigger, samples, 1000);
+
+            THEN( "it re-arms only after the window" ) {
+                REQUIRE( events.size() == 17 );
+                REQUIRE( events[0].sample == 10 );
+                REQUIRE( events[1].sample == 70 );
+                REQUIRE( events[16].sample == 970 );
+            }
+        }
+    }
+}
@@ -0,0 +1,373 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "UartDecoder.h"
+#include "ParallelDecode.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <string>
+
+#define RATE 16000000
+
+/* Lines of up to 16 channels, idle high, frames drawn at fractional bit times */
+struct UartWave {
+    std::vector<uint16_t> samples;
+
+    explicit UartWave(size_t length) : samples(length, 0xffff) {}
+
+    void level(unsigned ch, double from, double to, bool high) {
+        size_t a = (size_t) std::max(0.0, ceil(from)), b = std::min(samples.size(), (size_t) ceil(to));
+        for (size_t i = a; i < b; i++) {
+            samples[i] = high ? samples[i] | 1 << ch : samples[i] & ~(1 << ch);
+        }
+    }
+    /* Returns where the frame ends */
+    double frame(unsigned ch, double at, uint32_t baud, const UartConfig &cfg, uint16_t data,
+                 bool badParity = false, bool badStop = false) {
+        double bit = (double) RATE / baud;
+        std::vector<bool> bits;
+        bits.push_back(false);
+        for (unsigned i = 0; i < cfg.dataBits; i++) {
+            bits.push_back((data >> i) & 1);
+        }
+        if (cfg.parity != UART_PARITY_NONE) {
+            bool odd = __builtin_popcount(data & ((1 << cfg.dataBits) - 1)) & 1;
+            bits.push_back((cfg.parity == UART_PARITY_ODD ? !odd : odd) ^ badParity);
+        }
+        for (unsigned i = 0; i < cfg.stopBits; i++) {
+            bits.push_back(!badStop);
+        }
+        for (size_t i = 0; i < bits.size(); i++) {
+            level(ch, at + i * bit, at + (i + 1) * bit, bits[i]);
+        }
+        return at + bits.size() * bit;
+    }
+    double text(unsigned ch, double at, uint32_t baud, const UartConfig &cfg, const std::string &s) {
+        for (char c : s) {
+            at = frame(ch, at, baud, cfg, (uint8_t) c);
+        }
+        return at;
+    }
+};
+
+static const UartConfig cfg8n1 = { 115200, 8, UART_PARITY_NONE, 1 };
+static const UartConfig cfg8e1 = { 3000000, 8, UART_PARITY_EVEN, 1 };
+static const UartConfig cfg7o2 = { 9600, 7, UART_PARITY_ODD, 2 };
+static const UartConfig cfgAuto = { 0, 8, UART_PARITY_NONE, 1 };
+
+static UartWave uart_session() {
+    UartWave w(120000);
+    w.text(0, 3000, 115200, cfg8n1, "Hello, world");
+
+    double at = 500;
+    for (unsigned i = 0; i < 64; i++) {
+        at = w.frame(1, at, 3000000, cfg8e1, i, i == 40);
+    }
+
+    at = 20000;
+    for (uint16_t v : { 0x41, 0x7f, 0x00 }) {
+        at = w.frame(2, at, 9600, cfg7o2, v) + 5000;
+    }
+
+    /* 0x55 gives single bit pulses to measure */
+    at = w.text(3, 2000, 1000000, cfgAuto, "UUUUUU");
+    w.text(3, at + 100, 1000000, cfgAuto, "abc");
+
+    /* Break for two frames, then a byte after idle */
+    w.level(4, 10000, 10000 + 20 * RATE / 115200.0, false);
+    w.frame(4, 40000, 115200, cfg8n1, 0x42);
+
+    /* Joined mid-stream: shifted frames are skipped until the gap */
+    at = -4 * (double) RATE / 115200;
+    for (int i = 0; i < 20; i++) {
+        at = w.frame(5, at, 115200, cfg8n1, 0xaa);
+    }
+    w.text(5, at + 2000, 115200, cfg8n1, "OK");
+
+    /* Stop bit low */
+    w.frame(6, 5000, 115200, cfg8n1, 0x33, false, true);
+    w.frame(6, 30000, 115200, cfg8n1, 0x34);
+    return w;
+}
+
+static UartDecoder *session_decoder(unsigned threads) {
+    UartDecoder *d = new UartDecoder(16, RATE, threads);
+    d->addChannel(0, cfg8n1);
+    d->addChannel(1, cfg8e1);
+    d->addChannel(2, cfg7o2);
+    d->addChannel(3, cfgAuto);
+    d->addChannel(4, cfg8n1);
+    d->addChannel(5, cfg8n1);
+    d->addChannel(6, cfg8n1);
+    return d;
+}
+
+static std::vector<UartEvent> decode_blocks(UartDecoder &d, const std::vector<uint16_t> &samples) {
+    std::vector<UartEvent> events;
+    Bitplanes bp(16);
+    size_t offset = 0, size = 777;
+    while (offset < samples.size()) {
+        size_t n = std::min(samples.size() - offset, size);
+        bitplane_from_samples(&samples[offset], n, bp);
+        bp.firstSample = offset;
+        d.decode(bp, events);
+        offset += n;
+        size = size * 3 % 20011 + 64;
+    }
+    d.flush(events);
+    return events;
+}
+
+static std::vector<UartEvent> on(const std::vector<UartEvent> &events, unsigned ch) {
+    std::vector<UartEvent> r;
+    for (auto &e : events) {
+        if (e.channel == ch) {
+            r.push_back(e);
+        }
+    }
+    return r;
+}
+
+static std::string text(const std::vector<UartEvent> &events) {
+    std::string s;
+    for (auto &e : events) {
+        s += (char) e.data;
+    }
+    return s;
+}
+
+SCENARIO( "UART channels decode from bit planes", "[uart]" ) {
+
+    GIVEN( "Seven lines with different settings, fed in odd sized blocks" ) {
+        UartWave w = uart_session();
+        std::unique_ptr<UartDecoder> d(session_decoder(1));
+        std::vector<UartEvent> events = decode_blocks(*d, w.samples);
+
+        THEN( "events are in sample order" ) {
+            for (size_t i = 1; i < events.size(); i++) {
+                REQUIRE( events[i - 1].sample <= events[i].sample );
+            }
+        }
+        THEN( "configured channels give their bytes with start bit timestamps" ) {
+            std::vector<UartEvent> e0 = on(events, 0);
+            REQUIRE( text(e0) == "Hello, world" );
+            REQUIRE( e0[0].sample == 3000 );
+            REQUIRE( e0[0].flags == 0 );
+
+            std::vector<UartEvent> e1 = on(events, 1);
+            REQUIRE( e1.size() == 64 );
+            for (unsigned i = 0; i < 64; i++) {
+                INFO( "byte " << i );
+                REQUIRE( e1[i].data == i );
+                REQUIRE( e1[i].flags == (i == 40 ? UART_FLAG_PARITY : 0) );
+            }
+
+            std::vector<UartEvent> e2 = on(events, 2);
+            REQUIRE( e2.size() == 3 );
+            REQUIRE( e2[0].data == 0x41 );
+            REQUIRE( e2[1].data == 0x7f );
+            REQUIRE( e2[2].data == 0x00 );
+            REQUIRE( e2[2].flags == 0 );
+        }
+        THEN( "the auto-baud channel locks to the standard rate" ) {
+            REQUIRE( d->baud(3) == 1000000 );
+            std::string s = text(on(events, 3));
+            REQUIRE( s.size() >= 3 );
+            REQUIRE( s.substr(s.size() - 3) == "abc" );
+        }
+        THEN( "a break is flagged and decoding resumes after idle" ) {
+            std::vector<UartEvent> e4 = on(events, 4);
+            REQUIRE( e4.size() == 2 );
+            REQUIRE( e4[0].flags == (UART_FLAG_BREAK | UART_FLAG_FRAMING) );
+            REQUIRE( e4[1].data == 0x42 );
+            REQUIRE( e4[1].flags == 0 );
+        }
+        THEN( "a line joined mid-stream syncs on the first gap" ) {
+            REQUIRE( text(on(events, 5)) == "OK" );
+        }
+        THEN( "a low stop bit is a framing error" ) {
+            std::vector<UartEvent> e6 = on(events, 6);
+            REQUIRE( e6.size() == 2 );
+            REQUIRE( e6[0].data == 0x33 );
+            REQUIRE( e6[0].flags == UART_FLAG_FRAMING );
+            REQUIRE( e6[1].data == 0x34 );
+            REQUIRE( e6[1].flags == 0 );
+        }
+
+        WHEN( "the channels are decoded on several threads" ) {
+            std::unique_ptr<UartDecoder> p(session_decoder(3));
+            std::vector<UartEvent> parallel = decode_blocks(*p, w.samples);
+
+            THEN( "the events are the same" ) {
+                REQUIRE( parallel.size() == events.size() );
+                for (size_t i = 0; i < events.size(); i++) {
+                    REQUIRE( parallel[i].sample == events[i].sample );
+                    REQUIRE( parallel[i].channel == events[i].channel );
+                    REQUIRE( parallel[i].data == events[i].data );
+                }
+            }
+        }
+    }
+}
+
+SCENARIO( "UART decoding plugs into the capture callback path", "[uart]" ) {
+
+    GIVEN( "A Logic16 stream of eight channels" ) {
+        UartWave w(16 * 4096);
+        w.text(2, 2000, 115200, cfg8n1, "packets");
+        std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+
+        WHEN( "packets are processed as they arrive" ) {
+            UartDecoder d(8, RATE);
+            d.addChannel(2, cfg8n1);
+            std::string s;
+            for (size_t offset = 0; offset < raw.size(); offset += 16 * 50) {
+                size_t size = std::min(raw.size() - offset, (size_t) 16 * 50);
+                sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset };
+                d.process(&packet);
+                s += text(d.events());
+            }
+
+            THEN( "the text comes out" ) {
+                REQUIRE( s == "packets" );
+            }
+        }
+    }
+}
+
+SCENARIO( "UART decodes a stored capture in parallel chunks", "[uart][paralleldecode]" ) {
+
+    GIVEN( "Bursts of frames with random gaps on three lines" ) {
+        const UartConfig cfg8n1fast = { 1000000, 8, UART_PARITY_NONE, 1 };
+        const UartConfig cfgs[3] = { cfg8n1, cfg8e1, cfg8n1fast };
+        UartWave w(2000000);
+        std::mt19937 rng(5);
+        for (unsigned ch = 0; ch < 3; ch++) {
+            double at = rng() % 1000;
+            while (at + 20000 < w.samples.size()) {
+                for (unsigned n = 1 + rng() % 6; n > 0; n--) {
+                    at = w.frame(ch, at, cfgs[ch].baud, cfgs[ch], (uint16_t) rng(), false, rng() % 16 == 0);
+                }
+                at += 200 + rng() % 20000;
+            }
+        }
+
+        UartDecoder d(16, RATE);
+        for (unsigned ch = 0; ch < 3; ch++) {
+            d.addChannel(ch, cfgs[ch]);
+        }
+        std::vector<UartEvent> expect = decode_blocks(d, w.samples);
+        Bitplanes bp(16);
+        bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+        bp.firstSample = 0;
+
+        WHEN( "chunks are decoded on four threads" ) {
+            ParallelDecodeStats stats;
+            std::vector<UartEvent> events = parallel_decode(d, bp, 4, 50000, &stats);
+
+            THEN( "the events match a sequential decode and every resync guess holds" ) {
+                REQUIRE( stats.chunks == 40 );
+                REQUIRE( stats.redecoded == 0 );
+                REQUIRE( expect.size() > 1000 );
+                REQUIRE( std::count_if(expect.begin(), expect.end(), [](const UartEvent &e) {
+                    return e.flags & UART_FLAG_FRAMING;
+                }) > 10 );
+                REQUIRE( events.size() == expect.size() );
+                for (size_t i = 0; i < events.size(); i++) {
+                    INFO( "event " << i );
+                    REQUIRE( events[i].sample == expect[i].sample );
+                    REQUIRE( events[i].channel == expect[i].channel );
+                    REQUIRE( events[i].data == expect[i].data );
+                    REQUIRE( events[i].flags == expect[i].flags );
+                }
+            }
+        }
+    }
+}
+
+/* Per-sample state machine on interleaved words, what the decoder replaces */
+static size_t naive_uart(const std::vector<uint16_t> &samples, unsigned channels, double bit) {
+    struct State { bool prev; bool in; uint64_t start; unsigned n; uint64_t mid; uint16_t data; } st[16];
+    size_t count = 0;
+    for (unsigned ch = 0; ch < channels; ch++) {
+        st[ch] = { true, false, 0, 0, 0, 0 };
+    }
+    for (size_t s = 0; s < samples.size(); s++) {
+        for (unsigned ch = 0; ch < channels; ch++) {
+            State &c = st[ch];
+            bool v = (samples[s] >> ch) & 1;
+            if (!c.in) {
+                if (c.prev && !v) {
+                    c.in = true;
+                    c.start = s;
+                    c.n = 0;
+                    c.data = 0;
+                    c.mid = s + (uint64_t) (bit / 2);
+                }
+            } else if (s == c.mid) {
+                c.data |= v << c.n;
+                if (++c.n == 10) {
+                    c.in = false;
+                    count++;
+                }
+                c.mid = c.start + (uint64_t) ((2 * c.n + 1) * bit / 2);
+            }
+            c.prev = v;
+        }
+    }
+    return count;
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "UART decoder throughput", "[.][bench]" ) {
+    const UartConfig cfg = { 3000000, 8, UART_PARITY_NONE, 1 };
+    const size_t block = 160256 / 2;
+
+    /* Bursts of 16 bytes on eight lines, back to back and then mostly idle */
+    for (double period : { 1600.0, 160000.0 }) {
+        UartWave w(32u << 20);
+        for (unsigned ch = 0; ch < 8; ch++) {
+            for (double at = 1000 + ch * 37; at + 2000 < w.samples.size(); at += period) {
+                double t = at;
+                for (unsigned i = 0; i < 16; i++) {
+                    t = w.frame(ch, t, 3000000, cfg, (uint8_t) (i * 13 + ch));
+                }
+            }
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        size_t naive = naive_uart(w.samples, 8, (double) RATE / 3000000);
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        printf("UART burst every %6.0f samples\n", period);
+        printf("  naive             %7.1f Msamples/s  %zu frames\n", w.samples.size() / s / 1e6, naive);
+
+        Bitplanes bp(8);
+        std::vector<UartEvent> events;
+        for (unsigned threads : { 1, 4 }) {
+            UartDecoder d(8, RATE, threads);
+            for (unsigned ch = 0; ch < 8; ch++) {
+                d.addChannel(ch, cfg);
+            }
+            size_t total = 0;
+            double decode = 0;
+            for (size_t offset = 0; offset < w.samples.size(); offset += block) {
+                size_t n = std::min(block, w.samples.size() - offset);
+                bitplane_from_samples(&w.samples[offset], n, bp);
+                bp.firstSample = offset;
+                events.clear();
+                auto a = std::chrono::steady_clock::now();
+                total += d.decode(bp, events);
+                decode += std::chrono::duration<double>(std::chrono::steady_clock::now() - a).count();
+            }
+            total += d.flush(events);
+            printf("  planes %u threads  %7.1f Msamples/s  %zu frames\n", threads, w.samples.size() / decode / 1e6, total);
+            REQUIRE( total == naive );
+        }
+    }
+}
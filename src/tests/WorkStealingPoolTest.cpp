@@ -0,0 +1,82 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "WorkStealingPool.h"
+#include <chrono>
+
+SCENARIO( "WorkStealingPool keeps streams in order", "[pool]" ) {
+
+    GIVEN( "Four streams on three workers" ) {
+        TransferObjectPool pool(64, 16);
+        WorkStealingPool workers(3);
+        uint64_t expect[4] = { 0, 0, 0, 0 };
+        bool inOrder[4] = { true, true, true, true };
+        std::atomic<int> worked(0);
+
+        for (int i = 0; i < 4; i++) {
+            workers.addStream([&](PacketHandle &p) {
+                /* Uneven chunks so they finish out of order */
+                std::this_thread::sleep_for(std::chrono::microseconds((p->sample * 37) % 200));
+                p->size = 1;
+                worked++;
+            }, [&, i](PacketHandle &p) {
+                inOrder[i] = inOrder[i] && p->size == 1 && p->sample == expect[i]++;
+            });
+        }
+
+        WHEN( "chunks are submitted round robin" ) {
+            for (uint64_t n = 0; n < 100; n++) {
+                for (int s = 0; s < 4; s++) {
+                    for (;;) {
+                        PacketHandle h = pool.acquire();
+                        if (h) {
+                            h->sample = n;
+                            REQUIRE( workers.submit(s, std::move(h)) );
+                            break;
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            workers.wait();
+
+            THEN( "every stream commits in order and buffers go back to the pool" ) {
+                REQUIRE( worked == 400 );
+                for (int s = 0; s < 4; s++) {
+                    REQUIRE( inOrder[s] );
+                    REQUIRE( expect[s] == 100 );
+                }
+                REQUIRE( pool.available() == 64 );
+            }
+        }
+    }
+
+    GIVEN( "One busy stream" ) {
+        TransferObjectPool pool(32, 16);
+        WorkStealingPool workers(3);
+        uint64_t committed = 0;
+        int s = workers.addStream([](PacketHandle &) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }, [&](PacketHandle &p) {
+            committed += p->sample == committed;
+        }, 32);
+
+        WHEN( "its chunks pile up on one worker" ) {
+            for (uint64_t n = 0; n < 32; n++) {
+                PacketHandle h = pool.acquire();
+                h->sample = n;
+                REQUIRE( workers.submit(s, std::move(h)) );
+            }
+
+            THEN( "the window is enforced and idle workers steal" ) {
+                REQUIRE_FALSE( workers.submit(s, pool.acquire()) );
+                workers.wait();
+                REQUIRE( committed == 32 );
+                REQUIRE( workers.stolen() > 0 );
+                REQUIRE( pool.available() == 32 );
+            }
+        }
+    }
+}
@@ -0,0 +1,329 @@
+//
+// Created by kape on 10/19/26.
+//
+
+#include "catch.hpp"
+#include "xble_trace.h"
+#include "Logic16.h"
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLE_RX_CLK  0
+#define BLE_RX_DATA 1
+#define BLE_TX_EN   2
+#define BLE_TX_DATA 3
+
+#define BLE_AA       0x50654c1du
+#define BLE_CRC_INIT 0x123456u
+
+/* Bit by bit as drawn in the core spec, independent of the tables */
+static uint32_t ref_crc(uint32_t init, const uint8_t *data, size_t length) {
+    uint8_t pos[24];
+    for (int j = 0; j < 24; j++) {
+        pos[j] = (init >> j) & 1;
+    }
+    for (size_t i = 0; i < length * 8; i++) {
+        uint8_t fb = pos[23] ^ ((data[i / 8] >> (i % 8)) & 1);
+        for (int j = 23; j > 0; j--) {
+            pos[j] = pos[j - 1];
+        }
+        pos[0] = fb;
+        pos[1] ^= fb; pos[3] ^= fb; pos[4] ^= fb; pos[6] ^= fb; pos[9] ^= fb; pos[10] ^= fb;
+    }
+    /* Sent from position 23 down */
+    uint32_t crc = 0;
+    for (int k = 0; k < 24; k++) {
+        crc |= (uint32_t) pos[23 - k] << k;
+    }
+    return crc;
+}
+
+static void ref_whiten(uint8_t *data, size_t length, unsigned channel) {
+    uint8_t pos[7];
+    pos[0] = 1;
+    for (int k = 1; k < 7; k++) {
+        pos[k] = (channel >> (6 - k)) & 1;
+    }
+    for (size_t i = 0; i < length * 8; i++) {
+        uint8_t out = pos[6];
+        data[i / 8] ^= out << (i % 8);
+        pos[6] = pos[5]; pos[5] = pos[4]; pos[4] = pos[3] ^ out;
+        pos[3] = pos[2]; pos[2] = pos[1]; pos[1] = pos[0]; pos[0] = out;
+    }
+}
+
+/* Preamble, access address and the whitened PDU with CRC */
+static std::vector<uint8_t> air(uint32_t aa, uint32_t crcInit, unsigned channel, uint8_t header,
+                                const std::vector<uint8_t> &payload, bool corrupt = false) {
+    std::vector<uint8_t> pdu = { header, (uint8_t) payload.size() };
+    pdu.insert(pdu.end(), payload.begin(), payload.end());
+    uint32_t crc = ref_crc(crcInit, pdu.data(), pdu.size());
+    pdu.push_back(crc & 0xff);
+    pdu.push_back((crc >> 8) & 0xff);
+    pdu.push_back(crc >> 16);
+    if (corrupt) {
+        pdu[2] ^= 0x10;
+    }
+    ref_whiten(pdu.data(), pdu.size(), channel);
+
+    std::vector<uint8_t> bytes = { (uint8_t) (aa & 1 ? 0x55 : 0xaa),
+                                   (uint8_t) aa, (uint8_t) (aa >> 8), (uint8_t) (aa >> 16), (uint8_t) (aa >> 24) };
+    bytes.insert(bytes.end(), pdu.begin(), pdu.end());
+    return bytes;
+}
+
+/* Radio debug port at 16 samples per bit: RX as clock and data, TX as enable and data */
+struct BleWave {
+    std::vector<uint16_t> samples;
+
+    void until(size_t sample) {
+        samples.resize(std::max(samples.size(), sample), 0xf0);
+    }
+    void rx(size_t at, const std::vector<uint8_t> &bytes) {
+        until(at);
+        for (size_t i = 0; i < bytes.size() * 8; i++) {
+            uint16_t data = ((bytes[i / 8] >> (i % 8)) & 1) << BLE_RX_DATA;
+            samples.insert(samples.end(), 8, 0xf0 | data);
+            samples.insert(samples.end(), 8, 0xf0 | data | 1 << BLE_RX_CLK);
+        }
+    }
+    void tx(size_t at, const std::vector<uint8_t> &bytes) {
+        until(at);
+        for (size_t i = 0; i < bytes.size() * 8; i++) {
+            uint16_t data = ((bytes[i / 8] >> (i % 8)) & 1) << BLE_TX_DATA;
+            samples.insert(samples.end(), 16, 0xf0 | data | 1 << BLE_TX_EN);
+        }
+        samples.push_back(0xf0);
+    }
+    void pad() {
+        until((samples.size() + 2048) & ~(size_t) 15);
+    }
+};
+
+#define BLE_FIRST_EVENT 60000
+#define BLE_INTERVAL    120000
+
+/* Channel selection #1 worked by hand: hop 7, map 10..34 and 36 from event 4 */
+static const unsigned event_channels[] = { 7, 14, 21, 28, 19, 15 };
+
+static std::vector<uint8_t> connect_ind() {
+    std::vector<uint8_t> p = {
+        0x11, 0x22, 0x33, 0x44, 0x55, 0x66,             /* InitA */
+        0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6,             /* AdvA */
+        (uint8_t) BLE_AA, (uint8_t) (BLE_AA >> 8), (uint8_t) (BLE_AA >> 16), (uint8_t) (BLE_AA >> 24),
+        (uint8_t) BLE_CRC_INIT, (uint8_t) (BLE_CRC_INIT >> 8), (uint8_t) (BLE_CRC_INIT >> 16),
+        2,                                              /* WinSize */
+        0, 0,                                           /* WinOffset */
+        6, 0,                                           /* Interval, 7.5 ms */
+        0, 0,                                           /* Latency */
+        100, 0,                                         /* Timeout, 1 s */
+        0xff, 0xff, 0xff, 0xff, 0x1f,                   /* all data channels */
+        7 | 0x20                                        /* hop, SCA */
+    };
+    return p;
+}
+
+static BleWave ble_session() {
+    BleWave w;
+    std::vector<uint8_t> adv = { 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0x02, 0x01, 0x06 };
+    w.tx(1000, air(XBLE_ADV_ACCESS_ADDRESS, XBLE_ADV_CRC_INIT, 37, XBLE_ADV_IND, adv));
+    w.rx(20000, air(XBLE_ADV_ACCESS_ADDRESS, XBLE_ADV_CRC_INIT, 37, XBLE_CONNECT_IND, connect_ind()));
+
+    for (unsigned e = 0; e < 6; e++) {
+        unsigned ch = event_channels[e];
+        size_t at = BLE_FIRST_EVENT + e * BLE_INTERVAL;
+        std::vector<uint8_t> none;
+        switch (e) {
+            case 2:
+                /* Drop 0..9 and 35 at event 4 */
+                w.tx(at, air(BLE_AA, BLE_CRC_INIT, ch, XBLE_LLID_CONTROL,
+                             { XBLE_LL_CHANNEL_MAP_IND, 0x00, 0xfc, 0xff, 0xff, 0x17, 4, 0 }));
+                break;
+            case 5:
+                w.tx(at, air(BLE_AA, BLE_CRC_INIT, ch, XBLE_LLID_CONTROL, { XBLE_LL_TERMINATE_IND, 0x13 }));
+                break;
+            default:
+                w.tx(at, air(BLE_AA, BLE_CRC_INIT, ch, 0x01, none));
+        }
+        /* The slave answers with data at event 0, a bad CRC at event 3 */
+        std::vector<uint8_t> data = { 'h', 'e', 'l', 'l', 'o' };
+        w.rx(at + 4000, air(BLE_AA, BLE_CRC_INIT, ch, e == 0 ? 0x02 : 0x01, e == 0 ? data : none, e == 3));
+    }
+    w.pad();
+    return w;
+}
+
+SCENARIO( "CRC and whitening match the bitwise definitions", "[xble]" ) {
+
+    GIVEN( "Random PDUs" ) {
+        srand(7);
+        uint8_t a[64], b[64];
+        for (int n = 0; n < 100; n++) {
+            size_t length = 2 + rand() % 60;
+            unsigned channel = rand() % XBLE_CHANNELS;
+            uint32_t init = rand() & 0xffffff;
+            for (size_t i = 0; i < length; i++) {
+                a[i] = b[i] = (uint8_t) rand();
+            }
+            REQUIRE( xble_crc24(init, a, length) == ref_crc(init, a, length) );
+            xble_whiten(a, length, channel);
+            ref_whiten(b, length, channel);
+            REQUIRE( memcmp(a, b, length) == 0 );
+        }
+    }
+}
+
+SCENARIO( "A connection is followed from CONNECT_IND to LL_TERMINATE_IND", "[xble]" ) {
+
+    GIVEN( "Advertising, a connection, a channel map update and a terminate" ) {
+        BleWave w = ble_session();
+        std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+
+        WHEN( "Logic16 packets of odd sizes go through the trace stage to a file" ) {
+            XbleTrace trace(8, BLE_RX_CLK, BLE_RX_DATA, BLE_TX_EN, BLE_TX_DATA);
+            const char *path = "/tmp/ttt_xble_test.ble";
+            REQUIRE( trace.open(path) );
+
+            size_t offset = 0, blocks = 1;
+            size_t connectionsAfterConnect = 0;
+            while (offset < raw.size()) {
+                size_t size = std::min(raw.size() - offset, blocks * 16);
+                sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) size, NULL, offset };
+                trace.process(&packet);
+                if (offset < BLE_FIRST_EVENT) {
+                    connectionsAfterConnect = trace.links().connections();
+                }
+                offset += size;
+                blocks = blocks * 5 % 1021 + 1;
+            }
+            REQUIRE( trace.close() );
+            std::vector<XblePdu> pdus;
+            REQUIRE( xble_trace_load(path, pdus) );
+            remove(path);
+
+            THEN( "every packet decodes on the hand worked channel" ) {
+                REQUIRE( connectionsAfterConnect == 1 );
+                REQUIRE( trace.total() == 13 );
+                REQUIRE( pdus.size() == 13 );
+
+                REQUIRE( xble_advertising(pdus[0]) );
+                REQUIRE( pdus[0].direction == XBLE_TX );
+                REQUIRE( pdus[0].channel == 37 );
+                REQUIRE( pdus[0].sample == 1000 + 8 * 16 );
+                REQUIRE( pdus[0].flags == XBLE_FLAG_CRC_OK );
+                REQUIRE( (pdus[1].header & 0x0f) == XBLE_CONNECT_IND );
+                REQUIRE( pdus[1].direction == XBLE_RX );
+                REQUIRE( pdus[1].length == 34 );
+
+                for (unsigned e = 0; e < 6; e++) {
+                    for (unsigned k = 0; k < 2 && 2 + e * 2 + k < pdus.size(); k++) {
+                        const XblePdu &p = pdus[2 + e * 2 + k];
+                        INFO( "event " << e << " packet " << k );
+                        REQUIRE( p.accessAddress == BLE_AA );
+                        REQUIRE( p.event == e );
+                        REQUIRE( p.channel == event_channels[e] );
+                        REQUIRE( p.direction == (k ? XBLE_RX : XBLE_TX) );
+                        REQUIRE( p.flags == (e == 3 && k ? 0 : XBLE_FLAG_CRC_OK) );
+                    }
+                }
+                REQUIRE( pdus[3].length == 5 );
+                REQUIRE( memcmp(pdus[3].payload, "hello", 5) == 0 );
+                REQUIRE( trace.decoder().misses() == 0 );
+            }
+            THEN( "the terminate ends the connection" ) {
+                REQUIRE( pdus.back().payload[0] == XBLE_LL_TERMINATE_IND );
+                REQUIRE( trace.links().connections() == 0 );
+            }
+        }
+        WHEN( "the PDU file is on a full device" ) {
+            XbleTrace trace(8, BLE_RX_CLK, BLE_RX_DATA, BLE_TX_EN, BLE_TX_DATA);
+            REQUIRE( trace.open("/dev/full") );
+            sr_wrap_packet_t packet = { 0, raw.data(), (ssize_t) raw.size(), NULL, 0 };
+            trace.process(&packet);
+
+            THEN( "close reports the lost PDUs and the failure stays latched" ) {
+                REQUIRE( trace.total() == 13 );
+                REQUIRE_FALSE( trace.close() );
+                REQUIRE( trace.writeFailed() );
+            }
+        }
+    }
+}
+
+SCENARIO( "Connections expire and cut bursts report truncation", "[xble]" ) {
+
+    GIVEN( "A tracker that saw a CONNECT_IND" ) {
+        BleWave w;
+        w.rx(100, air(XBLE_ADV_ACCESS_ADDRESS, XBLE_ADV_CRC_INIT, 38, XBLE_CONNECT_IND, connect_ind()));
+        /* A connection packet cut off within its payload */
+        std::vector<uint8_t> cut = air(BLE_AA, BLE_CRC_INIT, 7, 0x02, std::vector<uint8_t>(20, 0x5a));
+        cut.resize(cut.size() - 10);
+        w.tx(40000, cut);
+        w.pad();
+
+        Bitplanes bp(16);
+        bitplane_from_samples(w.samples.data(), w.samples.size(), bp);
+        bp.firstSample = 0;
+        XbleRxSampler rx(BLE_RX_CLK, BLE_RX_DATA, 64);
+        XbleTxSampler tx(BLE_TX_EN, BLE_TX_DATA, 16000000);
+        std::vector<XbleBurst> bursts;
+        rx.sample(bp, bursts);
+        tx.sample(bp, bursts);
+        REQUIRE( bursts.size() == 2 );
+
+        XbleLinkTracker links(16000000);
+        XbleDecoder decoder(links);
+        XblePdu pdu;
+        REQUIRE( decoder.decode(bursts[0], pdu) );
+        REQUIRE( pdu.channel == 38 );
+        REQUIRE( links.connections() == 1 );
+
+        WHEN( "the cut packet is decoded" ) {
+            REQUIRE( decoder.decode(bursts[1], pdu) );
+
+            THEN( "it is flagged, not taken for a good one" ) {
+                REQUIRE( pdu.flags == XBLE_FLAG_TRUNCATED );
+                REQUIRE( pdu.length == 20 );
+                REQUIRE( pdu.channel == 7 );
+            }
+        }
+
+        WHEN( "nothing is heard for longer than the supervision timeout" ) {
+            links.expire(100 + 16000000);
+            size_t within = links.connections();
+            links.expire(100 + 16000000 + 2000);
+
+            THEN( "the connection is dropped" ) {
+                REQUIRE( within == 1 );
+                REQUIRE( links.connections() == 0 );
+            }
+        }
+    }
+}
+
+/* Hidden, run with: tst "[bench]" */
+TEST_CASE( "BLE trace throughput", "[.][bench]" ) {
+    BleWave w;
+    std::vector<uint8_t> adv(31);
+    for (unsigned n = 0; w.samples.size() < (16u << 20); n++) {
+        adv[0] = (uint8_t) n;
+        w.tx(w.samples.size() + 500, air(XBLE_ADV_ACCESS_ADDRESS, XBLE_ADV_CRC_INIT, 37 + n % 3, XBLE_ADV_IND, adv));
+        w.rx(w.samples.size() + 2400, air(XBLE_ADV_ACCESS_ADDRESS, XBLE_ADV_CRC_INIT, 37 + n % 3, XBLE_SCAN_RSP, adv));
+    }
+    w.pad();
+    std::vector<uint8_t> raw = to_logic16(w.samples, 8);
+    XbleTrace trace(8, BLE_RX_CLK, BLE_RX_DATA, BLE_TX_EN, BLE_TX_DATA);
+    const size_t packetSize = 160256;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset + packetSize <= raw.size(); offset += packetSize) {
+        sr_wrap_packet_t packet = { 0, &raw[offset], (ssize_t) packetSize, NULL, offset };
+        trace.process(&packet);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    printf("BLE trace   %7.1f Msamples/s  %llu PDUs\n", w.samples.size() / s / 1e6,
+           (unsigned long long) trace.total());
+}